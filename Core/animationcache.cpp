@@ -0,0 +1,328 @@
+#include "animationcache.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#include <quat.h>
+
+#include "sketchobject.h"
+
+// how far (in frames) a time may be from a frame and still be that frame
+#define FRAME_TOLERANCE 1e-6
+
+// the bits of Sample::flags
+#define SAMPLE_ANIMATED 0x1
+#define SAMPLE_VISIBLE 0x2
+#define SAMPLE_ACTIVE 0x4
+#define SAMPLE_SET_COLOR_MAP 0x8
+#define SAMPLE_SET_SOLID_COLOR 0x10
+
+AnimationCache::AnimationCache()
+    : frameRate(0.0),
+      numFrames(0),
+      numCachedFrames(0),
+      maxMemorySize(DEFAULT_ANIMATION_CACHE_MAX_SIZE),
+      samples(),
+      columns(),
+      revisions(),
+      filled(),
+      columnOf(),
+      colorMaps(),
+      colorMapIds()
+{
+}
+
+QVector< int > AnimationCache::layOut(const QVector< SketchObject * > &objects,
+                                      double rate, int frames)
+{
+    assert(rate > 0.0 && frames >= 0);
+    int numColumns = objects.size();
+    // past the memory limit only the first frames are kept
+    int cachedFrames = frames;
+    if (numColumns > 0)
+    {
+        qint64 fit = maxMemorySize /
+                (qint64(numColumns) * qint64(sizeof(Sample)));
+        cachedFrames = static_cast< int >(qMin(qint64(frames), fit));
+    }
+    bool sameFrames = (rate == frameRate && frames == numFrames &&
+                       cachedFrames == numCachedFrames);
+    QVector< int > stale;
+    if (sameFrames && objects == columns)
+    {
+        // same layout, only the changed objects need to be redone
+        for (int c = 0; c < numColumns; c++)
+        {
+            quint64 revision = columns[c]->getKeyframeRevision();
+            if (revisions[c] != revision)
+            {
+                revisions[c] = revision;
+                filled[c] = 0;
+                // frames where the object has no state must not keep the
+                // old samples
+                for (int f = 0; f < numCachedFrames; f++)
+                {
+                    samples[f * numColumns + c].flags = 0;
+                }
+            }
+            if (filled[c] < numCachedFrames)
+            {
+                stale.append(c);
+            }
+        }
+        return stale;
+    }
+    QVector< Sample > newSamples(cachedFrames * numColumns);
+    QVector< quint64 > newRevisions(numColumns);
+    QVector< int > newFilled(numColumns, 0);
+    QHash< SketchObject *, int > newColumnOf;
+    for (int c = 0; c < numColumns; c++)
+    {
+        SketchObject *obj = objects[c];
+        newColumnOf.insert(obj, c);
+        newRevisions[c] = obj->getKeyframeRevision();
+        int old = columnOf.value(obj, -1);
+        if (sameFrames && old >= 0 && revisions[old] == newRevisions[c])
+        {
+            for (int f = 0; f < filled[old]; f++)
+            {
+                newSamples[f * numColumns + c] =
+                        samples[f * columns.size() + old];
+            }
+            newFilled[c] = filled[old];
+        }
+        if (newFilled[c] < cachedFrames)
+        {
+            stale.append(c);
+        }
+    }
+    frameRate = rate;
+    numFrames = frames;
+    numCachedFrames = cachedFrames;
+    samples = newSamples;
+    columns = objects;
+    revisions = newRevisions;
+    filled = newFilled;
+    columnOf = newColumnOf;
+    return stale;
+}
+
+void AnimationCache::store(int frame, int column,
+                           const AnimationState &state)
+{
+    assert(frame >= 0 && frame < numCachedFrames);
+    assert(column >= 0 && column < columns.size());
+    Sample &s = samples[frame * columns.size() + column];
+    memcpy(s.position, state.position, sizeof(s.position));
+    memcpy(s.orientation, state.orientation, sizeof(s.orientation));
+    s.flags = SAMPLE_ANIMATED;
+    if (state.visible)
+    {
+        s.flags |= SAMPLE_VISIBLE;
+    }
+    if (state.active)
+    {
+        s.flags |= SAMPLE_ACTIVE;
+    }
+    s.colorMap = -1;
+    if (state.colorChange == AnimationState::SET_COLOR_MAP)
+    {
+        s.flags |= SAMPLE_SET_COLOR_MAP;
+        s.colorMap = internColorMap(state.colorMap);
+    }
+    else if (state.colorChange == AnimationState::SET_SOLID_COLOR)
+    {
+        s.flags |= SAMPLE_SET_SOLID_COLOR;
+        for (int i = 0; i < 3; i++)
+        {
+            s.solidColor[i] = static_cast< float >(state.solidColor[i]);
+        }
+    }
+}
+
+void AnimationCache::setFilled(int column, int numFilled)
+{
+    assert(numFilled >= 0 && numFilled <= numCachedFrames);
+    filled[column] = numFilled;
+}
+
+int AnimationCache::getFilledFrames(int column) const
+{
+    return filled[column];
+}
+
+int AnimationCache::getFrameAt(double t) const
+{
+    if (numFrames == 0)
+    {
+        return -1;
+    }
+    double f = t * frameRate;
+    double nearest = floor(f + 0.5);
+    if (fabs(f - nearest) > FRAME_TOLERANCE || nearest < 0 ||
+            nearest >= numFrames)
+    {
+        return -1;
+    }
+    return static_cast< int >(nearest);
+}
+
+bool AnimationCache::load(int frame, SketchObject *obj,
+                          AnimationState &state) const
+{
+    if (frame < 0 || frame >= numCachedFrames)
+    {
+        return false;
+    }
+    int column = columnOf.value(obj, -1);
+    if (column < 0 || revisions[column] != obj->getKeyframeRevision() ||
+            frame >= filled[column])
+    {
+        return false;
+    }
+    const Sample &s = samples[frame * columns.size() + column];
+    if (!(s.flags & SAMPLE_ANIMATED))
+    {
+        return false;
+    }
+    memcpy(state.position, s.position, sizeof(s.position));
+    memcpy(state.orientation, s.orientation, sizeof(s.orientation));
+    state.visible = (s.flags & SAMPLE_VISIBLE) != 0;
+    state.active = (s.flags & SAMPLE_ACTIVE) != 0;
+    if (s.flags & SAMPLE_SET_COLOR_MAP)
+    {
+        state.colorChange = AnimationState::SET_COLOR_MAP;
+        state.colorMap = colorMaps[s.colorMap];
+    }
+    else if (s.flags & SAMPLE_SET_SOLID_COLOR)
+    {
+        state.colorChange = AnimationState::SET_SOLID_COLOR;
+        for (int i = 0; i < 3; i++)
+        {
+            state.solidColor[i] = s.solidColor[i];
+        }
+    }
+    else
+    {
+        state.colorChange = AnimationState::KEEP_COLOR;
+    }
+    return true;
+}
+
+bool AnimationCache::loadBetween(double t, SketchObject *obj,
+                                 AnimationState &state) const
+{
+    if (numFrames == 0 || !obj->hasKeyframes())
+    {
+        return false;
+    }
+    double f = t * frameRate;
+    int frame = static_cast< int >(floor(f));
+    if (frame < 0 || frame + 1 >= numCachedFrames)
+    {
+        return false;
+    }
+    // both frames must be strictly inside the same stretch between two
+    // keyframes
+    KeyframeSpan span = obj->findKeyframesAround(t);
+    if (span.after == -1 || span.after == span.before ||
+            span.beforeTime >= frame / frameRate ||
+            span.afterTime <= (frame + 1) / frameRate)
+    {
+        return false;
+    }
+    AnimationState next;
+    if (!load(frame, obj, state) || !load(frame + 1, obj, next))
+    {
+        return false;
+    }
+    double ratio = f - frame;
+    for (int i = 0; i < 3; i++)
+    {
+        state.position[i] += ratio * (next.position[i] - state.position[i]);
+    }
+    q_type orient;
+    q_slerp(orient, state.orientation, next.orientation, ratio);
+    q_copy(state.orientation, orient);
+    // solid colors are blended linearly between keyframes, so blending the
+    // frames gives the same color
+    if (state.colorChange == AnimationState::SET_SOLID_COLOR &&
+            next.colorChange == AnimationState::SET_SOLID_COLOR)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            state.solidColor[i] +=
+                    ratio * (next.solidColor[i] - state.solidColor[i]);
+        }
+    }
+    return true;
+}
+
+void AnimationCache::clear()
+{
+    frameRate = 0.0;
+    numFrames = 0;
+    numCachedFrames = 0;
+    samples.clear();
+    columns.clear();
+    revisions.clear();
+    filled.clear();
+    columnOf.clear();
+    colorMaps.clear();
+    colorMapIds.clear();
+}
+
+double AnimationCache::getFrameRate() const
+{
+    return frameRate;
+}
+
+int AnimationCache::getNumberOfFrames() const
+{
+    return numFrames;
+}
+
+int AnimationCache::getNumberOfCachedFrames() const
+{
+    return numCachedFrames;
+}
+
+void AnimationCache::setMaxMemorySize(qint64 bytes)
+{
+    maxMemorySize = qMax(Q_INT64_C(0), bytes);
+}
+
+qint64 AnimationCache::getMaxMemorySize() const
+{
+    return maxMemorySize;
+}
+
+int AnimationCache::getNumberOfObjects() const
+{
+    return columns.size();
+}
+
+qint64 AnimationCache::getMemorySize() const
+{
+    return sizeof(AnimationCache) + samples.capacity() * sizeof(Sample) +
+            columns.capacity() * sizeof(SketchObject *) +
+            revisions.capacity() * sizeof(quint64) +
+            filled.capacity() * sizeof(int) +
+            columnOf.capacity() * (sizeof(SketchObject *) + sizeof(int)) +
+            colorMaps.size() * sizeof(ColorMapType::ColorMap);
+}
+
+int AnimationCache::internColorMap(const ColorMapType::ColorMap &cmap)
+{
+    QHash< ColorMapType::ColorMap, int >::const_iterator it =
+            colorMapIds.constFind(cmap);
+    if (it != colorMapIds.constEnd())
+    {
+        return it.value();
+    }
+    int id = colorMaps.size();
+    colorMaps.append(cmap);
+    colorMapIds.insert(cmap, id);
+    return id;
+}
@@ -0,0 +1,125 @@
+#ifndef ANIMATIONCACHE_H
+#define ANIMATIONCACHE_H
+
+#include <QVector>
+#include <QList>
+#include <QHash>
+
+#include "colormaptype.h"
+
+class SketchObject;
+struct AnimationState;
+
+// the frame rate the animation is baked at for playback, the same as the
+// frame rate of the Blender export
+#define DEFAULT_ANIMATION_FRAME_RATE 30
+// the most memory the cache's samples may use by default (256 MiB)
+#define DEFAULT_ANIMATION_CACHE_MAX_SIZE (Q_INT64_C(256) << 20)
+
+/*
+ * This class holds the animation states (see
+ * SketchObject::computeAnimationState) of a set of objects sampled at a fixed
+ * frame rate, so that playing the animation back or exporting it does not
+ * need to evaluate splines and interpolate colors for every object in every
+ * frame.
+ *
+ * The samples are stored in one array in time-major order: all the objects'
+ * samples for frame 0, then all of them for frame 1, and so on, so a frame is
+ * read from one contiguous block.  Each object has a column in this array
+ * that is tagged with the keyframe revision of the object it is being filled
+ * in for and counts how many frames (from frame 0) have been filled in.  If
+ * the object's keyframes change, its column no longer matches and load()
+ * refuses to return its samples until it is filled in again.  Color maps are
+ * stored as an index into a table of the distinct color maps.
+ *
+ * The samples may use at most a set amount of memory.  If all the frames of
+ * all the objects would not fit, only the frames from the start of the
+ * animation that do fit are cached and load() returns false for the rest, so
+ * the caller falls back to computing those states.
+ *
+ * Filling in the cache is done in three steps: layOut() sets up the columns
+ * and returns the ones that need to be filled in, store() is called for the
+ * frames of those columns, then setFilled() marks the frames as valid.  The
+ * frames can be filled in a few at a time.
+ */
+class AnimationCache
+{
+   public:
+    AnimationCache();
+
+    // Sets up the cache for the given objects with numFrames frames at the
+    // given frame rate.  The samples of objects that were already in the
+    // cache and whose keyframes have not changed are kept, the columns that
+    // are not completely filled in are returned.  If the frame rate or number
+    // of frames changes, all the columns are returned.
+    QVector< int > layOut(const QVector< SketchObject * > &objects,
+                          double frameRate, int numFrames);
+    // Stores the state of the object in the given column at the given frame
+    void store(int frame, int column, const AnimationState &state);
+    // Marks the first numFilled frames of the column as filled in for the
+    // object's current keyframes.  Frames where nothing was stored have no
+    // state.
+    void setFilled(int column, int numFilled);
+    // Returns the number of frames of the column that are filled in
+    int getFilledFrames(int column) const;
+
+    // Returns the frame at time t or -1 if t is not (within rounding) the
+    // time of a frame of the animation
+    int getFrameAt(double t) const;
+    // Gets the state of the object at the given frame.  Returns false if the
+    // object is not in the cache, its keyframes have changed since it was
+    // baked, or the frame is not cached or not filled in yet.
+    bool load(int frame, SketchObject *obj, AnimationState &state) const;
+    // Gets the state of the object at a time t between two frames by
+    // interpolating the states at those frames.  Returns false if either
+    // frame can't be loaded, or if the object has a keyframe at or between
+    // the two frames, since its grouping, color and visibility may change
+    // there and its pose is only smooth between keyframes.
+    bool loadBetween(double t, SketchObject *obj, AnimationState &state) const;
+
+    // The most memory the samples may use, in bytes.  Takes effect at the
+    // next layOut().
+    void setMaxMemorySize(qint64 bytes);
+    qint64 getMaxMemorySize() const;
+
+    // Removes everything from the cache
+    void clear();
+    double getFrameRate() const;
+    // the number of frames in the animation
+    int getNumberOfFrames() const;
+    // the number of frames (from frame 0) that fit in the cache
+    int getNumberOfCachedFrames() const;
+    int getNumberOfObjects() const;
+    // Returns the approximate memory used by the cache in bytes
+    qint64 getMemorySize() const;
+
+   private:
+    // one object at one frame
+    struct Sample
+    {
+        double position[3];
+        double orientation[4];
+        float solidColor[3];
+        // index into colorMaps
+        int colorMap;
+        quint8 flags;
+    };
+
+    int internColorMap(const ColorMapType::ColorMap &cmap);
+
+    double frameRate;
+    int numFrames, numCachedFrames;
+    qint64 maxMemorySize;
+    // numCachedFrames * columns.size() samples, frame by frame
+    QVector< Sample > samples;
+    QVector< SketchObject * > columns;
+    // the keyframe revision of each column's object when it was laid out and
+    // the number of its frames that have been filled in since
+    QVector< quint64 > revisions;
+    QVector< int > filled;
+    QHash< SketchObject *, int > columnOf;
+    QList< ColorMapType::ColorMap > colorMaps;
+    QHash< ColorMapType::ColorMap, int > colorMapIds;
+};
+
+#endif  // ANIMATIONCACHE_H
@@ -0,0 +1,324 @@
+#include "collisionscan.h"
+
+#include <QtConcurrentMap>
+#include <QThread>
+#include <QHash>
+#include <QPair>
+
+#include <cmath>
+
+#include <PQP.h>
+
+#include "sketchobject.h"
+#include "keyframestore.h"
+#include "sketchmodel.h"
+#include "worldmanager.h"
+
+// the number of samples whose poses are held at once for each thread
+#define SAMPLES_PER_THREAD 8
+
+namespace
+{
+// A model instance that is tested for collisions
+struct Leaf
+{
+    SketchObject *object;
+    // the conformation and resolution the model and sphere were found for
+    int conformation;
+    ModelResolution::ResolutionType resolution;
+    PQP_Model *model;
+    // a sphere around the model in model coordinates
+    double center[3];
+    double radius;
+};
+
+// The world pose of a leaf at one sample, with the collision model and
+// bounding sphere radius it had then
+struct LeafPose
+{
+    PQP_REAL rotation[3][3];
+    PQP_REAL translation[3];
+    PQP_Model *model;
+    // the center of the leaf's bounding sphere in world coordinates
+    double center[3];
+    double radius;
+    // the index of the leaf's top-level object, or -1 if the leaf is hidden
+    int root;
+};
+
+// The poses of the leaves at one sample and the pairs of them found to
+// collide
+struct SampleTask
+{
+    QVector< LeafPose > poses;
+    QVector< QPair< int, int > > hits;
+    qint64 pairTests;
+};
+}
+
+// Adds the model instances at or under the object to the list
+static void collectLeaves(SketchObject *obj,
+                          const QSet< SketchModel * > &ignoredModels,
+                          QVector< Leaf > &leaves,
+                          QHash< SketchObject *, int > &leafIndex)
+{
+    QList< SketchObject * > *subObjects = obj->getSubObjects();
+    if (subObjects != NULL)
+    {
+        for (QListIterator< SketchObject * > it(*subObjects); it.hasNext();)
+        {
+            collectLeaves(it.next(), ignoredModels, leaves, leafIndex);
+        }
+        return;
+    }
+    SketchModel *model = obj->getModel();
+    if (model == NULL || ignoredModels.contains(model))
+    {
+        return;
+    }
+    Leaf leaf;
+    leaf.object = obj;
+    leaf.model = NULL;
+    leafIndex.insert(obj, leaves.size());
+    leaves.append(leaf);
+}
+
+// Finds the leaf's collision model and bounding sphere if its conformation or
+// resolution changed since they were last found
+static void updateLeafShape(Leaf &leaf)
+{
+    SketchObject *obj = leaf.object;
+    SketchModel *model = obj->getModel();
+    int conformation = obj->getModelConformation();
+    ModelResolution::ResolutionType resolution =
+        model->getResolutionLevel(conformation);
+    if (leaf.model != NULL && leaf.conformation == conformation &&
+        leaf.resolution == resolution)
+    {
+        return;
+    }
+    leaf.conformation = conformation;
+    leaf.resolution = resolution;
+    leaf.model = model->getCollisionModel(conformation);
+    double bb[6];
+    obj->getBoundingBox(bb);
+    q_vec_type diagonal;
+    for (int i = 0; i < 3; i++)
+    {
+        leaf.center[i] = (bb[2 * i] + bb[2 * i + 1]) * 0.5;
+        diagonal[i] = bb[2 * i + 1] - bb[2 * i];
+    }
+    leaf.radius = q_vec_magnitude(diagonal) * 0.5;
+}
+
+// Returns the time of the last keyframe at or under the object, or 0
+static double getLastKeyframeTime(SketchObject *obj)
+{
+    double endTime = 0.0;
+    if (obj->hasKeyframes())
+    {
+        const KeyframeStore *frames = obj->getKeyframeStore();
+        endTime = frames->getTime(frames->size() - 1);
+    }
+    QList< SketchObject * > *subObjects = obj->getSubObjects();
+    if (subObjects != NULL)
+    {
+        for (QListIterator< SketchObject * > it(*subObjects); it.hasNext();)
+        {
+            endTime = qMax(endTime, getLastKeyframeTime(it.next()));
+        }
+    }
+    return endTime;
+}
+
+// Copies the world poses of the leaves at or under the object into the
+// sample's buffer
+static void capturePoses(SketchObject *obj, int root, bool visible,
+                         QVector< Leaf > &leaves,
+                         const QHash< SketchObject *, int > &leafIndex,
+                         SampleTask &task)
+{
+    visible = visible && obj->isVisible();
+    QList< SketchObject * > *subObjects = obj->getSubObjects();
+    if (subObjects != NULL)
+    {
+        for (QListIterator< SketchObject * > it(*subObjects); it.hasNext();)
+        {
+            capturePoses(it.next(), root, visible, leaves, leafIndex, task);
+        }
+        return;
+    }
+    int index = leafIndex.value(obj, -1);
+    if (index < 0 || !visible)
+    {
+        return;
+    }
+    Leaf &leaf = leaves[index];
+    updateLeafShape(leaf);
+    LeafPose &pose = task.poses[index];
+    pose.model = leaf.model;
+    pose.radius = leaf.radius;
+    obj->getPosition(pose.translation);
+    obj->getOrientation(pose.rotation);
+    const double *c = leaf.center;
+    for (int i = 0; i < 3; i++)
+    {
+        pose.center[i] = pose.rotation[i][0] * c[0] +
+                         pose.rotation[i][1] * c[1] +
+                         pose.rotation[i][2] * c[2] + pose.translation[i];
+    }
+    pose.root = root;
+}
+
+// Tests every pair of leaves in the sample that could collide
+static void testSample(SampleTask &task)
+{
+    task.hits.clear();
+    task.pairTests = 0;
+    int numLeaves = task.poses.size();
+    for (int i = 0; i < numLeaves; i++)
+    {
+        LeafPose &p1 = task.poses[i];
+        if (p1.root < 0)
+        {
+            continue;
+        }
+        for (int j = i + 1; j < numLeaves; j++)
+        {
+            LeafPose &p2 = task.poses[j];
+            // objects under the same top-level object move together
+            if (p2.root < 0 || p2.root == p1.root)
+            {
+                continue;
+            }
+            double reach = p1.radius + p2.radius;
+            q_vec_type between;
+            q_vec_subtract(between, p1.center, p2.center);
+            if (q_vec_dot_product(between, between) > reach * reach)
+            {
+                continue;
+            }
+            task.pairTests++;
+            PQP_CollideResult result;
+            PQP_Collide(&result, p1.rotation, p1.translation, p1.model,
+                        p2.rotation, p2.translation, p2.model,
+                        PQP_FIRST_CONTACT);
+            if (result.NumPairs() != 0)
+            {
+                task.hits.append(qMakePair(i, j));
+            }
+        }
+    }
+}
+
+CollisionScan::CollisionScan() :
+    ignoredModels(),
+    collisions(),
+    numSamples(0),
+    numPairTests(0)
+{
+}
+
+void CollisionScan::ignoreModel(SketchModel *model)
+{
+    ignoredModels.insert(model);
+}
+
+void CollisionScan::scan(WorldManager &world, double sampleRate,
+                         bool parallel)
+{
+    collisions.clear();
+    numPairTests = 0;
+    const QList< SketchObject * > &objects = *world.getObjects();
+    QVector< Leaf > leaves;
+    QHash< SketchObject *, int > leafIndex;
+    double endTime = 0.0;
+    for (QListIterator< SketchObject * > it(objects); it.hasNext();)
+    {
+        SketchObject *obj = it.next();
+        collectLeaves(obj, ignoredModels, leaves, leafIndex);
+        endTime = qMax(endTime, getLastKeyframeTime(obj));
+    }
+    numSamples = static_cast< int >(ceil(endTime * sampleRate - 1e-6)) + 1;
+
+    int numThreads = parallel ? qMax(1, QThread::idealThreadCount()) : 1;
+    QVector< SampleTask > tasks(numThreads * SAMPLES_PER_THREAD);
+    for (int i = 0; i < tasks.size(); i++)
+    {
+        tasks[i].poses.resize(leaves.size());
+    }
+    // the interval each colliding pair is in and the last sample it was
+    // seen colliding at
+    QHash< QPair< int, int >, QPair< int, int > > openIntervals;
+    for (int first = 0; first < numSamples; first += tasks.size())
+    {
+        int count = qMin(tasks.size(), numSamples - first);
+        for (int k = 0; k < count; k++)
+        {
+            world.setAnimationTime((first + k) / sampleRate, parallel);
+            SampleTask &task = tasks[k];
+            for (int i = 0; i < task.poses.size(); i++)
+            {
+                task.poses[i].root = -1;
+            }
+            for (int i = 0; i < objects.size(); i++)
+            {
+                capturePoses(objects[i], i, true, leaves, leafIndex, task);
+            }
+        }
+        if (count > 1)
+        {
+            QtConcurrent::blockingMap(tasks.begin(), tasks.begin() + count,
+                                      testSample);
+        }
+        else
+        {
+            testSample(tasks[0]);
+        }
+        // join the hits into intervals in time order
+        for (int k = 0; k < count; k++)
+        {
+            int sample = first + k;
+            double t = sample / sampleRate;
+            const SampleTask &task = tasks[k];
+            numPairTests += task.pairTests;
+            for (int h = 0; h < task.hits.size(); h++)
+            {
+                const QPair< int, int > &hit = task.hits[h];
+                QHash< QPair< int, int >, QPair< int, int > >::iterator it =
+                        openIntervals.find(hit);
+                if (it != openIntervals.end() &&
+                        it.value().second == sample - 1)
+                {
+                    collisions[it.value().first].end = t;
+                    it.value().second = sample;
+                }
+                else
+                {
+                    Interval interval;
+                    interval.first = leaves[hit.first].object;
+                    interval.second = leaves[hit.second].object;
+                    interval.start = interval.end = t;
+                    openIntervals.insert(hit, qMakePair(collisions.size(),
+                                                        sample));
+                    collisions.append(interval);
+                }
+            }
+        }
+    }
+}
+
+const QVector< CollisionScan::Interval > &CollisionScan::getCollisions() const
+{
+    return collisions;
+}
+
+int CollisionScan::getNumberOfSamples() const
+{
+    return numSamples;
+}
+
+qint64 CollisionScan::getNumberOfPairTests() const
+{
+    return numPairTests;
+}
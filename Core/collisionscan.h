@@ -0,0 +1,66 @@
+#ifndef COLLISIONSCAN_H
+#define COLLISIONSCAN_H
+
+#include <QVector>
+#include <QSet>
+
+class SketchObject;
+class SketchModel;
+class WorldManager;
+
+#include "animationcache.h"
+
+/*
+ * This class finds where objects interpenetrate over the whole animation
+ * without playing it.  The animation is sampled at a fixed rate and at each
+ * sample every pair of visible model instances that can move relative to
+ * each other (that are not in the same top-level object) is tested with PQP.
+ * Samples in a row where the same pair collides are joined into one interval.
+ *
+ * The objects are moved to each sample time on the calling thread and their
+ * world poses are copied into a buffer for that sample, along with each
+ * model instance's collision model and bounding sphere (found again whenever
+ * the instance's conformation or resolution changes).  Then the collision
+ * tests for a batch of samples are run on worker threads, each reading only
+ * its own sample's buffer.  Nothing is drawn, so this does not need a window.
+ */
+class CollisionScan
+{
+   public:
+    // Two objects that collide at every sample from start to end
+    struct Interval
+    {
+        SketchObject *first, *second;
+        double start, end;
+    };
+
+    CollisionScan();
+
+    // Objects with the given model are not tested (the camera model, for
+    // example)
+    void ignoreModel(SketchModel *model);
+    // Scans the animation of the objects in the world from time 0 to the
+    // last keyframe at the given number of samples per second.  The objects
+    // are moved with WorldManager::setAnimationTime, which reads the baked
+    // animation where it can, and are left at the last sample time, so
+    // setAnimationTime should be called afterwards.  If parallel is false,
+    // everything is done on the calling thread.
+    void scan(WorldManager &world,
+              double sampleRate = DEFAULT_ANIMATION_FRAME_RATE,
+              bool parallel = true);
+
+    // The intervals found by the last scan, ordered by start time
+    const QVector< Interval > &getCollisions() const;
+    int getNumberOfSamples() const;
+    // The number of pairs tested with PQP in the last scan.  Pairs whose
+    // bounding spheres do not touch are not tested.
+    qint64 getNumberOfPairTests() const;
+
+   private:
+    QSet< SketchModel * > ignoredModels;
+    QVector< Interval > collisions;
+    int numSamples;
+    qint64 numPairTests;
+};
+
+#endif // COLLISIONSCAN_H
@@ -2,6 +2,11 @@
 
 #include <QString>
 #include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWeakPointer>
+
+#include <cstring>
 
 #include <vtkNew.h>
 #include <vtkColorTransferFunction.h>
@@ -82,62 +87,237 @@ Type colorMapFromString(const char *str)
     throw "Unknown color map.";
 }
 
-vtkColorTransferFunction *ColorMap::getColorMap(
-        double low,
-        double high) const
+// Gets the color of one of the solid color maps, returns false if the color
+// map is not a solid color
+static bool getSolidColorMapColor(Type cmap, double rgb[3])
 {
-    vtkColorTransferFunction *ctf = vtkColorTransferFunction::New();
-    ctf->SetScaleToLinear();
-    switch (first)
+    double r, g, b;
+    switch (cmap)
     {
     case SOLID_COLOR_RED:
-        ctf->AddRGBPoint(low,1.0,0.7,0.7);
+        r = 1.0; g = 0.7; b = 0.7;
         break;
     case SOLID_COLOR_GREEN:
-        ctf->AddRGBPoint(low,0.7,1.0,0.8);
+        r = 0.7; g = 1.0; b = 0.8;
         break;
     case SOLID_COLOR_BLUE:
-        ctf->AddRGBPoint(low,0.7,0.7,1.0);
+        r = 0.7; g = 0.7; b = 1.0;
         break;
     case SOLID_COLOR_YELLOW:
-        ctf->AddRGBPoint(low,1.0,1.0,0.7);
+        r = 1.0; g = 1.0; b = 0.7;
         break;
     case SOLID_COLOR_PURPLE:
-        ctf->AddRGBPoint(low,1.0,0.7,1.0);
+        r = 1.0; g = 0.7; b = 1.0;
         break;
     case SOLID_COLOR_CYAN:
-        ctf->AddRGBPoint(low,0.7,1.0,1.0);
+        r = 0.7; g = 1.0; b = 1.0;
         break;
 	case SOLID_COLOR_GRAY:
-        ctf->AddRGBPoint(low,0.8,0.8,0.8);
+        r = 0.8; g = 0.8; b = 0.8;
         break;
     case DIM_SOLID_COLOR_RED:
-        ctf->AddRGBPoint(low,0.5,0.35,0.35);
+        r = 0.5; g = 0.35; b = 0.35;
         break;
     case DIM_SOLID_COLOR_GREEN:
-        ctf->AddRGBPoint(low,0.35,0.5,0.4);
+        r = 0.35; g = 0.5; b = 0.4;
         break;
     case DIM_SOLID_COLOR_BLUE:
-        ctf->AddRGBPoint(low,0.35,0.35,0.5);
+        r = 0.35; g = 0.35; b = 0.5;
         break;
     case DIM_SOLID_COLOR_YELLOW:
-        ctf->AddRGBPoint(low,0.5,0.5,0.35);
+        r = 0.5; g = 0.5; b = 0.35;
         break;
     case DIM_SOLID_COLOR_PURPLE:
-        ctf->AddRGBPoint(low,0.5,0.35,0.5);
+        r = 0.5; g = 0.35; b = 0.5;
         break;
     case DIM_SOLID_COLOR_CYAN:
-        ctf->AddRGBPoint(low,0.35,0.5,0.5);
+        r = 0.35; g = 0.5; b = 0.5;
         break;
-    case BLUE_TO_RED:
+    default:
+        return false;
+    }
+    rgb[0] = r;
+    rgb[1] = g;
+    rgb[2] = b;
+    return true;
+}
+
+// the ends of the blue to red color map
+static const double BLUE_TO_RED_LOW[3] =
+{ 59.0/256.0, 76.0/256.0, 192.0/256.0 };
+static const double BLUE_TO_RED_HIGH[3] =
+{ 180.0/256.0, 4.0/256.0, 38.0/256.0 };
+
+vtkColorTransferFunction *ColorMap::getColorMap(
+        double low,
+        double high) const
+{
+    vtkColorTransferFunction *ctf = vtkColorTransferFunction::New();
+    ctf->SetScaleToLinear();
+    double rgb[3];
+    if (getSolidColorMapColor(first, rgb))
+    {
+        ctf->AddRGBPoint(low,rgb[0],rgb[1],rgb[2]);
+    }
+    else if (first == BLUE_TO_RED)
+    {
         ctf->SetColorSpaceToDiverging();
-        ctf->AddRGBPoint(low,59.0/256.0,76.0/256.0,192.0/256.0);
-        ctf->AddRGBPoint(high,180.0/256.0,4.0/256.0,38.0/256.0);
-        break;
+        ctf->AddRGBPoint(low,BLUE_TO_RED_LOW[0],BLUE_TO_RED_LOW[1],
+                         BLUE_TO_RED_LOW[2]);
+        ctf->AddRGBPoint(high,BLUE_TO_RED_HIGH[0],BLUE_TO_RED_HIGH[1],
+                         BLUE_TO_RED_HIGH[2]);
     }
     return ctf;
 }
 
+namespace
+{
+// The color map type and range that identify a lookup table.  Lookup tables
+// do not depend on the array being colored by.
+struct LookupTableKey
+{
+    Type type;
+    double low, high;
+};
+
+inline bool operator==(const LookupTableKey &a, const LookupTableKey &b)
+{
+    return a.type == b.type && a.low == b.low && a.high == b.high;
+}
+
+inline uint qHash(const LookupTableKey &key)
+{
+    // hash the bits of the doubles, adding 0.0 so -0.0 hashes the same as 0.0
+    double range[2] = { key.low + 0.0, key.high + 0.0 };
+    quint64 bits[2];
+    memcpy(bits, range, sizeof(bits));
+    return ::qHash(bits[0]) ^ (::qHash(bits[1]) * 31) ^ key.type;
+}
+
+// The lookup tables in use.  Only weak pointers are kept here so that a
+// table is freed when the last thing using it is done with it, otherwise
+// every data range that was ever shown would keep its table.
+QMutex lookupTableMutex;
+QHash< LookupTableKey, QWeakPointer< const ColorLookupTable > > lookupTables;
+}
+
+QSharedPointer< const ColorLookupTable > ColorMap::getLookupTable(
+        double low, double high) const
+{
+    LookupTableKey key = { first, low, high };
+    {
+        QMutexLocker lock(&lookupTableMutex);
+        QSharedPointer< const ColorLookupTable > existing =
+                lookupTables.value(key).toStrongRef();
+        if (!existing.isNull())
+        {
+            return existing;
+        }
+    }
+    // make the table without holding the lock since sampling the transfer
+    // function is not free
+    QSharedPointer< const ColorLookupTable > table(
+                new ColorLookupTable(*this, low, high));
+    QSharedPointer< const ColorLookupTable > existing;
+    {
+        QMutexLocker lock(&lookupTableMutex);
+        // another thread may have made the same table in the meantime
+        existing = lookupTables.value(key).toStrongRef();
+        if (existing.isNull())
+        {
+            lookupTables.insert(key, table.toWeakRef());
+        }
+    }
+    // the unused table (if any) is freed after the lock is released since
+    // its destructor takes the lock
+    return existing.isNull() ? table : existing;
+}
+
+ColorLookupTable::ColorLookupTable(const ColorMap &cmap, double l, double h) :
+    type(cmap.first),
+    low(l),
+    high(h),
+    samples(3 * NUM_SAMPLES),
+    function(vtkSmartPointer< vtkColorTransferFunction >::Take(
+                 cmap.getColorMap(l, h)))
+{
+    function->GetTable(low, high, NUM_SAMPLES, samples.data());
+}
+
+ColorLookupTable::~ColorLookupTable()
+{
+    LookupTableKey key = { type, low, high };
+    QMutexLocker lock(&lookupTableMutex);
+    // only remove the entry if it is this table's (expired) entry and not a
+    // new table for the same type and range
+    QHash< LookupTableKey, QWeakPointer< const ColorLookupTable > >::iterator
+            it = lookupTables.find(key);
+    if (it != lookupTables.end() && it.value().isNull())
+    {
+        lookupTables.erase(it);
+    }
+}
+
+int ColorLookupTable::getNumberOfLookupTables()
+{
+    QMutexLocker lock(&lookupTableMutex);
+    int count = 0;
+    QHashIterator< LookupTableKey, QWeakPointer< const ColorLookupTable > >
+            it(lookupTables);
+    while (it.hasNext())
+    {
+        if (!it.next().value().isNull())
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+void ColorLookupTable::getColor(double value, double rgb[3]) const
+{
+    double f = 0.0;
+    if (high != low)
+    {
+        f = (value - low) / (high - low) * (NUM_SAMPLES - 1);
+    }
+    if (f <= 0.0 || f != f)
+    {
+        f = 0.0;
+    }
+    else if (f >= NUM_SAMPLES - 1)
+    {
+        f = NUM_SAMPLES - 1;
+    }
+    int i = static_cast< int >(f);
+    if (i == NUM_SAMPLES - 1)
+    {
+        i--;
+    }
+    double t = f - i;
+    const double *a = samples.constData() + 3 * i, *b = a + 3;
+    for (int j = 0; j < 3; j++)
+    {
+        rgb[j] = (1.0 - t) * a[j] + t * b[j];
+    }
+}
+
+vtkColorTransferFunction *ColorLookupTable::getTransferFunction() const
+{
+    return function;
+}
+
+void ColorMap::getSolidColor(double rgb[3]) const
+{
+    if (!getSolidColorMapColor(first, rgb))
+    {
+        // the top of the range, like getColorMap(0,1)->GetColor(1.0,rgb)
+        rgb[0] = BLUE_TO_RED_HIGH[0];
+        rgb[1] = BLUE_TO_RED_HIGH[1];
+        rgb[2] = BLUE_TO_RED_HIGH[2];
+    }
+}
+
 bool ColorMap::isSolidColor() const
 {
     // this array means solid color whatever the color map
@@ -2,7 +2,10 @@
 #define COLORMAPTYPE_H_
 
 #include <QString>
+#include <QVector>
+#include <QSharedPointer>
 
+#include <vtkSmartPointer.h>
 class vtkColorTransferFunction;
 /*
  * This namespace contains an enum that holds the color map types that are available,
@@ -28,6 +31,8 @@ namespace ColorMapType {
         BLUE_TO_RED
     };
 
+    class ColorLookupTable;
+
     class ColorMap : public std::pair< Type, QString >
     {
     public:
@@ -41,10 +46,54 @@ namespace ColorMapType {
     // low and high are the lowest and highest values in the interval that the
     // color map should map over.
         vtkColorTransferFunction* getColorMap(double low, double high) const;
+    // Gets the lookup table for this color map's type over the interval from
+    // low to high.  Lookup tables are made the first time they are asked for
+    // and then shared by everything that uses the same type and range until
+    // the last pointer to them is released, so this is much cheaper than
+    // getColorMap while the table is in use.  This may be called from any
+    // thread.
+        QSharedPointer< const ColorLookupTable > getLookupTable(
+                double low, double high) const;
     // Returns true if the color map listed has a solid color for the entire object
     // and false if it requires per-vertex coloring
         bool isSolidColor() const;
+    // Gets the color of an object colored solid with this color map (the
+    // color at the top of the map's range), without making a
+    // vtkColorTransferFunction so it is safe to call from any thread
+        void getSolidColor(double rgb[3]) const;
+    };
+    // A color map over a fixed range, sampled so that colors can be looked up
+    // without going through VTK.  These are made by ColorMap::getLookupTable
+    // and never change after they are made.
+    class ColorLookupTable
+    {
+    public:
+        // the number of colors sampled from the color map
+        enum { NUM_SAMPLES = 256 };
+
+        ColorLookupTable(const ColorMap &cmap, double low, double high);
+        ~ColorLookupTable();
+
+        // Returns the number of distinct lookup tables currently in use
+        static int getNumberOfLookupTables();
+
+        Type getType() const { return type; }
+        double getLow() const { return low; }
+        double getHigh() const { return high; }
+        // Gets the color at the given value, interpolated between the
+        // samples.  Values outside the range get the color at the nearest end.
+        void getColor(double value, double rgb[3]) const;
+        // Gets the color function the samples were taken from, to give to VTK
+        // mappers.  It is shared and must not be changed.
+        vtkColorTransferFunction *getTransferFunction() const;
+    private:
+        Type type;
+        double low, high;
+        // NUM_SAMPLES rgb triples from low to high
+        QVector< double > samples;
+        vtkSmartPointer< vtkColorTransferFunction > function;
     };
+
     // gets the color map corresponding to one of the strings
     // returned by stringFromColorMap
     Type colorMapFromString(const char *str);
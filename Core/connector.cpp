@@ -4,7 +4,6 @@
 #include <vtkLineSource.h>
 #include <vtkTubeFilter.h>
 #include <vtkPolyDataMapper.h>
-#include <vtkColorTransferFunction.h>
 #include <vtkActor.h>
 #include <vtkProperty.h>
 
@@ -75,14 +74,9 @@ Connector::LineVisibilityData::LineVisibilityData(q_vec_type p1, q_vec_type p2,
 
 void Connector::LineVisibilityData::updateColorMap(ColorMapType::Type cmap)
 {
-    double range[2] = { 0.0, 1.0};
     ColorMapType::ColorMap map(cmap,"modelNum");
-    vtkSmartPointer< vtkColorTransferFunction > colorFunc =
-        vtkSmartPointer< vtkColorTransferFunction >::Take(
-            map.getColorMap(range[0],range[1])
-        );
     double rgb[3];
-    colorFunc->GetColor(range[1],rgb);
+    map.getSolidColor(rgb);
     actor->GetProperty()->SetColor(rgb);
 }
 
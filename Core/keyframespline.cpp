@@ -0,0 +1,351 @@
+#include "keyframespline.h"
+
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+
+// the number of values stored for each point before the spline is computed:
+// the time, the position and the orientation
+#define RAW_POINT_SIZE 8
+#define RAW_TIME 0
+#define RAW_POSITION 1
+#define RAW_ORIENTATION 4
+// the number of arrays (each with one entry per point) in a computed spline:
+// the times, 4 cubic coefficients for each of the 3 coordinates, 4 quaternion
+// components for the orientations and 4 for the SQUAD control orientations
+#define NUM_PACKED_ARRAYS 21
+// cosine of the angle below which slerp falls back to linear interpolation
+#define SLERP_LINEAR_THRESHOLD (1.0 - 1e-6)
+
+//###############################################################
+// Packed layout
+//
+// Each array has one entry per point.  The coefficients of the last point
+// describe the constant position after the end of the spline.
+
+static inline int timesOffset()
+{
+    return 0;
+}
+
+static inline int coefficientOffset(int numPoints, int coordinate, int power)
+{
+    return numPoints * (1 + 4 * coordinate + power);
+}
+
+static inline int orientationOffset(int numPoints, int component)
+{
+    return numPoints * (13 + component);
+}
+
+static inline int controlOffset(int numPoints, int component)
+{
+    return numPoints * (17 + component);
+}
+
+//###############################################################
+// Quaternion helpers
+
+static inline double dot(const q_type a, const q_type b)
+{
+    return a[Q_X] * b[Q_X] + a[Q_Y] * b[Q_Y] + a[Q_Z] * b[Q_Z] +
+            a[Q_W] * b[Q_W];
+}
+
+// the log of a unit quaternion, a quaternion with w = 0
+static void quatLog(q_type dest, const q_type q)
+{
+    double w = std::max(-1.0, std::min(1.0, q[Q_W]));
+    double angle = acos(w);
+    double s = sin(angle);
+    double scale = (s > 1e-12) ? angle / s : 1.0;
+    dest[Q_X] = q[Q_X] * scale;
+    dest[Q_Y] = q[Q_Y] * scale;
+    dest[Q_Z] = q[Q_Z] * scale;
+    dest[Q_W] = 0.0;
+}
+
+// the exponential of a quaternion with w = 0
+static void quatExp(q_type dest, const q_type q)
+{
+    double angle = sqrt(q[Q_X] * q[Q_X] + q[Q_Y] * q[Q_Y] + q[Q_Z] * q[Q_Z]);
+    double scale = (angle > 1e-12) ? sin(angle) / angle : 1.0;
+    dest[Q_X] = q[Q_X] * scale;
+    dest[Q_Y] = q[Q_Y] * scale;
+    dest[Q_Z] = q[Q_Z] * scale;
+    dest[Q_W] = cos(angle);
+}
+
+// spherical linear interpolation from a to b, without flipping b to take the
+// short way around (SQUAD depends on that)
+static inline void slerp(q_type dest, const q_type a, const q_type b,
+                         double h)
+{
+    double c = dot(a, b);
+    double wa, wb;
+    if (c > SLERP_LINEAR_THRESHOLD)
+    {
+        wa = 1.0 - h;
+        wb = h;
+    }
+    else
+    {
+        double angle = acos(std::max(-1.0, c));
+        double s = sin(angle);
+        wa = sin((1.0 - h) * angle) / s;
+        wb = sin(h * angle) / s;
+    }
+    for (int i = 0; i < 4; i++)
+    {
+        dest[i] = wa * a[i] + wb * b[i];
+    }
+    if (c > SLERP_LINEAR_THRESHOLD)
+    {
+        q_normalize(dest, dest);
+    }
+}
+
+//###############################################################
+
+KeyframeSpline::KeyframeSpline() : numPoints(0), computed(false), data()
+{
+}
+
+void KeyframeSpline::addPoint(double t, const q_vec_type position,
+                              const q_type orientation)
+{
+    if (computed)
+    {
+        // unpack the points, the constant coefficients are the positions
+        QVector< double > raw(numPoints * RAW_POINT_SIZE);
+        const double *packed = data.constData();
+        for (int i = 0; i < numPoints; i++)
+        {
+            double *point = raw.data() + i * RAW_POINT_SIZE;
+            point[RAW_TIME] = packed[timesOffset() + i];
+            for (int c = 0; c < 3; c++)
+            {
+                point[RAW_POSITION + c] =
+                        packed[coefficientOffset(numPoints, c, 0) + i];
+            }
+            for (int j = 0; j < 4; j++)
+            {
+                point[RAW_ORIENTATION + j] =
+                        packed[orientationOffset(numPoints, j) + i];
+            }
+        }
+        data = raw;
+        computed = false;
+    }
+    assert(numPoints == 0 ||
+           t > data[(numPoints - 1) * RAW_POINT_SIZE + RAW_TIME]);
+    data.append(t);
+    for (int c = 0; c < 3; c++)
+    {
+        data.append(position[c]);
+    }
+    for (int j = 0; j < 4; j++)
+    {
+        data.append(orientation[j]);
+    }
+    numPoints++;
+}
+
+void KeyframeSpline::compute()
+{
+    if (computed || numPoints == 0)
+    {
+        return;
+    }
+    int n = numPoints;
+    QVector< double > packedData(n * NUM_PACKED_ARRAYS);
+    double *packed = packedData.data();
+    const double *raw = data.constData();
+    double *times = packed + timesOffset();
+    for (int i = 0; i < n; i++)
+    {
+        times[i] = raw[i * RAW_POINT_SIZE + RAW_TIME];
+    }
+
+    // The position: solve for the velocity at each point so that the
+    // acceleration is continuous and the velocity at the ends is 0 (this
+    // system is the same one vtkCardinalSpline solves), then make each
+    // interval's cubic from the positions and velocities at its ends.
+    QVector< double > lower(n), diagonal(n), upper(n), velocity(n);
+    for (int c = 0; c < 3; c++)
+    {
+        const double *y = raw + RAW_POSITION + c;
+        diagonal[0] = 1.0;
+        upper[0] = 0.0;
+        velocity[0] = 0.0;
+        for (int k = 1; k < n - 1; k++)
+        {
+            double before = times[k] - times[k - 1];
+            double after = times[k + 1] - times[k];
+            double yBefore = y[(k - 1) * RAW_POINT_SIZE];
+            double yHere = y[k * RAW_POINT_SIZE];
+            double yAfter = y[(k + 1) * RAW_POINT_SIZE];
+            lower[k] = after;
+            diagonal[k] = 2.0 * (before + after);
+            upper[k] = before;
+            velocity[k] = 3.0 * (after * (yHere - yBefore) / before +
+                                 before * (yAfter - yHere) / after);
+        }
+        if (n > 1)
+        {
+            lower[n - 1] = 0.0;
+            diagonal[n - 1] = 1.0;
+            velocity[n - 1] = 0.0;
+        }
+        // tridiagonal solve
+        for (int k = 1; k < n; k++)
+        {
+            double w = lower[k] / diagonal[k - 1];
+            diagonal[k] -= w * upper[k - 1];
+            velocity[k] -= w * velocity[k - 1];
+        }
+        velocity[n - 1] /= diagonal[n - 1];
+        for (int k = n - 2; k >= 0; k--)
+        {
+            velocity[k] = (velocity[k] - upper[k] * velocity[k + 1]) /
+                    diagonal[k];
+        }
+        double *a = packed + coefficientOffset(n, c, 0);
+        double *b = packed + coefficientOffset(n, c, 1);
+        double *c2 = packed + coefficientOffset(n, c, 2);
+        double *c3 = packed + coefficientOffset(n, c, 3);
+        for (int k = 0; k < n - 1; k++)
+        {
+            double h = times[k + 1] - times[k];
+            double dy = y[(k + 1) * RAW_POINT_SIZE] - y[k * RAW_POINT_SIZE];
+            a[k] = y[k * RAW_POINT_SIZE];
+            b[k] = velocity[k];
+            c2[k] = 3.0 * dy / (h * h) - (velocity[k + 1] + 2.0 * velocity[k]) / h;
+            c3[k] = -2.0 * dy / (h * h * h) +
+                    (velocity[k + 1] + velocity[k]) / (h * h);
+        }
+        a[n - 1] = y[(n - 1) * RAW_POINT_SIZE];
+        b[n - 1] = c2[n - 1] = c3[n - 1] = 0.0;
+    }
+
+    // The orientation: the keyframe orientations, each flipped if needed to
+    // be in the same hemisphere as the one before it (so that interpolation
+    // takes the short way), and the SQUAD control points between them.
+    QVector< double > orientations(4 * n);
+    for (int i = 0; i < n; i++)
+    {
+        double *q = orientations.data() + 4 * i;
+        q_copy(q, raw + i * RAW_POINT_SIZE + RAW_ORIENTATION);
+        q_normalize(q, q);
+        if (i > 0 && dot(q, q - 4) < 0)
+        {
+            for (int j = 0; j < 4; j++)
+            {
+                q[j] = -q[j];
+            }
+        }
+    }
+    for (int i = 0; i < n; i++)
+    {
+        const double *q = orientations.constData() + 4 * i;
+        q_type control;
+        if (i == 0 || i == n - 1)
+        {
+            q_copy(control, q);
+        }
+        else
+        {
+            // s = q * exp(-(log(q^-1 * q_next) + log(q^-1 * q_previous)) / 4)
+            q_type inverse, toNext, toPrevious, logNext, logPrevious, sum;
+            q_invert(inverse, q);
+            q_mult(toNext, inverse, q + 4);
+            q_mult(toPrevious, inverse, q - 4);
+            quatLog(logNext, toNext);
+            quatLog(logPrevious, toPrevious);
+            for (int j = 0; j < 4; j++)
+            {
+                sum[j] = -0.25 * (logNext[j] + logPrevious[j]);
+            }
+            q_type offset;
+            quatExp(offset, sum);
+            q_mult(control, q, offset);
+            q_normalize(control, control);
+        }
+        for (int j = 0; j < 4; j++)
+        {
+            packed[orientationOffset(n, j) + i] = q[j];
+            packed[controlOffset(n, j) + i] = control[j];
+        }
+    }
+    data = packedData;
+    computed = true;
+}
+
+int KeyframeSpline::getNumberOfPoints() const
+{
+    return numPoints;
+}
+
+double KeyframeSpline::getStartTime() const
+{
+    assert(numPoints > 0);
+    return computed ? data[timesOffset()] : data[RAW_TIME];
+}
+
+double KeyframeSpline::getEndTime() const
+{
+    assert(numPoints > 0);
+    return computed ? data[timesOffset() + numPoints - 1]
+            : data[(numPoints - 1) * RAW_POINT_SIZE + RAW_TIME];
+}
+
+int KeyframeSpline::findInterval(double t) const
+{
+    const double *times = data.constData() + timesOffset();
+    int index = std::upper_bound(times, times + numPoints, t) - times - 1;
+    return std::max(0, index);
+}
+
+void KeyframeSpline::evaluate(double t, q_vec_type position,
+                              q_type orientation) const
+{
+    assert(computed && numPoints > 0);
+    int n = numPoints;
+    const double *packed = data.constData();
+    const double *times = packed + timesOffset();
+    int i = findInterval(t);
+    double dt = (i == n - 1) ? 0.0 : std::max(0.0, t - times[i]);
+    for (int c = 0; c < 3; c++)
+    {
+        position[c] = packed[coefficientOffset(n, c, 0) + i] +
+                dt * (packed[coefficientOffset(n, c, 1) + i] +
+                      dt * (packed[coefficientOffset(n, c, 2) + i] +
+                            dt * packed[coefficientOffset(n, c, 3) + i]));
+    }
+    q_type q1, q2, s1, s2;
+    for (int j = 0; j < 4; j++)
+    {
+        q1[j] = packed[orientationOffset(n, j) + i];
+    }
+    if (i == n - 1)
+    {
+        q_copy(orientation, q1);
+        return;
+    }
+    for (int j = 0; j < 4; j++)
+    {
+        q2[j] = packed[orientationOffset(n, j) + i + 1];
+        s1[j] = packed[controlOffset(n, j) + i];
+        s2[j] = packed[controlOffset(n, j) + i + 1];
+    }
+    double h = std::min(1.0, dt / (times[i + 1] - times[i]));
+    q_type between, controlBetween;
+    slerp(between, q1, q2, h);
+    slerp(controlBetween, s1, s2, h);
+    slerp(orientation, between, controlBetween, 2.0 * h * (1.0 - h));
+}
+
+qint64 KeyframeSpline::getMemorySize() const
+{
+    return sizeof(KeyframeSpline) + data.capacity() * sizeof(double);
+}
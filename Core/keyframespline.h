@@ -0,0 +1,63 @@
+#ifndef KEYFRAMESPLINE_H
+#define KEYFRAMESPLINE_H
+
+#include <quat.h>
+
+#include <QVector>
+
+/*
+ * This class is the path of an object through a stretch of keyframes where
+ * it is not in a group.  It replaces the six vtkCardinalSplines (x, y, z,
+ * yaw, pitch, roll) that used to be made for each stretch.
+ *
+ * The position is a cubic spline through the keyframe positions with zero
+ * velocity at the first and last keyframes, the same curve vtkCardinalSpline
+ * makes with its default settings.  The orientation is interpolated between
+ * the keyframe orientations with SQUAD (spherical quadrangle interpolation),
+ * which is smooth across keyframes and always takes the short way around
+ * instead of interpolating Euler angles.
+ *
+ * Everything needed for evaluation is computed once by compute() and packed
+ * into one array: the keyframe times, then each cubic coefficient of each
+ * coordinate as its own array, then the keyframe orientations and the SQUAD
+ * control orientations, one array per quaternion component.  Evaluating finds
+ * the interval with a binary search and then reads only a few entries from
+ * each array, and the whole spline takes about 170 bytes per keyframe.
+ *
+ * Copies share their data until one of them is changed.
+ */
+class KeyframeSpline
+{
+   public:
+    KeyframeSpline();
+
+    // Adds a point, the times must be added in increasing order.  Adding a
+    // point to a computed spline is allowed, compute must be called again
+    // before it is evaluated.
+    void addPoint(double t, const q_vec_type position, const q_type orientation);
+    // Computes the coefficients, must be called after the last point is added
+    void compute();
+    int getNumberOfPoints() const;
+    double getStartTime() const;
+    double getEndTime() const;
+
+    // Evaluates the spline at time t.  Times before the first point or after
+    // the last are clamped to the first or last point.
+    void evaluate(double t, q_vec_type position, q_type orientation) const;
+
+    // Returns the approximate memory used by the spline in bytes
+    qint64 getMemorySize() const;
+
+   private:
+    // finds the index of the last point at or before t, 0 if t is before the
+    // first point
+    int findInterval(double t) const;
+
+    int numPoints;
+    bool computed;
+    // before compute, the points one after another (time, position,
+    // orientation); after compute, the packed arrays described above
+    QVector< double > data;
+};
+
+#endif  // KEYFRAMESPLINE_H
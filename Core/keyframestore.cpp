@@ -0,0 +1,285 @@
+#include "keyframestore.h"
+
+#include <algorithm>
+
+#include "keyframe.h"
+
+// how many keyframes lowerBound steps forward from the hint before it does a
+// binary search instead
+#define KEYFRAME_SEARCH_MAX_STEPS 4
+
+// flags for each keyframe
+#define VISIBLE_AFTER_FLAG 1
+#define ACTIVE_FLAG 2
+
+KeyframeStore::KeyframeStore() :
+    times(),
+    positions(),
+    orientations(),
+    colorMapIds(),
+    flags(),
+    groupedIds(),
+    grouped(),
+    colorMaps()
+{
+}
+
+int KeyframeStore::size() const
+{
+    return times.size();
+}
+
+bool KeyframeStore::isEmpty() const
+{
+    return times.isEmpty();
+}
+
+double KeyframeStore::getTime(int i) const
+{
+    return times[i];
+}
+
+int KeyframeStore::lowerBound(double t) const
+{
+    return std::lower_bound(times.constBegin(), times.constEnd(), t) -
+           times.constBegin();
+}
+
+int KeyframeStore::lowerBound(double t, int &hint) const
+{
+    int n = times.size();
+    if (hint >= 0 && hint <= n)
+    {
+        for (int step = 0; step <= KEYFRAME_SEARCH_MAX_STEPS; step++)
+        {
+            // the hint is the answer if t is after the keyframe before it and
+            // not after the keyframe itself
+            if (hint > 0 && !(times[hint - 1] < t))
+            {
+                break;
+            }
+            if (hint == n || !(times[hint] < t))
+            {
+                return hint;
+            }
+            hint++;
+        }
+    }
+    hint = lowerBound(t);
+    return hint;
+}
+
+int KeyframeStore::indexOf(double t) const
+{
+    int i = lowerBound(t);
+    return (i < times.size() && times[i] == t) ? i : -1;
+}
+
+void KeyframeStore::insert(double t, const Keyframe &frame)
+{
+    int i = lowerBound(t);
+    if (i == times.size() || times[i] != t)
+    {
+        times.insert(i, t);
+        positions.insert(3 * i, 3, 0.0);
+        orientations.insert(4 * i, 4, 0.0);
+        colorMapIds.insert(i, 0);
+        flags.insert(i, 0);
+        groupedIds.insert(i, -1);
+    }
+    frame.getPosition(positions.data() + 3 * i);
+    frame.getOrientation(orientations.data() + 4 * i);
+    colorMapIds[i] = internColorMap(frame.getColorMap());
+    flags[i] = (frame.isVisibleAfter() ? VISIBLE_AFTER_FLAG : 0) |
+               (frame.isActive() ? ACTIVE_FLAG : 0);
+    setGroupedData(i, frame);
+}
+
+bool KeyframeStore::remove(double t)
+{
+    int i = indexOf(t);
+    if (i < 0)
+    {
+        return false;
+    }
+    removeGroupedData(i);
+    times.remove(i);
+    positions.remove(3 * i, 3);
+    orientations.remove(4 * i, 4);
+    colorMapIds.remove(i);
+    flags.remove(i);
+    groupedIds.remove(i);
+    return true;
+}
+
+void KeyframeStore::clear()
+{
+    times.clear();
+    positions.clear();
+    orientations.clear();
+    colorMapIds.clear();
+    flags.clear();
+    groupedIds.clear();
+    grouped.clear();
+    colorMaps.clear();
+}
+
+Keyframe KeyframeStore::getKeyframe(int i) const
+{
+    q_vec_type pos, absPos;
+    q_type orient, absOrient;
+    getPosition(i, pos);
+    getAbsolutePosition(i, absPos);
+    getOrientation(i, orient);
+    getAbsoluteOrientation(i, absOrient);
+    const ColorMapType::ColorMap &cmap = getColorMap(i);
+    return Keyframe(pos, absPos, orient, absOrient, cmap.first, cmap.second,
+                    getLevel(i), getParent(i), isVisibleAfter(i), isActive(i));
+}
+
+void KeyframeStore::getPosition(int i, q_vec_type pos) const
+{
+    q_vec_copy(pos, positions.constData() + 3 * i);
+}
+
+void KeyframeStore::getAbsolutePosition(int i, q_vec_type pos) const
+{
+    int g = groupedIds[i];
+    if (g < 0)
+    {
+        getPosition(i, pos);
+    }
+    else
+    {
+        q_vec_copy(pos, grouped[g].absolutePosition);
+    }
+}
+
+void KeyframeStore::getOrientation(int i, q_type orient) const
+{
+    q_copy(orient, orientations.constData() + 4 * i);
+}
+
+void KeyframeStore::getAbsoluteOrientation(int i, q_type orient) const
+{
+    int g = groupedIds[i];
+    if (g < 0)
+    {
+        getOrientation(i, orient);
+    }
+    else
+    {
+        q_copy(orient, grouped[g].absoluteOrientation);
+    }
+}
+
+const ColorMapType::ColorMap &KeyframeStore::getColorMap(int i) const
+{
+    return colorMaps[colorMapIds[i]];
+}
+
+bool KeyframeStore::isVisibleAfter(int i) const
+{
+    return (flags[i] & VISIBLE_AFTER_FLAG) != 0;
+}
+
+bool KeyframeStore::isActive(int i) const
+{
+    return (flags[i] & ACTIVE_FLAG) != 0;
+}
+
+int KeyframeStore::getLevel(int i) const
+{
+    int g = groupedIds[i];
+    return (g < 0) ? 0 : grouped[g].level;
+}
+
+SketchObject *KeyframeStore::getParent(int i) const
+{
+    int g = groupedIds[i];
+    return (g < 0) ? NULL : grouped[g].parent;
+}
+
+qint64 KeyframeStore::getMemorySize() const
+{
+    qint64 size = sizeof(KeyframeStore);
+    size += times.capacity() * sizeof(double);
+    size += positions.capacity() * sizeof(double);
+    size += orientations.capacity() * sizeof(double);
+    size += colorMapIds.capacity() * sizeof(int);
+    size += flags.capacity() * sizeof(quint8);
+    size += groupedIds.capacity() * sizeof(int);
+    size += grouped.capacity() * sizeof(GroupedData);
+    // the array names are shared with the objects, so only count the list
+    size += colorMaps.size() *
+            (sizeof(void *) + sizeof(ColorMapType::ColorMap));
+    return size;
+}
+
+void KeyframeStore::setGroupedData(int i, const Keyframe &frame)
+{
+    q_vec_type pos, absPos;
+    q_type orient, absOrient;
+    frame.getPosition(pos);
+    frame.getAbsolutePosition(absPos);
+    frame.getOrientation(orient);
+    frame.getAbsoluteOrientation(absOrient);
+    bool needed = frame.getLevel() != 0 || frame.getParent() != NULL;
+    for (int j = 0; j < 3 && !needed; j++)
+    {
+        needed = pos[j] != absPos[j];
+    }
+    for (int j = 0; j < 4 && !needed; j++)
+    {
+        needed = orient[j] != absOrient[j];
+    }
+    if (!needed)
+    {
+        removeGroupedData(i);
+        return;
+    }
+    if (groupedIds[i] < 0)
+    {
+        groupedIds[i] = grouped.size();
+        grouped.append(GroupedData());
+    }
+    GroupedData &data = grouped[groupedIds[i]];
+    q_vec_copy(data.absolutePosition, absPos);
+    q_copy(data.absoluteOrientation, absOrient);
+    data.parent = frame.getParent();
+    data.level = frame.getLevel();
+}
+
+void KeyframeStore::removeGroupedData(int i)
+{
+    int g = groupedIds[i];
+    if (g < 0)
+    {
+        return;
+    }
+    groupedIds[i] = -1;
+    // move the last entry into the hole so the array stays packed
+    int last = grouped.size() - 1;
+    if (g != last)
+    {
+        grouped[g] = grouped[last];
+        *std::find(groupedIds.begin(), groupedIds.end(), last) = g;
+    }
+    grouped.remove(last);
+}
+
+int KeyframeStore::internColorMap(const ColorMapType::ColorMap &cmap)
+{
+    // compare the array names too, ColorMap's == ignores them for solid
+    // colors but they are saved with the keyframes
+    for (int i = 0; i < colorMaps.size(); i++)
+    {
+        if (colorMaps[i].first == cmap.first &&
+            colorMaps[i].second == cmap.second)
+        {
+            return i;
+        }
+    }
+    colorMaps.append(cmap);
+    return colorMaps.size() - 1;
+}
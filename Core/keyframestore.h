@@ -0,0 +1,98 @@
+#ifndef KEYFRAMESTORE_H
+#define KEYFRAMESTORE_H
+
+#include <quat.h>
+
+#include <QVector>
+#include <QList>
+
+#include "colormaptype.h"
+
+class Keyframe;
+class SketchObject;
+
+/*
+ * This class holds the keyframes of one object in arrays sorted by time,
+ * instead of one map node per keyframe.  The times, relative poses, colors
+ * and flags are each in their own contiguous array, so stepping through the
+ * keyframes during playback reads memory in order.
+ *
+ * Most keyframes are of objects that are not in a group, and for those the
+ * absolute pose is the same as the relative one.  So the absolute pose,
+ * grouping level and parent are only stored (in a separate array) for the
+ * keyframes that need them.  Color maps are interned: each keyframe holds
+ * the index of its color map in a table of the distinct color maps in the
+ * store.
+ */
+class KeyframeStore
+{
+   public:
+    KeyframeStore();
+
+    int size() const;
+    bool isEmpty() const;
+    // the time of keyframe i (the keyframes are sorted by time)
+    double getTime(int i) const;
+    // Returns the index of the first keyframe at or after time t, or size()
+    // if there is none.  The version with a hint starts from the index in the
+    // hint and steps forward a few keyframes before falling back on a binary
+    // search, so times that usually increase a little at a time (like the
+    // times looked up while an animation plays) are found in constant time.
+    // The hint is set to the result.
+    int lowerBound(double t) const;
+    int lowerBound(double t, int &hint) const;
+    // Returns the index of the keyframe at time t, or -1 if there is none
+    int indexOf(double t) const;
+
+    // Adds the keyframe at time t, replacing the one at that time if there is
+    // one
+    void insert(double t, const Keyframe &frame);
+    // Removes the keyframe at time t.  Returns false if there was none.
+    bool remove(double t);
+    void clear();
+
+    // Gets a copy of keyframe i
+    Keyframe getKeyframe(int i) const;
+    void getPosition(int i, q_vec_type pos) const;
+    void getAbsolutePosition(int i, q_vec_type pos) const;
+    void getOrientation(int i, q_type orient) const;
+    void getAbsoluteOrientation(int i, q_type orient) const;
+    const ColorMapType::ColorMap &getColorMap(int i) const;
+    bool isVisibleAfter(int i) const;
+    bool isActive(int i) const;
+    int getLevel(int i) const;
+    SketchObject *getParent(int i) const;
+
+    // Returns the approximate memory used by the store in bytes
+    qint64 getMemorySize() const;
+
+   private:
+    // the parts of a keyframe that are only stored if the object is in a
+    // group or its absolute pose is not the same as its relative pose
+    struct GroupedData
+    {
+        double absolutePosition[3];
+        double absoluteOrientation[4];
+        SketchObject *parent;
+        int level;
+    };
+
+    void setGroupedData(int i, const Keyframe &frame);
+    void removeGroupedData(int i);
+    int internColorMap(const ColorMapType::ColorMap &cmap);
+
+    QVector< double > times;
+    // 3 per keyframe
+    QVector< double > positions;
+    // 4 per keyframe
+    QVector< double > orientations;
+    // index into colorMaps
+    QVector< int > colorMapIds;
+    QVector< quint8 > flags;
+    // index into grouped, or -1 if the keyframe has no grouped data
+    QVector< int > groupedIds;
+    QVector< GroupedData > grouped;
+    QList< ColorMapType::ColorMap > colorMaps;
+};
+
+#endif // KEYFRAMESTORE_H
@@ -0,0 +1,69 @@
+#ifndef MAPCURSOR_H
+#define MAPCURSOR_H
+
+#include <QMap>
+
+// how many entries a cursor steps forward before it gives up and does a
+// binary search instead
+#define MAP_CURSOR_MAX_STEPS 4
+
+/*
+ * This class is a cursor for looking up keys in a QMap when the keys looked
+ * up usually increase a little at a time, like the times looked up in an
+ * object's keyframes while an animation plays.
+ *
+ * The cursor remembers where the last lookup ended.  If the next key is in
+ * the same place or a few entries further on, it is found by stepping
+ * forward from there, otherwise (after a seek) by a binary search.  So
+ * playing an animation forward takes constant time per lookup no matter how
+ * many keyframes there are.
+ *
+ * The cursor holds an iterator into the map, so it must be reset whenever
+ * the map changes.
+ */
+template < typename Key, typename T >
+class MapCursor
+{
+   public:
+    typedef typename QMap< Key, T >::const_iterator const_iterator;
+
+    MapCursor() : map(NULL), previousKey() {}
+    // forgets where the last lookup ended, must be called whenever the map
+    // changes
+    void reset() { map = NULL; }
+    // returns the first entry with a key at or after the given key, or the
+    // end of the map if there is none (the same as QMap::lowerBound)
+    const_iterator lowerBound(const QMap< Key, T > &m, const Key &key)
+    {
+        if (map == &m) {
+            for (int step = 0; step <= MAP_CURSOR_MAX_STEPS; step++) {
+                // the remembered entry is the answer if the key is after the
+                // entry before it and not after the entry itself
+                if (current != m.constBegin() && !(previousKey < key)) {
+                    break;
+                }
+                if (current == m.constEnd() || !(current.key() < key)) {
+                    return current;
+                }
+                previousKey = current.key();
+                ++current;
+            }
+        }
+        map = &m;
+        current = m.lowerBound(key);
+        if (current != m.constBegin()) {
+            const_iterator previous = current;
+            --previous;
+            previousKey = previous.key();
+        }
+        return current;
+    }
+
+   private:
+    const QMap< Key, T > *map;
+    const_iterator current;
+    // the key of the entry before current, if there is one
+    Key previousKey;
+};
+
+#endif  // MAPCURSOR_H
@@ -0,0 +1,874 @@
+#include "meshdecimator.h"
+
+#include <cmath>
+#include <queue>
+#include <algorithm>
+
+#include <vtkPolyData.h>
+#include <vtkCellArray.h>
+#include <vtkPoints.h>
+#include <vtkPointData.h>
+#include <vtkTriangleFilter.h>
+
+#include <QVarLengthArray>
+#include <QHash>
+#include <QtConcurrentMap>
+#include <QThread>
+
+// surfaces are only split if each partition would have at least this many
+// triangles
+#define MIN_TRIANGLES_PER_PARTITION 20000
+// partitions are simplified until the whole surface has this many times the
+// largest target triangle count, the rest is done after they are joined
+#define PARTITION_TARGET_FACTOR 2
+// how much more the planes that hold the surface boundaries in place count
+// than the triangles' own planes
+#define BOUNDARY_WEIGHT 1000.0
+
+namespace MeshDecimator
+{
+
+//###############################################################
+// Quadrics
+//
+// A quadric is stored as the upper triangle of the symmetric 4x4 matrix
+// [a2 ab ac ad; ab b2 bc bd; ac bc c2 cd; ad bd cd d2]
+struct Quadric
+{
+    double q[10];
+};
+
+static inline void setZero(Quadric &k)
+{
+    for (int i = 0; i < 10; i++)
+    {
+        k.q[i] = 0.0;
+    }
+}
+
+static inline void addTo(Quadric &k, const Quadric &other)
+{
+    for (int i = 0; i < 10; i++)
+    {
+        k.q[i] += other.q[i];
+    }
+}
+
+// Adds the squared distance to the plane n.x + d = 0 (times the weight)
+static inline void addPlane(Quadric &k, const double n[3], double d,
+                            double weight)
+{
+    k.q[0] += weight * n[0] * n[0];
+    k.q[1] += weight * n[0] * n[1];
+    k.q[2] += weight * n[0] * n[2];
+    k.q[3] += weight * n[0] * d;
+    k.q[4] += weight * n[1] * n[1];
+    k.q[5] += weight * n[1] * n[2];
+    k.q[6] += weight * n[1] * d;
+    k.q[7] += weight * n[2] * n[2];
+    k.q[8] += weight * n[2] * d;
+    k.q[9] += weight * d * d;
+}
+
+static inline double evaluate(const Quadric &k, const double p[3])
+{
+    const double *q = k.q;
+    double x = p[0], y = p[1], z = p[2];
+    double e = q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z +
+               2 * q[3] * x + q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y +
+               q[7] * z * z + 2 * q[8] * z + q[9];
+    return std::max(e, 0.0);
+}
+
+// Finds the point with the least error for the quadric.  Returns false if
+// there is no single best point (the matrix is nearly singular).
+static bool optimize(const Quadric &k, double p[3])
+{
+    const double *q = k.q;
+    double a = q[0], b = q[1], c = q[2];
+    double e = q[4], f = q[5], h = q[7];
+    double c00 = e * h - f * f;
+    double c01 = c * f - b * h;
+    double c02 = b * f - c * e;
+    double det = a * c00 + b * c01 + c * c02;
+    double trace = a + e + h;
+    if (std::fabs(det) <= 1e-9 * trace * trace * trace)
+    {
+        return false;
+    }
+    double c11 = a * h - c * c;
+    double c12 = b * c - a * f;
+    double c22 = a * e - b * b;
+    double r0 = -q[3], r1 = -q[6], r2 = -q[8];
+    p[0] = (c00 * r0 + c01 * r1 + c02 * r2) / det;
+    p[1] = (c01 * r0 + c11 * r1 + c12 * r2) / det;
+    p[2] = (c02 * r0 + c12 * r1 + c22 * r2) / det;
+    return true;
+}
+
+static inline void cross(const double a[3], const double b[3], double r[3])
+{
+    r[0] = a[1] * b[2] - a[2] * b[1];
+    r[1] = a[2] * b[0] - a[0] * b[2];
+    r[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static inline double dot(const double a[3], const double b[3])
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static inline void triangleNormal(const double *p1, const double *p2,
+                                  const double *p3, double n[3])
+{
+    double u[3] = {p2[0] - p1[0], p2[1] - p1[1], p2[2] - p1[2]};
+    double v[3] = {p3[0] - p1[0], p3[1] - p1[1], p3[2] - p1[2]};
+    cross(u, v, n);
+}
+
+//###############################################################
+// The triangle mesh that is simplified.  Vertices remember the id of the input
+// point they started as so the point data can be copied when the result is
+// made.
+
+struct MeshData
+{
+    QVector< double > positions;     // 3 per vertex
+    QVector< vtkIdType > inputIds;   // input point id of each vertex
+    QVector< char > locked;          // vertices that may not move
+    QVector< int > triangles;        // 3 vertex indices per triangle
+};
+
+// A possible edge collapse, the versions tell if either vertex has changed
+// since the collapse was computed
+struct Collapse
+{
+    double cost;
+    double position[3];
+    int v1, v2;
+    int version1, version2;
+    bool operator<(const Collapse &other) const
+    {
+        // so that the priority queue puts the cheapest collapse on top
+        return cost > other.cost;
+    }
+};
+
+class QuadricMesh
+{
+   public:
+    explicit QuadricMesh(const MeshData &data);
+    // Collapses edges until there are no more than the given number of
+    // triangles left (or no more edges can be collapsed)
+    void decimateTo(int targetTriangles);
+    int getNumberOfTriangles() const { return liveTriangles; }
+    // Gets the remaining vertices and triangles (with no gaps in the indices)
+    void getResult(MeshData &result) const;
+
+   private:
+    void addBoundaryPlanes();
+    void addCollapsesFor(int v);
+    bool computeCollapse(int v1, int v2, Collapse &c) const;
+    void getNeighbors(int v, QVarLengthArray< int, 32 > &neighbors) const;
+    bool canCollapse(const Collapse &c) const;
+    void collapse(const Collapse &c);
+    inline bool hasVertex(int t, int v) const
+    {
+        return tris[3 * t] == v || tris[3 * t + 1] == v || tris[3 * t + 2] == v;
+    }
+
+    QVector< double > pos;
+    QVector< vtkIdType > inputIds;
+    QVector< char > locked;
+    QVector< char > vertexRemoved;
+    QVector< int > versions;
+    QVector< Quadric > quadrics;
+    QVector< int > tris;
+    QVector< char > triRemoved;
+    QVector< QVector< int > > vertexTris;
+    std::priority_queue< Collapse > collapses;
+    int liveTriangles;
+};
+
+QuadricMesh::QuadricMesh(const MeshData &data) :
+    pos(data.positions),
+    inputIds(data.inputIds),
+    locked(data.locked),
+    vertexRemoved(data.inputIds.size(), 0),
+    versions(data.inputIds.size(), 0),
+    quadrics(data.inputIds.size()),
+    tris(data.triangles),
+    triRemoved(data.triangles.size() / 3, 0),
+    vertexTris(data.inputIds.size()),
+    liveTriangles(data.triangles.size() / 3)
+{
+    int numVerts = inputIds.size();
+    for (int v = 0; v < numVerts; v++)
+    {
+        setZero(quadrics[v]);
+    }
+    for (int t = 0; t < liveTriangles; t++)
+    {
+        const double *p1 = &pos[3 * tris[3 * t]];
+        double n[3];
+        triangleNormal(p1, &pos[3 * tris[3 * t + 1]], &pos[3 * tris[3 * t + 2]],
+                       n);
+        double len = std::sqrt(dot(n, n));
+        for (int k = 0; k < 3; k++)
+        {
+            vertexTris[tris[3 * t + k]].append(t);
+        }
+        if (len == 0.0)
+        {
+            continue;
+        }
+        n[0] /= len;
+        n[1] /= len;
+        n[2] /= len;
+        // weight each plane by the area of its triangle
+        Quadric k;
+        setZero(k);
+        addPlane(k, n, -dot(n, p1), len * 0.5);
+        for (int j = 0; j < 3; j++)
+        {
+            addTo(quadrics[tris[3 * t + j]], k);
+        }
+    }
+    addBoundaryPlanes();
+    for (int v = 0; v < numVerts; v++)
+    {
+        addCollapsesFor(v);
+    }
+}
+
+// An edge used by only one triangle is on the boundary of the surface.  To
+// keep the boundary from shrinking, add a heavily weighted plane through the
+// edge perpendicular to the triangle.
+void QuadricMesh::addBoundaryPlanes()
+{
+    int numVerts = inputIds.size();
+    for (int v = 0; v < numVerts; v++)
+    {
+        const QVector< int > &around = vertexTris[v];
+        for (int i = 0; i < around.size(); i++)
+        {
+            int t = around[i];
+            for (int k = 0; k < 3; k++)
+            {
+                int w = tris[3 * t + k];
+                if (w <= v)
+                {
+                    continue;
+                }
+                int count = 0;
+                for (int j = 0; j < around.size(); j++)
+                {
+                    if (hasVertex(around[j], w))
+                    {
+                        count++;
+                    }
+                }
+                if (count != 1)
+                {
+                    continue;
+                }
+                double n[3], e[3], perp[3];
+                triangleNormal(&pos[3 * tris[3 * t]], &pos[3 * tris[3 * t + 1]],
+                               &pos[3 * tris[3 * t + 2]], n);
+                for (int j = 0; j < 3; j++)
+                {
+                    e[j] = pos[3 * w + j] - pos[3 * v + j];
+                }
+                cross(e, n, perp);
+                double len = std::sqrt(dot(perp, perp));
+                if (len == 0.0)
+                {
+                    continue;
+                }
+                perp[0] /= len;
+                perp[1] /= len;
+                perp[2] /= len;
+                Quadric k2;
+                setZero(k2);
+                addPlane(k2, perp, -dot(perp, &pos[3 * v]),
+                         BOUNDARY_WEIGHT * dot(e, e));
+                addTo(quadrics[v], k2);
+                addTo(quadrics[w], k2);
+            }
+        }
+    }
+}
+
+void QuadricMesh::getNeighbors(int v, QVarLengthArray< int, 32 > &neighbors) const
+{
+    neighbors.clear();
+    const QVector< int > &around = vertexTris[v];
+    for (int i = 0; i < around.size(); i++)
+    {
+        int t = around[i];
+        if (triRemoved[t])
+        {
+            continue;
+        }
+        for (int k = 0; k < 3; k++)
+        {
+            int w = tris[3 * t + k];
+            if (w == v)
+            {
+                continue;
+            }
+            bool found = false;
+            for (int j = 0; j < neighbors.size() && !found; j++)
+            {
+                found = (neighbors[j] == w);
+            }
+            if (!found)
+            {
+                neighbors.append(w);
+            }
+        }
+    }
+}
+
+void QuadricMesh::addCollapsesFor(int v)
+{
+    QVarLengthArray< int, 32 > neighbors;
+    getNeighbors(v, neighbors);
+    for (int i = 0; i < neighbors.size(); i++)
+    {
+        Collapse c;
+        if (computeCollapse(v, neighbors[i], c))
+        {
+            collapses.push(c);
+        }
+    }
+}
+
+bool QuadricMesh::computeCollapse(int v1, int v2, Collapse &c) const
+{
+    if (locked[v1] && locked[v2])
+    {
+        return false;
+    }
+    Quadric k = quadrics[v1];
+    addTo(k, quadrics[v2]);
+    const double *p1 = &pos[3 * v1];
+    const double *p2 = &pos[3 * v2];
+    if (locked[v1] || locked[v2])
+    {
+        const double *p = locked[v1] ? p1 : p2;
+        c.position[0] = p[0];
+        c.position[1] = p[1];
+        c.position[2] = p[2];
+    }
+    else if (!optimize(k, c.position))
+    {
+        // pick the best of the endpoints and the midpoint
+        double mid[3] = {(p1[0] + p2[0]) * 0.5, (p1[1] + p2[1]) * 0.5,
+                         (p1[2] + p2[2]) * 0.5};
+        const double *options[3] = {p1, p2, mid};
+        double best = -1.0;
+        for (int i = 0; i < 3; i++)
+        {
+            double e = evaluate(k, options[i]);
+            if (best < 0.0 || e < best)
+            {
+                best = e;
+                c.position[0] = options[i][0];
+                c.position[1] = options[i][1];
+                c.position[2] = options[i][2];
+            }
+        }
+    }
+    c.cost = evaluate(k, c.position);
+    c.v1 = v1;
+    c.v2 = v2;
+    c.version1 = versions[v1];
+    c.version2 = versions[v2];
+    return true;
+}
+
+bool QuadricMesh::canCollapse(const Collapse &c) const
+{
+    // the link condition: the only vertices next to both ends of the edge
+    // must be the third vertices of the triangles on the edge, otherwise the
+    // collapse would pinch the surface
+    QVarLengthArray< int, 32 > n1, n2;
+    getNeighbors(c.v1, n1);
+    getNeighbors(c.v2, n2);
+    // when moving a vertex onto a locked one, every edge between locked
+    // vertices must stay as it is, since the partition next to this one has
+    // the same edges.  So the moving vertex must not be next to any other
+    // locked vertex (its triangles with them would either be removed or would
+    // make new edges between locked vertices).
+    if (locked[c.v1] != locked[c.v2])
+    {
+        const QVarLengthArray< int, 32 > &moving = locked[c.v1] ? n2 : n1;
+        int fixed = locked[c.v1] ? c.v1 : c.v2;
+        for (int i = 0; i < moving.size(); i++)
+        {
+            if (locked[moving[i]] && moving[i] != fixed)
+            {
+                return false;
+            }
+        }
+    }
+    int common = 0;
+    for (int i = 0; i < n1.size(); i++)
+    {
+        for (int j = 0; j < n2.size(); j++)
+        {
+            if (n1[i] == n2[j])
+            {
+                common++;
+            }
+        }
+    }
+    int shared = 0;
+    const int ends[2] = {c.v1, c.v2};
+    for (int e = 0; e < 2; e++)
+    {
+        int v = ends[e], other = ends[1 - e];
+        const QVector< int > &around = vertexTris[v];
+        for (int i = 0; i < around.size(); i++)
+        {
+            int t = around[i];
+            if (triRemoved[t])
+            {
+                continue;
+            }
+            if (hasVertex(t, other))
+            {
+                if (e == 0)
+                {
+                    shared++;
+                }
+                continue;
+            }
+            // make sure the triangle does not flip over when v moves
+            double oldN[3], newN[3];
+            const double *p[3], *q[3];
+            for (int k = 0; k < 3; k++)
+            {
+                int w = tris[3 * t + k];
+                p[k] = &pos[3 * w];
+                q[k] = (w == v) ? c.position : p[k];
+            }
+            triangleNormal(p[0], p[1], p[2], oldN);
+            triangleNormal(q[0], q[1], q[2], newN);
+            double d = dot(oldN, newN);
+            if (d <= 0.0 || dot(newN, newN) == 0.0)
+            {
+                return false;
+            }
+        }
+    }
+    return shared > 0 && common == shared;
+}
+
+void QuadricMesh::collapse(const Collapse &c)
+{
+    // keep the vertex closer to the new position (unless one of them is
+    // locked) so the point data comes from the closest input point
+    int keep = c.v1, remove = c.v2;
+    if (locked[c.v2])
+    {
+        std::swap(keep, remove);
+    }
+    else if (!locked[c.v1])
+    {
+        double d1 = 0.0, d2 = 0.0;
+        for (int k = 0; k < 3; k++)
+        {
+            double a = pos[3 * c.v1 + k] - c.position[k];
+            double b = pos[3 * c.v2 + k] - c.position[k];
+            d1 += a * a;
+            d2 += b * b;
+        }
+        if (d2 < d1)
+        {
+            std::swap(keep, remove);
+        }
+    }
+    for (int k = 0; k < 3; k++)
+    {
+        pos[3 * keep + k] = c.position[k];
+    }
+    addTo(quadrics[keep], quadrics[remove]);
+    vertexRemoved[remove] = 1;
+    QVector< int > &keptTris = vertexTris[keep];
+    const QVector< int > &removedTris = vertexTris[remove];
+    for (int i = 0; i < removedTris.size(); i++)
+    {
+        int t = removedTris[i];
+        if (triRemoved[t])
+        {
+            continue;
+        }
+        if (hasVertex(t, keep))
+        {
+            triRemoved[t] = 1;
+            liveTriangles--;
+            continue;
+        }
+        for (int k = 0; k < 3; k++)
+        {
+            if (tris[3 * t + k] == remove)
+            {
+                tris[3 * t + k] = keep;
+            }
+        }
+        keptTris.append(t);
+    }
+    vertexTris[remove].clear();
+    // drop the removed triangles from the kept vertex's list
+    int j = 0;
+    for (int i = 0; i < keptTris.size(); i++)
+    {
+        if (!triRemoved[keptTris[i]])
+        {
+            keptTris[j++] = keptTris[i];
+        }
+    }
+    keptTris.resize(j);
+    versions[keep]++;
+    addCollapsesFor(keep);
+}
+
+void QuadricMesh::decimateTo(int targetTriangles)
+{
+    while (liveTriangles > targetTriangles && !collapses.empty())
+    {
+        Collapse c = collapses.top();
+        collapses.pop();
+        if (vertexRemoved[c.v1] || vertexRemoved[c.v2] ||
+                versions[c.v1] != c.version1 || versions[c.v2] != c.version2)
+        {
+            continue;
+        }
+        if (!canCollapse(c))
+        {
+            continue;
+        }
+        collapse(c);
+    }
+}
+
+void QuadricMesh::getResult(MeshData &result) const
+{
+    int numVerts = inputIds.size();
+    QVector< int > newIndex(numVerts, -1);
+    result.positions.clear();
+    result.inputIds.clear();
+    result.locked.clear();
+    result.triangles.clear();
+    for (int v = 0; v < numVerts; v++)
+    {
+        if (vertexRemoved[v] || vertexTris[v].isEmpty())
+        {
+            continue;
+        }
+        newIndex[v] = result.inputIds.size();
+        result.positions.append(pos[3 * v]);
+        result.positions.append(pos[3 * v + 1]);
+        result.positions.append(pos[3 * v + 2]);
+        result.inputIds.append(inputIds[v]);
+        result.locked.append(locked[v]);
+    }
+    result.triangles.reserve(3 * liveTriangles);
+    for (int t = 0; t < triRemoved.size(); t++)
+    {
+        if (triRemoved[t])
+        {
+            continue;
+        }
+        for (int k = 0; k < 3; k++)
+        {
+            result.triangles.append(newIndex[tris[3 * t + k]]);
+        }
+    }
+}
+
+//###############################################################
+// Partitions
+
+struct Partition
+{
+    MeshData data;
+    int target;
+};
+
+static void simplifyPartition(Partition &p)
+{
+    QuadricMesh mesh(p.data);
+    mesh.decimateTo(p.target);
+    mesh.getResult(p.data);
+}
+
+struct TriangleKey
+{
+    double key;
+    int triangle;
+    bool operator<(const TriangleKey &other) const
+    {
+        return key < other.key;
+    }
+};
+
+// Splits the triangles into slabs along the longest side of the bounding box,
+// simplifies the slabs in parallel and joins them back together.  Vertices
+// used by triangles in more than one slab are locked so the slabs still fit
+// together afterwards.
+static void simplifyInPartitions(MeshData &mesh, int numPartitions,
+                                 int targetTriangles)
+{
+    int numVerts = mesh.inputIds.size();
+    int numTris = mesh.triangles.size() / 3;
+    double lo[3], hi[3];
+    for (int k = 0; k < 3; k++)
+    {
+        lo[k] = hi[k] = mesh.positions[k];
+    }
+    for (int v = 1; v < numVerts; v++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            lo[k] = std::min(lo[k], mesh.positions[3 * v + k]);
+            hi[k] = std::max(hi[k], mesh.positions[3 * v + k]);
+        }
+    }
+    int axis = 0;
+    for (int k = 1; k < 3; k++)
+    {
+        if (hi[k] - lo[k] > hi[axis] - lo[axis])
+        {
+            axis = k;
+        }
+    }
+    QVector< TriangleKey > order(numTris);
+    for (int t = 0; t < numTris; t++)
+    {
+        order[t].triangle = t;
+        order[t].key = mesh.positions[3 * mesh.triangles[3 * t] + axis] +
+                       mesh.positions[3 * mesh.triangles[3 * t + 1] + axis] +
+                       mesh.positions[3 * mesh.triangles[3 * t + 2] + axis];
+    }
+    std::sort(order.begin(), order.end());
+
+    // find the vertices on the borders between partitions
+    QVector< int > owner(numVerts, -1);
+    QVector< char > locked(mesh.locked);
+    for (int p = 0; p < numPartitions; p++)
+    {
+        int first = (qint64)numTris * p / numPartitions;
+        int last = (qint64)numTris * (p + 1) / numPartitions;
+        for (int i = first; i < last; i++)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                int v = mesh.triangles[3 * order[i].triangle + k];
+                if (owner[v] == -1)
+                {
+                    owner[v] = p;
+                }
+                else if (owner[v] != p)
+                {
+                    locked[v] = 1;
+                }
+            }
+        }
+    }
+
+    QVector< Partition > partitions(numPartitions);
+    QVector< int > localIndex(numVerts, -1);
+    QVector< int > addedTo(numVerts, -1);
+    for (int p = 0; p < numPartitions; p++)
+    {
+        int first = (qint64)numTris * p / numPartitions;
+        int last = (qint64)numTris * (p + 1) / numPartitions;
+        MeshData &data = partitions[p].data;
+        data.triangles.reserve(3 * (last - first));
+        for (int i = first; i < last; i++)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                int v = mesh.triangles[3 * order[i].triangle + k];
+                if (addedTo[v] != p)
+                {
+                    addedTo[v] = p;
+                    localIndex[v] = data.inputIds.size();
+                    data.positions.append(mesh.positions[3 * v]);
+                    data.positions.append(mesh.positions[3 * v + 1]);
+                    data.positions.append(mesh.positions[3 * v + 2]);
+                    data.inputIds.append(mesh.inputIds[v]);
+                    data.locked.append(locked[v]);
+                }
+                data.triangles.append(localIndex[v]);
+            }
+        }
+        partitions[p].target =
+                (qint64)targetTriangles * (last - first) / numTris;
+    }
+
+    QtConcurrent::blockingMap(partitions, simplifyPartition);
+
+    // join the partitions, locked vertices are in more than one of them but
+    // are at the same place in all of them
+    QHash< vtkIdType, int > joined;
+    MeshData result;
+    for (int p = 0; p < numPartitions; p++)
+    {
+        const MeshData &data = partitions[p].data;
+        QVector< int > index(data.inputIds.size());
+        for (int v = 0; v < data.inputIds.size(); v++)
+        {
+            if (data.locked[v] && joined.contains(data.inputIds[v]))
+            {
+                index[v] = joined.value(data.inputIds[v]);
+                continue;
+            }
+            index[v] = result.inputIds.size();
+            if (data.locked[v])
+            {
+                joined.insert(data.inputIds[v], index[v]);
+            }
+            result.positions.append(data.positions[3 * v]);
+            result.positions.append(data.positions[3 * v + 1]);
+            result.positions.append(data.positions[3 * v + 2]);
+            result.inputIds.append(data.inputIds[v]);
+            result.locked.append(0);
+        }
+        for (int i = 0; i < data.triangles.size(); i++)
+        {
+            result.triangles.append(index[data.triangles[i]]);
+        }
+    }
+    mesh = result;
+}
+
+//###############################################################
+
+static vtkSmartPointer< vtkPolyData > makePolyData(const MeshData &data,
+                                                   vtkPolyData *input)
+{
+    vtkSmartPointer< vtkPolyData > output = vtkSmartPointer< vtkPolyData >::New();
+    vtkSmartPointer< vtkPoints > points = vtkSmartPointer< vtkPoints >::New();
+    points->SetDataType(input->GetPoints()->GetDataType());
+    int numVerts = data.inputIds.size();
+    points->SetNumberOfPoints(numVerts);
+    for (int v = 0; v < numVerts; v++)
+    {
+        points->SetPoint(v, &data.positions[3 * v]);
+    }
+    output->SetPoints(points);
+    vtkSmartPointer< vtkCellArray > polys = vtkSmartPointer< vtkCellArray >::New();
+    int numTris = data.triangles.size() / 3;
+    polys->Allocate(polys->EstimateSize(numTris, 3));
+    for (int t = 0; t < numTris; t++)
+    {
+        vtkIdType ids[3] = {data.triangles[3 * t], data.triangles[3 * t + 1],
+                            data.triangles[3 * t + 2]};
+        polys->InsertNextCell(3, ids);
+    }
+    output->SetPolys(polys);
+    vtkPointData *inPD = input->GetPointData();
+    vtkPointData *outPD = output->GetPointData();
+    outPD->CopyAllocate(inPD, numVerts);
+    for (int v = 0; v < numVerts; v++)
+    {
+        outPD->CopyData(inPD, data.inputIds[v], v);
+    }
+    return output;
+}
+
+struct TargetOrder
+{
+    int target;
+    int index;
+    bool operator<(const TargetOrder &other) const
+    {
+        // largest first
+        return target > other.target;
+    }
+};
+
+QVector< vtkSmartPointer< vtkPolyData > > decimate(
+        vtkPolyData *input, const QVector< int > &targetTriangles,
+        bool parallel)
+{
+    QVector< vtkSmartPointer< vtkPolyData > > results(targetTriangles.size());
+    // split polygons and strips into triangles, this keeps the same points
+    vtkSmartPointer< vtkTriangleFilter > triangles =
+            vtkSmartPointer< vtkTriangleFilter >::New();
+    triangles->SetInputData(input);
+    triangles->PassVertsOff();
+    triangles->PassLinesOff();
+    triangles->Update();
+    vtkPolyData *triangulated = triangles->GetOutput();
+
+    MeshData mesh;
+    int numVerts = triangulated->GetNumberOfPoints();
+    mesh.positions.resize(3 * numVerts);
+    mesh.inputIds.resize(numVerts);
+    mesh.locked.fill(0, numVerts);
+    for (int v = 0; v < numVerts; v++)
+    {
+        triangulated->GetPoint(v, &mesh.positions[3 * v]);
+        mesh.inputIds[v] = v;
+    }
+    vtkCellArray *polys = triangulated->GetPolys();
+    const vtkIdType *cells = polys->GetPointer();
+    vtkIdType loc = 0;
+    mesh.triangles.reserve(3 * polys->GetNumberOfCells());
+    for (vtkIdType i = 0; i < polys->GetNumberOfCells(); i++)
+    {
+        const vtkIdType *ids = &cells[loc + 1];
+        // leave out degenerate triangles
+        if (cells[loc] == 3 && ids[0] != ids[1] && ids[1] != ids[2] &&
+                ids[0] != ids[2])
+        {
+            mesh.triangles.append(ids[0]);
+            mesh.triangles.append(ids[1]);
+            mesh.triangles.append(ids[2]);
+        }
+        loc += cells[loc] + 1;
+    }
+    if (mesh.triangles.isEmpty() || targetTriangles.isEmpty())
+    {
+        for (int i = 0; i < results.size(); i++)
+        {
+            results[i] = vtkSmartPointer< vtkPolyData >::New();
+            results[i]->DeepCopy(triangulated);
+        }
+        return results;
+    }
+
+    QVector< TargetOrder > order(targetTriangles.size());
+    for (int i = 0; i < targetTriangles.size(); i++)
+    {
+        order[i].target = targetTriangles[i];
+        order[i].index = i;
+    }
+    std::sort(order.begin(), order.end());
+
+    int numTris = mesh.triangles.size() / 3;
+    int intermediate = PARTITION_TARGET_FACTOR * order[0].target;
+    int numPartitions = std::min(QThread::idealThreadCount(),
+                                 numTris / MIN_TRIANGLES_PER_PARTITION);
+    if (parallel && numPartitions > 1 && intermediate < numTris)
+    {
+        simplifyInPartitions(mesh, numPartitions, intermediate);
+    }
+
+    QuadricMesh simplified(mesh);
+    MeshData level;
+    for (int i = 0; i < order.size(); i++)
+    {
+        simplified.decimateTo(order[i].target);
+        simplified.getResult(level);
+        results[order[i].index] = makePolyData(level, triangulated);
+    }
+    return results;
+}
+
+}
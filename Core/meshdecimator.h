@@ -0,0 +1,40 @@
+#ifndef MESHDECIMATOR_H
+#define MESHDECIMATOR_H
+
+#include <vtkSmartPointer.h>
+class vtkPolyData;
+
+#include <QVector>
+
+/*
+ * This is a namespace for simplifying model surfaces in process using
+ * quadric error metrics (Garland and Heckbert's edge collapse algorithm).
+ *
+ * All the simplified levels of a surface are made in one pass: the edge
+ * collapses continue from one target triangle count to the next and the
+ * surface is copied out as each target is reached.  Large surfaces are first
+ * split into spatial partitions that are simplified in parallel (with the
+ * vertices on the partition borders held in place) before the pieces are
+ * joined and simplified the rest of the way.
+ *
+ * Point data arrays (modelNum, chainPosition, charge, etc) are never
+ * interpolated.  Each point in the result has the values of the input point
+ * that it was collapsed into, so arrays that identify things (like modelNum)
+ * stay valid.
+ */
+namespace MeshDecimator
+{
+/*
+ * Simplifies the triangles in the polydata (polygons and triangle strips) to
+ * each of the given triangle counts.  The results are in the same order as
+ * the targets.  A result may have more triangles than its target if no more
+ * edges could be collapsed without folding the surface over on itself or
+ * changing its topology.  If parallel is false, everything is done on the
+ * calling thread.
+ */
+QVector< vtkSmartPointer< vtkPolyData > > decimate(
+        vtkPolyData *input, const QVector< int > &targetTriangles,
+        bool parallel = true);
+}
+
+#endif // MESHDECIMATOR_H
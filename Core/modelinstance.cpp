@@ -6,7 +6,6 @@
 #include <vtkExtractEdges.h>
 #include <vtkTransform.h>
 #include <vtkTransformPolyDataFilter.h>
-#include <vtkColorTransferFunction.h>
 #include <vtkPolyDataMapper.h>
 #include <vtkPointData.h>
 #include <vtkActor.h>
@@ -228,13 +227,9 @@ void ModelInstance::updateColorMap()
 		else {
 			actor->SetMapper(model->getFullResSolidSurfaceMapper(conformation));	
 		}
-        vtkSmartPointer< vtkColorTransferFunction > colorFunc =
-                vtkSmartPointer< vtkColorTransferFunction >::Take(
-                    cmap.getColorMap(0,1)
-                );
         double rgb[3];
 		double displayLum = getDisplayLuminance(); 
-        colorFunc->GetColor(1,rgb);
+        cmap.getSolidColor(rgb);
 		rgb[0] *= displayLum;
 		rgb[1] *= displayLum;
 		rgb[2] *= displayLum;
@@ -247,7 +242,15 @@ void ModelInstance::updateColorMap()
 }
 
 //#########################################################################
-void ModelInstance::setSolidColor(double color[])
+bool ModelInstance::setSolidColor(double color[])
 {
+    // the actor's color is also set by updateColorMap, so compare against it
+    // instead of the last color given here
+    double *current = actor->GetProperty()->GetColor();
+    if (current[0] == color[0] && current[1] == color[1] &&
+        current[2] == color[2]) {
+        return false;
+    }
     actor->GetProperty()->SetColor(color);
+    return true;
 }
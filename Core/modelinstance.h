@@ -50,7 +50,7 @@ public:
 	virtual void setMaxLuminance(double maxLum);
 	virtual void updateColorMap();
 protected:
-    virtual void setSolidColor(double color[3]);
+    virtual bool setSolidColor(double color[3]);
 private:
     // Disable copy constructor and assignment operator these are not implemented
     // and not supported
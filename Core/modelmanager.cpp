@@ -20,6 +20,7 @@
 #include "modelmanager.h"
 #include "modelutilities.h"
 #include "sketchmodel.h"
+#include "sharedgeometry.h"
 #include "sketchioconstants.h"
 
 ModelManager::ModelManager() :
@@ -128,6 +129,22 @@ SketchModel *ModelManager::makeModel(const QString &source, const QString &filen
     }
 }
 
+SketchModel *ModelManager::makeModel(const QString &source, const QString &filename,
+                                     const QSharedPointer< SharedGeometry > &geometry,
+                                     double iMass, double iMoment)
+{
+    if (modelSourceToIdx.contains(source))
+        return models[modelSourceToIdx.value(source)];
+    else
+    {
+        SketchModel *model = new SketchModel(iMass, iMoment);
+        model->addConformation(source,filename,geometry);
+        models.append(model);
+        modelSourceToIdx.insert(source,models.size()-1);
+        return model;
+    }
+}
+
 SketchModel *ModelManager::addConformation(const QString &originalSource,
                                            const QString &newSource,
                                            const QString &newFilename)
@@ -224,3 +241,19 @@ int ModelManager::getNumberOfModels() const {
     return models.size();
 }
 
+qint64 ModelManager::getSharedGeometryMemorySaved() const {
+    QHash< const SharedGeometry *, int > uses;
+    for (int i = 0; i < models.size(); i++) {
+        for (int j = 0; j < models[i]->getNumberOfConformations(); j++) {
+            uses[models[i]->getSharedGeometry(j)]++;
+        }
+    }
+    qint64 saved = 0;
+    QHashIterator< const SharedGeometry *, int > it(uses);
+    while (it.hasNext()) {
+        it.next();
+        saved += (it.value() - 1) * it.key()->getMemorySize();
+    }
+    return saved;
+}
+
@@ -18,8 +18,10 @@ class QDir;
 class QString;
 #include <QVector>
 #include <QHash>
+#include <QSharedPointer>
 
 class SketchModel;
+class SharedGeometry;
 class vtkPolyDataAlgorithm;
 
 
@@ -74,6 +76,17 @@ public:
       ****************************************************************************/
     SketchModel *makeModel(const QString &source, const QString &filename,
                            double iMass, double iMoment);
+    /*****************************************************************************
+      *
+      * This method is the same as the one above, except that the geometry of
+      * the file has already been read (see SketchModel::readGeometry).  This
+      * lets the reading happen on a worker thread and only the model creation
+      * on the main thread.
+      *
+      ****************************************************************************/
+    SketchModel *makeModel(const QString &source, const QString &filename,
+                           const QSharedPointer< SharedGeometry > &geometry,
+                           double iMass, double iMoment);
 
     /*****************************************************************************
       *
@@ -126,6 +139,15 @@ public:
       *
       ****************************************************************************/
     int getNumberOfModels() const;
+    /*****************************************************************************
+      *
+      * Conformations with identical full resolution geometry share a single copy
+      * of it (see SharedGeometry).  This method returns the number of bytes
+      * that would be used by the extra copies of the geometry if it were not
+      * shared between the conformations of the models in this ModelManager.
+      *
+      ****************************************************************************/
+    qint64 getSharedGeometryMemorySaved() const;
 
 private:
     // Disable copy constructor and assignment operator these are not implemented
@@ -0,0 +1,213 @@
+#include "modelmemorybudget.h"
+
+#include <algorithm>
+
+#include <QSettings>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QVector>
+#include <QList>
+#include <QSet>
+#include <QPair>
+
+#include "sketchmodel.h"
+#include "sharedgeometry.h"
+
+// the QSettings key for the budget
+#define MODEL_MEMORY_BUDGET_SETTING "models/memoryBudgetMB"
+// the default budget in megabytes
+#define DEFAULT_MODEL_MEMORY_BUDGET_MB 1024
+
+namespace ModelMemoryBudget
+{
+
+// All of the state here is only changed from the main thread, the mutex
+// is just so that creating models elsewhere doesn't corrupt the list
+static QMutex modelsMutex;
+static QList< SketchModel * > models;
+static qint64 budget = -1;
+static quint64 useClock = 0;
+
+QString getCategoryName(Category category)
+{
+    switch (category)
+    {
+    case RESOLUTION_DATA:
+        return "resolution data";
+    case SURFACE:
+        return "surface";
+    case MAPPERS:
+        return "mappers";
+    case SHARED_GEOMETRY:
+        return "shared geometry";
+    case COLLISION:
+        return "collision";
+    default:
+        return "unknown";
+    }
+}
+
+qint64 getBudget()
+{
+    if (budget < 0)
+    {
+        QSettings settings;
+        budget = settings.value(MODEL_MEMORY_BUDGET_SETTING,
+                                DEFAULT_MODEL_MEMORY_BUDGET_MB).toLongLong()
+                * 1024 * 1024;
+    }
+    return budget;
+}
+
+void setBudget(qint64 bytes)
+{
+    budget = bytes;
+    QSettings settings;
+    settings.setValue(MODEL_MEMORY_BUDGET_SETTING, bytes / (1024 * 1024));
+    enforceBudget();
+}
+
+void registerModel(SketchModel *model)
+{
+    QMutexLocker lock(&modelsMutex);
+    models.append(model);
+}
+
+void unregisterModel(SketchModel *model)
+{
+    QMutexLocker lock(&modelsMutex);
+    models.removeOne(model);
+}
+
+quint64 nextUseStamp()
+{
+    return ++useClock;
+}
+
+static QList< SketchModel * > getModels()
+{
+    QMutexLocker lock(&modelsMutex);
+    return models;
+}
+
+// Sums up the memory in the category.  Shared geometry is counted once no
+// matter how many conformations use it.
+static qint64 residentBytes(const QList< SketchModel * > &modelList,
+                            Category category)
+{
+    qint64 total = 0;
+    QSet< const SharedGeometry * > counted;
+    for (int i = 0; i < modelList.size(); i++)
+    {
+        SketchModel *model = modelList[i];
+        for (int j = 0; j < model->getNumberOfConformations(); j++)
+        {
+            if (category == SHARED_GEOMETRY || category == COLLISION)
+            {
+                const SharedGeometry *geom = model->getSharedGeometry(j);
+                if (counted.contains(geom))
+                {
+                    continue;
+                }
+                counted.insert(geom);
+            }
+            total += model->getResidentBytes(j, category);
+        }
+    }
+    return total;
+}
+
+static qint64 totalResidentBytes(const QList< SketchModel * > &modelList)
+{
+    qint64 total = 0;
+    for (int c = 0; c < NUM_CATEGORIES; c++)
+    {
+        total += residentBytes(modelList, static_cast< Category >(c));
+    }
+    return total;
+}
+
+qint64 getResidentBytes(Category category)
+{
+    return residentBytes(getModels(), category);
+}
+
+qint64 getTotalResidentBytes()
+{
+    return totalResidentBytes(getModels());
+}
+
+// a conformation that may be released, sorted by last use
+typedef QPair< quint64, QPair< SketchModel *, int > > Candidate;
+
+qint64 enforceBudget()
+{
+    QList< SketchModel * > modelList = getModels();
+    qint64 total = totalResidentBytes(modelList);
+    qint64 limit = getBudget();
+    if (total <= limit)
+    {
+        return 0;
+    }
+    QVector< Candidate > candidates;
+    for (int i = 0; i < modelList.size(); i++)
+    {
+        SketchModel *model = modelList[i];
+        for (int j = 0; j < model->getNumberOfConformations(); j++)
+        {
+            if (model->canReleaseMemory(j))
+            {
+                candidates.append(Candidate(model->getLastUseStamp(j),
+                                            QPair< SketchModel *, int >(model, j)));
+            }
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    qint64 released = 0;
+    for (int i = 0; i < candidates.size() && total - released > limit; i++)
+    {
+        released += candidates[i].second.first->releaseMemory(
+                        candidates[i].second.second);
+    }
+    return released;
+}
+
+static QString formatBytes(qint64 bytes)
+{
+    return QString::number(bytes / 1024.0 / 1024.0, 'f', 2) + " MB";
+}
+
+QString getReport()
+{
+    QList< SketchModel * > modelList = getModels();
+    QString report;
+    for (int i = 0; i < modelList.size(); i++)
+    {
+        SketchModel *model = modelList[i];
+        for (int j = 0; j < model->getNumberOfConformations(); j++)
+        {
+            report += model->getSource(j) + " (conformation " +
+                    QString::number(j) + ", " +
+                    QString::number(model->getNumberOfUses(j)) + " uses):";
+            for (int c = 0; c < NUM_CATEGORIES; c++)
+            {
+                Category category = static_cast< Category >(c);
+                report += " " + getCategoryName(category) + " " +
+                        formatBytes(model->getResidentBytes(j, category));
+                report += (c + 1 < NUM_CATEGORIES) ? "," : "\n";
+            }
+        }
+    }
+    report += "Totals (shared geometry counted once):";
+    for (int c = 0; c < NUM_CATEGORIES; c++)
+    {
+        Category category = static_cast< Category >(c);
+        report += " " + getCategoryName(category) + " " +
+                formatBytes(residentBytes(modelList, category)) + ",";
+    }
+    report += " total " + formatBytes(totalResidentBytes(modelList)) +
+            " of " + formatBytes(getBudget()) + " budget\n";
+    return report;
+}
+
+}
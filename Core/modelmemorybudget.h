@@ -0,0 +1,88 @@
+#ifndef MODELMEMORYBUDGET_H
+#define MODELMEMORYBUDGET_H
+
+#include <QString>
+
+class SketchModel;
+
+/*
+ * This is a namespace for the memory budget shared by all SketchModels.
+ *
+ * Each conformation of a model keeps its current resolution's data, a copy of
+ * its surface, the mappers for each color map it has been shown with and its
+ * collision model in memory.  None of this is needed while no object uses the
+ * conformation, but used to be kept for the whole session.  When the memory
+ * used by all models goes over the budget, the conformations that are not in
+ * use are released in least recently used order until the total is back under
+ * the budget.  Releasing a conformation switches it back to its full
+ * resolution geometry (which is kept in memory, see SharedGeometry), drops its
+ * colored mappers and surface copy and frees its collision model if no other
+ * conformation sharing it is in use.  All of these are rebuilt or reloaded
+ * from the model files when they are needed again.
+ */
+namespace ModelMemoryBudget
+{
+// The categories of memory reported
+enum Category
+{
+    // data for the current resolution when it is not the full resolution
+    RESOLUTION_DATA,
+    // the conformation's copy of its current surface
+    SURFACE,
+    // the colored mappers (estimated from the colors they generate)
+    MAPPERS,
+    // the full resolution data, which may be shared between conformations
+    SHARED_GEOMETRY,
+    // the collision model, which is shared along with the full resolution
+    COLLISION,
+    NUM_CATEGORIES
+};
+
+// Gets the name of the category for reports
+QString getCategoryName(Category category);
+
+/*
+ * Gets the budget in bytes.  This is read from the application settings (key
+ * "models/memoryBudgetMB") the first time it is needed and defaults to 1024
+ * megabytes.
+ */
+qint64 getBudget();
+/*
+ * Sets the budget in bytes, saves it to the application settings and releases
+ * unused conformations if the models are now over budget.
+ */
+void setBudget(qint64 bytes);
+
+// Called by SketchModel when models are created and destroyed
+void registerModel(SketchModel *model);
+void unregisterModel(SketchModel *model);
+
+/*
+ * Returns a new, increasing timestamp to mark when a conformation was last
+ * used.
+ */
+quint64 nextUseStamp();
+
+/*
+ * Releases unused conformations in least recently used order until the memory
+ * used by all models is within the budget (or nothing else can be released).
+ * Returns the number of bytes released.  SketchModel calls this whenever it
+ * loads something or a conformation stops being used.
+ */
+qint64 enforceBudget();
+
+/*
+ * Gets the total memory used by all models in the given category.  Shared
+ * geometry is only counted once.
+ */
+qint64 getResidentBytes(Category category);
+// Gets the total memory used by all models
+qint64 getTotalResidentBytes();
+/*
+ * Returns a report of the memory used by each model and conformation
+ * and the totals by category.
+ */
+QString getReport();
+}
+
+#endif // MODELMEMORYBUDGET_H
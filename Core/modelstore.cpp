@@ -0,0 +1,321 @@
+#include "modelstore.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <QCryptographicHash>
+#include <QTemporaryFile>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QSettings>
+#include <QVector>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QHash>
+#include <QFile>
+#include <QDir>
+#include <QDebug>
+
+// the QSettings key for the store location
+#define MODEL_STORE_PATH_SETTING "modelstore/path"
+// default store location relative to the home directory
+#define DEFAULT_MODEL_STORE_DIR ".sketchbio/modelstore"
+// size of the blocks read when hashing a file
+#define HASH_BLOCK_SIZE (1 << 20)
+
+namespace ModelStore
+{
+
+//###############################################################
+// Hash cache
+//
+// Hashing a file means reading all of it, so the hash of each file is
+// remembered along with the size and modification time it had when it was
+// hashed.  If either changes, the file is hashed again.
+struct HashCacheEntry
+{
+    qint64 size;
+    QDateTime modified;
+    QByteArray hash;
+};
+
+static QMutex hashCacheMutex;
+static QHash< QString, HashCacheEntry > hashCache;
+
+static void cacheHash(const QFileInfo &info, const QByteArray &hash)
+{
+    HashCacheEntry entry;
+    entry.size = info.size();
+    entry.modified = info.lastModified();
+    entry.hash = hash;
+    QMutexLocker lock(&hashCacheMutex);
+    hashCache.insert(info.absoluteFilePath(), entry);
+}
+
+static QByteArray hashFile(const QFileInfo &info)
+{
+    QString path = info.absoluteFilePath();
+    {
+        QMutexLocker lock(&hashCacheMutex);
+        QHash< QString, HashCacheEntry >::const_iterator it =
+                hashCache.constFind(path);
+        if (it != hashCache.constEnd() && it->size == info.size() &&
+                it->modified == info.lastModified())
+        {
+            return it->hash;
+        }
+    }
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return QByteArray();
+    }
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    while (!file.atEnd())
+    {
+        hash.addData(file.read(HASH_BLOCK_SIZE));
+    }
+    QByteArray result = hash.result().toHex();
+    cacheHash(info, result);
+    return result;
+}
+
+//###############################################################
+// Low level file operations
+
+static bool makeHardLink(const QString &src, const QString &dst)
+{
+#if defined(_WIN32)
+    return CreateHardLinkW(reinterpret_cast< const wchar_t * >(dst.utf16()),
+                           reinterpret_cast< const wchar_t * >(src.utf16()),
+                           NULL) != 0;
+#else
+    return ::link(QFile::encodeName(src).constData(),
+                  QFile::encodeName(dst).constData()) == 0;
+#endif
+}
+
+static bool removeIfExists(const QString &dst)
+{
+    QFile dstFile(dst);
+    return !dstFile.exists() || dstFile.remove();
+}
+
+static bool copyFile(const QString &src, const QString &dst)
+{
+    if (!removeIfExists(dst))
+    {
+        return false;
+    }
+    return QFile::copy(src, dst);
+}
+
+//###############################################################
+// Store location
+
+QString getStoreDir()
+{
+    QSettings settings;
+    QString defaultDir = QDir::home().absoluteFilePath(DEFAULT_MODEL_STORE_DIR);
+    return settings.value(MODEL_STORE_PATH_SETTING, defaultDir).toString();
+}
+
+void setStoreDir(const QString &dir)
+{
+    QSettings settings;
+    settings.setValue(MODEL_STORE_PATH_SETTING, dir);
+}
+
+//###############################################################
+
+bool isModelFile(const QString &filename)
+{
+    QString suffix = QFileInfo(filename).suffix().toLower();
+    return suffix == "vtk" || suffix == "obj" || suffix == "mtl";
+}
+
+QByteArray getFileHash(const QString &filename)
+{
+    QFileInfo info(filename);
+    if (!info.isFile())
+    {
+        return QByteArray();
+    }
+    return hashFile(info);
+}
+
+bool linkOrCopyFile(const QString &src, const QString &dst)
+{
+    if (QFileInfo(src).absoluteFilePath() == QFileInfo(dst).absoluteFilePath())
+    {
+        return true;
+    }
+    if (!removeIfExists(dst))
+    {
+        return false;
+    }
+    if (makeHardLink(src, dst))
+    {
+        return true;
+    }
+    return QFile::copy(src, dst);
+}
+
+bool replaceFile(const QString &filename)
+{
+    return removeIfExists(filename);
+}
+
+QString addFile(const QString &filename)
+{
+    QFileInfo info(filename);
+    if (!info.isFile())
+    {
+        return QString();
+    }
+    QByteArray hash = hashFile(info);
+    if (hash.isEmpty())
+    {
+        return QString();
+    }
+    // two levels so no one directory gets too big
+    QString subdir = QString::fromLatin1(hash.left(2));
+    QDir store(getStoreDir());
+    if (!store.mkpath(subdir))
+    {
+        return QString();
+    }
+    QString entryName = QString::fromLatin1(hash);
+    if (!info.suffix().isEmpty())
+    {
+        entryName += "." + info.suffix().toLower();
+    }
+    QDir entryDir(store.absoluteFilePath(subdir));
+    QString entry = entryDir.absoluteFilePath(entryName);
+    // the entry's hash is cached by size and modification time from when it
+    // was added, so this only rereads it if it was changed since then
+    QFileInfo entryInfo(entry);
+    if (entryInfo.isFile() && hashFile(entryInfo) == hash)
+    {
+        return entry;
+    }
+    // Copy the file instead of linking it.  It is usually one the user
+    // picked from outside any project, and if it were linked, editing it in
+    // place later would change the entry and every project linked to it.
+    // The copy is hashed as it is written and only renamed to the entry
+    // name once it is complete.
+    QFile src(info.absoluteFilePath());
+    QTemporaryFile tmp(entryDir.absoluteFilePath("partial.XXXXXX"));
+    if (!src.open(QIODevice::ReadOnly) || !tmp.open())
+    {
+        return QString();
+    }
+    QCryptographicHash copyHash(QCryptographicHash::Sha1);
+    while (!src.atEnd())
+    {
+        QByteArray block = src.read(HASH_BLOCK_SIZE);
+        copyHash.addData(block);
+        if (tmp.write(block) != block.size())
+        {
+            return QString();
+        }
+    }
+    tmp.close();
+    // the file changed between hashing and copying it
+    if (copyHash.result().toHex() != hash)
+    {
+        return QString();
+    }
+    if (!removeIfExists(entry) || !tmp.rename(entry))
+    {
+        return QString();
+    }
+    tmp.setAutoRemove(false);
+    cacheHash(QFileInfo(entry), hash);
+    return entry;
+}
+
+bool placeFile(const QString &src, const QString &dst)
+{
+    if (!isModelFile(src))
+    {
+        return copyFile(src, dst);
+    }
+    QString entry = addFile(src);
+    if (!entry.isEmpty() && linkOrCopyFile(entry, dst))
+    {
+        return true;
+    }
+    return linkOrCopyFile(src, dst);
+}
+
+//###############################################################
+// listDir and linkDir are based on the listDir and cpDir functions that
+// were in sketchproject.cpp (which were heavily modified from mosg's
+// StackOverflow answer to http://stackoverflow.com/questions/2536524 ).
+// Listing everything before creating anything avoids infinite recursion
+// when copying a folder into a subfolder of itself, and the destination is
+// not cleared since that breaks copying from a subfolder to a parent folder.
+
+static void listDir(const QString &srcPath, QVector< QString > &files,
+                    QVector< QString > &dirs)
+{
+    QDir srcDir(srcPath);
+    foreach(const QFileInfo &info, srcDir.entryInfoList(
+                QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot))
+    {
+        QString srcItemPath = srcDir.absoluteFilePath(info.fileName());
+        if (info.isDir())
+        {
+            dirs.append(srcItemPath);
+            listDir(srcItemPath, files, dirs);
+        }
+        else if (info.isFile())
+        {
+            files.append(srcItemPath);
+        }
+        else
+        {
+            qDebug() << "Unhandled item " << info.filePath() << " in linkDir";
+        }
+    }
+}
+
+bool linkDir(const QString &srcPath, const QString &dstPath)
+{
+    QVector< QString > files, dirs;
+    listDir(srcPath, files, dirs);
+
+    QDir dstDir(dstPath);
+    QDir parentDstDir(QFileInfo(dstPath).path());
+    if (!dstDir.exists() && !parentDstDir.mkpath(QFileInfo(dstPath).fileName()))
+        return false;
+
+    QString absSrcPath = QFileInfo(srcPath).absoluteFilePath();
+    foreach(const QString &dir, dirs)
+    {
+        QString str = dir.mid(absSrcPath.length() + 1);
+        if (!dstDir.mkpath(str))
+        {
+            return false;
+        }
+    }
+    // link the files directly rather than through the store, this way
+    // duplicating a project never has to read the model files
+    foreach(const QString &file, files)
+    {
+        QString dstFilePath = dstPath + "/" + file.mid(absSrcPath.length() + 1);
+        bool success = isModelFile(file) ? linkOrCopyFile(file, dstFilePath)
+                                         : copyFile(file, dstFilePath);
+        if (!success)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,96 @@
+#ifndef MODELSTORE_H
+#define MODELSTORE_H
+
+#include <QString>
+#include <QByteArray>
+
+/*
+ * This is a namespace for the content-addressed model file store.
+ *
+ * Model files (the .vtk/.obj files for each resolution of a model) are large
+ * and never modified once written, but they used to be copied into every
+ * project directory that used them.  The store keeps one entry per distinct
+ * file contents (named by the SHA-1 of the contents) and project directories
+ * get hardlinks to the store entry.  Files from outside the store are copied
+ * into it, never linked, so that editing the original later cannot change
+ * the entry.  When hardlinks are not possible (a
+ * different filesystem, a filesystem without hardlinks, etc) the functions here
+ * fall back to a plain copy so callers never need to care which happened.
+ *
+ * Since a hardlinked file shares its data with every other link, nothing
+ * should ever write into a model file in place.  Anything rewriting a model
+ * file must call replaceFile first.
+ */
+namespace ModelStore
+{
+/*
+ * Returns the directory the store is kept in.  This is read from the
+ * application settings (key "modelstore/path") and defaults to a directory
+ * in the user's home directory.
+ */
+QString getStoreDir();
+/*
+ * Sets the directory the store is kept in and saves it to the application
+ * settings.
+ */
+void setStoreDir(const QString &dir);
+
+/*
+ * Returns true if the given filename is one that should be shared through the
+ * store (a model file) and false if it should always be copied (project xml,
+ * etc.) because it may be rewritten in place.
+ */
+bool isModelFile(const QString &filename);
+
+/*
+ * Makes dst refer to the same contents as src.  A hardlink is tried first
+ * and if that fails the file is copied.  Any existing file at dst is removed
+ * first. Returns true on success.
+ */
+bool linkOrCopyFile(const QString &src, const QString &dst);
+
+/*
+ * Prepares filename to have a new version written to it.  The old file may be
+ * a hardlink shared with the store and other projects, so writing over its
+ * contents would change every copy.  This removes the old file instead, so
+ * that whatever writes the new version (a vtk writer, Chimera, etc.) creates
+ * a new file.  Call this before every write of a model file.  Returns true if
+ * no file is left at filename.
+ */
+bool replaceFile(const QString &filename);
+
+/*
+ * Returns the SHA-1 of the given file's contents as hex or an empty array if
+ * the file could not be read.  The hash is cached as described for addFile.
+ */
+QByteArray getFileHash(const QString &filename);
+
+/*
+ * Adds a copy of the given file to the store (if its contents are not already
+ * there) and returns the path of the store entry.  An existing entry is only
+ * reused if its contents still match its name.  Returns an empty string if
+ * the file could not be copied into the store.
+ *
+ * The content hash of each file and store entry is cached by path, size and
+ * modification time so adding the same file again does not reread it.
+ */
+QString addFile(const QString &filename);
+
+/*
+ * Places a copy of src at dst, going through the store for model files so
+ * that all copies of the same contents share one set of disk blocks.  Falls
+ * back to linking or copying directly if the store cannot be used.
+ * Returns true on success.
+ */
+bool placeFile(const QString &src, const QString &dst);
+
+/*
+ * Implements the shell command 'cp -r' for a project directory, except that
+ * model files are linked instead of copied.  This makes duplicating a project
+ * take time proportional to the number of files rather than their size.
+ * The destination directory is not cleared first.  Returns true on success.
+ */
+bool linkDir(const QString &srcPath, const QString &dstPath);
+}
+
+#endif // MODELSTORE_H
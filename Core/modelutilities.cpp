@@ -18,6 +18,9 @@
 
 #include <PQP.h>
 
+#include "pqpbuilder.h"
+#include "modelstore.h"
+
 namespace ModelUtilities
 {
 /*****************************************************************************
@@ -31,90 +34,7 @@ namespace ModelUtilities
   ****************************************************************************/
 void makePQP_Model(PQP_Model *m1, vtkPolyData *polyData)
 {
-
-    int numPoints = polyData->GetNumberOfPoints();
-
-    // get points
-    QScopedPointer< double, QScopedPointerArrayDeleter< double > >
-            points(new double[3*numPoints]);
-    for (int i = 0; i < numPoints; i++)
-    {
-        polyData->GetPoint(i,&points.data()[3*i]);
-    }
-
-    int numStrips = polyData->GetNumberOfStrips();
-    int numPolygons = polyData->GetNumberOfPolys();
-    if (numStrips > 0)
-    {  // if we have triangle strips, great, use them!
-        vtkCellArray *strips = polyData->GetStrips();
-
-        m1->BeginModel();
-        vtkIdType nvertices, *pvertices, loc = 0;
-        PQP_REAL t[3], u[3],v[3], *p1 = t, *p2 = u, *p3 = v;
-        int triId = 0;
-        for (int i = 0; i < numStrips; i++)
-        {
-            strips->GetCell( loc, nvertices, pvertices );
-            // todo, refactor to getNextCell for better performance
-
-            p1[0] = points.data()[3*pvertices[0]];
-            p1[1] = points.data()[3*pvertices[0]+1];
-            p1[2] = points.data()[3*pvertices[0]+2];
-            p2[0] = points.data()[3*pvertices[1]];
-            p2[1] = points.data()[3*pvertices[1]+1];
-            p2[2] = points.data()[3*pvertices[1]+2];
-            for (int j = 2; j < nvertices; j++)
-            {
-                p3[0] = points.data()[3*pvertices[j]];
-                p3[1] = points.data()[3*pvertices[j]+1];
-                p3[2] = points.data()[3*pvertices[j]+2];
-                // ensure counterclockwise points
-                if (j % 2 == 0)
-                    m1->AddTri(p1,p2,p3,triId++);
-                else
-                    m1->AddTri(p1,p3,p2,triId++);
-                PQP_REAL *tmp = p1;
-                p1 = p2;
-                p2 = p3;
-                p3 = tmp;
-            }
-            loc += nvertices+1;
-        }
-        m1->EndModel();
-    }
-    else if (numPolygons > 0)
-    { // we may not have triangle strip data, try polygons
-        vtkCellArray *polys = polyData->GetPolys();
-
-        m1->BeginModel();
-        vtkIdType nvertices, *pvertices, loc = 0;
-        PQP_REAL t[3], u[3],v[3], *p1 = t, *p2 = u, *p3 = v;
-        int triId = 0;
-        for (int i = 0; i < numPolygons; i++)
-        {
-            polys->GetCell(loc,nvertices,pvertices);
-            p1[0] = points.data()[3*pvertices[0]];
-            p1[1] = points.data()[3*pvertices[0]+1];
-            p1[2] = points.data()[3*pvertices[0]+2];
-            p2[0] = points.data()[3*pvertices[1]];
-            p2[1] = points.data()[3*pvertices[1]+1];
-            p2[2] = points.data()[3*pvertices[1]+2];
-            for (int j = 2; j < nvertices; j++)
-            {
-                p3[0] = points.data()[3*pvertices[j]];
-                p3[1] = points.data()[3*pvertices[j]+1];
-                p3[2] = points.data()[3*pvertices[j]+2];
-                m1->AddTri(p1,p2,p3,triId++);
-                PQP_REAL *tmp = p2;
-                p2= p3;
-                p3 = tmp;
-            }
-            loc += nvertices +1;
-        }
-        m1->EndModel();
-    }
-    for (int i = 0 ; i< m1->num_tris; i++)
-        m1->tris[i].id = i;
+    PQPBuilder::buildModel(m1, polyData);
 }
 
 #ifdef PQP_UPDATE_EPSILON
@@ -302,6 +222,7 @@ QString createFileFromVTKSource(vtkPolyDataAlgorithm *algorithm, const QString &
 QString createFileFromVTKSource(vtkPolyDataAlgorithm *algorithm, const QString &descr,
                                 const QDir &dir)
 {
+    ModelStore::replaceFile(dir.absoluteFilePath(descr + ".vtk"));
     vtkSmartPointer< vtkPolyDataWriter > writer =
             vtkSmartPointer< vtkPolyDataWriter >::New();
     writer->SetInputConnection(algorithm->GetOutputPort());
@@ -332,6 +253,7 @@ void vtkConvertAsciiToBinary(const QString &filename)
                 vtkSmartPointer< vtkPolyDataReader >::New();
         reader->SetFileName(filename.toStdString().c_str());
         reader->Update();
+        ModelStore::replaceFile(filename);
         vtkSmartPointer< vtkPolyDataWriter > writer =
                 vtkSmartPointer< vtkPolyDataWriter >::New();
         writer->SetFileName(filename.toStdString().c_str());
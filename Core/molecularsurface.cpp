@@ -0,0 +1,952 @@
+#include "molecularsurface.h"
+
+#include <cmath>
+#include <algorithm>
+
+#include <vtkPolyData.h>
+#include <vtkCellArray.h>
+#include <vtkPoints.h>
+#include <vtkPointData.h>
+#include <vtkIntArray.h>
+#include <vtkFloatArray.h>
+#include <vtkStringArray.h>
+#include <vtkImageData.h>
+#include <vtkMarchingCubes.h>
+
+#include <QtConcurrentMap>
+#include <QThread>
+
+// grid spacing for the full detail surface, lower resolution surfaces use
+// one third of the resolution (like Chimera's molmap) if that is bigger
+#define ATOMIC_DETAIL_SPACING 0.5
+// the blobbiness (b above) of the full detail and lower resolution surfaces
+#define ATOMIC_DETAIL_BLOBBINESS 2.3
+#define LOW_RESOLUTION_BLOBBINESS 1.0
+// how much the atom radii grow per Angstrom of resolution
+#define RESOLUTION_RADIUS_SCALE 0.3
+// atoms stop adding to the density where they would add less than this
+#define MIN_DENSITY_CONTRIBUTION 0.01
+// the grid spacing is increased if the grid would have more points than this
+#define MAX_GRID_POINTS (1 << 25)
+// the surface points are split into about this many tasks per thread
+#define TASKS_PER_THREAD 4
+// Coulomb's constant in kcal*Angstrom/(mol*e^2) and the dielectric is
+// DIELECTRIC_SCALE times the distance
+#define COULOMB_CONSTANT 332.0
+#define DIELECTRIC_SCALE 4.0
+// charges closer than this to a point are treated as being this far away,
+// except an atom's own charge which is ignored
+#define MIN_CHARGE_DISTANCE 1.5
+// charges farther than this from a point are ignored.  Each charge's
+// potential is shifted to be zero here so the potential has no jumps.
+#define CHARGE_CUTOFF 20.0
+// atoms are bonded if they are closer than the sum of their covalent radii
+// plus this
+#define BOND_TOLERANCE 0.4
+#define MAX_BOND_LENGTH 3.0
+
+namespace MolecularSurface
+{
+
+//###############################################################
+// Tables
+
+struct ElementRadii
+{
+    const char *element;
+    double vdw, covalent;
+};
+
+static const ElementRadii ELEMENT_RADII[] =
+{
+    { "H", 1.10, 0.31 }, { "C", 1.70, 0.76 }, { "N", 1.55, 0.71 },
+    { "O", 1.52, 0.66 }, { "S", 1.80, 1.05 }, { "P", 1.80, 1.07 },
+    { "F", 1.47, 0.57 }, { "CL", 1.75, 1.02 }, { "BR", 1.85, 1.20 },
+    { "I", 1.98, 1.39 }, { "SE", 1.90, 1.20 }, { "NA", 2.27, 1.66 },
+    { "K", 2.75, 2.03 }, { "MG", 1.73, 1.41 }, { "CA", 2.31, 1.76 },
+    { "ZN", 1.39, 1.22 }, { "FE", 1.94, 1.32 }, { "MN", 1.97, 1.39 },
+    { "CU", 1.40, 1.32 }, { "NI", 1.63, 1.24 }, { "CO", 1.92, 1.26 },
+    { NULL, 0.0, 0.0 }
+};
+#define DEFAULT_VDW_RADIUS 1.80
+#define DEFAULT_COVALENT_RADIUS 0.77
+
+struct AtomCharge
+{
+    // NULL matches any residue
+    const char *residue;
+    const char *atom;
+    float charge;
+};
+
+// charges of the atoms in residues, the termini are handled separately
+static const AtomCharge ATOM_CHARGES[] =
+{
+    { "LYS", "NZ", 1.0f }, { "ARG", "NH1", 0.5f }, { "ARG", "NH2", 0.5f },
+    { "ASP", "OD1", -0.5f }, { "ASP", "OD2", -0.5f },
+    { "GLU", "OE1", -0.5f }, { "GLU", "OE2", -0.5f },
+    // nucleic acid phosphates
+    { NULL, "OP1", -0.5f }, { NULL, "OP2", -0.5f },
+    { NULL, "O1P", -0.5f }, { NULL, "O2P", -0.5f },
+    { NULL, "OXT", -1.0f },
+    { NULL, NULL, 0.0f }
+};
+
+// charges of ions (single atom hetero residues) by element
+static const AtomCharge ION_CHARGES[] =
+{
+    { NULL, "LI", 1.0f }, { NULL, "NA", 1.0f }, { NULL, "K", 1.0f },
+    { NULL, "MG", 2.0f }, { NULL, "CA", 2.0f }, { NULL, "ZN", 2.0f },
+    { NULL, "MN", 2.0f }, { NULL, "FE", 2.0f }, { NULL, "CU", 2.0f },
+    { NULL, "NI", 2.0f }, { NULL, "CO", 2.0f }, { NULL, "CD", 2.0f },
+    { NULL, "F", -1.0f }, { NULL, "CL", -1.0f }, { NULL, "BR", -1.0f },
+    { NULL, "I", -1.0f },
+    { NULL, NULL, 0.0f }
+};
+
+static const ElementRadii *findElement(const QByteArray &element)
+{
+    for (int i = 0; ELEMENT_RADII[i].element != NULL; i++)
+    {
+        if (element == ELEMENT_RADII[i].element)
+        {
+            return &ELEMENT_RADII[i];
+        }
+    }
+    return NULL;
+}
+
+double getVanDerWaalsRadius(const QByteArray &element)
+{
+    const ElementRadii *radii = findElement(element);
+    return (radii != NULL) ? radii->vdw : DEFAULT_VDW_RADIUS;
+}
+
+static double getCovalentRadius(const QByteArray &element)
+{
+    const ElementRadii *radii = findElement(element);
+    return (radii != NULL) ? radii->covalent : DEFAULT_COVALENT_RADIUS;
+}
+
+static float formalCharge(const StructureReader::Atom &atom, bool isIon,
+                          bool isNTerminus)
+{
+    if (isIon)
+    {
+        for (int i = 0; ION_CHARGES[i].atom != NULL; i++)
+        {
+            if (atom.element == ION_CHARGES[i].atom)
+            {
+                return ION_CHARGES[i].charge;
+            }
+        }
+        return 0.0f;
+    }
+    if (isNTerminus && atom.name == "N")
+    {
+        return 1.0f;
+    }
+    for (int i = 0; ATOM_CHARGES[i].atom != NULL; i++)
+    {
+        if (atom.name == ATOM_CHARGES[i].atom &&
+                (ATOM_CHARGES[i].residue == NULL ||
+                 atom.residueName == ATOM_CHARGES[i].residue))
+        {
+            return ATOM_CHARGES[i].charge;
+        }
+    }
+    return 0.0f;
+}
+
+//###############################################################
+// Residues
+
+// What each atom gets from its residue
+struct AtomInfo
+{
+    int residue;
+    float chainPosition;
+    float charge;
+    bool isIon;
+};
+
+static bool sameResidue(const StructureReader::Atom &a,
+                        const StructureReader::Atom &b)
+{
+    return a.residueNumber == b.residueNumber &&
+            a.insertionCode == b.insertionCode &&
+            a.chainId == b.chainId && a.residueName == b.residueName;
+}
+
+// Finds the residues and the runs of polymer residues in each chain.  The
+// chain position goes from 0 to 1 along each run (like Chimera's rainbow
+// command) and is 0.5 for anything not in a run.
+static QVector< AtomInfo > findResidues(
+        const QVector< StructureReader::Atom > &atoms)
+{
+    QVector< AtomInfo > info(atoms.size());
+    QVector< int > residueStart;
+    for (int i = 0; i < atoms.size(); i++)
+    {
+        if (i == 0 || !sameResidue(atoms[i], atoms[i - 1]))
+        {
+            residueStart.append(i);
+        }
+        info[i].residue = residueStart.size() - 1;
+    }
+    residueStart.append(atoms.size());
+    int numResidues = residueStart.size() - 1;
+    int r = 0;
+    while (r < numResidues)
+    {
+        const StructureReader::Atom &first = atoms[residueStart[r]];
+        if (first.hetero)
+        {
+            bool isIon = (residueStart[r + 1] - residueStart[r] == 1);
+            for (int i = residueStart[r]; i < residueStart[r + 1]; i++)
+            {
+                info[i].chainPosition = 0.5f;
+                info[i].isIon = isIon;
+                info[i].charge = formalCharge(atoms[i], isIon, false);
+            }
+            r++;
+            continue;
+        }
+        int end = r + 1;
+        while (end < numResidues && !atoms[residueStart[end]].hetero &&
+               atoms[residueStart[end]].chainId == first.chainId)
+        {
+            end++;
+        }
+        int length = end - r;
+        for (int res = r; res < end; res++)
+        {
+            float position = (length <= 1) ? 0.0f :
+                                             (res - r) / float(length - 1);
+            for (int i = residueStart[res]; i < residueStart[res + 1]; i++)
+            {
+                info[i].chainPosition = position;
+                info[i].isIon = false;
+                info[i].charge = formalCharge(atoms[i], false, res == r);
+            }
+        }
+        r = end;
+    }
+    return info;
+}
+
+//###############################################################
+// Spatial bins
+//
+// Points are sorted into cubic bins so that everything near a point can be
+// found by looking in the 27 bins around it.
+
+struct Bins
+{
+    double origin[3];
+    double size;
+    int dims[3];
+    // the entries of bin b are entries[binStart[b]] to entries[binStart[b+1]-1]
+    QVector< int > binStart;
+    QVector< int > entries;
+};
+
+static inline void binOf(const Bins &bins, const float *p, int b[3])
+{
+    for (int i = 0; i < 3; i++)
+    {
+        b[i] = (int) std::floor((p[i] - bins.origin[i]) / bins.size);
+        b[i] = std::max(0, std::min(bins.dims[i] - 1, b[i]));
+    }
+}
+
+// xyz is the coordinates of the n points, one after another
+static void makeBins(Bins &bins, const float *xyz, int n, double size)
+{
+    double maxCorner[3];
+    for (int i = 0; i < 3; i++)
+    {
+        bins.origin[i] = maxCorner[i] = (n > 0) ? xyz[i] : 0.0;
+    }
+    for (int p = 0; p < n; p++)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            bins.origin[i] = std::min(bins.origin[i], (double) xyz[3 * p + i]);
+            maxCorner[i] = std::max(maxCorner[i], (double) xyz[3 * p + i]);
+        }
+    }
+    bins.size = size;
+    for (int i = 0; i < 3; i++)
+    {
+        bins.dims[i] = (int) ((maxCorner[i] - bins.origin[i]) / size) + 1;
+    }
+    int numBins = bins.dims[0] * bins.dims[1] * bins.dims[2];
+    QVector< int > binOfPoint(n);
+    bins.binStart.fill(0, numBins + 1);
+    for (int p = 0; p < n; p++)
+    {
+        int b[3];
+        binOf(bins, &xyz[3 * p], b);
+        binOfPoint[p] = (b[2] * bins.dims[1] + b[1]) * bins.dims[0] + b[0];
+        bins.binStart[binOfPoint[p] + 1]++;
+    }
+    for (int b = 0; b < numBins; b++)
+    {
+        bins.binStart[b + 1] += bins.binStart[b];
+    }
+    QVector< int > next(bins.binStart);
+    bins.entries.resize(n);
+    for (int p = 0; p < n; p++)
+    {
+        bins.entries[next[binOfPoint[p]]++] = p;
+    }
+}
+
+// Lists the entries in the bins around the point in near
+static inline void findNear(const Bins &bins, const float *p,
+                            QVector< int > &near)
+{
+    near.clear();
+    int b[3];
+    binOf(bins, p, b);
+    for (int z = std::max(0, b[2] - 1); z <= std::min(bins.dims[2] - 1, b[2] + 1); z++)
+    {
+        for (int y = std::max(0, b[1] - 1); y <= std::min(bins.dims[1] - 1, b[1] + 1); y++)
+        {
+            int row = (z * bins.dims[1] + y) * bins.dims[0];
+            int first = row + std::max(0, b[0] - 1);
+            int last = row + std::min(bins.dims[0] - 1, b[0] + 1);
+            for (int e = bins.binStart[first]; e < bins.binStart[last + 1]; e++)
+            {
+                near.append(bins.entries[e]);
+            }
+        }
+    }
+}
+
+static inline float distance2(const float *a, const float *b)
+{
+    float dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+    return dx * dx + dy * dy + dz * dz;
+}
+
+//###############################################################
+// Density grid
+
+// An atom as it is splatted into the density grid
+struct SurfaceAtom
+{
+    float position[3];
+    float inverseRadius2;
+    float cutoff2;
+    // index in the atom list
+    int atom;
+    bool operator<(const SurfaceAtom &other) const
+    {
+        return position[2] < other.position[2];
+    }
+};
+
+struct DensityGrid
+{
+    double origin[3];
+    double spacing;
+    int dims[3];
+    double blobbiness;
+    float *values;
+};
+
+// Fills the z planes [zBegin,zEnd) of the grid.  Since each task has its
+// own planes, the tasks can run at the same time.
+struct SplatTask
+{
+    DensityGrid *grid;
+    // sorted by z, and their z coordinates
+    const QVector< SurfaceAtom > *atoms;
+    const QVector< float > *atomZ;
+    float maxCutoff;
+    int zBegin, zEnd;
+};
+
+static void splatSlab(SplatTask &task)
+{
+    DensityGrid &g = *task.grid;
+    const QVector< SurfaceAtom > &atoms = *task.atoms;
+    float zLow = g.origin[2] + task.zBegin * g.spacing - task.maxCutoff;
+    float zHigh = g.origin[2] + (task.zEnd - 1) * g.spacing + task.maxCutoff;
+    int first = std::lower_bound(task.atomZ->begin(), task.atomZ->end(), zLow)
+            - task.atomZ->begin();
+    int last = std::upper_bound(task.atomZ->begin(), task.atomZ->end(), zHigh)
+            - task.atomZ->begin();
+    for (int a = first; a < last; a++)
+    {
+        const SurfaceAtom &atom = atoms[a];
+        double cutoff = std::sqrt(atom.cutoff2);
+        int lo[3], hi[3];
+        for (int i = 0; i < 3; i++)
+        {
+            lo[i] = (int) std::ceil((atom.position[i] - cutoff - g.origin[i])
+                                    / g.spacing);
+            hi[i] = (int) std::floor((atom.position[i] + cutoff - g.origin[i])
+                                     / g.spacing);
+            lo[i] = std::max(lo[i], 0);
+            hi[i] = std::min(hi[i], g.dims[i] - 1);
+        }
+        lo[2] = std::max(lo[2], task.zBegin);
+        hi[2] = std::min(hi[2], task.zEnd - 1);
+        for (int k = lo[2]; k <= hi[2]; k++)
+        {
+            float dz = g.origin[2] + k * g.spacing - atom.position[2];
+            float dz2 = dz * dz;
+            for (int j = lo[1]; j <= hi[1]; j++)
+            {
+                float dy = g.origin[1] + j * g.spacing - atom.position[1];
+                float dyz2 = dz2 + dy * dy;
+                if (dyz2 > atom.cutoff2)
+                {
+                    continue;
+                }
+                float *row = g.values + (k * g.dims[1] + j) * g.dims[0];
+                for (int i = lo[0]; i <= hi[0]; i++)
+                {
+                    float dx = g.origin[0] + i * g.spacing - atom.position[0];
+                    float d2 = dyz2 + dx * dx;
+                    if (d2 <= atom.cutoff2)
+                    {
+                        row[i] += std::exp(-g.blobbiness *
+                                           (d2 * atom.inverseRadius2 - 1.0f));
+                    }
+                }
+            }
+        }
+    }
+}
+
+//###############################################################
+// Point attributes
+
+struct PointContext
+{
+    const QVector< SurfaceAtom > *surfaceAtoms;
+    const Bins *surfaceAtomBins;
+    double blobbiness;
+    // the charged atoms' positions and charges, binned by the cutoff
+    const QVector< float > *chargePositions;
+    const QVector< float > *charges;
+    const Bins *chargeBins;
+    // the points (atoms then surface vertices), and the outputs
+    const float *points;
+    int numAtoms;
+    float *normals;
+    int *nearestAtom;
+    float *potential;
+};
+
+// Computes the attributes of the points [begin,end)
+struct PointTask
+{
+    PointContext *context;
+    int begin, end;
+};
+
+static void computePointAttributes(PointTask &task)
+{
+    PointContext &c = *task.context;
+    const QVector< SurfaceAtom > &atoms = *c.surfaceAtoms;
+    QVector< int > near;
+    for (int p = task.begin; p < task.end; p++)
+    {
+        const float *point = &c.points[3 * p];
+        // the electrostatic potential from the charges within the cutoff
+        // (the bins are the size of the cutoff, so these are all near)
+        const float cutoff2 = CHARGE_CUTOFF * CHARGE_CUTOFF;
+        double potential = 0.0;
+        findNear(*c.chargeBins, point, near);
+        for (int n = 0; n < near.size(); n++)
+        {
+            int q = near[n];
+            float d2 = distance2(point, &c.chargePositions->at(3 * q));
+            if (d2 < 1e-4f || d2 >= cutoff2)
+            {
+                // the atom's own charge or too far away
+                continue;
+            }
+            d2 = std::max(d2, float(MIN_CHARGE_DISTANCE * MIN_CHARGE_DISTANCE));
+            potential += c.charges->at(q) *
+                    (1.0 / (DIELECTRIC_SCALE * d2) -
+                     1.0 / (DIELECTRIC_SCALE * cutoff2));
+        }
+        c.potential[p] = COULOMB_CONSTANT * potential;
+        if (p < c.numAtoms)
+        {
+            continue;
+        }
+        // the normal points down the density gradient, and the nearest atom
+        // gives the surface point its other attributes
+        int v = p - c.numAtoms;
+        double normal[3] = { 0.0, 0.0, 0.0 };
+        float nearest2 = -1.0f;
+        int nearest = -1;
+        findNear(*c.surfaceAtomBins, point, near);
+        for (int n = 0; n < near.size(); n++)
+        {
+            const SurfaceAtom &atom = atoms[near[n]];
+            float d2 = distance2(point, atom.position);
+            if (nearest2 < 0.0f || d2 < nearest2)
+            {
+                nearest2 = d2;
+                nearest = atom.atom;
+            }
+            if (d2 > atom.cutoff2)
+            {
+                continue;
+            }
+            double weight = 2.0 * c.blobbiness * atom.inverseRadius2 *
+                    std::exp(-c.blobbiness * (d2 * atom.inverseRadius2 - 1.0));
+            for (int i = 0; i < 3; i++)
+            {
+                normal[i] += weight * (point[i] - atom.position[i]);
+            }
+        }
+        if (nearest < 0)
+        {
+            // the bins are big enough that this shouldn't happen, but just in
+            // case look at all the atoms
+            for (int a = 0; a < atoms.size(); a++)
+            {
+                float d2 = distance2(point, atoms[a].position);
+                if (nearest2 < 0.0f || d2 < nearest2)
+                {
+                    nearest2 = d2;
+                    nearest = atoms[a].atom;
+                }
+            }
+        }
+        double length = std::sqrt(normal[0] * normal[0] +
+                                  normal[1] * normal[1] +
+                                  normal[2] * normal[2]);
+        for (int i = 0; i < 3; i++)
+        {
+            c.normals[3 * v + i] = (length > 0.0) ? normal[i] / length :
+                                                    (i == 2 ? 1.0f : 0.0f);
+        }
+        c.nearestAtom[v] = nearest;
+    }
+}
+
+//###############################################################
+// Bonds
+
+static void findBonds(const QVector< StructureReader::Atom > &atoms,
+                      const QVector< AtomInfo > &info, const float *xyz,
+                      vtkCellArray *lines)
+{
+    Bins bins;
+    makeBins(bins, xyz, atoms.size(), MAX_BOND_LENGTH);
+    QVector< double > radii(atoms.size());
+    for (int i = 0; i < atoms.size(); i++)
+    {
+        radii[i] = getCovalentRadius(atoms[i].element);
+    }
+    QVector< int > near;
+    for (int i = 0; i < atoms.size(); i++)
+    {
+        if (info[i].isIon)
+        {
+            continue;
+        }
+        findNear(bins, &xyz[3 * i], near);
+        for (int n = 0; n < near.size(); n++)
+        {
+            int j = near[n];
+            if (j <= i || info[j].isIon)
+            {
+                continue;
+            }
+            double maxLength = radii[i] + radii[j] + BOND_TOLERANCE;
+            if (distance2(&xyz[3 * i], &xyz[3 * j]) < maxLength * maxLength)
+            {
+                vtkIdType ids[2] = { i, j };
+                lines->InsertNextCell(2, ids);
+            }
+        }
+    }
+}
+
+//###############################################################
+// Making the model
+
+template < typename Task >
+static void runTasks(QVector< Task > &tasks, void (*function)(Task &),
+                     bool parallel)
+{
+    if (parallel)
+    {
+        QtConcurrent::blockingMap(tasks, function);
+    }
+    else
+    {
+        for (int i = 0; i < tasks.size(); i++)
+        {
+            function(tasks[i]);
+        }
+    }
+}
+
+static int numberOfTasks(int numItems, bool parallel)
+{
+    if (!parallel)
+    {
+        return 1;
+    }
+    int tasks = QThread::idealThreadCount() * TASKS_PER_THREAD;
+    return std::max(1, std::min(numItems, tasks));
+}
+
+// Makes the surface's triangles and vertices with marching cubes
+static void makeSurface(const QVector< SurfaceAtom > &sortedAtoms,
+                        double spacing, double blobbiness, float maxCutoff,
+                        bool parallel, QVector< float > &vertices,
+                        QVector< vtkIdType > &triangles)
+{
+    if (sortedAtoms.isEmpty())
+    {
+        return;
+    }
+    double minCorner[3], maxCorner[3];
+    for (int i = 0; i < 3; i++)
+    {
+        minCorner[i] = maxCorner[i] = sortedAtoms[0].position[i];
+    }
+    for (int a = 0; a < sortedAtoms.size(); a++)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            minCorner[i] = std::min(minCorner[i], (double) sortedAtoms[a].position[i]);
+            maxCorner[i] = std::max(maxCorner[i], (double) sortedAtoms[a].position[i]);
+        }
+    }
+    DensityGrid grid;
+    grid.blobbiness = blobbiness;
+    double numPoints;
+    do
+    {
+        // the padding keeps the surface from touching the sides of the grid
+        double padding = maxCutoff + 2 * spacing;
+        numPoints = 1.0;
+        for (int i = 0; i < 3; i++)
+        {
+            grid.origin[i] = minCorner[i] - padding;
+            grid.dims[i] = (int) std::ceil((maxCorner[i] - minCorner[i] +
+                                            2 * padding) / spacing) + 1;
+            numPoints *= grid.dims[i];
+        }
+        grid.spacing = spacing;
+        spacing *= 1.25;
+    } while (numPoints > MAX_GRID_POINTS);
+    QVector< float > values(grid.dims[0] * grid.dims[1] * grid.dims[2], 0.0f);
+    grid.values = values.data();
+
+    QVector< float > atomZ(sortedAtoms.size());
+    for (int a = 0; a < sortedAtoms.size(); a++)
+    {
+        atomZ[a] = sortedAtoms[a].position[2];
+    }
+    int numSlabs = numberOfTasks(grid.dims[2], parallel);
+    QVector< SplatTask > slabs(numSlabs);
+    for (int s = 0; s < numSlabs; s++)
+    {
+        slabs[s].grid = &grid;
+        slabs[s].atoms = &sortedAtoms;
+        slabs[s].atomZ = &atomZ;
+        slabs[s].maxCutoff = maxCutoff;
+        slabs[s].zBegin = (s * grid.dims[2]) / numSlabs;
+        slabs[s].zEnd = ((s + 1) * grid.dims[2]) / numSlabs;
+    }
+    runTasks(slabs, splatSlab, parallel);
+
+    vtkSmartPointer< vtkFloatArray > scalars =
+            vtkSmartPointer< vtkFloatArray >::New();
+    // the image uses the grid's values without copying them
+    scalars->SetArray(grid.values, values.size(), 1);
+    vtkSmartPointer< vtkImageData > image = vtkSmartPointer< vtkImageData >::New();
+    image->SetDimensions(grid.dims);
+    image->SetOrigin(grid.origin);
+    image->SetSpacing(grid.spacing, grid.spacing, grid.spacing);
+    image->GetPointData()->SetScalars(scalars);
+    vtkSmartPointer< vtkMarchingCubes > contour =
+            vtkSmartPointer< vtkMarchingCubes >::New();
+    contour->SetInputData(image);
+    contour->SetValue(0, 1.0);
+    contour->ComputeNormalsOff();
+    contour->ComputeGradientsOff();
+    contour->ComputeScalarsOff();
+    contour->Update();
+
+    vtkPolyData *surface = contour->GetOutput();
+    vertices.resize(3 * surface->GetNumberOfPoints());
+    for (vtkIdType p = 0; p < surface->GetNumberOfPoints(); p++)
+    {
+        double point[3];
+        surface->GetPoint(p, point);
+        for (int i = 0; i < 3; i++)
+        {
+            vertices[3 * p + i] = point[i];
+        }
+    }
+    vtkCellArray *polys = surface->GetPolys();
+    vtkIdType npts, *pts;
+    triangles.reserve(3 * polys->GetNumberOfCells());
+    for (polys->InitTraversal(); polys->GetNextCell(npts, pts);)
+    {
+        if (npts == 3)
+        {
+            triangles.append(pts[0]);
+            triangles.append(pts[1]);
+            triangles.append(pts[2]);
+        }
+    }
+}
+
+// Reverses the triangles if they are wound so that their normals point the
+// opposite way from the vertex normals
+static void orientTriangles(const QVector< float > &vertices,
+                            const float *normals,
+                            QVector< vtkIdType > &triangles)
+{
+    double agreement = 0.0;
+    for (int t = 0; t < triangles.size(); t += 3)
+    {
+        const float *a = &vertices[3 * triangles[t]];
+        const float *b = &vertices[3 * triangles[t + 1]];
+        const float *c = &vertices[3 * triangles[t + 2]];
+        float u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+        float w[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+        float n[3] = { u[1] * w[2] - u[2] * w[1], u[2] * w[0] - u[0] * w[2],
+                       u[0] * w[1] - u[1] * w[0] };
+        for (int i = 0; i < 3; i++)
+        {
+            agreement += n[i] * (normals[3 * triangles[t] + i] +
+                                 normals[3 * triangles[t + 1] + i] +
+                                 normals[3 * triangles[t + 2] + i]);
+        }
+    }
+    if (agreement < 0.0)
+    {
+        for (int t = 0; t < triangles.size(); t += 3)
+        {
+            std::swap(triangles[t + 1], triangles[t + 2]);
+        }
+    }
+}
+
+vtkSmartPointer< vtkPolyData > makeModel(
+        const QVector< StructureReader::Atom > &atoms, int resolution,
+        bool parallel)
+{
+    QVector< AtomInfo > info = findResidues(atoms);
+    int numAtoms = atoms.size();
+
+    // the surface parameters
+    double blobbiness, radiusIncrease, spacing;
+    if (resolution <= 0)
+    {
+        blobbiness = ATOMIC_DETAIL_BLOBBINESS;
+        radiusIncrease = 0.0;
+        spacing = ATOMIC_DETAIL_SPACING;
+    }
+    else
+    {
+        blobbiness = LOW_RESOLUTION_BLOBBINESS;
+        radiusIncrease = RESOLUTION_RADIUS_SCALE * resolution;
+        spacing = std::max(ATOMIC_DETAIL_SPACING, resolution / 3.0);
+    }
+    // an atom adds less than MIN_DENSITY_CONTRIBUTION beyond this many radii
+    double cutoffScale = std::sqrt(1.0 - std::log(MIN_DENSITY_CONTRIBUTION)
+                                   / blobbiness);
+    QVector< SurfaceAtom > surfaceAtoms;
+    float maxCutoff = 0.0f;
+    for (int a = 0; a < numAtoms; a++)
+    {
+        if (info[a].isIon)
+        {
+            continue;
+        }
+        SurfaceAtom atom;
+        for (int i = 0; i < 3; i++)
+        {
+            atom.position[i] = atoms[a].position[i];
+        }
+        double radius = getVanDerWaalsRadius(atoms[a].element) + radiusIncrease;
+        atom.inverseRadius2 = 1.0 / (radius * radius);
+        atom.cutoff2 = (radius * cutoffScale) * (radius * cutoffScale);
+        atom.atom = a;
+        maxCutoff = std::max(maxCutoff, float(radius * cutoffScale));
+        surfaceAtoms.append(atom);
+    }
+    std::sort(surfaceAtoms.begin(), surfaceAtoms.end());
+
+    QVector< float > vertices;
+    QVector< vtkIdType > triangles;
+    makeSurface(surfaceAtoms, spacing, blobbiness, maxCutoff, parallel,
+                vertices, triangles);
+    int numVertices = vertices.size() / 3;
+    int numPoints = numAtoms + numVertices;
+
+    // all the points, atoms first
+    QVector< float > points(3 * numPoints);
+    for (int a = 0; a < numAtoms; a++)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            points[3 * a + i] = atoms[a].position[i];
+        }
+    }
+    std::copy(vertices.begin(), vertices.end(), points.begin() + 3 * numAtoms);
+    QVector< float > chargePositions, charges;
+    for (int a = 0; a < numAtoms; a++)
+    {
+        if (info[a].charge != 0.0f)
+        {
+            chargePositions << atoms[a].position[0] << atoms[a].position[1]
+                            << atoms[a].position[2];
+            charges.append(info[a].charge);
+        }
+    }
+    Bins chargeBins;
+    makeBins(chargeBins, chargePositions.data(), charges.size(), CHARGE_CUTOFF);
+    QVector< float > surfaceAtomXYZ(3 * surfaceAtoms.size());
+    for (int a = 0; a < surfaceAtoms.size(); a++)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            surfaceAtomXYZ[3 * a + i] = surfaceAtoms[a].position[i];
+        }
+    }
+    Bins surfaceAtomBins;
+    makeBins(surfaceAtomBins, surfaceAtomXYZ.data(), surfaceAtoms.size(),
+             std::max(maxCutoff, 1.0f));
+    QVector< float > normals(3 * numVertices), potential(numPoints);
+    QVector< int > nearestAtom(numVertices);
+    PointContext context;
+    context.surfaceAtoms = &surfaceAtoms;
+    context.surfaceAtomBins = &surfaceAtomBins;
+    context.blobbiness = blobbiness;
+    context.chargePositions = &chargePositions;
+    context.charges = &charges;
+    context.chargeBins = &chargeBins;
+    context.points = points.data();
+    context.numAtoms = numAtoms;
+    context.normals = normals.data();
+    context.nearestAtom = nearestAtom.data();
+    context.potential = potential.data();
+    int numTasks = numberOfTasks(numPoints, parallel);
+    QVector< PointTask > tasks(numTasks);
+    for (int t = 0; t < numTasks; t++)
+    {
+        tasks[t].context = &context;
+        tasks[t].begin = (qint64(t) * numPoints) / numTasks;
+        tasks[t].end = (qint64(t + 1) * numPoints) / numTasks;
+    }
+    runTasks(tasks, computePointAttributes, parallel);
+    orientTriangles(vertices, normals.constData(), triangles);
+
+    // put it all in the polydata
+    vtkSmartPointer< vtkPolyData > model = vtkSmartPointer< vtkPolyData >::New();
+    vtkSmartPointer< vtkPoints > modelPoints = vtkSmartPointer< vtkPoints >::New();
+    modelPoints->SetDataTypeToFloat();
+    modelPoints->SetNumberOfPoints(numPoints);
+    for (int p = 0; p < numPoints; p++)
+    {
+        modelPoints->SetPoint(p, &points[3 * p]);
+    }
+    model->SetPoints(modelPoints);
+    vtkSmartPointer< vtkCellArray > lines = vtkSmartPointer< vtkCellArray >::New();
+    findBonds(atoms, info, points.constData(), lines);
+    model->SetLines(lines);
+    vtkSmartPointer< vtkCellArray > polys = vtkSmartPointer< vtkCellArray >::New();
+    for (int t = 0; t < triangles.size(); t += 3)
+    {
+        vtkIdType ids[3] = { numAtoms + triangles[t], numAtoms + triangles[t + 1],
+                             numAtoms + triangles[t + 2] };
+        polys->InsertNextCell(3, ids);
+    }
+    model->SetPolys(polys);
+
+    vtkSmartPointer< vtkIntArray > modelNum = vtkSmartPointer< vtkIntArray >::New();
+    modelNum->SetName("modelNum");
+    vtkSmartPointer< vtkIntArray > atomNum = vtkSmartPointer< vtkIntArray >::New();
+    atomNum->SetName("atomNum");
+    vtkSmartPointer< vtkIntArray > resNum = vtkSmartPointer< vtkIntArray >::New();
+    resNum->SetName("resNum");
+    vtkSmartPointer< vtkStringArray > resType =
+            vtkSmartPointer< vtkStringArray >::New();
+    resType->SetName("resType");
+    vtkSmartPointer< vtkStringArray > atomType =
+            vtkSmartPointer< vtkStringArray >::New();
+    atomType->SetName("atomType");
+    vtkSmartPointer< vtkFloatArray > bFactor =
+            vtkSmartPointer< vtkFloatArray >::New();
+    bFactor->SetName("bFactor");
+    vtkSmartPointer< vtkFloatArray > occupancy =
+            vtkSmartPointer< vtkFloatArray >::New();
+    occupancy->SetName("occupancy");
+    vtkSmartPointer< vtkFloatArray > chainPosition =
+            vtkSmartPointer< vtkFloatArray >::New();
+    chainPosition->SetName("chainPosition");
+    vtkSmartPointer< vtkFloatArray > charge =
+            vtkSmartPointer< vtkFloatArray >::New();
+    charge->SetName("charge");
+    vtkSmartPointer< vtkFloatArray > pointNormals =
+            vtkSmartPointer< vtkFloatArray >::New();
+    pointNormals->SetName("Normals");
+    pointNormals->SetNumberOfComponents(3);
+    modelNum->SetNumberOfValues(numPoints);
+    atomNum->SetNumberOfValues(numPoints);
+    resNum->SetNumberOfValues(numPoints);
+    resType->SetNumberOfValues(numPoints);
+    atomType->SetNumberOfValues(numPoints);
+    bFactor->SetNumberOfValues(numPoints);
+    occupancy->SetNumberOfValues(numPoints);
+    chainPosition->SetNumberOfValues(numPoints);
+    charge->SetNumberOfValues(numPoints);
+    pointNormals->SetNumberOfTuples(numPoints);
+    for (int p = 0; p < numPoints; p++)
+    {
+        bool isAtom = p < numAtoms;
+        int a = isAtom ? p : nearestAtom[p - numAtoms];
+        modelNum->SetValue(p, isAtom ? 0 : 1);
+        atomNum->SetValue(p, a);
+        resNum->SetValue(p, info[a].residue);
+        resType->SetValue(p, atoms[a].residueName.constData());
+        atomType->SetValue(p, atoms[a].name.constData());
+        bFactor->SetValue(p, atoms[a].bFactor);
+        occupancy->SetValue(p, atoms[a].occupancy);
+        chainPosition->SetValue(p, info[a].chainPosition);
+        charge->SetValue(p, potential[p]);
+        if (isAtom)
+        {
+            pointNormals->SetTuple3(p, 0.0, 0.0, 1.0);
+        }
+        else
+        {
+            const float *n = &normals[3 * (p - numAtoms)];
+            pointNormals->SetTuple3(p, n[0], n[1], n[2]);
+        }
+    }
+    vtkPointData *pointData = model->GetPointData();
+    pointData->SetNormals(pointNormals);
+    pointData->AddArray(modelNum);
+    pointData->AddArray(atomNum);
+    pointData->AddArray(resNum);
+    pointData->AddArray(resType);
+    pointData->AddArray(atomType);
+    pointData->AddArray(bFactor);
+    pointData->AddArray(occupancy);
+    pointData->AddArray(chainPosition);
+    pointData->AddArray(charge);
+    return model;
+}
+
+}
@@ -0,0 +1,56 @@
+#ifndef MOLECULARSURFACE_H
+#define MOLECULARSURFACE_H
+
+#include <vtkSmartPointer.h>
+class vtkPolyData;
+
+#include <QByteArray>
+#include <QVector>
+
+#include "structurereader.h"
+
+/*
+ * This is a namespace for making the model of a molecular structure in
+ * process, without UCSF Chimera.
+ *
+ * The surface is an isosurface of a Gaussian density made from the atoms
+ * (like the surfaces Chimera's Multiscale Models make): each atom adds
+ * exp(-b * (d^2 / R^2 - 1)) to a grid and the surface is where the sum is 1.
+ * A lone atom's surface is then a sphere of radius R.  With resolution 0, R
+ * is the atom's van der Waals radius and the surface is close to the atoms.
+ * Higher resolutions make the atoms bigger and blobbier and the grid
+ * coarser, which makes smoother, simpler surfaces.  The grid is filled in
+ * parallel, one slab of z planes per task.
+ *
+ * The model has the same layout as the vtk files that the ExportVTK Chimera
+ * extension writes: the atoms are points with modelNum 0 (with the bonds as
+ * lines between them) and the surface points have modelNum 1.  Every point
+ * has the atomNum, resNum, resType, atomType, bFactor, occupancy,
+ * chainPosition and charge arrays, each surface point getting the values of
+ * its nearest atom.  The charge array is the electrostatic potential at the
+ * point computed from the formal charges of the charged residues, termini
+ * and ions with a distance dependent dielectric (4r), which is what
+ * Chimera's coulombic command does with partial charges.  Only the charges
+ * within 20 Angstroms of a point are counted (found through a grid of bins),
+ * so this takes time proportional to the number of points instead of points
+ * times charges.
+ */
+namespace MolecularSurface
+{
+/*
+ * Makes the model of the given atoms with the given resolution (in
+ * Angstroms, 0 is full atomic detail).  Single atom hetero residues (ions)
+ * are in the model but not surfaced.  If parallel is false, everything is
+ * done on the calling thread.
+ */
+vtkSmartPointer< vtkPolyData > makeModel(
+        const QVector< StructureReader::Atom > &atoms, int resolution,
+        bool parallel = true);
+
+/*
+ * Returns the van der Waals radius of the given element (upper case).
+ */
+double getVanDerWaalsRadius(const QByteArray &element);
+}
+
+#endif // MOLECULARSURFACE_H
@@ -0,0 +1,145 @@
+#include "objectclipboard.h"
+
+#include <QScopedPointer>
+
+#include "sketchobject.h"
+#include "modelinstance.h"
+#include "objectgroup.h"
+#include "worldmanager.h"
+
+ObjectClipboard::ObjectClipboard()
+    : hasContents(false)
+{
+}
+
+ObjectClipboard::~ObjectClipboard()
+{
+}
+
+bool ObjectClipboard::isEmpty() const
+{
+    return !hasContents;
+}
+
+void ObjectClipboard::clear()
+{
+    hasContents = false;
+    root.children.clear();
+    copiedText.clear();
+}
+
+void ObjectClipboard::copy(SketchObject *object, const QString &text)
+{
+    clear();
+    if (object == NULL)
+    {
+        return;
+    }
+    copyNode(root, object);
+    copiedText = text;
+    hasContents = true;
+}
+
+bool ObjectClipboard::matchesText(const QString &text) const
+{
+    return hasContents && text == copiedText;
+}
+
+SketchObject *ObjectClipboard::createObject() const
+{
+    if (!hasContents)
+    {
+        return NULL;
+    }
+    return createFromNode(root);
+}
+
+SketchObject *ObjectClipboard::paste(WorldManager &world,
+                                     const q_vec_type newPos) const
+{
+    SketchObject *obj = createObject();
+    if (obj == NULL)
+    {
+        return NULL;
+    }
+    // same placement as ProjectToXML::objectFromClipboardXML
+    double bb[6];
+    q_vec_type center, pos, dir;
+    ColorMapType::Type cmap = obj->getColorMapType();
+    world.addObject(obj);
+    obj->getBoundingBox(bb);
+    center[0] = (bb[1] + bb[0]) * 0.5;
+    center[1] = (bb[3] + bb[2]) * 0.5;
+    center[2] = (bb[5] + bb[4]) * 0.5;
+    if (obj->numInstances() == 1)
+    {
+        obj->setColorMapType(cmap);
+        obj->getModelSpacePointInWorldCoordinates(center, center);
+    }
+    obj->getPosition(pos);
+    q_vec_subtract(dir, center, pos);
+    q_vec_subtract(pos, newPos, dir);
+    obj->setPosition(pos);
+    return obj;
+}
+
+void ObjectClipboard::copyNode(Node &node, SketchObject *object)
+{
+    object->getPosition(node.position);
+    object->getOrientation(node.orientation);
+    node.visible = object->isVisible();
+    node.active = object->isActive();
+    node.children.clear();
+    if (object->numInstances() == 1)
+    {
+        node.model = object->getModel();
+        node.conformation = object->getModelConformation();
+        node.colorMap = object->getColorMapType();
+        node.arrayToColorBy = object->getArrayToColorBy();
+        node.luminance = object->getLuminance();
+    }
+    else
+    {
+        node.model = NULL;
+        node.conformation = -1;
+        node.colorMap = ColorMapType::SOLID_COLOR_RED;
+        node.luminance = 0.0;
+        const QList< SketchObject * > *subObjs = object->getSubObjects();
+        if (subObjs != NULL)
+        {
+            for (QListIterator< SketchObject * > it(*subObjs); it.hasNext();)
+            {
+                node.children.append(Node());
+                copyNode(node.children.last(), it.next());
+            }
+        }
+    }
+}
+
+SketchObject *ObjectClipboard::createFromNode(const Node &node)
+{
+    QScopedPointer< SketchObject > object(NULL);
+    if (node.model != NULL)
+    {
+        object.reset(new ModelInstance(node.model, node.conformation));
+        object->setPosAndOrient(node.position, node.orientation);
+        object->setArrayToColorBy(node.arrayToColorBy);
+        object->setColorMapType(node.colorMap);
+        object->setLuminance(node.luminance);
+    }
+    else
+    {
+        QScopedPointer< ObjectGroup > group(new ObjectGroup());
+        group->setPosAndOrient(node.position, node.orientation);
+        // children were saved with their world positions, so addObject
+        // will compute the right group relative positions
+        for (int i = 0; i < node.children.size(); i++)
+        {
+            group->addObject(createFromNode(node.children[i]));
+        }
+        object.reset(group.take());
+    }
+    object->setIsVisible(node.visible);
+    object->setActive(node.active);
+    return object.take();
+}
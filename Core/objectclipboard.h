@@ -0,0 +1,83 @@
+#ifndef OBJECTCLIPBOARD_H
+#define OBJECTCLIPBOARD_H
+
+#include <quat.h>
+
+#include <QList>
+#include <QString>
+
+#include "colormaptype.h"
+
+class SketchModel;
+class SketchObject;
+class WorldManager;
+
+/*
+ * This class holds a copy of an object subtree for copy and paste within a
+ * project.  Unlike the xml clipboard format, it refers directly to the
+ * SketchModels that are already loaded in the project, so pasting just
+ * creates new instances of the same models without reading any xml or
+ * model files.  Since models are owned by the project's ModelManager and
+ * are never removed while the project exists, the clipboard must belong to
+ * the same project as the objects that are copied into it.
+ *
+ * The clipboard stores the same state as ProjectToXML::objectToClipboardXML
+ * (no keyframes) so pasting from either one gives the same result.
+ */
+class ObjectClipboard
+{
+   public:
+    ObjectClipboard();
+    ~ObjectClipboard();
+
+    // returns true if nothing has been copied
+    bool isEmpty() const;
+    // clears the contents of the clipboard
+    void clear();
+
+    // Copies the given object and its children into the clipboard, replacing
+    // the previous contents.  The text is the xml for the same object that
+    // was put on the system clipboard (if any), and is used by matchesText to
+    // tell if the system clipboard still holds what was copied here.
+    void copy(SketchObject *object, const QString &text = QString());
+    // Returns true if the given system clipboard text is the same as the text
+    // given when the current contents were copied
+    bool matchesText(const QString &text) const;
+
+    // Creates a new object tree from the clipboard contents that is not added
+    // to anything.  Returns NULL if the clipboard is empty.  The caller owns
+    // the returned object.
+    SketchObject *createObject() const;
+    // Creates a new object from the clipboard and adds it to the world with
+    // the center of its bounding box at the given position.  Returns the new
+    // object or NULL if the clipboard is empty.
+    SketchObject *paste(WorldManager &world, const q_vec_type newPos) const;
+
+   private:
+    // The saved state of one object in the copied tree
+    struct Node
+    {
+        SketchModel *model;  // NULL for groups
+        int conformation;
+        q_vec_type position;
+        q_type orientation;
+        ColorMapType::Type colorMap;
+        QString arrayToColorBy;
+        double luminance;
+        bool visible;
+        bool active;
+        QList< Node > children;
+    };
+    static void copyNode(Node &node, SketchObject *object);
+    static SketchObject *createFromNode(const Node &node);
+
+    // Disable copy constructor and assignment operator
+    ObjectClipboard(const ObjectClipboard &other);
+    ObjectClipboard &operator=(const ObjectClipboard &other);
+
+    bool hasContents;
+    Node root;
+    QString copiedText;
+};
+
+#endif  // OBJECTCLIPBOARD_H
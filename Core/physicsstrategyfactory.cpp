@@ -12,6 +12,7 @@
 class Connector;
 #include "physicsstrategy.h"
 #include "physicsutilities.h"
+#include "pqpbuilder.h"
 
 /*
  * These classes have definitions further down in the file, below
@@ -142,112 +143,6 @@ void populateStrategies(QVector<QSharedPointer<PhysicsStrategy> > &strategies) {
 // magic # force to use for collisions
 #define COLLISION_FORCE 5
 
-//######################################################################################
-/*
- * This next bit was stolen from PQP's matrix library.  It computes the eigenvalues/eigenvectors
- * of a matrix.  The #define was part of its code
- */
-#define ROTATE(a,i,j,k,l) {g=a[i][j]; h=a[k][l]; a[i][j]=g-s*(h+g*tau); a[k][l]=h+s*(g-h*tau);}
-
-//######################################################################################
-// computes the eigenvalues and eigenvectors of the matrix a
-// returns eigenvectors as columns of vout and eigenvalues in dout
-static void
-inline
-Meigen(PQP_REAL vout[3][3], PQP_REAL dout[3], PQP_REAL a[3][3])
-{
-  int n = 3;
-  int j,iq,ip,i;
-  PQP_REAL tresh,theta,tau,t,sm,s,h,g,c;
-  int nrot;
-  PQP_REAL b[3];
-  PQP_REAL z[3];
-  PQP_REAL v[3][3];
-  PQP_REAL d[3];
-
-  // identity
-  v[0][0] = v[1][1] = v[2][2] = 1;
-  v[0][1] = v[0][2] = v[1][0] = v[1][2] = v[2][0] = v[2][1] = 0;
-
-  for(ip=0; ip<n; ip++)
-    {
-      b[ip] = a[ip][ip];
-      d[ip] = a[ip][ip];
-      z[ip] = 0.0;
-    }
-
-  nrot = 0;
-
-  for(i=0; i<50; i++)
-    {
-
-      sm=0.0;
-      for(ip=0;ip<n;ip++) for(iq=ip+1;iq<n;iq++) sm+=fabs(a[ip][iq]);
-      if (sm == 0.0)
-    {
-          // matrix & vector copies
-          for (int ii = 0; ii < 3; ii++) {
-              for (int jj = 0; jj < 3; jj++) {
-                  vout[ii][jj] = v[ii][jj];
-              }
-              dout[ii] = d[ii];
-          }
-      return;
-    }
-
-
-      if (i < 3) tresh=(PQP_REAL)0.2*sm/(n*n);
-      else tresh=0.0;
-
-      for(ip=0; ip<n; ip++) for(iq=ip+1; iq<n; iq++)
-    {
-      g = (PQP_REAL)100.0*fabs(a[ip][iq]);
-      if (i>3 &&
-          fabs(d[ip])+g==fabs(d[ip]) &&
-          fabs(d[iq])+g==fabs(d[iq]))
-        a[ip][iq]=0.0;
-      else if (fabs(a[ip][iq])>tresh)
-        {
-          h = d[iq]-d[ip];
-          if (fabs(h)+g == fabs(h)) t=(a[ip][iq])/h;
-          else
-        {
-          theta=(PQP_REAL)0.5*h/(a[ip][iq]);
-          t=(PQP_REAL)(1.0/(fabs(theta)+sqrt(1.0+theta*theta)));
-          if (theta < 0.0) t = -t;
-        }
-          c=(PQP_REAL)1.0/sqrt(1+t*t);
-          s=t*c;
-          tau=s/((PQP_REAL)1.0+c);
-          h=t*a[ip][iq];
-          z[ip] -= h;
-          z[iq] += h;
-          d[ip] -= h;
-          d[iq] += h;
-          a[ip][iq]=0.0;
-          for(j=0;j<ip;j++) { ROTATE(a,j,ip,j,iq); }
-          for(j=ip+1;j<iq;j++) { ROTATE(a,ip,j,j,iq); }
-          for(j=iq+1;j<n;j++) { ROTATE(a,ip,j,iq,j); }
-          for(j=0;j<n;j++) { ROTATE(v,j,ip,j,iq); }
-          nrot++;
-        }
-    }
-      for(ip=0;ip<n;ip++)
-    {
-      b[ip] += z[ip];
-      d[ip] = b[ip];
-      z[ip] = 0.0;
-    }
-    }
-
-  fprintf(stderr, "eigen: too many iterations in Jacobi transform.\n");
-
-  return;
-}
-
-#undef ROTATE
-// end code stolen from PQP
-
 //##################################################################################################
 // helper function-- compute the normal n of triangle tri in the model
 // assumes points in each triangle in the model are added in counterclockwise order
@@ -476,7 +371,7 @@ static inline void applyPCACollisionResponseForce(SketchObject* o1, SketchObject
     computeMeanCollisionPoint(mean1,cr,model1,true,m1);
     computeCollisonPointCovariance(mean1,cr,model1,true,m1,covariance1);
     PQP_REAL covEigenVecs1[3][3], covEigenVals1[3];
-    Meigen(covEigenVecs1,covEigenVals1,covariance1);
+    PQPBuilder::eigen(covEigenVecs1,covEigenVals1,covariance1);
     int min1 = (covEigenVals1[0] < covEigenVals1[1]) ?
                 ((covEigenVals1[2] < covEigenVals1[0]) ? 2 : 0) :
                 ((covEigenVals1[2] < covEigenVals1[1]) ? 2 : 1);
@@ -484,7 +379,7 @@ static inline void applyPCACollisionResponseForce(SketchObject* o1, SketchObject
     computeMeanCollisionPoint(mean2,cr,model2,false,m2);
     computeCollisonPointCovariance(mean2,cr,model2,false,m2,covariance2);
     PQP_REAL covEigenVecs2[3][3], covEigenVals2[3];
-    Meigen(covEigenVecs2,covEigenVals2,covariance2);
+    PQPBuilder::eigen(covEigenVecs2,covEigenVals2,covariance2);
     int min2 = (covEigenVals2[0] < covEigenVals2[1]) ?
                 ((covEigenVals2[2] < covEigenVals2[0]) ? 2 : 0) :
                 ((covEigenVals2[2] < covEigenVals2[1]) ? 2 : 1);
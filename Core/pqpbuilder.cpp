@@ -0,0 +1,475 @@
+#include "pqpbuilder.h"
+
+#include <cmath>
+#include <cstdio>
+
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+#include <vtkCellArray.h>
+#include <vtkPoints.h>
+#include <vtkDoubleArray.h>
+#include <vtkFloatArray.h>
+
+#include <QtConcurrentRun>
+#include <QFuture>
+
+#include <PQP.h>
+
+// subtrees with at least this many triangles have their halves built in
+// parallel, smaller ones are not worth the overhead
+#define PARALLEL_SUBTREE_MIN_TRIS 8192
+
+namespace PQPBuilder
+{
+
+//###############################################################
+// Filling the triangle array
+
+// Counts the triangles the cells will be split into
+static int countTriangles(vtkCellArray *cells)
+{
+    const vtkIdType *c = cells->GetPointer();
+    vtkIdType numCells = cells->GetNumberOfCells();
+    int count = 0;
+    vtkIdType loc = 0;
+    for (vtkIdType i = 0; i < numCells; i++)
+    {
+        vtkIdType n = c[loc];
+        if (n > 2)
+        {
+            count += n - 2;
+        }
+        loc += n + 1;
+    }
+    return count;
+}
+
+template < typename T >
+static inline void copyPoint(PQP_REAL dst[3], const T *pts, vtkIdType id)
+{
+    dst[0] = pts[3 * id];
+    dst[1] = pts[3 * id + 1];
+    dst[2] = pts[3 * id + 2];
+}
+
+// Fills the triangles straight from the points and cell arrays.  Strips
+// alternate winding so that all triangles are counterclockwise, and polygons
+// are split into fans.  This is the same triangulation the AddTri based code
+// in ModelUtilities used.
+template < typename T >
+static void fillTriangles(Tri *tris, const T *pts, vtkCellArray *cells,
+                          bool strips)
+{
+    const vtkIdType *c = cells->GetPointer();
+    vtkIdType numCells = cells->GetNumberOfCells();
+    int t = 0;
+    vtkIdType loc = 0;
+    for (vtkIdType i = 0; i < numCells; i++)
+    {
+        vtkIdType n = c[loc];
+        const vtkIdType *ids = &c[loc + 1];
+        for (vtkIdType j = 2; j < n; j++)
+        {
+            Tri &tri = tris[t];
+            if (!strips)
+            {
+                copyPoint(tri.p1, pts, ids[0]);
+                copyPoint(tri.p2, pts, ids[j - 1]);
+                copyPoint(tri.p3, pts, ids[j]);
+            }
+            else if (j % 2 == 0)
+            {
+                copyPoint(tri.p1, pts, ids[j - 2]);
+                copyPoint(tri.p2, pts, ids[j - 1]);
+                copyPoint(tri.p3, pts, ids[j]);
+            }
+            else
+            {
+                copyPoint(tri.p1, pts, ids[j - 2]);
+                copyPoint(tri.p2, pts, ids[j]);
+                copyPoint(tri.p3, pts, ids[j - 1]);
+            }
+            tri.id = t;
+            t++;
+        }
+        loc += n + 1;
+    }
+}
+
+//###############################################################
+// Building the bounding volume tree.  This follows PQP's Build.cpp so that
+// the tree is the same one PQP would build.
+
+// begin code stolen from PQP's matrix library, the #define was part of its
+// code
+#define ROTATE(a,i,j,k,l) {g=a[i][j]; h=a[k][l]; a[i][j]=g-s*(h+g*tau); a[k][l]=h+s*(g-h*tau);}
+
+void eigen(PQP_REAL vout[3][3], PQP_REAL dout[3], PQP_REAL a[3][3])
+{
+    int n = 3;
+    int j, iq, ip, i;
+    PQP_REAL tresh, theta, tau, t, sm, s, h, g, c;
+    PQP_REAL b[3];
+    PQP_REAL z[3];
+    PQP_REAL v[3][3];
+    PQP_REAL d[3];
+
+    // identity
+    v[0][0] = v[1][1] = v[2][2] = 1;
+    v[0][1] = v[0][2] = v[1][0] = v[1][2] = v[2][0] = v[2][1] = 0;
+
+    for (ip = 0; ip < n; ip++)
+    {
+        b[ip] = a[ip][ip];
+        d[ip] = a[ip][ip];
+        z[ip] = 0.0;
+    }
+
+    for (i = 0; i < 50; i++)
+    {
+        sm = 0.0;
+        for (ip = 0; ip < n; ip++)
+            for (iq = ip + 1; iq < n; iq++) sm += fabs(a[ip][iq]);
+        if (sm == 0.0)
+        {
+            // matrix & vector copies
+            for (int ii = 0; ii < 3; ii++)
+            {
+                for (int jj = 0; jj < 3; jj++)
+                {
+                    vout[ii][jj] = v[ii][jj];
+                }
+                dout[ii] = d[ii];
+            }
+            return;
+        }
+
+        if (i < 3)
+            tresh = (PQP_REAL)0.2 * sm / (n * n);
+        else
+            tresh = 0.0;
+
+        for (ip = 0; ip < n; ip++)
+            for (iq = ip + 1; iq < n; iq++)
+            {
+                g = (PQP_REAL)100.0 * fabs(a[ip][iq]);
+                if (i > 3 && fabs(d[ip]) + g == fabs(d[ip]) &&
+                    fabs(d[iq]) + g == fabs(d[iq]))
+                    a[ip][iq] = 0.0;
+                else if (fabs(a[ip][iq]) > tresh)
+                {
+                    h = d[iq] - d[ip];
+                    if (fabs(h) + g == fabs(h))
+                        t = (a[ip][iq]) / h;
+                    else
+                    {
+                        theta = (PQP_REAL)0.5 * h / (a[ip][iq]);
+                        t = (PQP_REAL)(1.0 /
+                                       (fabs(theta) + sqrt(1.0 + theta * theta)));
+                        if (theta < 0.0) t = -t;
+                    }
+                    c = (PQP_REAL)1.0 / sqrt(1 + t * t);
+                    s = t * c;
+                    tau = s / ((PQP_REAL)1.0 + c);
+                    h = t * a[ip][iq];
+                    z[ip] -= h;
+                    z[iq] += h;
+                    d[ip] -= h;
+                    d[iq] += h;
+                    a[ip][iq] = 0.0;
+                    for (j = 0; j < ip; j++) { ROTATE(a, j, ip, j, iq); }
+                    for (j = ip + 1; j < iq; j++) { ROTATE(a, ip, j, j, iq); }
+                    for (j = iq + 1; j < n; j++) { ROTATE(a, ip, j, iq, j); }
+                    for (j = 0; j < n; j++) { ROTATE(v, j, ip, j, iq); }
+                }
+            }
+        for (ip = 0; ip < n; ip++)
+        {
+            b[ip] += z[ip];
+            d[ip] = b[ip];
+            z[ip] = 0.0;
+        }
+    }
+
+    fprintf(stderr, "eigen: too many iterations in Jacobi transform.\n");
+}
+
+#undef ROTATE
+
+static void getCentroid(PQP_REAL c[3], const Tri *tris, int numTris)
+{
+    c[0] = c[1] = c[2] = 0.0;
+    for (int i = 0; i < numTris; i++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            c[k] += tris[i].p1[k] + tris[i].p2[k] + tris[i].p3[k];
+        }
+    }
+    PQP_REAL n = (PQP_REAL)(3 * numTris);
+    c[0] /= n;
+    c[1] /= n;
+    c[2] /= n;
+}
+
+static void getCovariance(PQP_REAL M[3][3], const Tri *tris, int numTris)
+{
+    PQP_REAL S1[3] = {0.0, 0.0, 0.0};
+    PQP_REAL S2[3][3] = {{0.0, 0.0, 0.0}, {0.0, 0.0, 0.0}, {0.0, 0.0, 0.0}};
+    for (int i = 0; i < numTris; i++)
+    {
+        const PQP_REAL *p1 = tris[i].p1;
+        const PQP_REAL *p2 = tris[i].p2;
+        const PQP_REAL *p3 = tris[i].p3;
+        for (int k = 0; k < 3; k++)
+        {
+            S1[k] += p1[k] + p2[k] + p3[k];
+        }
+        S2[0][0] += (p1[0] * p1[0] + p2[0] * p2[0] + p3[0] * p3[0]);
+        S2[1][1] += (p1[1] * p1[1] + p2[1] * p2[1] + p3[1] * p3[1]);
+        S2[2][2] += (p1[2] * p1[2] + p2[2] * p2[2] + p3[2] * p3[2]);
+        S2[0][1] += (p1[0] * p1[1] + p2[0] * p2[1] + p3[0] * p3[1]);
+        S2[0][2] += (p1[0] * p1[2] + p2[0] * p2[2] + p3[0] * p3[2]);
+        S2[1][2] += (p1[1] * p1[2] + p2[1] * p2[2] + p3[1] * p3[2]);
+    }
+    PQP_REAL n = (PQP_REAL)(3 * numTris);
+    M[0][0] = S2[0][0] - S1[0] * S1[0] / n;
+    M[1][1] = S2[1][1] - S1[1] * S1[1] / n;
+    M[2][2] = S2[2][2] - S1[2] * S1[2] / n;
+    M[0][1] = S2[0][1] - S1[0] * S1[1] / n;
+    M[1][2] = S2[1][2] - S1[1] * S1[2] / n;
+    M[0][2] = S2[0][2] - S1[0] * S1[2] / n;
+    M[1][0] = M[0][1];
+    M[2][0] = M[0][2];
+    M[2][1] = M[1][2];
+}
+
+// Partitions the triangles by which side of the plane through c with normal
+// a their centroids are on.  Returns the number on the low side.
+static int splitTriangles(Tri *tris, int numTris, const PQP_REAL a[3],
+                          PQP_REAL c)
+{
+    int c1 = 0;
+    for (int i = 0; i < numTris; i++)
+    {
+        PQP_REAL x = 0.0;
+        for (int k = 0; k < 3; k++)
+        {
+            x += (tris[i].p1[k] + tris[i].p2[k] + tris[i].p3[k]) * a[k];
+        }
+        x /= 3.0;
+        if (x <= c)
+        {
+            Tri temp = tris[i];
+            tris[i] = tris[c1];
+            tris[c1] = temp;
+            c1++;
+        }
+    }
+    // split arbitrarily if one group empty
+    if ((c1 == 0) || (c1 == numTris)) c1 = numTris / 2;
+    return c1;
+}
+
+// Changes the child's orientation and position to be relative to its
+// parent.  Both must be world relative when this is called.
+static void makeParentRelative(BV *child, const BV *parent)
+{
+    PQP_REAL Rpc[3][3], Tpc[3];
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            Rpc[i][j] = parent->R[0][i] * child->R[0][j] +
+                        parent->R[1][i] * child->R[1][j] +
+                        parent->R[2][i] * child->R[2][j];
+        }
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            child->R[i][j] = Rpc[i][j];
+        }
+    }
+#if PQP_BV_TYPE & RSS_TYPE
+    for (int i = 0; i < 3; i++)
+    {
+        Tpc[i] = child->Tr[i] - parent->Tr[i];
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        child->Tr[i] = parent->R[0][i] * Tpc[0] + parent->R[1][i] * Tpc[1] +
+                       parent->R[2][i] * Tpc[2];
+    }
+#endif
+#if PQP_BV_TYPE & OBB_TYPE
+    for (int i = 0; i < 3; i++)
+    {
+        Tpc[i] = child->To[i] - parent->To[i];
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        child->To[i] = parent->R[0][i] * Tpc[0] + parent->R[1][i] * Tpc[1] +
+                       parent->R[2][i] * Tpc[2];
+    }
+#endif
+}
+
+// A subtree of the bounding volume tree.  A subtree with n triangles uses 2n-1
+// bounding volumes: its root at bv and its descendants starting at nextFree.
+// PQP allocates both children of a node next to each other, then all the
+// descendants of the first child, then all those of the second.
+struct Subtree
+{
+    int bv;
+    int firstTri;
+    int numTris;
+    int nextFree;
+};
+
+static void buildSubtree(PQP_Model *m, Subtree tree, bool parallel)
+{
+    BV *b = &m->b[tree.bv];
+    Tri *tris = &m->tris[tree.firstTri];
+
+    // compute a rotation matrix
+    PQP_REAL C[3][3], E[3][3], R[3][3], s[3], axis[3], mean[3], coord;
+    getCovariance(C, tris, tree.numTris);
+    eigen(E, s, C);
+
+    // place axes of E in order of increasing s
+    int min, mid, max;
+    if (s[0] > s[1]) { max = 0; min = 1; }
+    else { min = 0; max = 1; }
+    if (s[2] < s[min]) { mid = min; min = 2; }
+    else if (s[2] > s[max]) { mid = max; max = 2; }
+    else { mid = 2; }
+    for (int i = 0; i < 3; i++)
+    {
+        R[i][0] = E[i][max];
+        R[i][1] = E[i][mid];
+    }
+    R[0][2] = E[1][max] * E[2][mid] - E[1][mid] * E[2][max];
+    R[1][2] = E[0][mid] * E[2][max] - E[0][max] * E[2][mid];
+    R[2][2] = E[0][max] * E[1][mid] - E[0][mid] * E[1][max];
+
+    // fit the BV
+    b->FitToTris(R, tris, tree.numTris);
+
+    if (tree.numTris == 1)
+    {
+        // BV is a leaf BV - first_child will index a triangle
+        b->first_child = -(tree.firstTri + 1);
+        return;
+    }
+    // BV not a leaf - first_child will index a BV
+    b->first_child = tree.nextFree;
+
+    // choose splitting axis and splitting coord, then split
+    for (int i = 0; i < 3; i++)
+    {
+        axis[i] = R[i][0];
+    }
+    getCentroid(mean, tris, tree.numTris);
+    coord = axis[0] * mean[0] + axis[1] * mean[1] + axis[2] * mean[2];
+    int numFirstHalf = splitTriangles(tris, tree.numTris, axis, coord);
+
+    Subtree first, second;
+    first.bv = tree.nextFree;
+    first.firstTri = tree.firstTri;
+    first.numTris = numFirstHalf;
+    first.nextFree = tree.nextFree + 2;
+    second.bv = tree.nextFree + 1;
+    second.firstTri = tree.firstTri + numFirstHalf;
+    second.numTris = tree.numTris - numFirstHalf;
+    second.nextFree = first.nextFree + 2 * first.numTris - 2;
+
+    // the halves are independent, so build large ones in parallel
+    if (parallel && tree.numTris >= PARALLEL_SUBTREE_MIN_TRIS)
+    {
+        QFuture< void > firstDone =
+                QtConcurrent::run(buildSubtree, m, first, parallel);
+        buildSubtree(m, second, parallel);
+        firstDone.waitForFinished();
+    }
+    else
+    {
+        buildSubtree(m, first, parallel);
+        buildSubtree(m, second, parallel);
+    }
+    // the children's own children are already relative to them, now that
+    // nothing else needs the children's world relative transforms, make them
+    // relative to this BV
+    makeParentRelative(&m->b[first.bv], b);
+    makeParentRelative(&m->b[second.bv], b);
+}
+// end code stolen from PQP
+
+//###############################################################
+
+bool buildModel(PQP_Model *m, vtkPolyData *polyData, bool parallel)
+{
+    bool useStrips = polyData->GetNumberOfStrips() > 0;
+    vtkCellArray *cells = useStrips ? polyData->GetStrips() : polyData->GetPolys();
+    int numTris = (cells == NULL) ? 0 : countTriangles(cells);
+    if (numTris == 0 || polyData->GetPoints() == NULL)
+    {
+        return false;
+    }
+#ifdef PQP_UPDATE_EPSILON
+    // the modified PQP keeps extra data that is only built by EndModel
+    parallel = false;
+#endif
+
+    // BeginModel frees any old data and allocates the triangles
+    m->BeginModel(numTris);
+    vtkDataArray *points = polyData->GetPoints()->GetData();
+    if (points->GetDataType() == VTK_FLOAT)
+    {
+        fillTriangles(m->tris,
+                      static_cast< vtkFloatArray * >(points)->GetPointer(0),
+                      cells, useStrips);
+    }
+    else
+    {
+        vtkSmartPointer< vtkDoubleArray > doublePoints;
+        if (points->GetDataType() != VTK_DOUBLE)
+        {
+            doublePoints = vtkSmartPointer< vtkDoubleArray >::New();
+            doublePoints->DeepCopy(points);
+            points = doublePoints;
+        }
+        fillTriangles(m->tris,
+                      static_cast< vtkDoubleArray * >(points)->GetPointer(0),
+                      cells, useStrips);
+    }
+    m->num_tris = numTris;
+
+#ifdef PQP_UPDATE_EPSILON
+    m->EndModel();
+#else
+    // what EndModel does, but with the tree built here
+    m->b = new BV[2 * numTris - 1];
+    m->num_bvs_alloced = 2 * numTris - 1;
+    Subtree root;
+    root.bv = 0;
+    root.firstTri = 0;
+    root.numTris = numTris;
+    root.nextFree = 1;
+    // the root stays world relative (relative to the identity)
+    buildSubtree(m, root, parallel);
+    m->num_bvs = 2 * numTris - 1;
+    m->last_tri = m->tris;
+    m->build_state = PQP_BUILD_STATE_PROCESSED;
+#endif
+    // the tree reorders the triangles, make the ids their new indices (as
+    // the old makePQP_Model did) so collision results index m->tris directly
+    for (int i = 0; i < m->num_tris; i++)
+    {
+        m->tris[i].id = i;
+    }
+    return true;
+}
+
+}
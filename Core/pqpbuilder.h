@@ -0,0 +1,44 @@
+#ifndef PQPBUILDER_H
+#define PQPBUILDER_H
+
+#include <PQP_Compile.h>
+
+class vtkPolyData;
+class PQP_Model;
+
+/*
+ * This is a namespace for building PQP collision models directly from
+ * vtkPolyData.
+ *
+ * Building through PQP's BeginModel/AddTri/EndModel interface means copying
+ * every point out of the polydata, then copying each triangle into a growing
+ * array one at a time before the bounding volume tree is built on one thread.
+ * The builder here counts the triangles first, allocates PQP's triangle array
+ * once at its final size and fills it with one pass over the cell array and
+ * the points array (no temporary copies).  It then builds the same bounding
+ * volume tree that PQP would, but since the subtrees for each half of a split
+ * are independent and their positions in PQP's bounding volume array can be
+ * computed from the number of triangles in them, large subtrees are built in
+ * parallel.
+ */
+namespace PQPBuilder
+{
+/*
+ * Replaces the contents of the PQP_Model with the triangles in the polydata's
+ * triangle strips (or polygons if there are no strips) and builds its
+ * bounding volume tree.  Triangle ids are the triangle's index in the model's
+ * triangle array after the tree is built.  If parallel is false, the tree is
+ * built on the calling thread.  Returns false if there are no triangles (in
+ * which case the model is left empty).
+ */
+bool buildModel(PQP_Model *m, vtkPolyData *polyData, bool parallel = true);
+
+/*
+ * Computes the eigenvalues and eigenvectors of the symmetric matrix a (which
+ * is changed) with PQP's Jacobi method.  The eigenvectors are returned as
+ * the columns of vout and the eigenvalues in dout.
+ */
+void eigen(PQP_REAL vout[3][3], PQP_REAL dout[3], PQP_REAL a[3][3]);
+}
+
+#endif // PQPBUILDER_H
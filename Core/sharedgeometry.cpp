@@ -0,0 +1,217 @@
+#include "sharedgeometry.h"
+
+#include <vtkPolyData.h>
+#include <vtkPolyDataAlgorithm.h>
+#include <vtkPolyDataMapper.h>
+#include <vtkPointData.h>
+#include <vtkCellArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkPoints.h>
+#include <vtkDataArray.h>
+
+#include <QCryptographicHash>
+#include <QWeakPointer>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QHash>
+
+#include <PQP.h>
+
+#include "modelutilities.h"
+
+//###############################################################
+// Registry of the geometry in use, by fingerprint.  Only weak pointers are
+// kept here so that the geometry is freed when the last user is done with it.
+
+static QMutex registryMutex;
+static QHash< QByteArray, QWeakPointer< SharedGeometry > > registry;
+
+//###############################################################
+
+static void addArrayToHash(QCryptographicHash &hash, vtkDataArray *array)
+{
+    if (array == NULL)
+    {
+        hash.addData("null", 4);
+        return;
+    }
+    qint64 header[3] = {array->GetDataType(), array->GetNumberOfTuples(),
+                        array->GetNumberOfComponents()};
+    hash.addData(reinterpret_cast< const char * >(header), sizeof(header));
+    hash.addData(
+        reinterpret_cast< const char * >(array->GetVoidPointer(0)),
+        array->GetNumberOfTuples() * array->GetNumberOfComponents() *
+            array->GetDataTypeSize());
+}
+
+static void addCellsToHash(QCryptographicHash &hash, vtkCellArray *cells)
+{
+    addArrayToHash(hash, cells == NULL ? NULL : cells->GetData());
+}
+
+QByteArray SharedGeometry::fingerprint(vtkPolyData *data)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    addArrayToHash(hash, data->GetPoints() == NULL ? NULL
+                                                   : data->GetPoints()->GetData());
+    addCellsToHash(hash, data->GetVerts());
+    addCellsToHash(hash, data->GetLines());
+    addCellsToHash(hash, data->GetPolys());
+    addCellsToHash(hash, data->GetStrips());
+    // the point data arrays are used for coloring and for separating the
+    // surface from the atoms, so they have to match too
+    vtkPointData *pointData = data->GetPointData();
+    for (int i = 0; i < pointData->GetNumberOfArrays(); i++)
+    {
+        const char *name = pointData->GetArrayName(i);
+        if (name != NULL)
+        {
+            hash.addData(name, qstrlen(name) + 1);
+        }
+        addArrayToHash(hash, pointData->GetArray(i));
+    }
+    return hash.result();
+}
+
+QSharedPointer< SharedGeometry > SharedGeometry::getGeometryFor(
+    vtkPolyDataAlgorithm *data)
+{
+    QByteArray hash = fingerprint(data->GetOutput());
+    {
+        QMutexLocker lock(&registryMutex);
+        QSharedPointer< SharedGeometry > existing =
+            registry.value(hash).toStrongRef();
+        if (!existing.isNull())
+        {
+            return existing;
+        }
+    }
+    // build the new geometry without holding the lock since building the
+    // collision model can take a while
+    QSharedPointer< SharedGeometry > geometry(new SharedGeometry(data, hash));
+    QSharedPointer< SharedGeometry > existing;
+    {
+        QMutexLocker lock(&registryMutex);
+        // someone else may have added the same geometry in the meantime
+        existing = registry.value(hash).toStrongRef();
+        if (existing.isNull())
+        {
+            registry.insert(hash, geometry.toWeakRef());
+        }
+    }
+    // the unused geometry (if any) is freed after the lock is released since
+    // its destructor takes the lock
+    return existing.isNull() ? geometry : existing;
+}
+
+int SharedGeometry::getNumberOfGeometries()
+{
+    QMutexLocker lock(&registryMutex);
+    int count = 0;
+    QHashIterator< QByteArray, QWeakPointer< SharedGeometry > > it(registry);
+    while (it.hasNext())
+    {
+        if (!it.next().value().isNull())
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+SharedGeometry::SharedGeometry(vtkPolyDataAlgorithm *dataSource,
+                               const QByteArray &fingerprint)
+    : hash(fingerprint),
+      data(dataSource),
+      users(0),
+      numTriangles(0),
+      dataMemorySize(0)
+{
+    surface.TakeReference(ModelUtilities::modelSurfaceFrom(data));
+    atoms.TakeReference(ModelUtilities::modelAtomsFrom(data));
+    solidMapper.TakeReference(vtkPolyDataMapper::New());
+    solidMapper->SetInputConnection(surface->GetOutputPort());
+    solidMapper->Update();
+    numTriangles = getCollisionModel()->num_tris;
+    // GetActualMemorySize is in kibibytes
+    dataMemorySize = qint64(data->GetOutput()->GetActualMemorySize()) * 1024;
+    if (surface.GetPointer() != data.GetPointer())
+    {
+        dataMemorySize +=
+            qint64(surface->GetOutput()->GetActualMemorySize()) * 1024;
+    }
+    if (atoms.GetPointer() != NULL)
+    {
+        dataMemorySize +=
+            qint64(atoms->GetOutput()->GetActualMemorySize()) * 1024;
+    }
+}
+
+SharedGeometry::~SharedGeometry()
+{
+    QMutexLocker lock(&registryMutex);
+    // only remove the entry if it is this geometry's (expired) entry and not
+    // a new geometry with the same fingerprint
+    QHash< QByteArray, QWeakPointer< SharedGeometry > >::iterator it =
+        registry.find(hash);
+    if (it != registry.end() && it.value().isNull())
+    {
+        registry.erase(it);
+    }
+}
+
+const QByteArray &SharedGeometry::getFingerprint() const { return hash; }
+
+vtkPolyDataAlgorithm *SharedGeometry::getData() const { return data; }
+
+vtkPolyDataAlgorithm *SharedGeometry::getSurface() const { return surface; }
+
+vtkPolyDataAlgorithm *SharedGeometry::getAtoms() const { return atoms; }
+
+vtkPolyDataMapper *SharedGeometry::getSolidMapper() const
+{
+    return solidMapper;
+}
+
+PQP_Model *SharedGeometry::getCollisionModel()
+{
+    if (collisionModel.isNull())
+    {
+        collisionModel.reset(new PQP_Model());
+        ModelUtilities::makePQP_Model(collisionModel.data(),
+                                      surface->GetOutput());
+    }
+    return collisionModel.data();
+}
+
+void SharedGeometry::releaseCollisionModel() { collisionModel.reset(); }
+
+bool SharedGeometry::hasCollisionModel() const
+{
+    return !collisionModel.isNull();
+}
+
+int SharedGeometry::getNumberOfTriangles() const { return numTriangles; }
+
+void SharedGeometry::addUser() { users++; }
+
+void SharedGeometry::removeUser() { users--; }
+
+int SharedGeometry::getNumberOfUsers() const { return users; }
+
+qint64 SharedGeometry::getDataMemorySize() const { return dataMemorySize; }
+
+qint64 SharedGeometry::getCollisionMemorySize() const
+{
+    if (collisionModel.isNull())
+    {
+        return 0;
+    }
+    return qint64(collisionModel->num_tris_alloced) * sizeof(Tri) +
+           qint64(collisionModel->num_bvs_alloced) * sizeof(BV);
+}
+
+qint64 SharedGeometry::getMemorySize() const
+{
+    return getDataMemorySize() + getCollisionMemorySize();
+}
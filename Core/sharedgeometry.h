@@ -0,0 +1,97 @@
+#ifndef SHAREDGEOMETRY_H
+#define SHAREDGEOMETRY_H
+
+#include <QByteArray>
+#include <QSharedPointer>
+#include <QScopedPointer>
+
+#include <vtkSmartPointer.h>
+
+class vtkPolyData;
+class vtkPolyDataAlgorithm;
+class vtkPolyDataMapper;
+class PQP_Model;
+
+/*
+ * This class holds the full resolution geometry for a model conformation:
+ * the data read from the file, the surface and atoms extracted from it, a
+ * mapper for the full resolution surface and the collision model.  None of
+ * these are changed after the SharedGeometry is created.
+ *
+ * SharedGeometry objects are only created through getGeometryFor, which
+ * fingerprints the data (points, cells and point data arrays) and returns the
+ * existing SharedGeometry if one with identical data is still in use.  This
+ * way the same surface imported under different sources (a local pdb file
+ * and the same pdb id, for example) is only held in memory once.  The
+ * geometry is reference counted through QSharedPointer and is freed when the
+ * last conformation using it is destroyed.
+ */
+class SharedGeometry
+{
+   public:
+    ~SharedGeometry();
+
+    // Returns the shared geometry for the given data, creating it (and
+    // building the collision model) if no geometry with the same fingerprint
+    // is in use.  The data algorithm must already be updated.
+    static QSharedPointer< SharedGeometry > getGeometryFor(
+        vtkPolyDataAlgorithm *data);
+    // Computes the fingerprint used to find identical geometry
+    static QByteArray fingerprint(vtkPolyData *data);
+    // Returns the number of distinct geometries currently in use
+    static int getNumberOfGeometries();
+
+    const QByteArray &getFingerprint() const;
+    // the data read in, including atoms if there are any
+    vtkPolyDataAlgorithm *getData() const;
+    // the surface part of the data
+    vtkPolyDataAlgorithm *getSurface() const;
+    // the atoms part of the data, or NULL if there are no atoms
+    vtkPolyDataAlgorithm *getAtoms() const;
+    // a mapper for the surface
+    vtkPolyDataMapper *getSolidMapper() const;
+    // the collision model, built from the surface.  If the collision model
+    // has been released, it is rebuilt.  This and releaseCollisionModel must
+    // only be called on the main thread since neither is locked, and the
+    // returned model is only valid until the collision model is released
+    // (which the memory budget does when no object uses the geometry).
+    PQP_Model *getCollisionModel();
+    // Frees the collision model until it is needed again (main thread only)
+    void releaseCollisionModel();
+    bool hasCollisionModel() const;
+    // The number of triangles in the collision model.  This is kept even
+    // when the collision model is released.
+    int getNumberOfTriangles() const;
+
+    // Counts the objects using this geometry (through any conformation)
+    void addUser();
+    void removeUser();
+    int getNumberOfUsers() const;
+
+    // Returns the approximate memory used by the data, surface, atoms and
+    // mapper in bytes
+    qint64 getDataMemorySize() const;
+    // Returns the approximate memory used by the collision model in bytes, or
+    // 0 if it has been released
+    qint64 getCollisionMemorySize() const;
+    // Returns the approximate memory used by this geometry in bytes
+    qint64 getMemorySize() const;
+
+   private:
+    SharedGeometry(vtkPolyDataAlgorithm *data, const QByteArray &fingerprint);
+    // Disable copy constructor and assignment operator
+    SharedGeometry(const SharedGeometry &other);
+    SharedGeometry &operator=(const SharedGeometry &other);
+
+    QByteArray hash;
+    vtkSmartPointer< vtkPolyDataAlgorithm > data;
+    vtkSmartPointer< vtkPolyDataAlgorithm > surface;
+    vtkSmartPointer< vtkPolyDataAlgorithm > atoms;
+    vtkSmartPointer< vtkPolyDataMapper > solidMapper;
+    QScopedPointer< PQP_Model > collisionModel;
+    int users;
+    int numTriangles;
+    qint64 dataMemorySize;
+};
+
+#endif  // SHAREDGEOMETRY_H
@@ -25,6 +25,10 @@ static const double STARTING_CAMERA_POSITION = 50.0;
 // the name of the project's save file in the project directory
 static const char PROJECT_XML_FILENAME[] = "project.xml";
 
+// the name of the file the project is periodically autosaved to in the
+// project directory (kept separate so autosave never overwrites a real save)
+static const char AUTOSAVE_XML_FILENAME[] = "project.autosave.xml";
+
 // the name of a structure's save file
 static const char STRUCTURE_XML_FILENAME[] = "structure.xml";
 
@@ -6,6 +6,7 @@
 #include <vtkColorTransferFunction.h>
 #include <vtkPolyDataMapper.h>
 #include <vtkPointData.h>
+#include <vtkPolyData.h>
 #include <vtkPolyDataAlgorithm.h>
 #include <vtkTransform.h>
 #include <vtkTransformPolyDataFilter.h>
@@ -13,11 +14,15 @@
 #include <QString>
 #include <QHash>
 #include <QSharedPointer>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
+#include <QDebug>
 
 #include <PQP.h>
 
 #include "modelutilities.h"
 #include "colormaptype.h"
+#include "sharedgeometry.h"
 
 struct SketchModel::ConformationData
 {
@@ -35,42 +40,55 @@ public:
     // changed instead of setting a new filter.  This allows getSurface() to
     // always return the same filter
     vtkSmartPointer< vtkPolyDataAlgorithm > surface;
-	vtkSmartPointer< vtkPolyDataAlgorithm > fullResSurface;
     // The atoms data for the conformation
     vtkSmartPointer< vtkPolyDataAlgorithm > atoms;
     // The mapper for solid-colored objects with this model and conformation
     vtkSmartPointer< vtkPolyDataMapper > solidMapper;
-	vtkSmartPointer< vtkPolyDataMapper > fullResSolidMapper;
     QHash< ColorMapType::ColorMap, vtkSmartPointer< vtkMapper > > mappers;
-    // The collision model for the conformation
-    QSharedPointer< PQP_Model > collisionModel;
+    // The lookup tables whose transfer functions the mappers use, kept so
+    // that other mappers with the same color map and range share them
+    QHash< ColorMapType::ColorMap,
+           QSharedPointer< const ColorMapType::ColorLookupTable > > tables;
+    // The full resolution data, full resolution mapper and collision model.
+    // These are shared with any other conformation (in any model) that has
+    // identical full resolution geometry
+    QSharedPointer< SharedGeometry > geometry;
     // The file names for all the resolutions for the conformation
     QHash< ModelResolution::ResolutionType, QString > filenames;
     // The count of uses of the conformation
     int useCount;
+    // If a resolution is being loaded in the background, the resolution
+    // being loaded
+    bool loadPending;
+    ModelResolution::ResolutionType pendingLevel;
+    // Incremented whenever the resolution is set or a background load is
+    // started so that the results of superseded loads are ignored
+    int loadGeneration;
+    // When the conformation was last used, for the memory budget
+    quint64 lastUsed;
+    // True if the memory budget has released the surface's output data
+    bool surfaceReleased;
 
     //#########################################################################
     ConformationData() :
         level(ModelResolution::SIMPLIFIED_FULL_RESOLUTION),
-        collisionModel(new PQP_Model()),
-        useCount(0)
+        useCount(0),
+        loadPending(false),
+        pendingLevel(ModelResolution::SIMPLIFIED_FULL_RESOLUTION),
+        loadGeneration(0),
+        lastUsed(ModelMemoryBudget::nextUseStamp()),
+        surfaceReleased(false)
     {
         vtkSmartPointer< vtkTransformPolyDataFilter > id =
                 vtkSmartPointer< vtkTransformPolyDataFilter >::New();
-		vtkSmartPointer< vtkTransformPolyDataFilter > id2 =
-                vtkSmartPointer< vtkTransformPolyDataFilter >::New();
         vtkSmartPointer< vtkTransform > trans =
                 vtkSmartPointer< vtkTransform >::New();
         trans->Identity();
         trans->Update();
         id->SetTransform(trans);
-		id2->SetTransform(trans);
         surface = id;
-		fullResSurface = id2;
         solidMapper.TakeReference(vtkPolyDataMapper::New());
         solidMapper->SetInputConnection(surface->GetOutputPort());
-		fullResSolidMapper.TakeReference(vtkPolyDataMapper::New());
-		fullResSolidMapper->SetInputConnection(fullResSurface->GetOutputPort());
     }
 
     ConformationData(const ConformationData& other) :
@@ -78,13 +96,16 @@ public:
         level(other.level),
         data(other.data),
         surface(other.surface),
-		fullResSurface(other.fullResSurface),
         atoms(other.atoms),
         solidMapper(other.solidMapper),
-		fullResSolidMapper(other.fullResSolidMapper),
-        collisionModel(other.collisionModel),
+        geometry(other.geometry),
         filenames(other.filenames),
-        useCount(other.useCount)
+        useCount(other.useCount),
+        loadPending(other.loadPending),
+        pendingLevel(other.pendingLevel),
+        loadGeneration(other.loadGeneration),
+        lastUsed(other.lastUsed),
+        surfaceReleased(other.surfaceReleased)
     {}
 
     ConformationData& operator=(const ConformationData& other)
@@ -95,39 +116,93 @@ public:
         level = other.level;
         data = other.data;
         surface = other.surface;
-		fullResSurface = other.fullResSurface;
         atoms = other.atoms;
         solidMapper = other.solidMapper;
-		fullResSolidMapper = other.fullResSolidMapper;
-        collisionModel = other.collisionModel;
+        geometry = other.geometry;
         filenames = other.filenames;
         useCount = other.useCount;
+        loadPending = other.loadPending;
+        pendingLevel = other.pendingLevel;
+        loadGeneration = other.loadGeneration;
+        lastUsed = other.lastUsed;
+        surfaceReleased = other.surfaceReleased;
         return *this;
     }
-    void updateData(vtkPolyDataAlgorithm* dataSource,  
-					ModelResolution::ResolutionType resolution)
+    // Switches the conformation to a simplified resolution
+    void updateData(vtkPolyDataAlgorithm* dataSource)
     {
-        data = dataSource;
         vtkSmartPointer< vtkPolyDataAlgorithm > surf =
                 vtkSmartPointer< vtkPolyDataAlgorithm >::Take(
                     ModelUtilities::modelSurfaceFrom(dataSource));
+        vtkSmartPointer< vtkPolyDataAlgorithm > atomData =
+                vtkSmartPointer< vtkPolyDataAlgorithm >::Take(
+                    ModelUtilities::modelAtomsFrom(dataSource));
+        swapData(dataSource, surf, atomData);
+    }
+    // Switches the conformation to data whose surface and atoms have already
+    // been extracted
+    void swapData(vtkPolyDataAlgorithm* dataSource,
+                  vtkPolyDataAlgorithm* surf,
+                  vtkPolyDataAlgorithm* atomData)
+    {
+        data = dataSource;
         surface->SetInputConnection(surf->GetOutputPort());
         surface->Update();
+        surfaceReleased = false;
         solidMapper->Update();
-        atoms.TakeReference(ModelUtilities::modelAtomsFrom(dataSource));
-		
-		if (resolution == ModelResolution::FULL_RESOLUTION) {
-			fullResSurface->SetInputConnection(surf->GetOutputPort());
-			fullResSurface->Update();
-			fullResSolidMapper->Update();
-
-			// Only make the PQP model if using the full resolution so that
-			// collision detection always occurs with the highly detailed model.
-			if (collisionModel->build_state == 0 ) {
-				ModelUtilities::makePQP_Model(collisionModel.data(),
-											  surface->GetOutput());
-			}
-		}
+        atoms = atomData;
+    }
+    // Marks the conformation as used and brings back anything the memory
+    // budget released that can't be rebuilt lazily elsewhere
+    void touch()
+    {
+        lastUsed = ModelMemoryBudget::nextUseStamp();
+        if (surfaceReleased)
+        {
+            surface->Modified();
+            surface->Update();
+            surfaceReleased = false;
+        }
+    }
+    // Frees everything that is not needed while the conformation is not in
+    // use.  The full resolution data stays in the shared geometry so the
+    // conformation switches to that without updating the surface, then
+    // releases the surface's data.  The collision model is only freed if
+    // nothing using the shared geometry needs it.
+    void releaseUnused()
+    {
+        cancelPendingLoad();
+        data = geometry->getData();
+        surface->SetInputConnection(geometry->getSurface()->GetOutputPort());
+        atoms = geometry->getAtoms();
+        level = ModelResolution::FULL_RESOLUTION;
+        mappers.clear();
+        tables.clear();
+        surface->GetOutput()->ReleaseData();
+        surfaceReleased = true;
+        if (geometry->getNumberOfUsers() == 0)
+        {
+            geometry->releaseCollisionModel();
+        }
+    }
+    // Marks any background load as out of date
+    void cancelPendingLoad()
+    {
+        loadPending = false;
+        loadGeneration++;
+    }
+    // Switches the conformation to the full resolution geometry.  This never
+    // needs to read the file again since the shared geometry holds it.
+    // Collision detection always uses the full resolution collision model in
+    // the shared geometry.
+    void useFullResolution()
+    {
+        data = geometry->getData();
+        surface->SetInputConnection(geometry->getSurface()->GetOutputPort());
+        surface->Update();
+        surfaceReleased = false;
+        solidMapper->Update();
+        atoms = geometry->getAtoms();
     }
 };
 
@@ -138,10 +213,55 @@ SketchModel::SketchModel(double iMass, double iMoment, QObject *parent) :
     invMass(iMass),
     invMomentOfInertia(iMoment)
 {
+    ModelMemoryBudget::registerModel(this);
+}
+
+//#########################################################################
+// Background resolution loading
+
+// The result of reading a resolution on a background thread
+struct ResolutionLoad
+{
+    int conformation;
+    ModelResolution::ResolutionType resolution;
+    int generation;
+    vtkSmartPointer< vtkPolyDataAlgorithm > data;
+    vtkSmartPointer< vtkPolyDataAlgorithm > surface;
+    vtkSmartPointer< vtkPolyDataAlgorithm > atoms;
+};
+
+// Reads the file and extracts the surface and atoms.  This runs on a
+// background thread so it only touches the vtk objects it creates.
+static ResolutionLoad loadResolution(int conformation,
+                                     ModelResolution::ResolutionType resolution,
+                                     int generation, QString filename)
+{
+    ResolutionLoad load;
+    load.conformation = conformation;
+    load.resolution = resolution;
+    load.generation = generation;
+    try
+    {
+        load.data.TakeReference(ModelUtilities::read(filename));
+    }
+    catch (const char *c)
+    {
+        qDebug() << c;
+        return load;
+    }
+    load.surface.TakeReference(ModelUtilities::modelSurfaceFrom(load.data));
+    load.atoms.TakeReference(ModelUtilities::modelAtomsFrom(load.data));
+    return load;
 }
 
+//#########################################################################
+
 SketchModel::~SketchModel()
 {
+    // the loads only use their own data, but don't leave them running
+    // after the model is gone
+    waitForResolutionLoads();
+    ModelMemoryBudget::unregisterModel(this);
 }
 
 int SketchModel::getNumberOfConformations() const
@@ -156,28 +276,33 @@ ModelResolution::ResolutionType SketchModel::getResolutionLevel(int conformation
 
 vtkPolyDataAlgorithm *SketchModel::getVTKSource(int conformationNum)
 {
+    conformations[conformationNum].touch();
     return conformations[conformationNum].data;
 }
 
 vtkPolyDataAlgorithm *SketchModel::getVTKSurface(int conformationNum)
 {
+    conformations[conformationNum].touch();
     return conformations[conformationNum].surface;
 }
 
 vtkMapper* SketchModel::getSolidSurfaceMapper(int conformationNum)
 {
+    conformations[conformationNum].touch();
     return conformations[conformationNum].solidMapper;
 }
 
 vtkMapper* SketchModel::getFullResSolidSurfaceMapper(int conformationNum)
 {
-	return conformations[conformationNum].fullResSolidMapper;
+    conformations[conformationNum].touch();
+	return conformations[conformationNum].geometry->getSolidMapper();
 }
 
 vtkMapper* SketchModel::getColoredSurfaceMapper(int conformationNum,
                                                 const ColorMapType::ColorMap &cmap)
 {
     ConformationData& conf = conformations[conformationNum];
+    conf.touch();
     if (!conf.mappers.contains(cmap))
     {
         // create it
@@ -199,9 +324,10 @@ vtkMapper* SketchModel::getColoredSurfaceMapper(int conformationNum,
         if (!cmap.isSolidColor() &&
                 pointData->HasArray(cmap.second.toStdString().c_str()))
         {
-            vtkSmartPointer< vtkColorTransferFunction > colorFunc =
-                    vtkSmartPointer< vtkColorTransferFunction >::Take(
-                        cmap.getColorMap(range[0],range[1]));
+            // shared by all the mappers using this color map and range
+            QSharedPointer< const ColorMapType::ColorLookupTable > table =
+                    cmap.getLookupTable(range[0],range[1]);
+            vtkColorTransferFunction *colorFunc = table->getTransferFunction();
             mapper->SetInputConnection(conf.surface->GetOutputPort());
             mapper->ScalarVisibilityOn();
             mapper->SetColorModeToMapScalars();
@@ -211,6 +337,7 @@ vtkMapper* SketchModel::getColoredSurfaceMapper(int conformationNum,
             mapper->Update();
             // add it to the datastructure
             conf.mappers.insert(cmap,mapper.GetPointer());
+            conf.tables.insert(cmap,table);
         }
         else
         {
@@ -222,12 +349,19 @@ vtkMapper* SketchModel::getColoredSurfaceMapper(int conformationNum,
 
 vtkPolyDataAlgorithm *SketchModel::getAtomData(int conformation)
 {
+    conformations[conformation].touch();
     return conformations[conformation].atoms;
 }
 
 PQP_Model *SketchModel::getCollisionModel(int conformationNum)
 {
-    return conformations[conformationNum].collisionModel.data();
+    conformations[conformationNum].lastUsed = ModelMemoryBudget::nextUseStamp();
+    return conformations[conformationNum].geometry->getCollisionModel();
+}
+
+const SharedGeometry *SketchModel::getSharedGeometry(int conformationNum) const
+{
+    return conformations[conformationNum].geometry.data();
 }
 
 int SketchModel::getNumberOfUses(int conformation) const
@@ -287,10 +421,13 @@ inline void pqpMatrixToQuat(q_type quat, const PQP_REAL mat[3][3])
 
 int SketchModel::addConformation(const QString &src, const QString &fullResolutionFileName)
 {
-    ConformationData newConf;
-    newConf.src = src;
-    newConf.filenames.insert(ModelResolution::FULL_RESOLUTION,fullResolutionFileName);
-    newConf.level = ModelResolution::FULL_RESOLUTION;
+    return addConformation(src,fullResolutionFileName,
+                           readGeometry(fullResolutionFileName));
+}
+
+QSharedPointer< SharedGeometry > SketchModel::readGeometry(
+        const QString &fullResolutionFileName)
+{
     vtkSmartPointer< vtkPolyDataAlgorithm > dataSource =
             vtkSmartPointer< vtkPolyDataAlgorithm >::Take(
                 ModelUtilities::read(fullResolutionFileName));
@@ -304,43 +441,61 @@ int SketchModel::addConformation(const QString &src, const QString &fullResoluti
     transform->Identity();
     filter->SetTransform(transform);
     filter->Update();
-	// The collision detection model should always use the full resolution.
-	// Currently this happens because updateData() is always called the first time
-	// with the full resolution
-    newConf.updateData(filter, ModelResolution::FULL_RESOLUTION);
-    // populate the PQP collision detection model
-    PQP_Model* collisionModel = newConf.collisionModel.data();
-    // get the orientation of the model
-    if (collisionModel->num_tris < 5000)
+    // if identical geometry has already been read in, this shares it instead
+    // of keeping another copy
+    return SharedGeometry::getGeometryFor(filter);
+}
+
+int SketchModel::addConformation(const QString &src, const QString &fullResolutionFileName,
+                                 const QSharedPointer< SharedGeometry > &geometry)
+{
+    ConformationData newConf;
+    newConf.src = src;
+    newConf.filenames.insert(ModelResolution::FULL_RESOLUTION,fullResolutionFileName);
+    newConf.level = ModelResolution::FULL_RESOLUTION;
+    newConf.geometry = geometry;
+    newConf.useFullResolution();
+    int numTriangles = geometry->getNumberOfTriangles();
+    if (numTriangles < 5000)
     {
         newConf.filenames.insert(ModelResolution::SIMPLIFIED_FULL_RESOLUTION,
                                  fullResolutionFileName);
         newConf.filenames.insert(ModelResolution::SIMPLIFIED_5000,
                                  fullResolutionFileName);
     }
-    if (collisionModel->num_tris < 2000)
+    if (numTriangles < 2000)
     {
         newConf.filenames.insert(ModelResolution::SIMPLIFIED_2000,
                                  fullResolutionFileName);
     }
-    if (collisionModel->num_tris < 1000)
+    if (numTriangles < 1000)
     {
         newConf.filenames.insert(ModelResolution::SIMPLIFIED_1000,
                                  fullResolutionFileName);
     }
     conformations.append(newConf);
-    return numConformations++;
+    numConformations++;
+    ModelMemoryBudget::enforceBudget();
+    return numConformations - 1;
 }
 
 void SketchModel::incrementUses(int conformation)
 {
     conformations[conformation].useCount++;
+    conformations[conformation].geometry->addUser();
+    conformations[conformation].touch();
     setResolutionLevelByUses(conformation);
 }
 
 void SketchModel::decrementUses(int conformation)
 {
     conformations[conformation].useCount--;
+    conformations[conformation].geometry->removeUser();
+    if (conformations[conformation].useCount == 0)
+    {
+        // it may be released now
+        ModelMemoryBudget::enforceBudget();
+    }
 }
 
 void SketchModel::addSurfaceFileForResolution(
@@ -356,14 +511,103 @@ void SketchModel::setResolutionForConformation(
         int conformation, ModelResolution::ResolutionType resolution)
 {
     ConformationData& conf = conformations[conformation];
-    if (conf.filenames.contains(resolution) && conf.level != resolution
+    if (!conf.filenames.contains(resolution))
+    {
+        return;
+    }
+    // an explicitly set resolution replaces any that is still loading
+    conf.cancelPendingLoad();
+    if (conf.level != resolution
             && conf.filenames.value(conf.level) != conf.filenames.value(resolution))
     {
-        vtkSmartPointer< vtkPolyDataAlgorithm > dataSource =
-                vtkSmartPointer< vtkPolyDataAlgorithm >::Take(
-                    ModelUtilities::read(conf.filenames.value(resolution)));
-        conf.updateData(dataSource, resolution);
+        if (resolution == ModelResolution::FULL_RESOLUTION)
+        {
+            conf.useFullResolution();
+        }
+        else
+        {
+            vtkSmartPointer< vtkPolyDataAlgorithm > dataSource =
+                    vtkSmartPointer< vtkPolyDataAlgorithm >::Take(
+                        ModelUtilities::read(conf.filenames.value(resolution)));
+            conf.updateData(dataSource);
+        }
         conf.level = resolution;
+        emit resolutionChanged(conformation, resolution);
+    }
+}
+
+void SketchModel::requestResolutionForConformation(
+        int conformation, ModelResolution::ResolutionType resolution)
+{
+    ConformationData& conf = conformations[conformation];
+    if (!conf.filenames.contains(resolution))
+    {
+        return;
+    }
+    if (conf.loadPending && conf.pendingLevel == resolution)
+    {
+        return;  // already loading it
+    }
+    if (conf.level == resolution
+            || conf.filenames.value(conf.level) == conf.filenames.value(resolution))
+    {
+        conf.cancelPendingLoad();  // the current data is what was requested
+        return;
+    }
+    if (resolution == ModelResolution::FULL_RESOLUTION)
+    {
+        // the full resolution is kept in memory, nothing to load
+        setResolutionForConformation(conformation, resolution);
+        return;
+    }
+    conf.loadGeneration++;
+    conf.loadPending = true;
+    conf.pendingLevel = resolution;
+    QFutureWatcher< ResolutionLoad > *watcher =
+            new QFutureWatcher< ResolutionLoad >(this);
+    connect(watcher, SIGNAL(finished()), this, SLOT(resolutionLoadFinished()));
+    pendingLoads.append(watcher);
+    watcher->setFuture(QtConcurrent::run(loadResolution, conformation,
+                                         resolution, conf.loadGeneration,
+                                         conf.filenames.value(resolution)));
+}
+
+void SketchModel::resolutionLoadFinished()
+{
+    QFutureWatcher< ResolutionLoad > *watcher =
+            static_cast< QFutureWatcher< ResolutionLoad > * >(sender());
+    pendingLoads.removeOne(watcher);
+    watcher->deleteLater();
+    ResolutionLoad load = watcher->result();
+    ConformationData& conf = conformations[load.conformation];
+    if (!conf.loadPending || conf.loadGeneration != load.generation)
+    {
+        return;  // superseded by a later request
+    }
+    conf.loadPending = false;
+    if (load.data.GetPointer() == NULL)
+    {
+        return;  // the read failed, keep the current resolution
+    }
+    // everything the mappers need is ready, so this just switches the
+    // surface filter's input.  The old resolution is rendered right up until
+    // this point.
+    conf.swapData(load.data, load.surface, load.atoms);
+    conf.level = load.resolution;
+    emit resolutionChanged(load.conformation, load.resolution);
+    ModelMemoryBudget::enforceBudget();
+}
+
+bool SketchModel::isLoadingResolution(int conformation) const
+{
+    return conformations[conformation].loadPending;
+}
+
+void SketchModel::waitForResolutionLoads()
+{
+    for (int i = 0; i < pendingLoads.size(); i++)
+    {
+        pendingLoads[i]->waitForFinished();
     }
 }
 
@@ -372,7 +616,9 @@ void SketchModel::setResolutionLevelByUses(int conformation)
     ConformationData& conf = conformations[conformation];
     int uses = conf.useCount;
     int res;
-    switch (conf.level)
+    // compare against the resolution being loaded if there is one so that
+    // it isn't requested again
+    switch (conf.loadPending ? conf.pendingLevel : conf.level)
     {
     case ModelResolution::SIMPLIFIED_1000:
         res = 1000;
@@ -391,12 +637,106 @@ void SketchModel::setResolutionLevelByUses(int conformation)
         break;
     }
     if (uses > 15 && res > 1000)
-        setResolutionForConformation(conformation,ModelResolution::SIMPLIFIED_1000);
+        requestResolutionForConformation(conformation,ModelResolution::SIMPLIFIED_1000);
     else if (uses > 10 && res > 2000)
-        setResolutionForConformation(conformation,ModelResolution::SIMPLIFIED_2000);
+        requestResolutionForConformation(conformation,ModelResolution::SIMPLIFIED_2000);
     else if (uses > 5 && res > 5000)
-        setResolutionForConformation(conformation,ModelResolution::SIMPLIFIED_5000);
+        requestResolutionForConformation(conformation,ModelResolution::SIMPLIFIED_5000);
     else if (uses != 0 && res > 50000)
-        setResolutionForConformation(conformation,ModelResolution::SIMPLIFIED_FULL_RESOLUTION);
+        requestResolutionForConformation(conformation,ModelResolution::SIMPLIFIED_FULL_RESOLUTION);
+}
+
+//#########################################################################
+// Memory budget
+
+// the size of a data object in bytes, GetActualMemorySize is in kibibytes
+static inline qint64 dataObjectBytes(vtkDataObject *obj)
+{
+    return (obj == NULL) ? 0 : qint64(obj->GetActualMemorySize()) * 1024;
+}
+
+qint64 SketchModel::getResidentBytes(
+        int conformation, ModelMemoryBudget::Category category) const
+{
+    const ConformationData& conf = conformations[conformation];
+    switch (category)
+    {
+    case ModelMemoryBudget::RESOLUTION_DATA:
+    {
+        if (conf.data.GetPointer() == conf.geometry->getData())
+        {
+            return 0;  // counted in the shared geometry
+        }
+        qint64 bytes = dataObjectBytes(conf.data->GetOutput());
+        vtkDataObject *surfIn = conf.surface->GetInputDataObject(0,0);
+        if (surfIn != conf.data->GetOutput())
+        {
+            bytes += dataObjectBytes(surfIn);
+        }
+        if (conf.atoms.GetPointer() != NULL)
+        {
+            bytes += dataObjectBytes(conf.atoms->GetOutput());
+        }
+        return bytes;
+    }
+    case ModelMemoryBudget::SURFACE:
+        return conf.surfaceReleased ? 0 :
+                                      dataObjectBytes(conf.surface->GetOutput());
+    case ModelMemoryBudget::MAPPERS:
+        // the colored mappers each generate 4 bytes of color per point
+        return conf.surfaceReleased ? 0 :
+                                      qint64(conf.mappers.size()) * 4 *
+                                      conf.surface->GetOutput()->GetNumberOfPoints();
+    case ModelMemoryBudget::SHARED_GEOMETRY:
+        return conf.geometry->getDataMemorySize();
+    case ModelMemoryBudget::COLLISION:
+        return conf.geometry->getCollisionMemorySize();
+    default:
+        return 0;
+    }
+}
+
+quint64 SketchModel::getLastUseStamp(int conformation) const
+{
+    return conformations[conformation].lastUsed;
 }
 
+bool SketchModel::canReleaseMemory(int conformation) const
+{
+    const ConformationData& conf = conformations[conformation];
+    if (conf.useCount > 0)
+    {
+        return false;
+    }
+    return conf.level != ModelResolution::FULL_RESOLUTION
+            || !conf.mappers.isEmpty() || !conf.surfaceReleased
+            || (conf.geometry->hasCollisionModel() &&
+                conf.geometry->getNumberOfUsers() == 0);
+}
+
+qint64 SketchModel::releaseMemory(int conformation)
+{
+    if (!canReleaseMemory(conformation))
+    {
+        return 0;
+    }
+    qint64 before = 0, after = 0;
+    for (int c = 0; c < ModelMemoryBudget::NUM_CATEGORIES; c++)
+    {
+        before += getResidentBytes(
+                    conformation, static_cast< ModelMemoryBudget::Category >(c));
+    }
+    ConformationData& conf = conformations[conformation];
+    bool levelChanged = (conf.level != ModelResolution::FULL_RESOLUTION);
+    conf.releaseUnused();
+    for (int c = 0; c < ModelMemoryBudget::NUM_CATEGORIES; c++)
+    {
+        after += getResidentBytes(
+                    conformation, static_cast< ModelMemoryBudget::Category >(c));
+    }
+    if (levelChanged)
+    {
+        emit resolutionChanged(conformation, ModelResolution::FULL_RESOLUTION);
+    }
+    return before - after;
+}
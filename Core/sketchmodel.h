@@ -8,10 +8,15 @@ class vtkMapper;
 
 class QString;
 class QDir;
+class QFutureWatcherBase;
 #include <QVector>
+#include <QList>
 #include <QObject>
+#include <QSharedPointer>
 
 class PQP_Model;
+class SharedGeometry;
+#include "modelmemorybudget.h"
 
 namespace ColorMapType {
 class ColorMap;
@@ -72,8 +77,13 @@ public:
     // gets the atom data for the model and conformation (if available).
     // this method willl return NULL if no data is available
     vtkPolyDataAlgorithm *getAtomData(int conformation);
-    // Gets the collision model for the given conformation
+    // Gets the collision model for the given conformation.  Main thread only,
+    // the model may be released by the memory budget once no object uses the
+    // conformation (see SharedGeometry::getCollisionModel).
     PQP_Model *getCollisionModel(int conformationNum);
+    // Gets the full resolution geometry for the given conformation.  This may
+    // be shared with other conformations that have identical geometry.
+    const SharedGeometry *getSharedGeometry(int conformationNum) const;
     // Gets the number of uses for a conformation
     int getNumberOfUses(int conformation) const;
     bool hasFileNameFor(int conformation,
@@ -100,6 +110,17 @@ public:
     // other resolutions will be generated later.  Returns the conformation number
     // of the conformation added.
     int addConformation(const QString &src, const QString &fullResolutionFileName);
+    // Adds a new conformation like the above, but using geometry already read
+    // from the file by readGeometry.
+    int addConformation(const QString &src, const QString &fullResolutionFileName,
+                        const QSharedPointer< SharedGeometry > &geometry);
+    // Reads the full resolution geometry from the given file (or finds the
+    // identical geometry if it is already in use) and builds its collision
+    // model.  This does not touch any model, so it can be called on a worker
+    // thread to keep the file reading and collision model building off the
+    // main thread.  Throws a const char * if the file cannot be read.
+    static QSharedPointer< SharedGeometry > readGeometry(
+            const QString &fullResolutionFileName);
     // Incrementes the use count on a conformation (used to determine which
     // conformations need simplifying). This should be called whenever an
     // object is created that uses the conformation or when the conformation
@@ -111,8 +132,38 @@ public:
     // of an object changes so that it no longer uses the conformation.
     void decrementUses(int conformation);
 	// sets the resolution level based on the number of uses of the given
-    // conformation
+    // conformation.  The new resolution is loaded in the background (see
+    // requestResolutionForConformation).
     void setResolutionLevelByUses(int conformation);
+    // Returns true if a resolution for the given conformation is being loaded
+    // in the background
+    bool isLoadingResolution(int conformation) const;
+    // Waits for all background resolution loads to finish.  The new
+    // resolutions are not used until the event loop processes the finished
+    // loads.
+    void waitForResolutionLoads();
+
+    // Memory budget support (see ModelMemoryBudget)
+    // Gets the approximate memory used by the conformation in the category.
+    // The shared geometry and collision categories may be shared with other
+    // conformations.
+    qint64 getResidentBytes(int conformation,
+                            ModelMemoryBudget::Category category) const;
+    // Gets when the conformation was last used, compared to other
+    // conformations' stamps
+    quint64 getLastUseStamp(int conformation) const;
+    // Returns true if the conformation is not in use and has something that
+    // releaseMemory would free
+    bool canReleaseMemory(int conformation) const;
+    // Frees what the conformation doesn't need while it is unused and returns
+    // the number of bytes freed.  Everything is reloaded or rebuilt when it
+    // is next needed.
+    qint64 releaseMemory(int conformation);
+signals:
+    // Emitted when the given conformation has switched to the given
+    // resolution, whether it was loaded in the background or not.
+    void resolutionChanged(int conformation,
+                           ModelResolution::ResolutionType resolution);
 public slots:
     // Sets the geometery file for the given conformation and resolution
     void addSurfaceFileForResolution(int conformation,
@@ -122,6 +173,16 @@ public slots:
     // geometry file for the given resolution exists, then it does nothing.
     void setResolutionForConformation(int conformation,
                                       ModelResolution::ResolutionType resolution);
+    // Like setResolutionForConformation, but the geometry file for the new
+    // resolution is read on a background thread.  The current resolution is
+    // used until the new one is ready, then the conformation's surface is
+    // switched over on the main thread and resolutionChanged is emitted.
+    // A later call to either method for the same conformation supersedes a
+    // load that has not finished yet.
+    void requestResolutionForConformation(
+            int conformation, ModelResolution::ResolutionType resolution);
+private slots:
+    void resolutionLoadFinished();
 private:
     // Disable copy constructor and assignment operator these are not implemented
     // and not supported
@@ -140,6 +201,8 @@ private:
     double invMass;
     // moment of inerita, but save the trouble of inverting it to divide
     double invMomentOfInertia;
+    // the watchers for background resolution loads that have not finished
+    QList< QFutureWatcherBase * > pendingLoads;
 };
 
 
@@ -4,14 +4,21 @@
 #include <vtkNew.h>
 #include <vtkActor.h>
 #include <vtkProperty.h>
-#include <vtkColorTransferFunction.h>
-#include <vtkCardinalSpline.h>
 #include <vtkMath.h>
 
+#include <limits>
+#include <algorithm>
+
 #include "keyframe.h"
+#include "keyframestore.h"
 #include "sketchtests.h"
 #include "objectchangeobserver.h"
 #include "sketchmodel.h"
+#include "mapcursor.h"
+#include "keyframespline.h"
+
+// the revision number given out next by SketchObject::keyframesChanged
+static quint64 nextKeyframeRevision = 1;
 
 //#########################################################################
 void SketchObject::setParentRelativePositionForAbsolutePosition(
@@ -95,9 +102,15 @@ SketchObject::SketchObject()
       observers(),
       map(ColorMapType::SOLID_COLOR_RED, "modelNum"),
       keyframes(NULL),
-      xsplines(NULL),
-      ysplines(NULL),
-      zsplines(NULL)
+      keyframeView(NULL),
+      splines(NULL),
+      keyframeCursor(0),
+      splineCursor(NULL),
+      keyframeRevision(nextKeyframeRevision++),
+      splinesDirty(false),
+      splinesDirtyStart(0.0),
+      splinesDirtyEnd(0.0),
+      colorMapShown(true)
 {
     q_vec_set(forceAccum, 0, 0, 0);
     q_vec_set(torqueAccum, 0, 0, 0);
@@ -394,7 +407,7 @@ bool SketchObject::isLocalTransformDefiningPosition() const
 //#########################################################################
 bool SketchObject::hasKeyframes() const
 {
-    return !(keyframes.isNull() || keyframes->empty());
+    return !(keyframes.isNull() || keyframes->isEmpty());
 }
 
 //#########################################################################
@@ -409,10 +422,79 @@ int SketchObject::getNumKeyframes() const
 
 //#########################################################################
 const QMap< double, Keyframe > *SketchObject::getKeyframes() const
+{
+    if (keyframes.isNull()) {
+        return NULL;
+    }
+    if (keyframeView.isNull()) {
+        keyframeView.reset(new QMap< double, Keyframe >());
+        for (int i = 0; i < keyframes->size(); i++) {
+            keyframeView->insert(keyframes->getTime(i),
+                                 keyframes->getKeyframe(i));
+        }
+    }
+    return keyframeView.data();
+}
+
+//#########################################################################
+const KeyframeStore *SketchObject::getKeyframeStore() const
 {
     return keyframes.data();
 }
 
+//#########################################################################
+KeyframeSpan SketchObject::findKeyframesAround(double t) const
+{
+    assert(hasKeyframes());
+    int after = keyframes->lowerBound(t, keyframeCursor);
+    int before = (after > 0) ? after - 1 : 0;
+    KeyframeSpan span;
+    span.beforeTime = keyframes->getTime(before);
+    span.before = before;
+    if (after == keyframes->size()) {
+        span.afterTime = span.beforeTime;
+        span.after = -1;
+    } else {
+        span.afterTime = keyframes->getTime(after);
+        span.after = after;
+    }
+    return span;
+}
+
+//#########################################################################
+void SketchObject::keyframesChanged(double changedFrom, double changedTo)
+{
+    keyframeView.reset();
+    keyframeRevision = nextKeyframeRevision++;
+    if (splinesDirty) {
+        splinesDirtyStart = std::min(splinesDirtyStart, changedFrom);
+        splinesDirtyEnd = std::max(splinesDirtyEnd, changedTo);
+    } else {
+        splinesDirtyStart = changedFrom;
+        splinesDirtyEnd = changedTo;
+    }
+    splinesDirty = true;
+}
+
+//#########################################################################
+void SketchObject::keyframesChanged()
+{
+    keyframesChanged(-std::numeric_limits< double >::max(),
+                     std::numeric_limits< double >::max());
+}
+
+//#########################################################################
+quint64 SketchObject::getKeyframeRevision() const
+{
+    return keyframeRevision;
+}
+
+//#########################################################################
+quint64 SketchObject::getLatestKeyframeRevision()
+{
+    return nextKeyframeRevision - 1;
+}
+
 //#########################################################################
 int SketchObject::getGroupingLevel()
 {
@@ -449,9 +531,10 @@ void SketchObject::addKeyframeForCurrentLocation(double t)
                    keyframe_orientation, getColorMapType(), getArrayToColorBy(),
                    getGroupingLevel(), getParent(), visible, active);
     if (keyframes.isNull()) {
-        keyframes.reset(new QMap< double, Keyframe >());
+        keyframes.reset(new KeyframeStore());
     }
     keyframes->insert(t, frame);
+    keyframesChanged(t, t);
     QList< SketchObject * > *subObjects = getSubObjects();
     if (subObjects != NULL) {
         for (int i = 0; i < subObjects->length(); i++) {
@@ -461,9 +544,6 @@ void SketchObject::addKeyframeForCurrentLocation(double t)
     for (QSetIterator< ObjectChangeObserver * > it(observers); it.hasNext();) {
         it.next()->objectKeyframed(this, t);
     }
-    if (keyframes->size() > 1) {
-        computeSplines();
-    }
 }
 
 //#########################################################################
@@ -473,26 +553,24 @@ void SketchObject::insertKeyframe(double time, const Keyframe &keyframe)
         return;
     }
     if (keyframes.isNull()) {
-        keyframes.reset(new QMap< double, Keyframe >());
+        keyframes.reset(new KeyframeStore());
     }
     keyframes->insert(time, keyframe);
-    if (keyframes->size() > 1) {
-        computeSplines();
-    }
+    keyframesChanged(time, time);
 }
 
 //#########################################################################
 bool SketchObject::hasChangedSinceKeyframe(double t)
 {
-    if (keyframes.isNull() || !keyframes->contains(t)) {
+    int frame = (keyframes.isNull()) ? -1 : keyframes->indexOf(t);
+    if (frame < 0) {
         return true;
     }
-    const Keyframe &frame = keyframes->value(t);
     q_vec_type framePos;
     q_type frameOrient;
-    frame.getPosition(framePos);
-    frame.getOrientation(frameOrient);
-    const ColorMapType::ColorMap &frameCMap = frame.getColorMap();
+    keyframes->getPosition(frame, framePos);
+    keyframes->getOrientation(frame, frameOrient);
+    const ColorMapType::ColorMap &frameCMap = keyframes->getColorMap(frame);
     bool a, b, c, d, e, f, g;
     a = q_vec_equals(position, framePos);
     b = q_equals(orientation, frameOrient);
@@ -500,8 +578,8 @@ bool SketchObject::hasChangedSinceKeyframe(double t)
     d = map.isSolidColor();
     e = frameCMap.isSolidColor();
     f = frameCMap.second == map.second;
-    g = (isVisible() == frame.isVisibleAfter()) &&
-        (isActive() == frame.isActive());
+    g = (isVisible() == keyframes->isVisibleAfter(frame)) &&
+        (isActive() == keyframes->isActive(frame));
     bool objectChanged = !(a && b && c && ((d && e) || f) && g);
     if (objectChanged) {
         return true;
@@ -524,10 +602,9 @@ void SketchObject::removeKeyframeForTime(double t)
     if (keyframes.isNull()) {
         return;
     }
-    if (keyframes->contains(t)) {
-        keyframes->remove(t);
+    if (keyframes->remove(t)) {
+        keyframesChanged(t, t);
     }
-    computeSplines();
 }
 
 //#########################################################################
@@ -537,363 +614,319 @@ void SketchObject::clearKeyframes()
         return;
     }
     keyframes->clear();
+    keyframesChanged();
+}
+
+//#########################################################################
+void SketchObject::setPositionByAnimationTime(double t, bool parentMoved)
+{
+    AnimationState state;
+    if (!computeAnimationState(t, state)) {
+        return;
+    }
+    int changes = applyAnimationState(state, parentMoved);
+    // set out own position first to avoid messing up sub-object positions
+    QList< SketchObject * > *subObjects = getSubObjects();
+    if (subObjects != NULL) {
+        bool moved = (changes & AnimationState::MOVED) != 0;
+        for (QListIterator< SketchObject * > itr(*subObjects); itr.hasNext();) {
+            itr.next()->setPositionByAnimationTime(t, moved);
+        }
+    }
 }
 
 //#########################################################################
-void SketchObject::setPositionByAnimationTime(double t)
+bool SketchObject::computeAnimationState(double t, AnimationState &state)
 {
     // we don't support negative times and if the object has no keyframes, then
     // no need to do anything
     if (t < 0 || !hasKeyframes()) {
-        return;
-    }
-    QMapIterator< double, Keyframe > it(*keyframes.data());
-    // last is the last keyframe we passed
-    double last = it.peekNext().key();
-    // go until the next one is greater than the time (the last one
-    // will be less than the time unless the time is less than the first
-    // time in the keyframes list
-    while (it.hasNext() && it.peekNext().key() < t) {
-        last = it.next().key();
+        return false;
     }
+    KeyframeSpan span = findKeyframesAround(t);
     // if we are after the end of the last keyframe defined
-    if (!it.hasNext()) {
-        Keyframe f = keyframes->value(last);
-        f.getPosition(position);
-        f.getOrientation(orientation);
-        // set color map stuff here
-        setColorMapType(f.getColorMapType());
-        setArrayToColorBy(f.getArrayToColorBy());
-        setIsVisible(f.isVisibleAfter());
-        setActive(f.isActive());
-        // if we happenned to land on a keyframe
-        // or if we are before the first keyframe
-    } else if (it.peekNext().key() == t || it.peekNext().key() == last) {
-        Keyframe f = it.next().value();
-        f.getPosition(position);
-        f.getOrientation(orientation);
-
+    // or if we happenned to land on a keyframe
+    // or if we are before the first keyframe
+    const KeyframeStore &frames = *keyframes;
+    if (span.after == -1 || span.afterTime == t ||
+        span.after == span.before) {
+        int f = (span.after == -1) ? span.before : span.after;
+        frames.getPosition(f, state.position);
+        frames.getOrientation(f, state.orientation);
         // set color map stuff here
-        setColorMapType(f.getColorMapType());
-        setArrayToColorBy(f.getArrayToColorBy());
-        setIsVisible(f.isVisibleAfter());
-        setActive(f.isActive());
+        state.colorChange = AnimationState::SET_COLOR_MAP;
+        state.colorMap = frames.getColorMap(f);
+        state.visible = frames.isVisibleAfter(f);
+        state.active = frames.isActive(f);
     } else {
         // if we have a next keyframe that is greater than the time
-        double next = it.peekNext().key();
-        // note, if the first keyframe is after the time given, these will
-        // be the same and the state will be set to the state at that keyframe
-        Keyframe f1 = keyframes->value(last), f2 = it.next().value();
-        double diff1 = next - last;
-        double diff2 = t - last;
+        int f1 = span.before, f2 = span.after;
+        double diff1 = span.afterTime - span.beforeTime;
+        double diff2 = t - span.beforeTime;
         double ratio = diff2 / diff1;
 
         // if object is in a group, just keep its position static relative to
-        // the group
-        if (getParent() != NULL) {
-            f1.getPosition(position);
-            f1.getOrientation(orientation);
+        // the group.  It is in a group between the keyframes if it is in the
+        // same one at both (see WorldManager::updateGroupStatus), which is
+        // read from the keyframes so that the grouping of the world does not
+        // have to be changed to time t first
+        int level = frames.getLevel(f1);
+        if (level != 0 && level == frames.getLevel(f2) &&
+            frames.getParent(f1) == frames.getParent(f2)) {
+            frames.getPosition(f1, state.position);
+            frames.getOrientation(f1, state.orientation);
         } else {  // otherwise, find the spline for the current time and
                   // evaluate position there
-            // spline interpolation for position
-            q_vec_type pos;
-            QMapIterator< double, vtkSmartPointer< vtkCardinalSpline > > it(
-                *xsplines.data());
-            // last is the last keyframe we passed
-            double last = it.peekNext().key();
-            while (it.hasNext() && it.peekNext().key() < t) {
-                last = it.next().key();
-            }
-
-            double spline_end = last;
-            if (it.hasNext()) {
-                spline_end = it.peekNext().key();
-            }
-            vtkSmartPointer< vtkCardinalSpline > xspline =
-                xsplines->value(spline_end);
-            vtkSmartPointer< vtkCardinalSpline > yspline =
-                ysplines->value(spline_end);
-            vtkSmartPointer< vtkCardinalSpline > zspline =
-                zsplines->value(spline_end);
-            vtkSmartPointer< vtkCardinalSpline > yaw_spline =
-                yaw_splines->value(spline_end);
-            vtkSmartPointer< vtkCardinalSpline > pitch_spline =
-                pitch_splines->value(spline_end);
-            vtkSmartPointer< vtkCardinalSpline > roll_spline =
-                roll_splines->value(spline_end);
-
-            pos[0] = xspline->Evaluate(t);
-            pos[1] = yspline->Evaluate(t);
-            pos[2] = zspline->Evaluate(t);
-            setPosition(pos);
-
-            q_type orient;
-            q_from_euler(orient, yaw_spline->Evaluate(t),
-                         pitch_spline->Evaluate(t), roll_spline->Evaluate(t));
-            setOrientation(orient);
+            getPosAndOrFromSpline(state.position, state.orientation, t);
         }
 
+        state.colorChange = AnimationState::KEEP_COLOR;
         if (numInstances() == 1) {
             // set color map stuff here
-            const ColorMapType::ColorMap &c1 = f1.getColorMap(),
-                                         &c2 = f2.getColorMap();
+            const ColorMapType::ColorMap &c1 = frames.getColorMap(f1),
+                                         &c2 = frames.getColorMap(f2);
             if (c1.isSolidColor() && c2.isSolidColor()) {
-                vtkSmartPointer< vtkColorTransferFunction > map =
-                    vtkSmartPointer< vtkColorTransferFunction >::Take(
-                        c1.getColorMap(0, 1));
-                double color1[3], color2[3], netColor[3];
-                map->GetColor(1.0, color1);
-                map.TakeReference(c2.getColorMap(0, 1));
-                map->GetColor(1.0, color2);
+                double color1[3], color2[3];
+                c1.getSolidColor(color1);
+                c2.getSolidColor(color2);
                 double tmpC1[3], tmpC2[3];
                 q_vec_scale(tmpC2, ratio, color2);
                 q_vec_scale(tmpC1, 1.0 - ratio, color1);
-                q_vec_add(netColor, tmpC1, tmpC2);
-				double displayLuminance = getDisplayLuminance();
-				netColor[0] *= displayLuminance;
-				netColor[1] *= displayLuminance;
-				netColor[2] *= displayLuminance;
-                setSolidColor(netColor);
+                q_vec_add(state.solidColor, tmpC1, tmpC2);
+                state.colorChange = AnimationState::SET_SOLID_COLOR;
             } else {
-                setColorMapType(f1.getColorMapType());
-                setArrayToColorBy(f1.getArrayToColorBy());
+                state.colorChange = AnimationState::SET_COLOR_MAP;
+                state.colorMap = c1;
             }
         }
         // set visibility stuff here
-        setIsVisible(f1.isVisibleAfter());
-        setActive(f1.isActive());
+        state.visible = frames.isVisibleAfter(f1);
+        state.active = frames.isActive(f1);
     }
-    for (QSetIterator< ObjectChangeObserver * > it(observers); it.hasNext();) {
-        it.next()->objectMoved(this);
+    return true;
+}
+
+//#########################################################################
+int SketchObject::applyAnimationState(const AnimationState &state,
+                                      bool parentMoved)
+{
+    int changes = AnimationState::NOTHING_CHANGED;
+    if (position[Q_X] != state.position[Q_X] ||
+        position[Q_Y] != state.position[Q_Y] ||
+        position[Q_Z] != state.position[Q_Z] ||
+        orientation[Q_X] != state.orientation[Q_X] ||
+        orientation[Q_Y] != state.orientation[Q_Y] ||
+        orientation[Q_Z] != state.orientation[Q_Z] ||
+        orientation[Q_W] != state.orientation[Q_W]) {
+        q_vec_copy(position, state.position);
+        q_copy(orientation, state.orientation);
+        changes |= AnimationState::LOCAL_POSE_CHANGED;
     }
-    recalculateLocalTransform();
-    // set out own position first to avoid messing up sub-object positions
-    QList< SketchObject * > *subObjects = getSubObjects();
-    if (subObjects != NULL) {
-        for (QListIterator< SketchObject * > itr(*subObjects); itr.hasNext();) {
-            itr.next()->setPositionByAnimationTime(t);
+    if (state.colorChange == AnimationState::SET_COLOR_MAP) {
+        // set both parts of the map before updating the color once
+        if (!colorMapShown || !(map == state.colorMap)) {
+            map = state.colorMap;
+            colorMapShown = true;
+            updateColorMap();
+            changes |= AnimationState::COLOR_CHANGED;
         }
+    } else if (state.colorChange == AnimationState::SET_SOLID_COLOR) {
+        double color[3];
+        q_vec_scale(color, getDisplayLuminance(), state.solidColor);
+        colorMapShown = false;
+        if (setSolidColor(color)) {
+            changes |= AnimationState::COLOR_CHANGED;
+        }
+    }
+    if (visible != state.visible) {
+        setIsVisible(state.visible);
+        changes |= AnimationState::VISIBILITY_CHANGED;
     }
+    setActive(state.active);
+    if (changes & AnimationState::LOCAL_POSE_CHANGED || parentMoved) {
+        for (QSetIterator< ObjectChangeObserver * > it(observers);
+             it.hasNext();) {
+            it.next()->objectMoved(this);
+        }
+        changes |= AnimationState::MOVED;
+    }
+    if (changes & AnimationState::LOCAL_POSE_CHANGED) {
+        // children's transforms are concatenated with this one, so they
+        // follow it without being recalculated
+        recalculateLocalTransform();
+    }
+    return changes;
 }
 
 //#########################################################################
 void SketchObject::computeSplines()
 {
-    double pi = 4 * atan(1.0);
-    vtkSmartPointer< vtkCardinalSpline > xspline =
-        vtkSmartPointer< vtkCardinalSpline >::New();
-    vtkSmartPointer< vtkCardinalSpline > yspline =
-        vtkSmartPointer< vtkCardinalSpline >::New();
-    vtkSmartPointer< vtkCardinalSpline > zspline =
-        vtkSmartPointer< vtkCardinalSpline >::New();
-    vtkSmartPointer< vtkCardinalSpline > yaw_spline =
-        vtkSmartPointer< vtkCardinalSpline >::New();
-    vtkSmartPointer< vtkCardinalSpline > pitch_spline =
-        vtkSmartPointer< vtkCardinalSpline >::New();
-    vtkSmartPointer< vtkCardinalSpline > roll_spline =
-        vtkSmartPointer< vtkCardinalSpline >::New();
-    xsplines.reset(new QMap< double, vtkSmartPointer< vtkCardinalSpline > >());
-    ysplines.reset(new QMap< double, vtkSmartPointer< vtkCardinalSpline > >());
-    zsplines.reset(new QMap< double, vtkSmartPointer< vtkCardinalSpline > >());
-    yaw_splines.reset(
-        new QMap< double, vtkSmartPointer< vtkCardinalSpline > >());
-    pitch_splines.reset(
-        new QMap< double, vtkSmartPointer< vtkCardinalSpline > >());
-    roll_splines.reset(
-        new QMap< double, vtkSmartPointer< vtkCardinalSpline > >());
+    updateSplines();
+    QList< SketchObject * > *subObjects = getSubObjects();
+    if (subObjects != NULL) {
+        for (int i = 0; i < subObjects->length(); i++) {
+            subObjects->at(i)->computeSplines();
+        }
+    }
+}
+
+//#########################################################################
+// The keyframes one spline goes through and the times it is stored at in the
+// map of splines
+struct SplineStretch {
+    QVector< double > times;
+    // indices in the object's KeyframeStore
+    QVector< int > frames;
+    QList< double > ends;
 
+    void addPoint(double t, int f)
+    {
+        times.append(t);
+        frames.append(f);
+    }
+};
+
+//#########################################################################
+void SketchObject::updateSplines()
+{
+    if (!splinesDirty) {
+        return;
+    }
+    // Find the keyframes in each spline.  A spline goes through a stretch of
+    // keyframes where the object is not in a group, plus the grouped
+    // keyframes at either end.
+    QList< SplineStretch > stretches;
+    stretches.append(SplineStretch());
     if (hasKeyframes()) {
-        QMapIterator< double, Keyframe > it(*keyframes.data());
-        q_vec_type last_or;
+        const KeyframeStore &frames = *keyframes;
         int last_level = 1;
-        double next = it.peekNext().key();
-        Keyframe f = keyframes->value(next);
-        q_type orient;
-        f.getOrientation(orient);
-        q_to_euler(last_or, orient);
         bool first_keyframe = true;
 
-        while (it.hasNext()) {
-            next = it.next().key();
-            f = keyframes->value(next);
-            q_vec_type pos;
-            f.getAbsolutePosition(pos);
-            f.getAbsoluteOrientation(orient);
-            q_vec_type euler;
-            q_to_euler(euler, orient);
-            int current_level = f.getLevel();
-
-            // Make sure we choose the shortest path instead of rotating around
-            // the long way
-            if (yaw_spline->GetNumberOfPoints() > 0) {
-                for (int i = 0; i < 3; i++) {
-                    while (fabs(euler[i] - last_or[i]) > pi) {
-                        if (euler[i] - last_or[i] > pi) {
-                            euler[i] -= 2 * pi;
-                        } else if (euler[i] - last_or[i] < -pi) {
-                            euler[i] += 2 * pi;
-                        }
-                    }
-                }
-            }
+        for (int f = 0; f < frames.size(); f++) {
+            double next = frames.getTime(f);
+            bool hasNext = f + 1 < frames.size();
+            int current_level = frames.getLevel(f);
 
             // Add to, finish, or start splines based on grouping status
             if (first_keyframe) {
                 first_keyframe = false;
                 if (current_level == 0) {
                     // start off not in a group, so create the first spline
-                    xspline = vtkSmartPointer< vtkCardinalSpline >::New();
-                    yspline = vtkSmartPointer< vtkCardinalSpline >::New();
-                    zspline = vtkSmartPointer< vtkCardinalSpline >::New();
-                    yaw_spline = vtkSmartPointer< vtkCardinalSpline >::New();
-                    pitch_spline = vtkSmartPointer< vtkCardinalSpline >::New();
-                    roll_spline = vtkSmartPointer< vtkCardinalSpline >::New();
-
-                    xspline->AddPoint(next, pos[0]);
-                    yspline->AddPoint(next, pos[1]);
-                    zspline->AddPoint(next, pos[2]);
-                    yaw_spline->AddPoint(next, euler[0]);
-                    pitch_spline->AddPoint(next, euler[1]);
-                    roll_spline->AddPoint(next, euler[2]);
+                    stretches.append(SplineStretch());
+                    stretches.last().addPoint(next, f);
                 }
             } else {
                 // if level changes:
                 if (current_level != last_level) {
                     if (last_level == 0) {
                         // we are entering a grouped phase, so add ending point
-                        // of spline and compute
-                        xspline->AddPoint(next, pos[0]);
-                        yspline->AddPoint(next, pos[1]);
-                        zspline->AddPoint(next, pos[2]);
-                        yaw_spline->AddPoint(next, euler[0]);
-                        pitch_spline->AddPoint(next, euler[1]);
-                        roll_spline->AddPoint(next, euler[2]);
-
-                        xspline->Compute();
-                        yspline->Compute();
-                        zspline->Compute();
-                        yaw_spline->Compute();
-                        pitch_spline->Compute();
-                        roll_spline->Compute();
-
-                        xsplines->insert(next, xspline);
-                        ysplines->insert(next, yspline);
-                        zsplines->insert(next, zspline);
-                        yaw_splines->insert(next, yaw_spline);
-                        pitch_splines->insert(next, pitch_spline);
-                        roll_splines->insert(next, roll_spline);
+                        // of spline.  If the object leaves the group right
+                        // after joining it, the spline continues past the
+                        // grouped keyframe and is stored at both ends.
+                        stretches.last().addPoint(next, f);
+                        stretches.last().ends.append(next);
                     } else {
                         if (current_level == 0) {
-                            xspline->AddPoint(next, pos[0]);
-                            yspline->AddPoint(next, pos[1]);
-                            zspline->AddPoint(next, pos[2]);
-                            yaw_spline->AddPoint(next, euler[0]);
-                            pitch_spline->AddPoint(next, euler[1]);
-                            roll_spline->AddPoint(next, euler[2]);
+                            stretches.last().addPoint(next, f);
                         }
                     }
                 } else {
                     if (current_level == 0) {
                         // currently in an ungrouped phase, so add a point to
                         // the current spline
-                        xspline->AddPoint(next, pos[0]);
-                        yspline->AddPoint(next, pos[1]);
-                        zspline->AddPoint(next, pos[2]);
-                        yaw_spline->AddPoint(next, euler[0]);
-                        pitch_spline->AddPoint(next, euler[1]);
-                        roll_spline->AddPoint(next, euler[2]);
-                    } else if (it.hasNext()) {
-                        double next_time = it.peekNext().key();
-                        Keyframe frame = keyframes->value(next_time);
-                        if (frame.getLevel() == 0) {
+                        stretches.last().addPoint(next, f);
+                    } else if (hasNext) {
+                        if (frames.getLevel(f + 1) == 0) {
                             // will come out of grouped phase in next keyframe,
                             // so start new spline
-                            xspline =
-                                vtkSmartPointer< vtkCardinalSpline >::New();
-                            yspline =
-                                vtkSmartPointer< vtkCardinalSpline >::New();
-                            zspline =
-                                vtkSmartPointer< vtkCardinalSpline >::New();
-                            yaw_spline =
-                                vtkSmartPointer< vtkCardinalSpline >::New();
-                            pitch_spline =
-                                vtkSmartPointer< vtkCardinalSpline >::New();
-                            roll_spline =
-                                vtkSmartPointer< vtkCardinalSpline >::New();
-
-                            xspline->AddPoint(next, pos[0]);
-                            yspline->AddPoint(next, pos[1]);
-                            zspline->AddPoint(next, pos[2]);
-                            yaw_spline->AddPoint(next, euler[0]);
-                            pitch_spline->AddPoint(next, euler[1]);
-                            roll_spline->AddPoint(next, euler[2]);
+                            stretches.append(SplineStretch());
+                            stretches.last().addPoint(next, f);
                         }
                     }
                 }
 
-                if (current_level == 0 && !it.hasNext()) {
-                    xspline->Compute();
-                    yspline->Compute();
-                    zspline->Compute();
-                    yaw_spline->Compute();
-                    pitch_spline->Compute();
-                    roll_spline->Compute();
-
-                    xsplines->insert(next, xspline);
-                    ysplines->insert(next, yspline);
-                    zsplines->insert(next, zspline);
-                    yaw_splines->insert(next, yaw_spline);
-                    pitch_splines->insert(next, pitch_spline);
-                    roll_splines->insert(next, roll_spline);
+                if (current_level == 0 && !hasNext) {
+                    stretches.last().ends.append(next);
                 }
             }
 
-            q_vec_copy(last_or, euler);
             last_level = current_level;
         }
     }
 
-    QList< SketchObject * > *subObjects = getSubObjects();
-    if (subObjects != NULL) {
-        for (int i = 0; i < subObjects->length(); i++) {
-            subObjects->at(i)->computeSplines();
+    // Make the splines.  A spline whose keyframes are all outside the times
+    // that changed is the same as before and is reused.
+    QScopedPointer< QMap< double, KeyframeSpline > > old(splines.take());
+    splines.reset(new QMap< double, KeyframeSpline >());
+    foreach(const SplineStretch & stretch, stretches) {
+        if (stretch.ends.empty()) {
+            continue;
+        }
+        int numPoints = stretch.times.size();
+        double start = stretch.times.first(), end = stretch.times.last();
+        KeyframeSpline spline;
+        bool reused = false;
+        if (!old.isNull() && (end < splinesDirtyStart || start > splinesDirtyEnd)) {
+            QMap< double, KeyframeSpline >::const_iterator previous =
+                old->constFind(stretch.ends.last());
+            if (previous != old->constEnd() &&
+                previous.value().getNumberOfPoints() == numPoints &&
+                previous.value().getStartTime() == start &&
+                previous.value().getEndTime() == end) {
+                spline = previous.value();
+                reused = true;
+            }
+        }
+        if (!reused) {
+            for (int i = 0; i < numPoints; i++) {
+                q_vec_type pos;
+                q_type orient;
+                keyframes->getAbsolutePosition(stretch.frames[i], pos);
+                keyframes->getAbsoluteOrientation(stretch.frames[i], orient);
+                spline.addPoint(stretch.times[i], pos, orient);
+            }
+            spline.compute();
+        }
+        foreach(double e, stretch.ends) {
+            splines->insert(e, spline);
         }
     }
+    if (!splineCursor.isNull()) {
+        splineCursor->reset();
+    }
+    splinesDirty = false;
 }
 
 //#########################################################################
-void SketchObject::getPosAndOrFromSpline(q_vec_type pos_dest, q_type or_dest,
-                                         double t)
+const KeyframeSpline *SketchObject::getSplineForTime(double t)
 {
-    q_vec_type pos;
-    QMapIterator< double, vtkSmartPointer< vtkCardinalSpline > > it(
-        *xsplines.data());
-    // last is the last keyframe we passed
-    double last = it.peekNext().key();
-    while (it.hasNext() && it.peekNext().key() < t) {
-        last = it.next().key();
+    updateSplines();
+    if (splines.isNull() || splines->empty()) {
+        return NULL;
     }
-
-    double spline_end = last;
-    if (it.hasNext()) {
-        spline_end = it.peekNext().key();
+    if (splineCursor.isNull()) {
+        splineCursor.reset(new MapCursor< double, KeyframeSpline >());
+    }
+    // the spline to use is the one for the stretch ending at or after t
+    QMap< double, KeyframeSpline >::const_iterator it =
+        splineCursor->lowerBound(*splines, t);
+    if (it == splines->constEnd()) {
+        --it;
     }
-    vtkSmartPointer< vtkCardinalSpline > xspline = xsplines->value(spline_end);
-    vtkSmartPointer< vtkCardinalSpline > yspline = ysplines->value(spline_end);
-    vtkSmartPointer< vtkCardinalSpline > zspline = zsplines->value(spline_end);
-    vtkSmartPointer< vtkCardinalSpline > yaw_spline =
-        yaw_splines->value(spline_end);
-    vtkSmartPointer< vtkCardinalSpline > pitch_spline =
-        pitch_splines->value(spline_end);
-    vtkSmartPointer< vtkCardinalSpline > roll_spline =
-        roll_splines->value(spline_end);
+    return &it.value();
+}
 
-    pos[0] = xspline->Evaluate(t);
-    pos[1] = yspline->Evaluate(t);
-    pos[2] = zspline->Evaluate(t);
-    q_vec_copy(pos_dest, pos);
-    q_from_euler(or_dest, yaw_spline->Evaluate(t), pitch_spline->Evaluate(t),
-                 roll_spline->Evaluate(t));
+//#########################################################################
+void SketchObject::getPosAndOrFromSpline(q_vec_type pos_dest, q_type or_dest,
+                                         double t)
+{
+    const KeyframeSpline *spline = getSplineForTime(t);
+    if (spline == NULL) {
+        getPosition(pos_dest);
+        getOrientation(or_dest);
+        return;
+    }
+    spline->evaluate(t, pos_dest, or_dest);
 }
 
 //#########################################################################
@@ -1021,6 +1054,7 @@ void SketchObject::makeDeepCopyOf(SketchObject *other)
     active = other->active;
     propagateForce = other->propagateForce;
     if (other->keyframes.data() != NULL) {
-        keyframes.reset(new QMap< double, Keyframe >(*other->keyframes.data()));
+        keyframes.reset(new KeyframeStore(*other->keyframes.data()));
+        keyframesChanged();
     }
 }
@@ -11,7 +11,6 @@ class vtkColorTransferFunction;
 class vtkTransform;
 class vtkLinearTransform;
 class vtkActor;
-class vtkCardinalSpline;
 
 #include <QList>
 #include <QScopedPointer>
@@ -23,6 +22,10 @@ class SketchModel;
 class Keyframe;
 class PhysicsStrategy;
 class ObjectChangeObserver;
+class KeyframeSpline;
+class KeyframeStore;
+template < typename Key, typename T >
+class MapCursor;
 #include "colormaptype.h"
 #include "sketchmodel.h"
 
@@ -30,6 +33,55 @@ class ObjectChangeObserver;
 // assigned a group
 #define OBJECT_HAS_NO_GROUP (-1)
 
+// The keyframes of an object around a time (see
+// SketchObject::findKeyframesAround).  The keyframes are given by their
+// indices in the object's KeyframeStore, which are only valid until the
+// object's keyframes change.
+struct KeyframeSpan {
+    // the last keyframe before the time, or the first keyframe if the time
+    // is before all of them
+    double beforeTime;
+    int before;
+    // the first keyframe at or after the time, or -1 if the time is after
+    // all of them
+    double afterTime;
+    int after;
+};
+
+// The state of an object at one time in the animation that is set from its
+// keyframes (see SketchObject::computeAnimationState).  The position and
+// orientation are relative to the object's parent if it has one.
+struct AnimationState {
+    // what to do with the object's color
+    enum ColorChange { KEEP_COLOR, SET_COLOR_MAP, SET_SOLID_COLOR };
+    // flags for what SketchObject::applyAnimationState actually changed
+    enum Change {
+        NOTHING_CHANGED = 0,
+        // the object's position or orientation relative to its parent
+        LOCAL_POSE_CHANGED = 1,
+        // the object's world pose (its own or its parent's), observers were
+        // told the object moved
+        MOVED = 2,
+        COLOR_CHANGED = 4,
+        VISIBILITY_CHANGED = 8
+    };
+
+    AnimationState() : colorChange(KEEP_COLOR),
+        colorMap(ColorMapType::defaultCMap), visible(true), active(false)
+    {
+    }
+
+    q_vec_type position;
+    q_type orientation;
+    ColorChange colorChange;
+    // used if colorChange is SET_COLOR_MAP
+    ColorMapType::ColorMap colorMap;
+    // used if colorChange is SET_SOLID_COLOR, before it is scaled by the
+    // object's display luminance
+    double solidColor[3];
+    bool visible, active;
+};
+
 /*
  * This class is an abstract representation of some instance or group of
  *instances
@@ -207,7 +259,19 @@ class SketchObject
     // methods for accessing and modifying keyframes
     bool hasKeyframes() const;
     int getNumKeyframes() const;
+    // returns the keyframes as a map from time to keyframe, or NULL if no
+    // keyframes were ever added.  The keyframes are stored in a
+    // KeyframeStore, this map is made from it when it is asked for and is
+    // dropped when the keyframes change, so it should only be used where
+    // the keyframes are read occasionally (saving, export) and only on the
+    // main thread.
     const QMap< double, Keyframe > *getKeyframes() const;
+    // returns the keyframes, or NULL if no keyframes were ever added
+    const KeyframeStore *getKeyframeStore() const;
+    // finds the keyframes around time t, the object must have keyframes.
+    // This remembers where the last search ended, so searching for times that
+    // increase a little at a time (like during playback) takes constant time
+    KeyframeSpan findKeyframesAround(double t) const;
     // return the level of the object within groups to be used in a keyframe
     int getGroupingLevel();
     // adds a keyframe at the given time, recursively descends to child objects
@@ -230,13 +294,44 @@ class SketchObject
     void removeKeyframeForTime(double t);
     // clears all keyframes
     void clearKeyframes();
+    // returns a number that changes whenever the keyframes of this object
+    // change and is never the same for two different objects' keyframes, so
+    // anything computed from the keyframes can be checked to see if it is
+    // still valid
+    quint64 getKeyframeRevision() const;
+    // returns the newest keyframe revision given to any object, so checking
+    // whether it has changed tells if any object's keyframes have changed
+    static quint64 getLatestKeyframeRevision();
     // sets the position and other data based on this object's keyframes to the
     // correct
     // state for the given time in the animation
-    void setPositionByAnimationTime(double t);
-    // Computes interpolating splines for animation
+    void setPositionByAnimationTime(double t, bool parentMoved = false);
+    // computes the state setPositionByAnimationTime would give this object
+    // (but not its children) at time t without changing anything.  Returns
+    // false if the object is not animated at time t.  The result only depends
+    // on the keyframes, not on which group the object is in now, so it may be
+    // computed for any time.  This may be called for different objects on
+    // different threads at the same time, but not for the same object.
+    bool computeAnimationState(double t, AnimationState &state);
+    // sets this object (but not its children) to the given state.  Only the
+    // parts of the state that differ from the object's current state are
+    // set, so the local transform is only recalculated and observers only
+    // told the object moved if it did.  If parentMoved is true, the object's
+    // world pose changed with its parent's, so observers are told it moved
+    // even if its local pose did not change.  Returns the AnimationState::Change
+    // flags for what changed.
+    int applyAnimationState(const AnimationState &state,
+                            bool parentMoved = false);
+    // Brings the interpolating splines for animation of this object and its
+    // sub-objects up to date with their keyframes.  Only the splines through
+    // keyframes that changed are recomputed.
     void computeSplines();
     void getPosAndOrFromSpline(q_vec_type pos_dest, q_type or_dest, double t);
+    // Returns the spline that positions the object at time t when it is not in
+    // a group (see KeyframeSpline::evaluate for evaluating many at once), or
+    // NULL if there are no splines.  The spline is only valid until the
+    // keyframes change.
+    const KeyframeSpline *getSplineForTime(double t);
     // visibility methods
     void setIsVisible(bool isVisible);
     static void setIsVisibleRecursive(SketchObject *obj, bool isVisible);
@@ -277,7 +372,10 @@ class SketchObject
     // notifies change observers that the given object has been removed as a
     // child or grandchild, etc
     void notifyObjectRemoved(SketchObject *child);
-    virtual void setSolidColor(double color[3]) {}
+    // shows the object in the given color in place of its color map until
+    // updateColorMap is called.  Returns false if it was already shown in
+    // that color
+    virtual bool setSolidColor(double color[3]) { return false; }
     virtual void updateColorMap() {}
 
    protected:  // fields
@@ -286,6 +384,13 @@ class SketchObject
 
    private:  // methods
     void notifyForceObservers();
+    // must be called whenever the keyframes change, with the range of times
+    // where they changed (all times if not given)
+    void keyframesChanged(double changedFrom, double changedTo);
+    void keyframesChanged();
+    // remakes the splines that go through keyframes that have changed since
+    // the splines were last made, called before the splines are used
+    void updateSplines();
 
    private:  // fields
     // Disable copy constructor and assignment operator these are not implemented
@@ -314,13 +419,30 @@ class SketchObject
     ColorMapType::ColorMap map;
     // this smart pointer contains the keyframes of the object.  If the pointer
     // it contains is null, then
-    // there are no keyframes.  Otherwise, the map it points to is a mapping
-    // from time to frame where frame
+    // there are no keyframes.  Otherwise, the store it points to holds the
+    // keyframes sorted by time, where each one
     // contains all the information about what happens at that time (position,
     // orientation, visibility, etc.)
-    QScopedPointer< QMap< double, Keyframe > > keyframes;
-    QScopedPointer< QMap< double, vtkSmartPointer< vtkCardinalSpline > > >
-        xsplines, ysplines, zsplines, yaw_splines, pitch_splines, roll_splines;
+    QScopedPointer< KeyframeStore > keyframes;
+    // the map returned by getKeyframes, made when it is asked for
+    mutable QScopedPointer< QMap< double, Keyframe > > keyframeView;
+    // the splines for the stretches of the animation where the object is not
+    // in a group, keyed by the time each stretch ends
+    QScopedPointer< QMap< double, KeyframeSpline > > splines;
+    // where the last searches of the keyframes and splines ended (see
+    // findKeyframesAround).  The keyframe cursor is only where the next
+    // search starts, so it does not need to be reset, but the spline cursor
+    // must be reset when the splines change.
+    mutable int keyframeCursor;
+    QScopedPointer< MapCursor< double, KeyframeSpline > > splineCursor;
+    quint64 keyframeRevision;
+    // whether the keyframes have changed since the splines were made, and
+    // the range of times where they changed
+    bool splinesDirty;
+    double splinesDirtyStart, splinesDirtyEnd;
+    // false if applyAnimationState has shown a solid color in place of the
+    // color map since the color map was last set
+    bool colorMapShown;
 };
 
 // helper function-- converts quaternion to a PQP rotation matrix
@@ -346,6 +468,7 @@ inline ColorMapType::Type SketchObject::getColorMapType() const
 inline void SketchObject::setColorMapType(ColorMapType::Type cmap)
 {
     map.first = cmap;
+    colorMapShown = true;
     updateColorMap();
 }
 
@@ -357,6 +480,7 @@ inline const QString &SketchObject::getArrayToColorBy() const
 inline void SketchObject::setArrayToColorBy(const QString &arrayName)
 {
     map.second = arrayName;
+    colorMapShown = true;
     updateColorMap();
 }
 #endif  // SKETCHOBJECT_H
@@ -31,8 +31,11 @@
 #include "transformmanager.h"
 #include "colormaptype.h"
 #include "modelmanager.h"
+#include "modelstore.h"
+#include "objectclipboard.h"
 #include "sketchobject.h"
 #include "worldmanager.h"
+#include "collisionscan.h"
 #include "objectchangeobserver.h"
 #include "springconnection.h"
 #include "structurereplicator.h"
@@ -41,6 +44,11 @@
 #include "hand.h"
 #include "OperationState.h"
 
+// the most object states baked per frame while the animation plays, so that
+// starting a large animation does not stall the display (frames that are not
+// baked yet are computed as they are shown)
+#define ANIMATION_BAKE_SAMPLES_PER_STEP 5000
+
 
 //###############################################################
 // Code for rmDir taken from mosg's StackOverflow answer
@@ -68,63 +76,6 @@ static bool rmDir(const QString &dirPath)
 }
 // end code taken from StackOverflow
 //###############################################################
-// listDir and cpDir heavily modified from same StackOverflow article
-// the original cpDir had issues with infinite recursion if copying a
-// folder to a subfolder of itself and so was almost completely rewritten
-// Another change is that cpDir no longer runs rmDir on the destination...
-// doing that turns out to be really annoying and breaks things when copying
-// from a subfolder to a parent folder
-
-static void listDir(const QString &srcPath, QVector<QString> &files,
-                        QVector<QString> &dirs)
-{
-    QDir srcDir(srcPath);
-    foreach(const QFileInfo &info, srcDir.entryInfoList(QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot)) {
-        QString srcItemPath = srcDir.absoluteFilePath(info.fileName());
-        if (info.isDir()) {
-            dirs.append(srcItemPath);
-            listDir(srcItemPath,files,dirs);
-        } else if (info.isFile()) {
-            files.append(srcItemPath);
-        } else {
-            qDebug() << "Unhandled item " << info.filePath() << " in cpDir";
-        }
-    }
-}
-
-// This function implements the shell command 'cp -r'
-static bool cpDir(const QString& srcPath, const QString &dstPath)
-{
-  QFileInfo src(srcPath);
-  src.makeAbsolute();
-  QVector<QString> files, dirs;
-  listDir(srcPath,files,dirs);
-
-  QDir dstDir(dstPath);
-  QDir parentDstDir(QFileInfo(dstPath).path());
-  if (!dstDir.exists() && !parentDstDir.mkpath(QFileInfo(dstPath).fileName()))
-    return false;
-
-  QString absSrcPath = QFileInfo(srcPath).absoluteFilePath();
-  foreach(const QString &dir, dirs) {
-    QString str = dir.mid(absSrcPath.length()+1);
-    if (!dstDir.mkpath(str)) {
-      return false;
-    }
-  }
-  foreach(const QString &file, files) {
-    QString dstFilePath = dstPath + "/" + file.mid(absSrcPath.length()+1);
-    if (QFile(dstFilePath).exists()) {
-        if (!QFile(dstFilePath).remove()) {
-            return false;
-        }
-    }
-    if (!QFile::copy(file,dstFilePath)) {
-      return false;
-    }
-  }
-  return true;
-}
 
 // helper function to compute position and orientation from vtkCamera
 // on return position and orientation will be in the quatlib types passed in
@@ -323,6 +274,8 @@ class Project::ProjectImpl : public WorldObserver, public StructureReplicatorObs
         const;
     // the project directory
     QString getProjectDir() const;
+    // the in-memory object clipboard
+    ObjectClipboard& getClipboard();
     // ###################################################################
     // Frame update functions:
     // functions to update things every frame
@@ -346,6 +299,7 @@ class Project::ProjectImpl : public WorldObserver, public StructureReplicatorObs
     double getViewTime() const;
     // sets the current time in the animation that is being viewed
     void setViewTime(double time);
+    void scanAnimationForCollisions(CollisionScan& scan, double sampleRate);
     // ###################################################################
     // Undo and Redo functions:
     // Note: these two will return NULL if there is no state to return
@@ -448,6 +402,10 @@ class Project::ProjectImpl : public WorldObserver, public StructureReplicatorObs
     // project dir
     QString projectDirName;
 
+    // copied objects, these refer to models in the model manager so they
+    // must not outlive it
+    ObjectClipboard clipboard;
+
     // undo states:
     QList< UndoState* > undoStack, redoStack;
 
@@ -459,6 +417,7 @@ class Project::ProjectImpl : public WorldObserver, public StructureReplicatorObs
     vtkSmartPointer< vtkActor > shadowFloorActor, floorLinesActor;
     // animation stuff
     bool isDoingAnimation;   // true if the animation is happenning
+    bool animationBaked;     // true once the playing animation is all baked
     bool showingShadows;     // true if shadows are currently being shown
     double timeInAnimation;  // the animation time starting at 0
     double viewTime;
@@ -480,12 +439,14 @@ Project::ProjectImpl::ProjectImpl(vtkRenderer* r, const QString& projDir)
       cameras(),
       transformOps(),
       projectDirName(projDir),
+      clipboard(),
       undoStack(),
       redoStack(),
       shadowFloorSource(vtkSmartPointer< vtkPlaneSource >::New()),
       shadowFloorActor(vtkSmartPointer< vtkActor >::New()),
       floorLinesActor(vtkSmartPointer< vtkActor >::New()),
       isDoingAnimation(false),
+      animationBaked(false),
       showingShadows(true),
       timeInAnimation(0.0),
       viewTime(0.0),
@@ -575,6 +536,7 @@ int Project::ProjectImpl::getNumberOfTransformOps() const
 {
     return transformOps.size();
 }
+ObjectClipboard& Project::ProjectImpl::getClipboard() { return clipboard; }
 const QHash< SketchObject*, vtkSmartPointer< vtkCamera > >&
     Project::ProjectImpl::getCameras() const
 {
@@ -612,6 +574,10 @@ void Project::ProjectImpl::timestep(double dt)
         transforms.copyCurrentHandTransformsToOld();
     } else {
         double elapsed_time = time.restart();
+        if (!animationBaked) {
+            animationBaked = world.bakeAnimation(
+                DEFAULT_ANIMATION_FRAME_RATE, ANIMATION_BAKE_SAMPLES_PER_STEP);
+        }
         if (world.setAnimationTime(timeInAnimation)) {
             // if setAnimationTime returns true, then we are done
             stopAnimation();
@@ -649,6 +615,10 @@ void Project::ProjectImpl::startAnimation()
         SketchObject* obj = it.next();
         obj->computeSplines();
     }
+    // only the objects whose keyframes changed since the last time are
+    // sampled again, a few frames at a time as the animation plays
+    animationBaked = world.bakeAnimation(DEFAULT_ANIMATION_FRAME_RATE,
+                                         ANIMATION_BAKE_SAMPLES_PER_STEP);
     time.start();
 }
 void Project::ProjectImpl::stopAnimation()
@@ -687,6 +657,13 @@ void Project::ProjectImpl::setViewTime(double time)
     viewTime = time;
     if (!isDoingAnimation) world.setAnimationTime(time);
 }
+void Project::ProjectImpl::scanAnimationForCollisions(CollisionScan& scan,
+                                                      double sampleRate)
+{
+    scan.ignoreModel(getCameraModel());
+    scan.scan(world, sampleRate);
+    world.setAnimationTime(isDoingAnimation ? timeInAnimation : viewTime);
+}
 
 //########################################################################
 // Undo and redo functions
@@ -789,7 +766,7 @@ bool Project::ProjectImpl::setProjectDir(const QString& dir)
         QString abs = QDir::current().absoluteFilePath(dir);
         if (abs == projectDirName) return true;
     }
-    if (!cpDir(projectDirName, dir)) return false;
+    if (!ModelStore::linkDir(projectDirName, dir)) return false;
     projectDirName = dir;
     return true;
 }
@@ -800,7 +777,7 @@ bool Project::ProjectImpl::getFileInProjDir(const QString& filename,
     QString localname = filename.mid(filename.lastIndexOf("/") + 1);
     QString fullpath = projectDir.absoluteFilePath(localname);
     QFile file(fullpath);
-    if (file.exists() || file.copy(filename, fullpath)) {
+    if (file.exists() || ModelStore::placeFile(filename, fullpath)) {
         newName = fullpath;
         return true;
     } else {
@@ -1012,6 +989,7 @@ int Project::getNumberOfTransformOps() const
 {
     return impl->getNumberOfTransformOps();
 }
+ObjectClipboard& Project::getClipboard() { return impl->getClipboard(); }
 const QHash< SketchObject*, vtkSmartPointer< vtkCamera > >&
     Project::getCameras() const
 {
@@ -1033,6 +1011,10 @@ bool Project::goToAnimationTime(double time)
 }
 double Project::getViewTime() const { return impl->getViewTime(); }
 void Project::setViewTime(double time) { impl->setViewTime(time); }
+void Project::scanAnimationForCollisions(CollisionScan& scan, double sampleRate)
+{
+    impl->scanAnimationForCollisions(scan, sampleRate);
+}
 //########################################################################
 // Undo and Redo functions
 UndoState* Project::getLastUndoState() { return impl->getLastUndoState(); }
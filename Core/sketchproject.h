@@ -34,6 +34,8 @@ class WorldManager;
 class StructureReplicator;
 class TransformEquals;
 class UndoState;
+class ObjectClipboard;
+class CollisionScan;
 
 namespace SketchBio
 {
@@ -96,6 +98,9 @@ class Project
         const;
     // the project directory
     QString getProjectDir() const;
+    // the in-memory clipboard used to copy and paste objects within this
+    // project
+    ObjectClipboard& getClipboard();
     // ###################################################################
     // Frame update functions:
     // functions to update things every frame
@@ -119,6 +124,10 @@ class Project
     double getViewTime() const;
     // sets the current time in the animation that is being viewed
     void setViewTime(double time);
+    // finds where objects collide over the whole animation without playing
+    // it (see CollisionScan), leaving out the cameras.  The objects are put
+    // back at the current time afterwards.
+    void scanAnimationForCollisions(CollisionScan& scan, double sampleRate);
     // ###################################################################
     // Undo and Redo functions:
     // Note: these two will return NULL if there is no state to return
@@ -0,0 +1,424 @@
+#include "structurereader.h"
+
+#include <QFileInfo>
+#include <QList>
+#include <QFile>
+
+// the residue names used for water
+static const char *const SOLVENT_NAMES[] =
+{ "HOH", "WAT", "H2O", "DOD", "D2O", "TIP", "TIP3", "SOL", NULL };
+
+namespace StructureReader
+{
+
+//###############################################################
+// Helpers
+
+static bool isAllLetters(const QByteArray &text)
+{
+    if (text.isEmpty())
+    {
+        return false;
+    }
+    for (int i = 0; i < text.length(); i++)
+    {
+        char c = text[i];
+        if (!((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z')))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Guesses the element from the atom name.  In PDB files the name is
+// positioned so that the element symbol is in the first two columns, right
+// justified: " CA " is a carbon, "CA  " is a calcium.  paddedName is those
+// four columns.
+static QByteArray elementFromName(const QByteArray &paddedName, bool hetero)
+{
+    QByteArray name = paddedName.left(2);
+    if (name.length() == 2 && isAllLetters(name))
+    {
+        // long hydrogen names (like HG21) fill all four columns
+        if (name[0] == 'H' && !hetero)
+        {
+            return "H";
+        }
+        return name.toUpper();
+    }
+    // strip the leading digits and spaces and use the first letter
+    QByteArray trimmed = paddedName.trimmed();
+    int i = 0;
+    while (i < trimmed.length() && !isAllLetters(trimmed.mid(i, 1)))
+    {
+        i++;
+    }
+    return trimmed.mid(i, 1).toUpper();
+}
+
+// Returns true if the element is plausible for the atom name.  Old PDB files
+// sometimes have other things in the element columns.
+static bool elementMatchesName(const QByteArray &element,
+                               const QByteArray &name)
+{
+    QByteArray stripped = name.trimmed().toUpper();
+    int i = 0;
+    while (i < stripped.length() && stripped[i] >= '0' && stripped[i] <= '9')
+    {
+        i++;
+    }
+    return isAllLetters(element) && stripped.mid(i).startsWith(element);
+}
+
+// Returns the columns [start,end] (counting from 1 like the PDB format
+// description does) of the line with the spaces trimmed off
+static inline QByteArray field(const QByteArray &line, int start, int end)
+{
+    return line.mid(start - 1, end - start + 1).trimmed();
+}
+
+// Splits a line of mmCIF data into its values.  Values may be quoted with
+// single or double quotes, a quote only ends the value if it is followed by
+// white space.
+static void tokenize(const QByteArray &line, QList< QByteArray > &tokens)
+{
+    int i = 0, n = line.length();
+    while (i < n)
+    {
+        while (i < n && (line[i] == ' ' || line[i] == '\t'))
+        {
+            i++;
+        }
+        if (i >= n)
+        {
+            break;
+        }
+        char quote = line[i];
+        if (quote == '\'' || quote == '"')
+        {
+            int end = i + 1;
+            while (end < n && !(line[end] == quote &&
+                                (end + 1 == n || line[end + 1] == ' ' ||
+                                 line[end + 1] == '\t')))
+            {
+                end++;
+            }
+            tokens.append(line.mid(i + 1, end - i - 1));
+            i = end + 1;
+        }
+        else
+        {
+            int end = i;
+            while (end < n && line[end] != ' ' && line[end] != '\t')
+            {
+                end++;
+            }
+            tokens.append(line.mid(i, end - i));
+            i = end;
+        }
+    }
+}
+
+// in mmCIF files . and ? are missing values
+static inline bool isMissing(const QByteArray &value)
+{
+    return value == "." || value == "?";
+}
+
+// The columns of the _atom_site table that are used, -1 for those that are
+// not in the file
+struct AtomSiteColumns
+{
+    int group, typeSymbol, atomId, altId, compId, asymId, seqId, insCode,
+    x, y, z, occupancy, bFactor, modelNum,
+    authSeqId, authCompId, authAsymId, authAtomId;
+};
+
+static void findColumns(const QList< QByteArray > &names, AtomSiteColumns &c)
+{
+    c.group = names.indexOf("group_PDB");
+    c.typeSymbol = names.indexOf("type_symbol");
+    c.atomId = names.indexOf("label_atom_id");
+    c.altId = names.indexOf("label_alt_id");
+    c.compId = names.indexOf("label_comp_id");
+    c.asymId = names.indexOf("label_asym_id");
+    c.seqId = names.indexOf("label_seq_id");
+    c.insCode = names.indexOf("pdbx_PDB_ins_code");
+    c.x = names.indexOf("Cartn_x");
+    c.y = names.indexOf("Cartn_y");
+    c.z = names.indexOf("Cartn_z");
+    c.occupancy = names.indexOf("occupancy");
+    c.bFactor = names.indexOf("B_iso_or_equiv");
+    c.modelNum = names.indexOf("pdbx_PDB_model_num");
+    c.authSeqId = names.indexOf("auth_seq_id");
+    c.authCompId = names.indexOf("auth_comp_id");
+    c.authAsymId = names.indexOf("auth_asym_id");
+    c.authAtomId = names.indexOf("auth_atom_id");
+}
+
+// returns the value in the preferred column if it is there, otherwise the
+// value in the other column, otherwise an empty array
+static inline QByteArray value(const QList< QByteArray > &row, int preferred,
+                               int other)
+{
+    if (preferred >= 0 && !isMissing(row[preferred]))
+    {
+        return row[preferred];
+    }
+    if (other >= 0 && !isMissing(row[other]))
+    {
+        return row[other];
+    }
+    return QByteArray();
+}
+
+//###############################################################
+
+bool readStructure(const QString &filename, QVector< Atom > &atoms)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+    QString suffix = QFileInfo(filename).suffix().toLower();
+    bool isCif = (suffix == "cif" || suffix == "mmcif");
+    if (!isCif)
+    {
+        QByteArray start = file.peek(1024).trimmed();
+        isCif = start.startsWith("data_");
+    }
+    return isCif ? readMMCIF(file, atoms) : readPDB(file, atoms);
+}
+
+bool readPDB(QIODevice &device, QVector< Atom > &atoms)
+{
+    atoms.clear();
+    char firstAltLoc = ' ';
+    while (!device.atEnd())
+    {
+        QByteArray line = device.readLine();
+        while (line.endsWith('\n') || line.endsWith('\r'))
+        {
+            line.chop(1);
+        }
+        if (line.startsWith("ENDMDL"))
+        {
+            // only the first model is used
+            break;
+        }
+        bool hetero = line.startsWith("HETATM");
+        if ((!hetero && !line.startsWith("ATOM  ")) || line.length() < 54)
+        {
+            continue;
+        }
+        char altLoc = line[16];
+        if (altLoc != ' ')
+        {
+            if (firstAltLoc == ' ')
+            {
+                firstAltLoc = altLoc;
+            }
+            else if (altLoc != firstAltLoc)
+            {
+                continue;
+            }
+        }
+        Atom atom;
+        QByteArray paddedName = line.mid(12, 4);
+        atom.name = paddedName.trimmed();
+        atom.residueName = field(line, 18, 20);
+        atom.chainId = field(line, 22, 22);
+        atom.residueNumber = field(line, 23, 26).toInt();
+        atom.insertionCode = (line.length() > 26) ? line[26] : ' ';
+        atom.position[0] = field(line, 31, 38).toFloat();
+        atom.position[1] = field(line, 39, 46).toFloat();
+        atom.position[2] = field(line, 47, 54).toFloat();
+        QByteArray occupancy = field(line, 55, 60);
+        atom.occupancy = occupancy.isEmpty() ? 1.0f : occupancy.toFloat();
+        atom.bFactor = field(line, 61, 66).toFloat();
+        atom.hetero = hetero;
+        QByteArray element = field(line, 77, 78).toUpper();
+        if (elementMatchesName(element, atom.name))
+        {
+            atom.element = element;
+        }
+        else
+        {
+            atom.element = elementFromName(paddedName, hetero);
+        }
+        atoms.append(atom);
+    }
+    return !atoms.isEmpty();
+}
+
+bool readMMCIF(QIODevice &device, QVector< Atom > &atoms)
+{
+    atoms.clear();
+    QList< QByteArray > columnNames;
+    QList< QByteArray > pending;
+    AtomSiteColumns c;
+    // inLoop is true from a loop_ line until the loop ends, loopHasData is
+    // true once its column names are done
+    bool inLoop = false, loopHasData = false, inAtomSite = false, done = false;
+    QByteArray firstModel, firstAltLoc;
+    while (!device.atEnd() && !done)
+    {
+        QByteArray line = device.readLine();
+        while (line.endsWith('\n') || line.endsWith('\r'))
+        {
+            line.chop(1);
+        }
+        QByteArray trimmed = line.trimmed();
+        if (trimmed.startsWith("loop_"))
+        {
+            done = inAtomSite;
+            inLoop = true;
+            loopHasData = false;
+            columnNames.clear();
+            continue;
+        }
+        if (trimmed.startsWith("_"))
+        {
+            if (inAtomSite)
+            {
+                done = true;
+            }
+            else if (inLoop && !loopHasData)
+            {
+                if (trimmed.startsWith("_atom_site."))
+                {
+                    columnNames.append(trimmed.mid(11));
+                }
+            }
+            else
+            {
+                inLoop = false;
+            }
+            continue;
+        }
+        if (trimmed.isEmpty() || trimmed.startsWith("#") ||
+                trimmed.startsWith("data_"))
+        {
+            done = inAtomSite;
+            inLoop = false;
+            continue;
+        }
+        loopHasData = true;
+        if (!inLoop || columnNames.isEmpty())
+        {
+            continue;
+        }
+        if (!inAtomSite)
+        {
+            inAtomSite = true;
+            findColumns(columnNames, c);
+            if (c.x < 0 || c.y < 0 || c.z < 0)
+            {
+                return false;
+            }
+        }
+        // a row may be split over several lines
+        tokenize(line, pending);
+        while (pending.size() >= columnNames.size())
+        {
+            QList< QByteArray > row = pending.mid(0, columnNames.size());
+            pending = pending.mid(columnNames.size());
+            if (c.modelNum >= 0)
+            {
+                if (firstModel.isEmpty())
+                {
+                    firstModel = row[c.modelNum];
+                }
+                else if (row[c.modelNum] != firstModel)
+                {
+                    continue;
+                }
+            }
+            QByteArray altLoc = value(row, c.altId, -1);
+            if (!altLoc.isEmpty())
+            {
+                if (firstAltLoc.isEmpty())
+                {
+                    firstAltLoc = altLoc;
+                }
+                else if (altLoc != firstAltLoc)
+                {
+                    continue;
+                }
+            }
+            Atom atom;
+            atom.name = value(row, c.authAtomId, c.atomId);
+            atom.residueName = value(row, c.authCompId, c.compId);
+            atom.chainId = value(row, c.authAsymId, c.asymId);
+            atom.residueNumber = value(row, c.authSeqId, c.seqId).toInt();
+            QByteArray insCode = value(row, c.insCode, -1);
+            atom.insertionCode = insCode.isEmpty() ? ' ' : insCode[0];
+            atom.position[0] = row[c.x].toFloat();
+            atom.position[1] = row[c.y].toFloat();
+            atom.position[2] = row[c.z].toFloat();
+            QByteArray occupancy = value(row, c.occupancy, -1);
+            atom.occupancy = occupancy.isEmpty() ? 1.0f : occupancy.toFloat();
+            atom.bFactor = value(row, c.bFactor, -1).toFloat();
+            atom.hetero = (value(row, c.group, -1) == "HETATM");
+            atom.element = value(row, c.typeSymbol, -1).toUpper();
+            if (atom.element.isEmpty())
+            {
+                atom.element = elementFromName(" " + atom.name, atom.hetero);
+            }
+            atoms.append(atom);
+        }
+    }
+    return !atoms.isEmpty();
+}
+
+void removeSolvent(QVector< Atom > &atoms)
+{
+    QVector< Atom > kept;
+    kept.reserve(atoms.size());
+    for (int i = 0; i < atoms.size(); i++)
+    {
+        bool solvent = false;
+        for (int j = 0; SOLVENT_NAMES[j] != NULL && !solvent; j++)
+        {
+            solvent = (atoms[i].residueName == SOLVENT_NAMES[j]);
+        }
+        if (!solvent)
+        {
+            kept.append(atoms[i]);
+        }
+    }
+    atoms = kept;
+}
+
+void removeChains(QVector< Atom > &atoms, const QString &chainsToDelete)
+{
+    // only letters are chain ids here, like the Chimera surface server
+    QString upper = chainsToDelete.toUpper();
+    QByteArray chains;
+    for (int i = 0; i < upper.length(); i++)
+    {
+        if (upper[i].isUpper())
+        {
+            chains.append(upper[i].toLatin1());
+        }
+    }
+    if (chains.isEmpty())
+    {
+        return;
+    }
+    QVector< Atom > kept;
+    kept.reserve(atoms.size());
+    for (int i = 0; i < atoms.size(); i++)
+    {
+        const QByteArray &chain = atoms[i].chainId;
+        if (chain.length() != 1 || !chains.contains(chain.toUpper()))
+        {
+            kept.append(atoms[i]);
+        }
+    }
+    atoms = kept;
+}
+
+}
@@ -0,0 +1,65 @@
+#ifndef STRUCTUREREADER_H
+#define STRUCTUREREADER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+class QIODevice;
+
+/*
+ * This is a namespace for reading the atoms of a molecular structure from PDB
+ * and mmCIF files without starting another program.
+ *
+ * Only the atoms of the first model are read (NMR structures have many), and
+ * only the first of any alternate locations of an atom is kept.  Nothing else
+ * in the file (secondary structure, biological assemblies, etc) is read.
+ */
+namespace StructureReader
+{
+struct Atom
+{
+    float position[3];
+    // the atom name (like CA), the element symbol (upper case, like C or FE)
+    // and the residue name (like LYS)
+    QByteArray name, element, residueName;
+    // the chain id, for PDB files this is one character
+    QByteArray chainId;
+    int residueNumber;
+    char insertionCode;
+    float occupancy, bFactor;
+    // true for HETATM records
+    bool hetero;
+};
+
+/*
+ * Reads the atoms from the given file into atoms.  Files named *.cif or
+ * *.mmcif (or that start with a data_ block) are read as mmCIF, anything else
+ * as PDB.  Returns false if the file could not be read or has no atoms.
+ */
+bool readStructure(const QString &filename, QVector< Atom > &atoms);
+/*
+ * Reads the atoms from PDB format data.  Returns false if there are no atoms.
+ */
+bool readPDB(QIODevice &device, QVector< Atom > &atoms);
+/*
+ * Reads the atoms from mmCIF format data (the _atom_site table).  The author
+ * chain ids and residue numbers are used when they are there, since those are
+ * what the PDB format uses.  Returns false if there are no atoms.
+ */
+bool readMMCIF(QIODevice &device, QVector< Atom > &atoms);
+
+/*
+ * Removes the water molecules.
+ */
+void removeSolvent(QVector< Atom > &atoms);
+/*
+ * Removes the atoms in the chains with the given ids.  Each letter in
+ * chainsToDelete is a chain id, compared without regard to case.  Other
+ * characters are ignored, which matches what the Chimera surface server
+ * deletes.
+ */
+void removeChains(QVector< Atom > &atoms, const QString &chainsToDelete);
+}
+
+#endif // STRUCTUREREADER_H
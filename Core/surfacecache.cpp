@@ -0,0 +1,317 @@
+#include "surfacecache.h"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QSettings>
+#include <QVector>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QAtomicInt>
+#include <QtAlgorithms>
+#include <QFile>
+#include <QDir>
+
+#include "modelstore.h"
+
+// the QSettings keys for the cache location and size limit
+#define SURFACE_CACHE_PATH_SETTING "surfacecache/path"
+#define SURFACE_CACHE_MAX_SIZE_SETTING "surfacecache/maxsize"
+// default cache location relative to the home directory
+#define DEFAULT_SURFACE_CACHE_DIR ".sketchbio/surfacecache"
+// default size limit (2 GB)
+#define DEFAULT_SURFACE_CACHE_MAX_SIZE (Q_INT64_C(2) << 30)
+// Change these whenever the surfaces made by Chimera or MolecularSurface or
+// the simplified levels made from them change so that entries made by the old
+// versions are not used
+#define CHIMERA_SURFACE_TOOL_VERSION "chimera-surfaceserver-1;meshdecimator-1"
+#define NATIVE_SURFACE_TOOL_VERSION "molecularsurface-1;meshdecimator-1"
+// the file in each entry that holds the time the entry was last used
+#define LAST_USED_FILE "lastused"
+// entries are written under a temporary name with this in it and then renamed
+#define TEMP_ENTRY_MARKER ".tmp"
+
+namespace SurfaceCache
+{
+
+// entries are only renamed into place, marked used and removed with this held
+static QMutex cacheMutex;
+// used to give each temporary entry a different name
+static QAtomicInt tempEntryCount;
+
+//###############################################################
+// Helpers
+
+static bool removeDir(const QString &path)
+{
+    QDir dir(path);
+    foreach(const QFileInfo &info, dir.entryInfoList(
+                QDir::Dirs | QDir::Files | QDir::Hidden | QDir::System |
+                QDir::NoDotAndDotDot))
+    {
+        if (info.isDir() && !info.isSymLink())
+        {
+            removeDir(info.absoluteFilePath());
+        }
+        else
+        {
+            QFile::remove(info.absoluteFilePath());
+        }
+    }
+    return QDir().rmdir(path);
+}
+
+static qint64 dirSize(const QString &path)
+{
+    qint64 size = 0;
+    QDir dir(path);
+    foreach(const QFileInfo &info, dir.entryInfoList(
+                QDir::Dirs | QDir::Files | QDir::Hidden | QDir::NoDotAndDotDot))
+    {
+        size += info.isDir() ? dirSize(info.absoluteFilePath()) : info.size();
+    }
+    return size;
+}
+
+static QString entryDir(const QString &key)
+{
+    // two levels so no one directory gets too big
+    return QDir(getCacheDir()).absoluteFilePath(key.left(2) + "/" + key);
+}
+
+static void markUsed(const QString &dir)
+{
+    QFile f(QDir(dir).absoluteFilePath(LAST_USED_FILE));
+    if (f.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        f.write(QByteArray::number(QDateTime::currentMSecsSinceEpoch()));
+    }
+}
+
+static qint64 lastUsed(const QString &dir)
+{
+    QFile f(QDir(dir).absoluteFilePath(LAST_USED_FILE));
+    if (!f.open(QIODevice::ReadOnly))
+    {
+        return 0;
+    }
+    return f.readAll().trimmed().toLongLong();
+}
+
+struct EntryInfo
+{
+    QString dir;
+    qint64 size;
+    qint64 lastUsed;
+    bool operator<(const EntryInfo &other) const
+    {
+        return lastUsed < other.lastUsed;
+    }
+};
+
+// lists the complete entries in the cache, must be called with the mutex held
+static QVector< EntryInfo > listEntries()
+{
+    QVector< EntryInfo > entries;
+    QDir cache(getCacheDir());
+    foreach(const QFileInfo &sub, cache.entryInfoList(
+                QDir::Dirs | QDir::NoDotAndDotDot))
+    {
+        QDir subdir(sub.absoluteFilePath());
+        foreach(const QFileInfo &info, subdir.entryInfoList(
+                    QDir::Dirs | QDir::NoDotAndDotDot))
+        {
+            if (info.fileName().contains(TEMP_ENTRY_MARKER))
+            {
+                continue;
+            }
+            EntryInfo entry;
+            entry.dir = info.absoluteFilePath();
+            entry.size = dirSize(entry.dir);
+            entry.lastUsed = lastUsed(entry.dir);
+            entries.append(entry);
+        }
+    }
+    return entries;
+}
+
+//###############################################################
+// Settings
+
+QString getCacheDir()
+{
+    QSettings settings;
+    QString defaultDir = QDir::home().absoluteFilePath(DEFAULT_SURFACE_CACHE_DIR);
+    return settings.value(SURFACE_CACHE_PATH_SETTING, defaultDir).toString();
+}
+
+void setCacheDir(const QString &dir)
+{
+    QSettings settings;
+    settings.setValue(SURFACE_CACHE_PATH_SETTING, dir);
+}
+
+qint64 getMaxSize()
+{
+    QSettings settings;
+    return settings.value(SURFACE_CACHE_MAX_SIZE_SETTING,
+                          DEFAULT_SURFACE_CACHE_MAX_SIZE).toLongLong();
+}
+
+void setMaxSize(qint64 bytes)
+{
+    QSettings settings;
+    settings.setValue(SURFACE_CACHE_MAX_SIZE_SETTING, bytes);
+}
+
+//###############################################################
+
+QString makeKey(const QString &pdbIdOrFile, const QString &chainsToDelete,
+                bool exportWholeBioUnit, SurfaceTool tool)
+{
+    QString structure;
+    if (QFileInfo(pdbIdOrFile).isFile())
+    {
+        QByteArray hash = ModelStore::getFileHash(pdbIdOrFile);
+        if (hash.isEmpty())
+        {
+            return QString();
+        }
+        structure = "file:" + QString::fromLatin1(hash);
+    }
+    else
+    {
+        structure = "pdb:" + pdbIdOrFile.trimmed().toLower();
+    }
+    // only the upper case letters are used as chain ids (see
+    // ChimeraVTKExportRunner), and the order they are deleted in doesn't matter
+    QString chains;
+    QString upper = chainsToDelete.toUpper();
+    for (int i = 0; i < upper.length(); i++)
+    {
+        if (upper[i].isUpper() && !chains.contains(upper[i]))
+        {
+            chains.append(upper[i]);
+        }
+    }
+    qSort(chains.begin(), chains.end());
+    QString key = structure + "\n" + chains + "\n" +
+            (exportWholeBioUnit ? "1" : "0") + "\n" +
+            (tool == NATIVE_SURFACES ? NATIVE_SURFACE_TOOL_VERSION :
+                                       CHIMERA_SURFACE_TOOL_VERSION);
+    return QString::fromLatin1(
+                QCryptographicHash::hash(key.toUtf8(),
+                                         QCryptographicHash::Sha1).toHex());
+}
+
+QString surfaceFileName(int threshold)
+{
+    return QString("surface.%1.vtk").arg(threshold);
+}
+
+QString simplifiedFileName(int threshold, int triangles)
+{
+    return QString("surface.%1.decimated.%2.vtk").arg(threshold).arg(triangles);
+}
+
+QString findEntry(const QString &key)
+{
+    if (key.isEmpty() || getMaxSize() <= 0)
+    {
+        return QString();
+    }
+    QString dir = entryDir(key);
+    QMutexLocker lock(&cacheMutex);
+    if (!QFileInfo(dir).isDir())
+    {
+        return QString();
+    }
+    markUsed(dir);
+    return dir;
+}
+
+bool addEntry(const QString &key, const QMap< QString, QString > &files)
+{
+    qint64 maxSize = getMaxSize();
+    if (key.isEmpty() || maxSize <= 0)
+    {
+        return false;
+    }
+    QString dir = entryDir(key);
+    // the files are put in a temporary directory first so that nobody can
+    // find the entry until it is complete
+    QString temp = dir + QString(TEMP_ENTRY_MARKER ".%1.%2")
+            .arg(QCoreApplication::applicationPid())
+            .arg(tempEntryCount.fetchAndAddRelaxed(1));
+    if (!QDir().mkpath(temp))
+    {
+        return false;
+    }
+    QDir tempDir(temp);
+    for (QMap< QString, QString >::const_iterator it = files.constBegin();
+         it != files.constEnd(); ++it)
+    {
+        if (!ModelStore::linkOrCopyFile(it.value(),
+                                        tempDir.absoluteFilePath(it.key())))
+        {
+            removeDir(temp);
+            return false;
+        }
+    }
+    markUsed(temp);
+    {
+        QMutexLocker lock(&cacheMutex);
+        if (QFileInfo(dir).exists())
+        {
+            removeDir(dir);
+        }
+        if (!QDir().rename(temp, dir))
+        {
+            removeDir(temp);
+            return false;
+        }
+    }
+    evictToSize(maxSize);
+    return true;
+}
+
+qint64 getCacheSize()
+{
+    QDir cache(getCacheDir());
+    if (!cache.exists())
+    {
+        return 0;
+    }
+    return dirSize(cache.absolutePath());
+}
+
+void evictToSize(qint64 maxSize)
+{
+    QMutexLocker lock(&cacheMutex);
+    QVector< EntryInfo > entries = listEntries();
+    qint64 total = 0;
+    for (int i = 0; i < entries.size(); i++)
+    {
+        total += entries[i].size;
+    }
+    qSort(entries);
+    for (int i = 0; i < entries.size() && total > maxSize; i++)
+    {
+        removeDir(entries[i].dir);
+        total -= entries[i].size;
+    }
+}
+
+void clear()
+{
+    QMutexLocker lock(&cacheMutex);
+    QDir cache(getCacheDir());
+    foreach(const QFileInfo &sub, cache.entryInfoList(
+                QDir::Dirs | QDir::NoDotAndDotDot))
+    {
+        removeDir(sub.absoluteFilePath());
+    }
+}
+
+}
@@ -0,0 +1,112 @@
+#ifndef SURFACECACHE_H
+#define SURFACECACHE_H
+
+#include <QString>
+#include <QMap>
+
+/*
+ * This is a namespace for the cache of surfaces made when importing PDB
+ * structures.
+ *
+ * Making the surfaces for a structure means running Chimera (or
+ * MolecularSurface) and then simplifying the result, which takes far longer
+ * than loading the files that come out of it.  The cache keeps those files so
+ * that importing the same structure again (in any project) can skip straight
+ * to loading them.
+ *
+ * Each entry is a directory named by a hash of its key.  The key is made from
+ * the pdb id (or the hash of the contents of a local pdb file), the chains
+ * that were deleted, whether the whole biological unit was used and which
+ * surfacing tools made the surfaces (and their versions).  The entry holds a
+ * surface file for each threshold that was surfaced and the simplified levels
+ * made from them.
+ * Entries are added all at once, so an entry that exists is complete.  Files
+ * are hardlinked into and out of the cache when possible (see ModelStore), so
+ * nothing should ever write into a cached file in place.
+ *
+ * When the cache gets bigger than its size limit, the least recently used
+ * entries are removed.
+ */
+namespace SurfaceCache
+{
+// The tools that can make the surfaces, the surfaces they make are different
+// so they have different keys
+enum SurfaceTool
+{
+    CHIMERA_SURFACES,
+    NATIVE_SURFACES
+};
+
+/*
+ * Returns the directory the cache is kept in.  This is read from the
+ * application settings (key "surfacecache/path") and defaults to a directory
+ * in the user's home directory.
+ */
+QString getCacheDir();
+/*
+ * Sets the directory the cache is kept in and saves it to the application
+ * settings.
+ */
+void setCacheDir(const QString &dir);
+/*
+ * Returns the maximum size of the cache in bytes.  This is read from the
+ * application settings (key "surfacecache/maxsize").  Zero or less means the
+ * cache is not used.
+ */
+qint64 getMaxSize();
+/*
+ * Sets the maximum size of the cache in bytes and saves it to the application
+ * settings.  Does not remove any entries until the next entry is added.
+ */
+void setMaxSize(qint64 bytes);
+
+/*
+ * Returns the key for the surfaces of the given structure made by the given
+ * tool.  pdbIdOrFile is either a pdb id or the name of a local pdb file.
+ * Chains are compared without regard to order or case.  Returns an empty
+ * string if the local file cannot be read.
+ */
+QString makeKey(const QString &pdbIdOrFile, const QString &chainsToDelete,
+                bool exportWholeBioUnit, SurfaceTool tool = CHIMERA_SURFACES);
+/*
+ * Returns the name within an entry of the surface made with the given
+ * threshold.
+ */
+QString surfaceFileName(int threshold);
+/*
+ * Returns the name within an entry of the simplified level with the given
+ * number of triangles made from the surface with the given threshold.
+ */
+QString simplifiedFileName(int threshold, int triangles);
+
+/*
+ * Returns the directory of the entry for the given key and marks it as
+ * recently used, or an empty string if there is no entry for the key.
+ */
+QString findEntry(const QString &key);
+/*
+ * Adds an entry for the given key containing the given files (name in the
+ * entry -> file to add), replacing any entry already there.  Then removes
+ * the least recently used entries if the cache is over its size limit.
+ * Returns true on success.
+ *
+ * This is safe to call from a worker thread.
+ */
+bool addEntry(const QString &key, const QMap< QString, QString > &files);
+
+/*
+ * Returns the total size in bytes of the files in the cache.
+ */
+qint64 getCacheSize();
+/*
+ * Removes the least recently used entries until the cache is no bigger than
+ * the given size.
+ */
+void evictToSize(qint64 maxSize);
+/*
+ * Removes all the entries in the cache.
+ */
+void clear();
+}
+
+#endif // SURFACECACHE_H
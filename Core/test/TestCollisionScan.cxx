@@ -0,0 +1,165 @@
+#include <iostream>
+using std::cout;
+using std::endl;
+
+#include <quat.h>
+
+#include <QScopedPointer>
+#include <QTime>
+
+#include <vtkSmartPointer.h>
+#include <vtkRenderer.h>
+
+#include <sketchmodel.h>
+#include <modelinstance.h>
+#include <objectgroup.h>
+#include <worldmanager.h>
+#include <collisionscan.h>
+
+#include "TestCoreHelpers.h"
+
+// Adds a cube at the given position to the world (or the group if it is not
+// NULL)
+static SketchObject *addCube(WorldManager *world, ObjectGroup *group,
+                             SketchModel *model, double x, double y)
+{
+    SketchObject *obj = new ModelInstance(model);
+    q_vec_type pos = {x, y, 0};
+    obj->setPosition(pos);
+    if (group != NULL)
+    {
+        group->addObject(obj);
+    }
+    else
+    {
+        world->addObject(obj);
+    }
+    return obj;
+}
+
+// One cube passes through another one halfway through the animation.  A
+// hidden cube that overlaps them and two cubes in a group that touch each
+// other should not be reported.
+int testScan(bool parallel)
+{
+    int errors = 0;
+    QScopedPointer< SketchModel > model(TestCoreHelpers::getCubeModel());
+    vtkSmartPointer< vtkRenderer > renderer =
+        vtkSmartPointer< vtkRenderer >::New();
+    QScopedPointer< WorldManager > world(new WorldManager(renderer));
+    SketchObject *still = addCube(world.data(), NULL, model.data(), 0, 0);
+    still->addKeyframeForCurrentLocation(0.0);
+    SketchObject *moving = addCube(world.data(), NULL, model.data(), 20, 0);
+    moving->addKeyframeForCurrentLocation(0.0);
+    q_vec_type end = {-20, 0, 0};
+    moving->setPosition(end);
+    moving->addKeyframeForCurrentLocation(10.0);
+    SketchObject *hidden = addCube(world.data(), NULL, model.data(), 0, 0);
+    hidden->setIsVisible(false);
+    hidden->addKeyframeForCurrentLocation(0.0);
+    ObjectGroup *group = new ObjectGroup();
+    addCube(world.data(), group, model.data(), 1, 0);
+    addCube(world.data(), group, model.data(), -1, 0);
+    q_vec_type groupPos = {0, 50, 0};
+    group->setPosition(groupPos);
+    world->addObject(group);
+
+    CollisionScan scan;
+    scan.scan(*world, 30.0, parallel);
+    if (scan.getNumberOfSamples() != 301)
+    {
+        errors++;
+        cout << "Expected 301 samples, got " << scan.getNumberOfSamples()
+             << endl;
+    }
+    const QVector< CollisionScan::Interval > &collisions =
+        scan.getCollisions();
+    if (collisions.size() != 1)
+    {
+        errors++;
+        cout << "Expected 1 collision interval, got " << collisions.size()
+             << endl;
+        return errors;
+    }
+    const CollisionScan::Interval &interval = collisions[0];
+    if (interval.first != still || interval.second != moving)
+    {
+        errors++;
+        cout << "Wrong objects in the collision interval" << endl;
+    }
+    if (interval.start <= 4.0 || interval.start > 5.0 || interval.end < 5.0 ||
+        interval.end >= 6.0)
+    {
+        errors++;
+        cout << "Wrong collision interval: " << interval.start << " to "
+             << interval.end << endl;
+    }
+    return errors;
+}
+
+// The scan should find the same intervals in parallel as on one thread
+int testParallelScan()
+{
+    int errors = 0;
+    QScopedPointer< SketchModel > model(TestCoreHelpers::getCubeModel());
+    vtkSmartPointer< vtkRenderer > renderer =
+        vtkSmartPointer< vtkRenderer >::New();
+    QScopedPointer< WorldManager > world(new WorldManager(renderer));
+    // rows of cubes sliding past each other
+    for (int i = 0; i < 40; i++)
+    {
+        SketchObject *obj = addCube(world.data(), NULL, model.data(),
+                                    (i % 2) * 30.0, (i / 2) * 3.0);
+        obj->addKeyframeForCurrentLocation(0.0);
+        q_vec_type pos = {(1 - i % 2) * 30.0, (i / 2) * 3.0, 0};
+        obj->setPosition(pos);
+        obj->addKeyframeForCurrentLocation(10.0);
+    }
+    CollisionScan serial, parallel;
+    QTime timer;
+    timer.start();
+    serial.scan(*world, 30.0, false);
+    int serialTime = timer.restart();
+    parallel.scan(*world, 30.0, true);
+    int parallelTime = timer.elapsed();
+    const QVector< CollisionScan::Interval > &a = serial.getCollisions(),
+                                             &b = parallel.getCollisions();
+    if (a.isEmpty())
+    {
+        errors++;
+        cout << "No collisions found between sliding cubes" << endl;
+    }
+    if (a.size() != b.size())
+    {
+        errors++;
+        cout << "Parallel scan found " << b.size() << " intervals instead of "
+             << a.size() << endl;
+    }
+    else
+    {
+        for (int i = 0; i < a.size(); i++)
+        {
+            if (a[i].first != b[i].first || a[i].second != b[i].second ||
+                a[i].start != b[i].start || a[i].end != b[i].end)
+            {
+                errors++;
+                cout << "Parallel scan interval " << i << " is different"
+                     << endl;
+                break;
+            }
+        }
+    }
+    cout << serial.getNumberOfSamples() << " samples, "
+         << serial.getNumberOfPairTests() << " pair tests: serial "
+         << serialTime << " ms, parallel " << parallelTime << " ms" << endl;
+    return errors;
+}
+
+int main()
+{
+    int errors = 0;
+    errors += testScan(false);
+    errors += testScan(true);
+    errors += testParallelScan();
+    return errors;
+}
@@ -0,0 +1,131 @@
+#include <iostream>
+using std::cout;
+using std::endl;
+
+#include <cmath>
+#include <algorithm>
+
+#include <QSharedPointer>
+
+#include <vtkSmartPointer.h>
+#include <vtkColorTransferFunction.h>
+
+#include <colormaptype.h>
+
+// Asking for the same type and range should give the same shared table, even
+// for a different array
+int testSharedTables()
+{
+    int errors = 0;
+    ColorMapType::ColorMap a(ColorMapType::BLUE_TO_RED, "charge");
+    ColorMapType::ColorMap b(ColorMapType::BLUE_TO_RED, "modelNum");
+    QSharedPointer< const ColorMapType::ColorLookupTable > t1 =
+            a.getLookupTable(10.0, -10.0);
+    QSharedPointer< const ColorMapType::ColorLookupTable > t2 =
+            b.getLookupTable(10.0, -10.0);
+    if (t1 != t2)
+    {
+        errors++;
+        cout << "Different tables for the same type and range" << endl;
+    }
+    if (t1->getTransferFunction() != t2->getTransferFunction())
+    {
+        errors++;
+        cout << "Different transfer functions for the same type and range"
+             << endl;
+    }
+    QSharedPointer< const ColorMapType::ColorLookupTable > t3 =
+            a.getLookupTable(0.0, 1.0);
+    ColorMapType::ColorMap c(ColorMapType::SOLID_COLOR_BLUE, "charge");
+    QSharedPointer< const ColorMapType::ColorLookupTable > t4 =
+            c.getLookupTable(10.0, -10.0);
+    if (t1 == t3 || t1 == t4)
+    {
+        errors++;
+        cout << "Same table for a different type or range" << endl;
+    }
+    return errors;
+}
+
+// Tables should be freed once nothing uses them, so new data ranges do not
+// pile up tables
+int testUnusedTablesFreed()
+{
+    int errors = 0;
+    int before = ColorMapType::ColorLookupTable::getNumberOfLookupTables();
+    ColorMapType::ColorMap cmap(ColorMapType::BLUE_TO_RED, "charge");
+    for (int i = 0; i < 100; i++)
+    {
+        QSharedPointer< const ColorMapType::ColorLookupTable > table =
+                cmap.getLookupTable(-i, i);
+        if (ColorMapType::ColorLookupTable::getNumberOfLookupTables() !=
+                before + 1)
+        {
+            errors++;
+            cout << "Wrong number of tables in use for range " << i << endl;
+            break;
+        }
+    }
+    if (ColorMapType::ColorLookupTable::getNumberOfLookupTables() != before)
+    {
+        errors++;
+        cout << "Unused tables were not freed" << endl;
+    }
+    // a table asked for again after it was freed should be made again
+    QSharedPointer< const ColorMapType::ColorLookupTable > table =
+            cmap.getLookupTable(-5.0, 5.0);
+    if (table->getLow() != -5.0 || table->getHigh() != 5.0 ||
+            table->getType() != ColorMapType::BLUE_TO_RED)
+    {
+        errors++;
+        cout << "Table made again has the wrong type or range" << endl;
+    }
+    return errors;
+}
+
+// The table's colors should match a new transfer function for the map, and
+// values outside the range should get the color at the nearest end
+int testColors()
+{
+    int errors = 0;
+    ColorMapType::Type types[2] = { ColorMapType::BLUE_TO_RED,
+                                    ColorMapType::DIM_SOLID_COLOR_GREEN };
+    for (int i = 0; i < 2; i++)
+    {
+        ColorMapType::ColorMap cmap(types[i], "charge");
+        double low = -3.0, high = 7.0;
+        QSharedPointer< const ColorMapType::ColorLookupTable > table =
+                cmap.getLookupTable(low, high);
+        vtkSmartPointer< vtkColorTransferFunction > function =
+                vtkSmartPointer< vtkColorTransferFunction >::Take(
+                    cmap.getColorMap(low, high));
+        for (int j = -2; j <= 12; j++)
+        {
+            double value = low + (high - low) * j / 10.0;
+            double expected[3], rgb[3];
+            function->GetColor(std::max(low, std::min(high, value)), expected);
+            table->getColor(value, rgb);
+            for (int k = 0; k < 3; k++)
+            {
+                // the table is sampled, so allow for the interpolation
+                if (std::fabs(expected[k] - rgb[k]) > 1e-2)
+                {
+                    errors++;
+                    cout << "Wrong color at " << value << " for "
+                         << ColorMapType::stringFromColorMap(types[i]) << endl;
+                    break;
+                }
+            }
+        }
+    }
+    return errors;
+}
+
+int main()
+{
+    int errors = 0;
+    errors += testSharedTables();
+    errors += testUnusedTablesFreed();
+    errors += testColors();
+    return errors;
+}
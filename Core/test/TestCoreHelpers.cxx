@@ -1,6 +1,7 @@
 #include "TestCoreHelpers.h"
 
 #include <iostream>
+#include <iterator>
 
 #include <QString>
 
@@ -652,6 +653,161 @@ public:
     ObjectKeyframeTestNewMacro(HasChangedSinceKeyframeTest)
 };
 
+// checks the keyframes found around the time against a search from the start
+static inline int testKeyframeSpan(SketchObject *obj, double t)
+{
+    const QMap< double, Keyframe > *frames = obj->getKeyframes();
+    QMap< double, Keyframe >::const_iterator after = frames->lowerBound(t);
+    QMap< double, Keyframe >::const_iterator before = after;
+    if (before != frames->constBegin()) {
+        --before;
+    }
+    int beforeIdx = std::distance(frames->constBegin(), before);
+    int afterIdx = std::distance(frames->constBegin(), after);
+    KeyframeSpan span = obj->findKeyframesAround(t);
+    int errors = 0;
+    errors += test_assert_true(span.before == beforeIdx &&
+                               span.beforeTime == before.key(),
+                               "Wrong keyframe found before the time");
+    if (after == frames->constEnd()) {
+        errors += test_assert_true(span.after == -1,
+                                   "Keyframe found after the last keyframe");
+    } else {
+        errors += test_assert_true(span.after == afterIdx &&
+                                   span.afterTime == after.key(),
+                                   "Wrong keyframe found after the time");
+    }
+    return errors;
+}
+
+class KeyframeSeekTest : public ObjectTest
+{
+public:
+    virtual ~KeyframeSeekTest() {}
+    ObjectTestNameMacro("KeyframeSeek")
+    virtual int testObject(SketchObject *obj)
+    {
+        int errors = 0;
+        q_vec_type pos, played, replayed;
+        q_type orient, playedOr, replayedOr;
+        for (int i = 0; i < 10; i++) {
+            q_vec_set(pos,i * 3.0,(i % 3) * 2.0,-i);
+            q_from_axis_angle(orient,0,1,0,i * .3);
+            obj->setPosAndOrient(pos,orient);
+            obj->addKeyframeForCurrentLocation(i * 2.0);
+        }
+        // play forward, then seek back and forth, the results should be the
+        // same as searching from the start each time
+        QList< double > times;
+        for (double t = 0.0; t < 20.0; t += 0.1) {
+            times.append(t);
+        }
+        times << 19.0 << 3.0 << 3.05 << 17.0 << 0.0 << 2.0 << 2.0 << 25.0;
+        foreach(double t, times) {
+            errors += testKeyframeSpan(obj,t);
+        }
+        // playing through a second time should put the object in the same
+        // places
+        obj->setPositionByAnimationTime(7.3);
+        obj->getPosition(played);
+        obj->getOrientation(playedOr);
+        obj->setPositionByAnimationTime(15.0);
+        obj->setPositionByAnimationTime(1.0);
+        for (double t = 1.0; t < 7.3; t += 0.1) {
+            obj->setPositionByAnimationTime(t);
+        }
+        obj->setPositionByAnimationTime(7.3);
+        obj->getPosition(replayed);
+        obj->getOrientation(replayedOr);
+        errors += vectors_should_be_equal(played,replayed,
+                                          "Position changed on replay");
+        errors += quats_should_be_equal(playedOr,replayedOr,
+                                        "Orientation changed on replay");
+        // changing the keyframes must not leave the search somewhere stale
+        obj->removeKeyframeForTime(4.0);
+        errors += testKeyframeSpan(obj,3.5);
+        errors += testKeyframeSpan(obj,4.5);
+        obj->setPosAndOrient(pos,orient);
+        obj->addKeyframeForCurrentLocation(5.0);
+        errors += testKeyframeSpan(obj,4.5);
+        errors += testKeyframeSpan(obj,5.5);
+        return errors;
+    }
+    ObjectTestNewMacro(KeyframeSeekTest)
+};
+
+// Makes a keyframe for the object's current place at the given grouping level
+static Keyframe keyframeAtLevel(SketchObject *obj, int level)
+{
+    q_vec_type pos;
+    q_type orient;
+    obj->getPosition(pos);
+    obj->getOrientation(orient);
+    return Keyframe(pos,pos,orient,orient,obj->getColorMapType(),
+                    obj->getArrayToColorBy(),level,NULL,true,false);
+}
+
+// checks that two objects' splines give the same places at every time
+static int testSameSplines(SketchObject *obj, SketchObject *reference,
+                           const char *message)
+{
+    int errors = 0;
+    for (double t = 0.0; t < 12.0 && errors == 0; t += 0.05) {
+        q_vec_type pos, refPos;
+        q_type orient, refOrient;
+        obj->getPosAndOrFromSpline(pos,orient,t);
+        reference->getPosAndOrFromSpline(refPos,refOrient,t);
+        errors += vectors_should_be_equal(pos,refPos,message);
+        errors += quats_should_be_equal(orient,refOrient,message);
+    }
+    return errors;
+}
+
+// Edits keyframes on both sides of a grouped stretch of the animation, which
+// only remakes the spline on that side, and checks that the splines are the
+// same as ones made from scratch
+class IncrementalSplineTest : public ObjectTest
+{
+public:
+    virtual ~IncrementalSplineTest() {}
+    ObjectTestNameMacro("IncrementalSpline")
+    virtual int testObject(SketchObject *obj)
+    {
+        int errors = 0;
+        q_vec_type pos;
+        q_type orient;
+        for (int i = 0; i < 11; i++) {
+            q_vec_set(pos,i * 2.0,(i % 4) * 3.0,-i * 0.5);
+            q_from_axis_angle(orient,1,0,i % 2,i * .4);
+            obj->setPosAndOrient(pos,orient);
+            // grouped at 4 and 5, so there are two splines
+            obj->insertKeyframe(i,keyframeAtLevel(obj,(i == 4 || i == 5) ? 1 : 0));
+        }
+        QScopedPointer< SketchObject > reference(obj->deepCopy());
+        errors += testSameSplines(obj,reference.data(),
+                                  "Splines differ before editing");
+        q_vec_set(pos,-5,7,1);
+        obj->setPosAndOrient(pos,orient);
+        obj->insertKeyframe(8.5,keyframeAtLevel(obj,0));
+        obj->removeKeyframeForTime(9.0);
+        reference.reset(obj->deepCopy());
+        errors += testSameSplines(obj,reference.data(),
+                                  "Splines differ after editing the end");
+        obj->insertKeyframe(1.0,keyframeAtLevel(obj,0));
+        reference.reset(obj->deepCopy());
+        errors += testSameSplines(obj,reference.data(),
+                                  "Splines differ after editing the start");
+        // ungrouping the middle joins the two splines
+        obj->insertKeyframe(5.0,keyframeAtLevel(obj,0));
+        obj->removeKeyframeForTime(4.0);
+        reference.reset(obj->deepCopy());
+        errors += testSameSplines(obj,reference.data(),
+                                  "Splines differ after joining them");
+        return errors;
+    }
+    ObjectTestNewMacro(IncrementalSplineTest)
+};
+
 class RemoveFromGroupPosAndOrientTest : public ObjectTest
 {
 public:
@@ -752,6 +908,8 @@ static ObjectActionTest keyframeCreationTest(KeyframeCreationTest::New,NULL);
 static ObjectActionTest visibilityAndActiveTest(VisibilityAndActiveTest::New,NULL);
 static ObjectActionTest interpolationTest(KeyframeInterpolationTest::New,NULL);
 static ObjectActionTest changeSinceKeyframeTest(HasChangedSinceKeyframeTest::New,NULL);
+static ObjectActionTest keyframeSeekTest(KeyframeSeekTest::New,NULL);
+static ObjectActionTest incrementalSplineTest(IncrementalSplineTest::New,NULL);
 static ObjectActionTest GroupRemovalPosAndOrientTest(RemoveFromGroupPosAndOrientTest::New,NULL);
 //###############################################################################
 //###############################################################################
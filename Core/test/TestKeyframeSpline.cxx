@@ -0,0 +1,236 @@
+#include <iostream>
+using std::cout;
+using std::endl;
+#define PRINT_ERROR_MESSAGE(x)  cout << x << endl
+
+#include <cmath>
+
+#include <QCoreApplication>
+#include <QVector>
+
+#include <vtkSmartPointer.h>
+#include <vtkCardinalSpline.h>
+
+#include <sketchtests.h>
+#include <keyframespline.h>
+
+#define NUM_POINTS 7
+
+static const double TIMES[NUM_POINTS] = { 0.0, 1.0, 2.5, 3.0, 5.0, 8.0, 8.5 };
+
+static void getPoint(int i, q_vec_type position, q_type orientation)
+{
+    q_vec_set(position, 3.0 * i, 10.0 * sin(i * 1.3), (i % 3) * -4.0);
+    q_from_axis_angle(orientation, 1.0, 0.5 * i, 2.0 - i, 0.9 * i);
+    // the sign of a quaternion should not matter
+    if (i % 2 == 1)
+    {
+        for (int j = 0; j < 4; j++)
+        {
+            orientation[j] = -orientation[j];
+        }
+    }
+}
+
+static KeyframeSpline makeSpline()
+{
+    KeyframeSpline spline;
+    for (int i = 0; i < NUM_POINTS; i++)
+    {
+        q_vec_type position;
+        q_type orientation;
+        getPoint(i, position, orientation);
+        spline.addPoint(TIMES[i], position, orientation);
+    }
+    spline.compute();
+    return spline;
+}
+
+// angle between two orientations
+static double angleBetween(const q_type a, const q_type b)
+{
+    double d = fabs(a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3]);
+    return 2.0 * acos(d > 1.0 ? 1.0 : d);
+}
+
+// The positions should be the same as the vtkCardinalSplines that were used
+// before
+int testPositions()
+{
+    int errors = 0;
+    KeyframeSpline spline = makeSpline();
+    vtkSmartPointer< vtkCardinalSpline > reference[3];
+    for (int c = 0; c < 3; c++)
+    {
+        reference[c] = vtkSmartPointer< vtkCardinalSpline >::New();
+        for (int i = 0; i < NUM_POINTS; i++)
+        {
+            q_vec_type position;
+            q_type orientation;
+            getPoint(i, position, orientation);
+            reference[c]->AddPoint(TIMES[i], position[c]);
+        }
+        reference[c]->Compute();
+    }
+    double maxDiff = 0.0;
+    for (double t = -1.0; t < 10.0; t += 0.01)
+    {
+        q_vec_type position;
+        q_type orientation;
+        spline.evaluate(t, position, orientation);
+        for (int c = 0; c < 3; c++)
+        {
+            double diff = fabs(position[c] - reference[c]->Evaluate(t));
+            maxDiff = (diff > maxDiff) ? diff : maxDiff;
+        }
+    }
+    if (maxDiff > 1e-8)
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Positions differ from vtkCardinalSpline by "
+                            << maxDiff);
+    }
+    return errors;
+}
+
+// The orientation should be the keyframe orientation at each keyframe and
+// change smoothly in between
+int testOrientations()
+{
+    int errors = 0;
+    KeyframeSpline spline = makeSpline();
+    for (int i = 0; i < NUM_POINTS; i++)
+    {
+        q_vec_type position, result;
+        q_type orientation, resultOrientation;
+        getPoint(i, position, orientation);
+        spline.evaluate(TIMES[i], result, resultOrientation);
+        if (!q_vec_equals(position, result) ||
+                angleBetween(orientation, resultOrientation) > 1e-6)
+        {
+            errors++;
+            PRINT_ERROR_MESSAGE("Spline does not pass through keyframe " << i);
+        }
+    }
+    q_vec_type position;
+    q_type last, current;
+    spline.evaluate(TIMES[0], position, last);
+    double maxStep = 0.0;
+    for (double t = TIMES[0] + 0.001; t <= TIMES[NUM_POINTS - 1]; t += 0.001)
+    {
+        spline.evaluate(t, position, current);
+        double length = sqrt(current[0] * current[0] + current[1] * current[1]
+                             + current[2] * current[2] + current[3] * current[3]);
+        if (fabs(length - 1.0) > 1e-9)
+        {
+            errors++;
+            PRINT_ERROR_MESSAGE("Orientation is not a unit quaternion at " << t);
+            break;
+        }
+        double step = angleBetween(last, current);
+        maxStep = (step > maxStep) ? step : maxStep;
+        q_copy(last, current);
+    }
+    // no keyframe is more than 180 degrees from the last and the shortest
+    // interval is 0.5, so the orientation turns by less than 2*pi radians per
+    // second (plus some room for the SQUAD curve)
+    if (maxStep > 0.001 * 4.0 * Q_PI)
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Orientation jumps by " << maxStep << " radians");
+    }
+    // after the end the spline stays at the last keyframe
+    q_vec_type endPosition;
+    q_type endOrientation;
+    getPoint(NUM_POINTS - 1, endPosition, endOrientation);
+    spline.evaluate(TIMES[NUM_POINTS - 1] + 5.0, position, current);
+    if (!q_vec_equals(position, endPosition) ||
+            angleBetween(current, endOrientation) > 1e-6)
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Spline not clamped after the last keyframe");
+    }
+    return errors;
+}
+
+// Adding points after computing and copying should give the same results
+int testRecomputeAndCopy()
+{
+    int errors = 0;
+    KeyframeSpline full = makeSpline();
+    KeyframeSpline partial;
+    for (int i = 0; i < NUM_POINTS; i++)
+    {
+        q_vec_type position;
+        q_type orientation;
+        getPoint(i, position, orientation);
+        partial.addPoint(TIMES[i], position, orientation);
+        if (i == 3)
+        {
+            partial.compute();
+        }
+    }
+    partial.compute();
+    KeyframeSpline copy = partial;
+    if (full.getNumberOfPoints() != NUM_POINTS ||
+            partial.getNumberOfPoints() != NUM_POINTS ||
+            copy.getStartTime() != TIMES[0] ||
+            copy.getEndTime() != TIMES[NUM_POINTS - 1])
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Wrong number of points or time range");
+    }
+    const KeyframeSpline *splines[3] = { &full, &partial, &copy };
+    q_vec_type positions[3];
+    q_type orientations[3];
+    for (double t = 0.0; t < 9.0; t += 0.1)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            splines[i]->evaluate(t, positions[i], orientations[i]);
+        }
+        for (int i = 1; i < 3; i++)
+        {
+            if (!q_vec_equals(positions[0], positions[i]) ||
+                    !q_equals(orientations[0], orientations[i]))
+            {
+                errors++;
+                PRINT_ERROR_MESSAGE("Spline " << i << " differs at " << t);
+            }
+        }
+    }
+    return errors;
+}
+
+int testMemorySize()
+{
+    int errors = 0;
+    KeyframeSpline spline;
+    for (int i = 0; i < 1000; i++)
+    {
+        q_vec_type position;
+        q_type orientation;
+        getPoint(i, position, orientation);
+        spline.addPoint(i, position, orientation);
+    }
+    spline.compute();
+    qint64 bytesPerPoint = spline.getMemorySize() / 1000;
+    if (bytesPerPoint > 200)
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Spline uses " << bytesPerPoint
+                            << " bytes per keyframe");
+    }
+    return errors;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    int errors = 0;
+    errors += testPositions();
+    errors += testOrientations();
+    errors += testRecomputeAndCopy();
+    errors += testMemorySize();
+    return errors;
+}
@@ -0,0 +1,215 @@
+#include <iostream>
+using std::cout;
+using std::endl;
+
+#include <cstdlib>
+#include <iterator>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include <QMap>
+#include <QString>
+#include <QVector>
+
+#include <quat.h>
+
+#include <sketchtests.h>
+#include <keyframe.h>
+#include <keyframestore.h>
+
+static const ColorMapType::Type COLORS[3] = {
+    ColorMapType::SOLID_COLOR_RED, ColorMapType::BLUE_TO_RED,
+    ColorMapType::DIM_SOLID_COLOR_GREEN };
+// the objects' array names are shared by their keyframes, so share them here
+static const QString ARRAYS[2] = { "modelNum", "charge" };
+
+static Keyframe makeKeyframe(int i, bool grouped)
+{
+    q_vec_type pos, absPos;
+    q_type orient, absOr;
+    q_vec_set(pos, i * 2.0, (i % 5) * -1.0, i * 0.5);
+    q_from_axis_angle(orient, 0, 1, 0, i * 0.1);
+    q_vec_copy(absPos, pos);
+    q_copy(absOr, orient);
+    if (grouped)
+    {
+        absPos[Q_X] += 10.0;
+        q_from_axis_angle(absOr, 1, 0, 0, i * 0.2);
+    }
+    return Keyframe(pos, absPos, orient, absOr, COLORS[i % 3],
+                    ARRAYS[i % 2], grouped ? 1 : 0, NULL,
+                    i % 4 != 0, i % 7 != 0);
+}
+
+static int compareKeyframes(const Keyframe &expected, const KeyframeStore &store,
+                            int i)
+{
+    q_vec_type p1, p2;
+    q_type o1, o2;
+    expected.getPosition(p1);
+    store.getPosition(i, p2);
+    bool same = q_vec_equals(p1, p2);
+    expected.getAbsolutePosition(p1);
+    store.getAbsolutePosition(i, p2);
+    same = same && q_vec_equals(p1, p2);
+    expected.getOrientation(o1);
+    store.getOrientation(i, o2);
+    same = same && q_equals(o1, o2);
+    expected.getAbsoluteOrientation(o1);
+    store.getAbsoluteOrientation(i, o2);
+    same = same && q_equals(o1, o2);
+    same = same && expected.getColorMapType() ==
+                           store.getColorMap(i).first &&
+           expected.getArrayToColorBy() == store.getColorMap(i).second;
+    same = same && expected.isVisibleAfter() == store.isVisibleAfter(i) &&
+           expected.isActive() == store.isActive(i) &&
+           expected.getLevel() == store.getLevel(i) &&
+           expected.getParent() == store.getParent(i);
+    if (!same)
+    {
+        cout << "Keyframe " << i << " does not match" << endl;
+        return 1;
+    }
+    return 0;
+}
+
+// Inserting, replacing and removing keyframes should give the same keyframes
+// in the same order as a QMap
+int testMatchesMap()
+{
+    int errors = 0;
+    QMap< double, Keyframe > map;
+    KeyframeStore store;
+    srand(17);
+    for (int i = 0; i < 500; i++)
+    {
+        double t = (rand() % 200) * 0.25;
+        if (rand() % 4 == 0)
+        {
+            bool removed = store.remove(t);
+            if (removed != (map.remove(t) > 0))
+            {
+                errors++;
+                cout << "Remove at " << t << " gave the wrong result" << endl;
+            }
+        }
+        else
+        {
+            Keyframe frame = makeKeyframe(i, rand() % 3 == 0);
+            map.insert(t, frame);
+            store.insert(t, frame);
+        }
+    }
+    if (map.size() != store.size())
+    {
+        cout << "Wrong number of keyframes" << endl;
+        return errors + 1;
+    }
+    int i = 0;
+    for (QMap< double, Keyframe >::const_iterator it = map.constBegin();
+         it != map.constEnd(); ++it, ++i)
+    {
+        if (store.getTime(i) != it.key())
+        {
+            errors++;
+            cout << "Wrong time for keyframe " << i << endl;
+        }
+        errors += compareKeyframes(it.value(), store, i);
+        errors += compareKeyframes(store.getKeyframe(i), store, i);
+        if (store.indexOf(it.key()) != i)
+        {
+            errors++;
+            cout << "Wrong index for time " << it.key() << endl;
+        }
+    }
+    // seeking with a hint should find the same keyframes as without one
+    int hint = 0;
+    for (double t = -1.0; t < 52.0; t += 0.1)
+    {
+        int expected = store.lowerBound(t);
+        int index = std::distance(map.constBegin(), map.lowerBound(t));
+        if (store.lowerBound(t, hint) != expected || expected != index)
+        {
+            errors++;
+            cout << "Wrong keyframe found for time " << t << endl;
+        }
+    }
+    hint = store.size() - 1;
+    if (store.lowerBound(0.1, hint) != store.lowerBound(0.1))
+    {
+        errors++;
+        cout << "Seeking backward with a hint failed" << endl;
+    }
+    return errors;
+}
+
+// Returns the bytes currently allocated from the heap (including the
+// allocator's overhead), or -1 if that can't be measured on this platform
+static qint64 heapInUse()
+{
+#if defined(__GLIBC__) && \
+    (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    return mallinfo2().uordblks;
+#elif defined(__GLIBC__)
+    return mallinfo().uordblks;
+#else
+    return -1;
+#endif
+}
+
+// A sample animation of many objects with many keyframes each, mostly not
+// grouped and using a few color maps, should take less memory in the stores
+// than in maps.  Both are measured by how much the heap grows while they are
+// filled in.
+int testMemoryReport()
+{
+    const int numObjects = 50, numKeyframes = 200;
+    QVector< QMap< double, Keyframe > > maps(numObjects);
+    QVector< KeyframeStore > stores(numObjects);
+    qint64 before = heapInUse();
+    for (int j = 0; j < numObjects; j++)
+    {
+        for (int i = 0; i < numKeyframes; i++)
+        {
+            maps[j].insert(i * 0.5, makeKeyframe(i + j, (i + j) % 10 == 0));
+        }
+    }
+    qint64 mapSize = heapInUse() - before;
+    before = heapInUse();
+    qint64 estimate = 0;
+    for (int j = 0; j < numObjects; j++)
+    {
+        for (int i = 0; i < numKeyframes; i++)
+        {
+            stores[j].insert(i * 0.5, makeKeyframe(i + j, (i + j) % 10 == 0));
+        }
+        estimate += stores[j].getMemorySize();
+    }
+    qint64 storeSize = heapInUse() - before;
+    cout << numObjects << " objects with " << numKeyframes
+         << " keyframes each: ";
+    if (before < 0)
+    {
+        cout << "about " << estimate << " bytes in stores, the heap can't "
+             << "be measured on this platform" << endl;
+        return 0;
+    }
+    cout << storeSize << " bytes in stores (estimated " << estimate
+         << "), " << mapSize << " bytes in maps" << endl;
+    if (storeSize >= mapSize)
+    {
+        cout << "Stores are not smaller than maps" << endl;
+        return 1;
+    }
+    return 0;
+}
+
+int main()
+{
+    int errors = 0;
+    errors += testMatchesMap();
+    errors += testMemoryReport();
+    return errors;
+}
@@ -0,0 +1,155 @@
+#include <iostream>
+using std::cout;
+using std::endl;
+#define PRINT_ERROR_MESSAGE(x)  cout << x << endl
+
+#include <cmath>
+
+#include <QCoreApplication>
+#include <QVector>
+#include <QTime>
+
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+#include <vtkPointData.h>
+#include <vtkIntArray.h>
+#include <vtkFloatArray.h>
+#include <vtkSphereSource.h>
+
+#include <meshdecimator.h>
+
+#define SPHERE_RADIUS 10.0
+
+// Makes a sphere with the point arrays a model from a pdb file would have.
+// The top half is model 1 and the bottom half is model 2, chainPosition goes
+// from 0 to 1 from bottom to top and charge is -1 or 1 by which side of the
+// x=0 plane the point is on.
+static vtkSmartPointer< vtkPolyData > makeSphere(int resolution)
+{
+    vtkSmartPointer< vtkSphereSource > sphere =
+            vtkSmartPointer< vtkSphereSource >::New();
+    sphere->SetRadius(SPHERE_RADIUS);
+    sphere->SetThetaResolution(resolution);
+    sphere->SetPhiResolution(resolution);
+    sphere->Update();
+    vtkSmartPointer< vtkPolyData > data = vtkSmartPointer< vtkPolyData >::New();
+    data->DeepCopy(sphere->GetOutput());
+    int numPoints = data->GetNumberOfPoints();
+    vtkSmartPointer< vtkIntArray > modelNum =
+            vtkSmartPointer< vtkIntArray >::New();
+    modelNum->SetName("modelNum");
+    vtkSmartPointer< vtkFloatArray > chainPosition =
+            vtkSmartPointer< vtkFloatArray >::New();
+    chainPosition->SetName("chainPosition");
+    vtkSmartPointer< vtkFloatArray > charge =
+            vtkSmartPointer< vtkFloatArray >::New();
+    charge->SetName("charge");
+    for (int i = 0; i < numPoints; i++)
+    {
+        double p[3];
+        data->GetPoint(i, p);
+        modelNum->InsertNextValue(p[2] >= 0 ? 1 : 2);
+        chainPosition->InsertNextValue((p[2] + SPHERE_RADIUS) /
+                                       (2 * SPHERE_RADIUS));
+        charge->InsertNextValue(p[0] >= 0 ? 1.0 : -1.0);
+    }
+    data->GetPointData()->AddArray(modelNum);
+    data->GetPointData()->AddArray(chainPosition);
+    data->GetPointData()->AddArray(charge);
+    return data;
+}
+
+// Checks that the simplified sphere is still a sphere with the right number
+// of triangles and arrays that make sense
+static int checkLevel(vtkPolyData *level, int target)
+{
+    int errors = 0;
+    int numTris = level->GetNumberOfPolys();
+    if (numTris > 1.1 * target || numTris < 0.5 * target)
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Wrong number of triangles: " << numTris <<
+                            " for target " << target);
+    }
+    vtkIntArray *modelNum = vtkIntArray::SafeDownCast(
+                level->GetPointData()->GetArray("modelNum"));
+    vtkFloatArray *chainPosition = vtkFloatArray::SafeDownCast(
+                level->GetPointData()->GetArray("chainPosition"));
+    vtkFloatArray *charge = vtkFloatArray::SafeDownCast(
+                level->GetPointData()->GetArray("charge"));
+    if (modelNum == NULL || chainPosition == NULL || charge == NULL)
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Point arrays not kept.");
+        return errors;
+    }
+    int badPoints = 0, badValues = 0;
+    for (int i = 0; i < level->GetNumberOfPoints(); i++)
+    {
+        double p[3];
+        level->GetPoint(i, p);
+        double r = std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+        if (r < 0.9 * SPHERE_RADIUS || r > 1.05 * SPHERE_RADIUS)
+        {
+            badPoints++;
+        }
+        int m = modelNum->GetValue(i);
+        float c = charge->GetValue(i);
+        float pos = chainPosition->GetValue(i);
+        // values come from an input point, never a mix of two
+        if ((m != 1 && m != 2) || (c != 1.0f && c != -1.0f) ||
+                pos < 0.0f || pos > 1.0f)
+        {
+            badValues++;
+        }
+    }
+    if (badPoints > 0)
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE(badPoints << " points moved off the surface.");
+    }
+    if (badValues > 0)
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE(badValues << " points have interpolated values.");
+    }
+    return errors;
+}
+
+static int testDecimate(int resolution, bool parallel)
+{
+    int errors = 0;
+    vtkSmartPointer< vtkPolyData > sphere = makeSphere(resolution);
+    QVector< int > targets;
+    // out of order on purpose
+    targets << 2000 << 5000 << 1000;
+    QTime timer;
+    timer.start();
+    QVector< vtkSmartPointer< vtkPolyData > > levels =
+            MeshDecimator::decimate(sphere, targets, parallel);
+    cout << sphere->GetNumberOfPolys() << " triangles "
+         << (parallel ? "(parallel)" : "(serial)") << ": "
+         << timer.elapsed() << " ms" << endl;
+    if (levels.size() != targets.size())
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Wrong number of levels.");
+        return errors;
+    }
+    for (int i = 0; i < targets.size(); i++)
+    {
+        errors += checkLevel(levels[i], targets[i]);
+    }
+    return errors;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    int errors = 0;
+    errors += testDecimate(100, false);
+    errors += testDecimate(100, true);
+    // large enough to be split into partitions
+    errors += testDecimate(400, true);
+    return errors;
+}
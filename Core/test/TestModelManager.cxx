@@ -4,6 +4,7 @@ using std::endl;
 #define PRINT_ERROR_MESSAGE(x)  cout << x << endl
 
 #include <QDir>
+#include <QFile>
 #include <QScopedPointer>
 
 #include <vtkSmartPointer.h>
@@ -12,10 +13,12 @@ using std::endl;
 #include <modelutilities.h>
 #include <sketchmodel.h>
 #include <modelmanager.h>
+#include <sharedgeometry.h>
 
 #include "TestCoreHelpers.h"
 
 int testAddModels();
+int testSharedGeometry();
 
 int main(int argc, char *argv[])
 {
@@ -29,6 +32,7 @@ int main(int argc, char *argv[])
                  dir.absolutePath().toStdString().c_str() << endl;
     int errors = 0;
     errors += testAddModels();
+    errors += testSharedGeometry();
     return errors;
 }
 
@@ -111,3 +115,42 @@ int testAddModels()
     }
     return errors;
 }
+
+int testSharedGeometry()
+{
+    int errors = 0;
+    ModelManager manager;
+    QScopedPointer< SketchModel > sphere(TestCoreHelpers::getSphereModel());
+    QString file1 = sphere->getFileNameFor(0,ModelResolution::FULL_RESOLUTION);
+    // the same geometry in a different file under a different source
+    QString file2 = file1 + ".copy.vtk";
+    QFile::remove(file2);
+    QFile::copy(file1, file2);
+    SketchModel *model1 = manager.makeModel("sphere_source_1",file1,1.0,1.0);
+    SketchModel *model2 = manager.makeModel("sphere_source_2",file2,1.0,1.0);
+    if (model1 == model2 || manager.getNumberOfModels() != 2)
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Models with different sources were merged.");
+    }
+    if (model1->getSharedGeometry(0) != model2->getSharedGeometry(0) ||
+            model1->getCollisionModel(0) != model2->getCollisionModel(0))
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Identical geometry was not shared.");
+    }
+    if (manager.getSharedGeometryMemorySaved() !=
+            model1->getSharedGeometry(0)->getMemorySize())
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Wrong memory saved by sharing geometry.");
+    }
+    SketchModel *cube = TestCoreHelpers::getCubeModel();
+    manager.addModel(cube);
+    if (cube->getSharedGeometry(0) == model1->getSharedGeometry(0))
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Different geometry was shared.");
+    }
+    return errors;
+}
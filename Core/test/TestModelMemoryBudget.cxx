@@ -0,0 +1,97 @@
+#include <iostream>
+using std::cout;
+using std::endl;
+#define PRINT_ERROR_MESSAGE(x)  cout << x << endl
+
+#include <QCoreApplication>
+#include <QScopedPointer>
+#include <QSettings>
+#include <QDir>
+
+#include <vtkPolyData.h>
+#include <vtkPolyDataAlgorithm.h>
+
+#include <PQP.h>
+
+#include <sketchmodel.h>
+#include <colormaptype.h>
+#include <modelmemorybudget.h>
+
+#include "TestCoreHelpers.h"
+
+int testReleaseUnusedConformation()
+{
+    int errors = 0;
+    QScopedPointer< SketchModel > model(TestCoreHelpers::getCubeModel());
+    ColorMapType::ColorMap cmap(ColorMapType::BLUE_TO_RED, "chainPosition");
+    model->incrementUses(0);
+    model->getColoredSurfaceMapper(0, cmap);
+    if (model->getResidentBytes(0, ModelMemoryBudget::MAPPERS) == 0 ||
+            model->getResidentBytes(0, ModelMemoryBudget::COLLISION) == 0)
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Mapper or collision model not counted.");
+    }
+    ModelMemoryBudget::setBudget(0);
+    if (model->getResidentBytes(0, ModelMemoryBudget::MAPPERS) == 0 ||
+            model->getResidentBytes(0, ModelMemoryBudget::COLLISION) == 0)
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Memory released while conformation in use.");
+    }
+    // now that nothing uses it, it should be released to get under the budget
+    model->decrementUses(0);
+    if (model->getResidentBytes(0, ModelMemoryBudget::MAPPERS) != 0 ||
+            model->getResidentBytes(0, ModelMemoryBudget::SURFACE) != 0 ||
+            model->getResidentBytes(0, ModelMemoryBudget::COLLISION) != 0)
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Unused conformation not released.");
+    }
+    if (model->getResidentBytes(0, ModelMemoryBudget::SHARED_GEOMETRY) == 0)
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Full resolution geometry should stay resident.");
+    }
+    // everything should come back when it is used again
+    if (model->getVTKSurface(0)->GetOutput()->GetNumberOfPoints() == 0)
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Surface not restored after release.");
+    }
+    if (model->getCollisionModel(0)->num_tris == 0)
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Collision model not rebuilt after release.");
+    }
+    if (!ModelMemoryBudget::getReport().contains(model->getSource(0)))
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Model missing from memory report.");
+    }
+    return errors;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("Sketchbio");
+    app.setOrganizationName("UNC Computer Science");
+    app.setOrganizationDomain("sketchbio.org");
+    QDir dir = QDir::current();
+    // change the working dir to the dir where the test executable is
+    QString executable = dir.absolutePath() + "/" + argv[0];
+    int last = executable.lastIndexOf("/");
+    if (QDir::setCurrent(executable.left(last)))
+        dir = QDir::current();
+    cout << "Working directory: " <<
+                 dir.absolutePath().toStdString().c_str() << endl;
+    // the test changes the budget, so keep its settings in the test directory
+    // instead of the user's settings
+    QSettings::setDefaultFormat(QSettings::IniFormat);
+    QSettings::setPath(QSettings::IniFormat, QSettings::UserScope,
+                       dir.absoluteFilePath("memorybudget_test_settings"));
+    int errors = 0;
+    errors += testReleaseUnusedConformation();
+    return errors;
+}
@@ -0,0 +1,184 @@
+#include <iostream>
+using std::cout;
+using std::endl;
+#define PRINT_ERROR_MESSAGE(x)  cout << x << endl
+
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QFile>
+#include <QDir>
+
+#include <modelstore.h>
+
+#define STORE_TEST_DIR "modelstore_test"
+
+static void writeFile(const QString &name, const QByteArray &contents)
+{
+    QFile f(name);
+    f.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    f.write(contents);
+    f.close();
+}
+
+static QByteArray readFile(const QString &name)
+{
+    QFile f(name);
+    if (!f.open(QIODevice::ReadOnly))
+        return QByteArray();
+    return f.readAll();
+}
+
+int testAddFile(QDir &base)
+{
+    int errors = 0;
+    QString a = base.absoluteFilePath("a.vtk");
+    QString b = base.absoluteFilePath("b.vtk");
+    QString c = base.absoluteFilePath("c.vtk");
+    writeFile(a, "same contents");
+    writeFile(b, "same contents");
+    writeFile(c, "other contents");
+    QString entryA = ModelStore::addFile(a);
+    QString entryB = ModelStore::addFile(b);
+    QString entryC = ModelStore::addFile(c);
+    if (entryA.isEmpty() || entryC.isEmpty())
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Failed to add files to the store.");
+        return errors;
+    }
+    if (entryA != entryB)
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Same contents gave different store entries.");
+    }
+    if (entryA == entryC)
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Different contents gave the same store entry.");
+    }
+    if (readFile(entryC) != "other contents")
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Store entry has the wrong contents.");
+    }
+    return errors;
+}
+
+// Editing a file after it was added must not change the store entry, and an
+// entry that was changed in place must not be reused
+int testEditedFiles(QDir &base)
+{
+    int errors = 0;
+    QString src = base.absoluteFilePath("edited.vtk");
+    writeFile(src, "original data");
+    QString entry = ModelStore::addFile(src);
+    // rewrite the original in place
+    writeFile(src, "ORIGINAL DATA");
+    if (readFile(entry) != "original data")
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Editing the original changed the store entry.");
+    }
+    // change the entry in place, keeping its size.  The modification time
+    // has to change for the cached hash to be checked again, which may take
+    // up to a second on some filesystems
+    QDateTime added = QFileInfo(entry).lastModified();
+    do
+    {
+        writeFile(entry, "changed  data");
+    }
+    while (QFileInfo(entry).lastModified() == added);
+    writeFile(src, "original data");
+    QString newEntry = ModelStore::addFile(src);
+    if (newEntry != entry || readFile(newEntry) != "original data")
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("A changed store entry was reused.");
+    }
+    return errors;
+}
+
+int testPlaceFile(QDir &base)
+{
+    int errors = 0;
+    base.mkpath("proj1");
+    base.mkpath("proj2");
+    QString src = base.absoluteFilePath("model.vtk");
+    writeFile(src, "model data");
+    QString dst1 = base.absoluteFilePath("proj1/model.vtk");
+    QString dst2 = base.absoluteFilePath("proj2/model.vtk");
+    if (!ModelStore::placeFile(src, dst1) || !ModelStore::placeFile(src, dst2))
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Failed to place model file.");
+    }
+    if (readFile(dst1) != "model data" || readFile(dst2) != "model data")
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Placed file has the wrong contents.");
+    }
+    return errors;
+}
+
+int testLinkDir(QDir &base)
+{
+    int errors = 0;
+    base.mkpath("src/sub");
+    writeFile(base.absoluteFilePath("src/project.xml"), "<sketchbio/>");
+    writeFile(base.absoluteFilePath("src/sub/m.obj"), "obj data");
+    if (!ModelStore::linkDir(base.absoluteFilePath("src"),
+                             base.absoluteFilePath("dst")))
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Failed to link directory.");
+        return errors;
+    }
+    if (readFile(base.absoluteFilePath("dst/sub/m.obj")) != "obj data")
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Model file not linked into subdirectory.");
+    }
+    // the project file must be a real copy since it is rewritten in place
+    writeFile(base.absoluteFilePath("dst/project.xml"), "<changed/>");
+    if (readFile(base.absoluteFilePath("src/project.xml")) != "<sketchbio/>")
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Writing copied project file changed the original.");
+    }
+    // linking into a subdirectory of the source must not recurse forever
+    if (!ModelStore::linkDir(base.absoluteFilePath("src"),
+                             base.absoluteFilePath("src/sub/copy")))
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Failed to link directory into its own subdirectory.");
+    }
+    return errors;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("Sketchbio");
+    app.setOrganizationName("UNC Computer Science");
+    app.setOrganizationDomain("sketchbio.org");
+    QDir dir = QDir::current();
+    // change the working dir to the dir where the test executable is
+    QString executable = dir.absolutePath() + "/" + argv[0];
+    int last = executable.lastIndexOf("/");
+    if (QDir::setCurrent(executable.left(last)))
+        dir = QDir::current();
+    cout << "Working directory: " <<
+                 dir.absolutePath().toStdString().c_str() << endl;
+    dir.mkpath(STORE_TEST_DIR);
+    QDir base(dir.absoluteFilePath(STORE_TEST_DIR));
+    QString oldStore = ModelStore::getStoreDir();
+    ModelStore::setStoreDir(base.absoluteFilePath("store"));
+    int errors = 0;
+    errors += testAddFile(base);
+    errors += testEditedFiles(base);
+    errors += testPlaceFile(base);
+    errors += testLinkDir(base);
+    ModelStore::setStoreDir(oldStore);
+    return errors;
+}
@@ -0,0 +1,334 @@
+#include <iostream>
+using std::cout;
+using std::endl;
+#define PRINT_ERROR_MESSAGE(x)  cout << x << endl
+
+#include <QCoreApplication>
+#include <QBuffer>
+#include <QVector>
+#include <QHash>
+#include <QPair>
+#include <QTime>
+#include <QDir>
+
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+#include <vtkCellArray.h>
+#include <vtkPointData.h>
+#include <vtkDataArray.h>
+#include <vtkStringArray.h>
+
+#include <structurereader.h>
+#include <molecularsurface.h>
+
+#define TEST_PDB_FILE "models/4fun.pdb"
+#define TEST_PDB_ATOMS 47
+
+// two models of a two residue chain A with alternate locations for one atom,
+// a water and a chain B
+static const char *TEST_CIF =
+        "data_TEST\n"
+        "#\n"
+        "_entry.id TEST\n"
+        "#\n"
+        "loop_\n"
+        "_atom_site.group_PDB\n"
+        "_atom_site.id\n"
+        "_atom_site.type_symbol\n"
+        "_atom_site.label_atom_id\n"
+        "_atom_site.label_alt_id\n"
+        "_atom_site.label_comp_id\n"
+        "_atom_site.label_asym_id\n"
+        "_atom_site.label_seq_id\n"
+        "_atom_site.pdbx_PDB_ins_code\n"
+        "_atom_site.Cartn_x\n"
+        "_atom_site.Cartn_y\n"
+        "_atom_site.Cartn_z\n"
+        "_atom_site.occupancy\n"
+        "_atom_site.B_iso_or_equiv\n"
+        "_atom_site.auth_seq_id\n"
+        "_atom_site.auth_asym_id\n"
+        "_atom_site.pdbx_PDB_model_num\n"
+        "ATOM   1 N N   . ALA A 1 ? 1.0 2.0 3.0 1.00 10.0 5 X 1\n"
+        "ATOM   2 C CA  A ALA A 1 ? 2.0 2.0 3.0 0.50 11.0 5 X 1\n"
+        "ATOM   3 C CA  B ALA A 1 ? 2.1 2.0 3.0 0.50 11.0 5 X 1\n"
+        "ATOM   4 O \"O5'\" . DA A 2 ? 3.0 2.0 3.0 1.00 12.0 6 X 1\n"
+        "HETATM 5 O O   . HOH C . ? 9.0 9.0 9.0 1.00 20.0 7 X 1\n"
+        "ATOM   6 N N   . GLY B 1 ? 5.0 2.0 3.0 1.00 13.0 1 Y 1\n"
+        "ATOM   7 N N   . ALA A 1 ? 1.5 2.0 3.0 1.00 10.0 5 X 2\n"
+        "#\n"
+        "loop_\n"
+        "_atom_type.symbol\n"
+        "C\n"
+        "N\n"
+        "#\n";
+
+int testReadPDB()
+{
+    int errors = 0;
+    QVector< StructureReader::Atom > atoms;
+    if (!StructureReader::readStructure(TEST_PDB_FILE, atoms))
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Could not read " TEST_PDB_FILE);
+        return errors;
+    }
+    if (atoms.size() != TEST_PDB_ATOMS)
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Wrong number of atoms: " << atoms.size());
+        return errors;
+    }
+    const StructureReader::Atom &first = atoms[0];
+    if (first.name != "N" || first.element != "N" ||
+            first.residueName != "HIS" || first.residueNumber != 1 ||
+            first.hetero || first.position[0] != 49.668f ||
+            first.position[1] != 24.248f || first.position[2] != 10.436f ||
+            first.occupancy != 1.0f || first.bFactor != 25.0f)
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("First atom read wrong.");
+    }
+    // this file has other things in the element columns
+    if (atoms[44].name != "CE1" || atoms[44].element != "C")
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Element of atom 45 is " <<
+                            atoms[44].element.constData());
+    }
+    return errors;
+}
+
+int testReadMMCIF()
+{
+    int errors = 0;
+    QByteArray data(TEST_CIF);
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+    QVector< StructureReader::Atom > atoms;
+    if (!StructureReader::readMMCIF(buffer, atoms))
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Could not read mmCIF data.");
+        return errors;
+    }
+    // only the first model and the first alternate location
+    if (atoms.size() != 5)
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Wrong number of mmCIF atoms: " << atoms.size());
+        return errors;
+    }
+    if (atoms[1].name != "CA" || atoms[1].position[0] != 2.0f ||
+            atoms[1].element != "C" || atoms[1].occupancy != 0.5f)
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Wrong alternate location used.");
+    }
+    if (atoms[0].chainId != "X" || atoms[0].residueNumber != 5)
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Author chain and residue number not used.");
+    }
+    if (atoms[2].name != "O5'" || atoms[2].residueName != "DA")
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Quoted atom name read as " <<
+                            atoms[2].name.constData());
+    }
+    if (!atoms[3].hetero || atoms[4].hetero)
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Wrong atoms marked as hetero.");
+    }
+    StructureReader::removeSolvent(atoms);
+    if (atoms.size() != 4 || atoms[3].residueName != "GLY")
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Water not removed.");
+    }
+    StructureReader::removeChains(atoms, "y");
+    if (atoms.size() != 3 || atoms[2].chainId != "X")
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Chain Y not removed.");
+    }
+    // digits are not chain ids to delete (Chimera ignores them too)
+    atoms[0].chainId = "1";
+    StructureReader::removeChains(atoms, "1");
+    if (atoms.size() != 3)
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Chain with a digit id removed.");
+    }
+    return errors;
+}
+
+static vtkDataArray *getArray(vtkPolyData *model, const char *name, int &errors)
+{
+    vtkDataArray *array = model->GetPointData()->GetArray(name);
+    if (array == NULL)
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Missing array " << name);
+    }
+    return array;
+}
+
+// Checks that no edge of the surface is in more than two triangles (marching
+// cubes can leave small holes where it can't tell how a cell is split, but
+// should never make anything else)
+static int checkManifold(vtkPolyData *model)
+{
+    QHash< QPair< vtkIdType, vtkIdType >, int > edges;
+    vtkCellArray *polys = model->GetPolys();
+    vtkIdType npts, *pts;
+    for (polys->InitTraversal(); polys->GetNextCell(npts, pts);)
+    {
+        for (int i = 0; i < npts; i++)
+        {
+            vtkIdType a = pts[i], b = pts[(i + 1) % npts];
+            edges[qMakePair(qMin(a, b), qMax(a, b))]++;
+        }
+    }
+    int nonManifold = 0;
+    foreach(int count, edges)
+    {
+        if (count > 2)
+        {
+            nonManifold++;
+        }
+    }
+    if (nonManifold > 0)
+    {
+        PRINT_ERROR_MESSAGE(nonManifold << " edges in more than two triangles.");
+        return 1;
+    }
+    return 0;
+}
+
+int testMakeModel(bool parallel)
+{
+    int errors = 0;
+    QVector< StructureReader::Atom > atoms;
+    StructureReader::readStructure(TEST_PDB_FILE, atoms);
+    QTime timer;
+    timer.start();
+    vtkSmartPointer< vtkPolyData > model =
+            MolecularSurface::makeModel(atoms, 0, parallel);
+    cout << "Surface " << (parallel ? "(parallel)" : "(serial)") << ": "
+         << model->GetNumberOfPolys() << " triangles in " << timer.elapsed()
+         << " ms" << endl;
+    if (model->GetNumberOfPolys() == 0)
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("No surface made.");
+        return errors;
+    }
+    if (model->GetNumberOfLines() < TEST_PDB_ATOMS - 1)
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Only " << model->GetNumberOfLines() << " bonds.");
+    }
+    vtkDataArray *modelNum = getArray(model, "modelNum", errors);
+    vtkDataArray *atomNum = getArray(model, "atomNum", errors);
+    vtkDataArray *resNum = getArray(model, "resNum", errors);
+    vtkDataArray *chainPosition = getArray(model, "chainPosition", errors);
+    vtkDataArray *charge = getArray(model, "charge", errors);
+    getArray(model, "bFactor", errors);
+    getArray(model, "occupancy", errors);
+    vtkDataArray *normals = model->GetPointData()->GetNormals();
+    if (vtkStringArray::SafeDownCast(
+                model->GetPointData()->GetAbstractArray("resType")) == NULL ||
+            vtkStringArray::SafeDownCast(
+                model->GetPointData()->GetAbstractArray("atomType")) == NULL)
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Missing string arrays.");
+    }
+    if (errors > 0 || normals == NULL)
+    {
+        PRINT_ERROR_MESSAGE("Missing normals or arrays.");
+        return errors + 1;
+    }
+    // the atoms come first
+    for (int i = 0; i < TEST_PDB_ATOMS; i++)
+    {
+        if (modelNum->GetTuple1(i) != 0 || atomNum->GetTuple1(i) != i)
+        {
+            errors++;
+            PRINT_ERROR_MESSAGE("Atom " << i << " has the wrong modelNum or atomNum");
+            break;
+        }
+    }
+    if (chainPosition->GetTuple1(0) != 0.0 ||
+            chainPosition->GetTuple1(TEST_PDB_ATOMS - 1) != 1.0 ||
+            resNum->GetTuple1(TEST_PDB_ATOMS - 1) != 5)
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Wrong chain positions of the termini.");
+    }
+    // the only charge is the N-terminus, so the potential is positive
+    // everywhere, and the normals should point away from the atoms
+    int inward = 0;
+    for (vtkIdType p = TEST_PDB_ATOMS; p < model->GetNumberOfPoints(); p++)
+    {
+        if (modelNum->GetTuple1(p) != 1)
+        {
+            errors++;
+            PRINT_ERROR_MESSAGE("Surface point " << p << " has modelNum "
+                                << modelNum->GetTuple1(p));
+            break;
+        }
+        if (charge->GetTuple1(p) <= 0.0)
+        {
+            errors++;
+            PRINT_ERROR_MESSAGE("Surface point " << p << " has charge "
+                                << charge->GetTuple1(p));
+            break;
+        }
+        double point[3], atom[3], n[3];
+        model->GetPoint(p, point);
+        model->GetPoint((vtkIdType) atomNum->GetTuple1(p), atom);
+        normals->GetTuple(p, n);
+        if ((point[0] - atom[0]) * n[0] + (point[1] - atom[1]) * n[1] +
+                (point[2] - atom[2]) * n[2] < 0.0)
+        {
+            inward++;
+        }
+    }
+    if (inward > model->GetNumberOfPoints() / 100)
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE(inward << " normals point toward their atom.");
+    }
+    errors += checkManifold(model);
+    // lower resolutions are simpler
+    vtkSmartPointer< vtkPolyData > lowResolution =
+            MolecularSurface::makeModel(atoms, 5, parallel);
+    if (lowResolution->GetNumberOfPolys() == 0 ||
+            lowResolution->GetNumberOfPolys() >= model->GetNumberOfPolys())
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Low resolution surface has " <<
+                            lowResolution->GetNumberOfPolys() << " triangles.");
+    }
+    errors += checkManifold(lowResolution);
+    return errors;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QDir dir = QDir::current();
+    // change the working dir to the dir where the test executable is
+    QString executable = dir.absolutePath() + "/" + argv[0];
+    int last = executable.lastIndexOf("/");
+    QDir::setCurrent(executable.left(last));
+    int errors = 0;
+    errors += testReadPDB();
+    errors += testReadMMCIF();
+    errors += testMakeModel(false);
+    errors += testMakeModel(true);
+    return errors;
+}
@@ -0,0 +1,192 @@
+#include <iostream>
+using std::cout;
+using std::endl;
+#define PRINT_ERROR_MESSAGE(x)  cout << x << endl
+
+#include <QCoreApplication>
+#include <QScopedPointer>
+#include <QString>
+#include <QTime>
+#include <QDir>
+
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+#include <vtkPolyDataAlgorithm.h>
+#include <vtkCellArray.h>
+#include <vtkSphereSource.h>
+
+#include <PQP.h>
+
+#include <modelutilities.h>
+#include <pqpbuilder.h>
+
+// Builds the model the way makePQP_Model used to, through AddTri and
+// EndModel.  This is the reference the builder is compared against.
+static void buildWithAddTri(PQP_Model *m, vtkPolyData *polyData)
+{
+    vtkCellArray *polys = polyData->GetPolys();
+    m->BeginModel();
+    vtkIdType nvertices, *pvertices, loc = 0;
+    PQP_REAL p1[3], p2[3], p3[3];
+    double p[3];
+    int triId = 0;
+    for (int i = 0; i < polyData->GetNumberOfPolys(); i++)
+    {
+        polys->GetCell(loc, nvertices, pvertices);
+        polyData->GetPoint(pvertices[0], p);
+        p1[0] = p[0]; p1[1] = p[1]; p1[2] = p[2];
+        for (int j = 2; j < nvertices; j++)
+        {
+            polyData->GetPoint(pvertices[j - 1], p);
+            p2[0] = p[0]; p2[1] = p[1]; p2[2] = p[2];
+            polyData->GetPoint(pvertices[j], p);
+            p3[0] = p[0]; p3[1] = p[1]; p3[2] = p[2];
+            m->AddTri(p1, p2, p3, triId++);
+        }
+        loc += nvertices + 1;
+    }
+    m->EndModel();
+    for (int i = 0; i < m->num_tris; i++)
+        m->tris[i].id = i;
+}
+
+// Returns true if the two models have the same triangles and trees
+static bool sameModel(PQP_Model *a, PQP_Model *b)
+{
+    if (a->num_tris != b->num_tris || a->num_bvs != b->num_bvs)
+        return false;
+    for (int i = 0; i < a->num_tris; i++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            if (a->tris[i].p1[k] != b->tris[i].p1[k] ||
+                    a->tris[i].p2[k] != b->tris[i].p2[k] ||
+                    a->tris[i].p3[k] != b->tris[i].p3[k])
+                return false;
+        }
+    }
+    for (int i = 0; i < a->num_bvs; i++)
+    {
+        if (a->b[i].first_child != b->b[i].first_child)
+            return false;
+        for (int j = 0; j < 3; j++)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                if (a->b[i].R[j][k] != b->b[i].R[j][k])
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Returns the number of triangle pairs in contact when the second copy of
+// the model is moved by the given offset
+static int countContacts(PQP_Model *a, PQP_Model *b, const PQP_REAL offset[3])
+{
+    PQP_REAL r[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+    PQP_REAL t1[3] = {0, 0, 0};
+    PQP_REAL t2[3] = {offset[0], offset[1], offset[2]};
+    PQP_CollideResult cr;
+    PQP_Collide(&cr, r, t1, a, r, t2, b, PQP_ALL_CONTACTS);
+    return cr.NumPairs();
+}
+
+// Builds the model with the old code and the builder (serial and parallel),
+// prints the times and checks that they all give the same results.
+static int testBuild(const char *name, vtkPolyData *polyData,
+                     const PQP_REAL offset[3])
+{
+    int errors = 0;
+    QScopedPointer< PQP_Model > reference(new PQP_Model());
+    QScopedPointer< PQP_Model > serial(new PQP_Model());
+    QScopedPointer< PQP_Model > parallel(new PQP_Model());
+    QTime timer;
+    timer.start();
+    buildWithAddTri(reference.data(), polyData);
+    int referenceTime = timer.restart();
+    PQPBuilder::buildModel(serial.data(), polyData, false);
+    int serialTime = timer.restart();
+    PQPBuilder::buildModel(parallel.data(), polyData, true);
+    int parallelTime = timer.elapsed();
+    cout << name << ": " << reference->num_tris << " triangles, AddTri "
+         << referenceTime << " ms, builder " << serialTime
+         << " ms, parallel builder " << parallelTime << " ms" << endl;
+
+    if (serial->num_tris != reference->num_tris ||
+            serial->num_bvs != reference->num_bvs)
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Builder gave a different model size for " << name);
+    }
+    if (!sameModel(serial.data(), parallel.data()))
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Parallel build gave a different tree for " << name);
+    }
+    int referenceContacts = countContacts(reference.data(), reference.data(),
+                                          offset);
+    int builderContacts = countContacts(parallel.data(), parallel.data(),
+                                        offset);
+    if (referenceContacts == 0 || referenceContacts != builderContacts)
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Collision results differ for " << name << ": "
+                            << referenceContacts << " vs " << builderContacts);
+    }
+    return errors;
+}
+
+int testModel1m1j()
+{
+    vtkSmartPointer< vtkPolyDataAlgorithm > source;
+    source.TakeReference(ModelUtilities::read("models/1m1j.obj"));
+    source->Update();
+    PQP_REAL offset[3] = {5, 0, 0};
+    return testBuild("1m1j", source->GetOutput(), offset);
+}
+
+int testLargeSurface()
+{
+    // about 500000 triangles
+    vtkSmartPointer< vtkSphereSource > sphere =
+            vtkSmartPointer< vtkSphereSource >::New();
+    sphere->SetRadius(10.0);
+    sphere->SetThetaResolution(500);
+    sphere->SetPhiResolution(500);
+    sphere->Update();
+    PQP_REAL offset[3] = {19.5, 0, 0};
+    return testBuild("sphere", sphere->GetOutput(), offset);
+}
+
+int testEmpty()
+{
+    int errors = 0;
+    vtkSmartPointer< vtkPolyData > empty = vtkSmartPointer< vtkPolyData >::New();
+    QScopedPointer< PQP_Model > m(new PQP_Model());
+    if (PQPBuilder::buildModel(m.data(), empty))
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Built a model with no triangles.");
+    }
+    return errors;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QDir dir = QDir::current();
+    // change the working dir to the dir where the test executable is
+    QString executable = dir.absolutePath() + "/" + argv[0];
+    int last = executable.lastIndexOf("/");
+    if (QDir::setCurrent(executable.left(last)))
+        dir = QDir::current();
+    cout << "Working directory: " <<
+                 dir.absolutePath().toStdString().c_str() << endl;
+    int errors = 0;
+    errors += testModel1m1j();
+    errors += testLargeSurface();
+    errors += testEmpty();
+    return errors;
+}
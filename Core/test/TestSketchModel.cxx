@@ -8,7 +8,10 @@
 #include <vtkSphereSource.h>
 #include <vtkCubeSource.h>
 
+#include <QCoreApplication>
 #include <QScopedPointer>
+#include <QEventLoop>
+#include <QTimer>
 #include <QDir>
 #include <QDebug>
 
@@ -18,10 +21,12 @@
 int testUseCount();
 int testAddResolutionFileAndChangeResolutions();
 int testAddConformations();
+int testBackgroundResolutionLoad();
 
 // The main method for the program that tests the SketchModel class
 int main(int argc, char *argv[])
 {
+    QCoreApplication app(argc, argv);
     int errors = 0;
     // setup
     QDir dir = QDir::current();
@@ -37,6 +42,7 @@ int main(int argc, char *argv[])
     errors += testAddConformations();
     errors += testUseCount();
     errors += testAddResolutionFileAndChangeResolutions();
+    errors += testBackgroundResolutionLoad();
 
     // return result of tests
     return errors;
@@ -132,6 +138,63 @@ int testAddResolutionFileAndChangeResolutions()
     return retVal;
 }
 
+int testBackgroundResolutionLoad()
+{
+    int retVal = 0;
+    QScopedPointer< SketchModel > model(new SketchModel(1,1));
+    QString filename = "models/1m1j.obj";
+    model->addConformation(filename,filename);
+    int fullPoints = model->getVTKSource(0)->GetOutput()->GetNumberOfPoints();
+
+    vtkSmartPointer< vtkCubeSource > cube =
+            vtkSmartPointer< vtkCubeSource >::New();
+    cube->SetBounds(-1,1,-1,1,-1,1);
+    cube->Update();
+    filename = ModelUtilities::createFileFromVTKSource(cube,"models/cube_for_async_test");
+    model->addSurfaceFileForResolution(0,ModelResolution::SIMPLIFIED_5000,filename);
+    // enough uses to switch to the 5000 triangle resolution
+    for (int i = 0; i < 6; i++)
+    {
+        model->incrementUses(0);
+    }
+    if (!model->isLoadingResolution(0))
+    {
+        retVal++;
+        qDebug() << "New resolution not loading in the background.";
+    }
+    if (model->getResolutionLevel(0) != ModelResolution::FULL_RESOLUTION ||
+            model->getVTKSource(0)->GetOutput()->GetNumberOfPoints() != fullPoints)
+    {
+        retVal++;
+        qDebug() << "Resolution changed before the background load finished.";
+    }
+    QEventLoop loop;
+    QObject::connect(model.data(),
+                     SIGNAL(resolutionChanged(int,ModelResolution::ResolutionType)),
+                     &loop, SLOT(quit()));
+    QTimer::singleShot(30000, &loop, SLOT(quit()));
+    loop.exec();
+    if (model->isLoadingResolution(0) ||
+            model->getResolutionLevel(0) != ModelResolution::SIMPLIFIED_5000)
+    {
+        retVal++;
+        qDebug() << "Background resolution load did not finish.";
+    }
+    if (model->getVTKSource(0)->GetOutput()->GetNumberOfPoints() == fullPoints)
+    {
+        retVal++;
+        qDebug() << "Data not switched after the background load.";
+    }
+    // a second use should not start another load of the same resolution
+    model->incrementUses(0);
+    if (model->isLoadingResolution(0))
+    {
+        retVal++;
+        qDebug() << "Current resolution loaded again.";
+    }
+    return retVal;
+}
+
 inline int testConformationAdded(SketchModel *model,int confNum)
 {
     int retVal = 0;
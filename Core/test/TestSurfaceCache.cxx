@@ -0,0 +1,246 @@
+#include <iostream>
+using std::cout;
+using std::endl;
+#define PRINT_ERROR_MESSAGE(x)  cout << x << endl
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QFile>
+#include <QDir>
+#include <QMap>
+
+#include <modelstore.h>
+#include <surfacecache.h>
+
+#define CACHE_TEST_DIR "surfacecache_test"
+
+static void writeFile(const QString &name, const QByteArray &contents)
+{
+    QFile f(name);
+    f.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    f.write(contents);
+    f.close();
+}
+
+static QByteArray readFile(const QString &name)
+{
+    QFile f(name);
+    if (!f.open(QIODevice::ReadOnly))
+        return QByteArray();
+    return f.readAll();
+}
+
+// the last used times are in milliseconds, so wait for the clock to move on
+// to make sure entries used one after the other have different times
+static void waitForClockTick()
+{
+    qint64 start = QDateTime::currentMSecsSinceEpoch();
+    while (QDateTime::currentMSecsSinceEpoch() <= start + 1)
+        ;
+}
+
+// adds an entry with one file of the given size
+static bool addEntryOfSize(QDir &base, const QString &key, int size)
+{
+    QString src = base.absoluteFilePath("src_" + key.left(8) + ".vtk");
+    writeFile(src, QByteArray(size, 'x'));
+    QMap< QString, QString > files;
+    files.insert(SurfaceCache::surfaceFileName(0), src);
+    return SurfaceCache::addEntry(key, files);
+}
+
+int testMakeKey(QDir &base)
+{
+    int errors = 0;
+    QString key = SurfaceCache::makeKey("1ABC", "bA", false);
+    if (key != SurfaceCache::makeKey("1abc", "AB", false))
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Case or order of chains changed the key.");
+    }
+    if (key == SurfaceCache::makeKey("1abc", "AB", true))
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Biological unit did not change the key.");
+    }
+    if (key == SurfaceCache::makeKey("1abc", "A", false))
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Chains did not change the key.");
+    }
+    if (key == SurfaceCache::makeKey("2abc", "AB", false))
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("PDB id did not change the key.");
+    }
+    if (key == SurfaceCache::makeKey("1abc", "AB", false,
+                                     SurfaceCache::NATIVE_SURFACES))
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Surface tool did not change the key.");
+    }
+    // local files are keyed by their contents
+    QString pdb = base.absoluteFilePath("local.pdb");
+    writeFile(pdb, "ATOM 1");
+    QString fileKey = SurfaceCache::makeKey(pdb, "", false);
+    QFile::remove(pdb);
+    writeFile(pdb, "ATOM 2");
+    if (fileKey == SurfaceCache::makeKey(pdb, "", false))
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Changing a local file did not change the key.");
+    }
+    return errors;
+}
+
+int testAddAndFind(QDir &base)
+{
+    int errors = 0;
+    SurfaceCache::clear();
+    QString key = SurfaceCache::makeKey("1abc", "", false);
+    if (!SurfaceCache::findEntry(key).isEmpty())
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Found an entry in an empty cache.");
+    }
+    QString full = base.absoluteFilePath("full.vtk");
+    QString level = base.absoluteFilePath("level.vtk");
+    writeFile(full, "full surface");
+    writeFile(level, "simplified surface");
+    QMap< QString, QString > files;
+    files.insert(SurfaceCache::surfaceFileName(0), full);
+    files.insert(SurfaceCache::simplifiedFileName(5, 1000), level);
+    if (!SurfaceCache::addEntry(key, files))
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Failed to add entry.");
+        return errors;
+    }
+    QString entry = SurfaceCache::findEntry(key);
+    if (entry.isEmpty())
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Added entry not found.");
+        return errors;
+    }
+    QDir entryDir(entry);
+    if (readFile(entryDir.absoluteFilePath(SurfaceCache::surfaceFileName(0)))
+            != "full surface" ||
+            readFile(entryDir.absoluteFilePath(
+                         SurfaceCache::simplifiedFileName(5, 1000)))
+            != "simplified surface")
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Cached files have the wrong contents.");
+    }
+    // the cache must not change when the original is replaced (the way
+    // ModelUtilities::createFileFromVTKSource does it)
+    QFile::remove(full);
+    writeFile(full, "new surface");
+    if (readFile(entryDir.absoluteFilePath(SurfaceCache::surfaceFileName(0)))
+            != "full surface")
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Replacing the original changed the cached file.");
+    }
+    // adding again replaces the entry
+    files.remove(SurfaceCache::simplifiedFileName(5, 1000));
+    if (!SurfaceCache::addEntry(key, files) ||
+            readFile(QDir(SurfaceCache::findEntry(key)).absoluteFilePath(
+                         SurfaceCache::surfaceFileName(0))) != "new surface" ||
+            QFile(QDir(SurfaceCache::findEntry(key)).absoluteFilePath(
+                      SurfaceCache::simplifiedFileName(5, 1000))).exists())
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Adding an entry again did not replace it.");
+    }
+    return errors;
+}
+
+int testEviction(QDir &base)
+{
+    int errors = 0;
+    SurfaceCache::clear();
+    qint64 oldMax = SurfaceCache::getMaxSize();
+    // room for three entries (plus their last used files)
+    SurfaceCache::setMaxSize(3 * 1100);
+    QString a = SurfaceCache::makeKey("aaaa", "", false);
+    QString b = SurfaceCache::makeKey("bbbb", "", false);
+    QString c = SurfaceCache::makeKey("cccc", "", false);
+    QString d = SurfaceCache::makeKey("dddd", "", false);
+    addEntryOfSize(base, a, 1000);
+    waitForClockTick();
+    addEntryOfSize(base, b, 1000);
+    waitForClockTick();
+    addEntryOfSize(base, c, 1000);
+    waitForClockTick();
+    // using a makes b the least recently used
+    SurfaceCache::findEntry(a);
+    waitForClockTick();
+    addEntryOfSize(base, d, 1000);
+    if (SurfaceCache::findEntry(a).isEmpty() ||
+            SurfaceCache::findEntry(c).isEmpty() ||
+            SurfaceCache::findEntry(d).isEmpty())
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Recently used entry was evicted.");
+    }
+    if (!SurfaceCache::findEntry(b).isEmpty())
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Least recently used entry was not evicted.");
+    }
+    if (SurfaceCache::getCacheSize() > 3 * 1100)
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Cache is bigger than its limit.");
+    }
+    // an entry bigger than the whole cache is not kept
+    addEntryOfSize(base, b, 4000);
+    if (!SurfaceCache::findEntry(b).isEmpty())
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Entry bigger than the cache was kept.");
+    }
+    // a size limit of zero turns the cache off
+    SurfaceCache::setMaxSize(0);
+    if (addEntryOfSize(base, b, 10) || !SurfaceCache::findEntry(a).isEmpty())
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Cache used when turned off.");
+    }
+    SurfaceCache::setMaxSize(oldMax);
+    SurfaceCache::clear();
+    if (SurfaceCache::getCacheSize() != 0)
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Cache not empty after clear.");
+    }
+    return errors;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("Sketchbio");
+    app.setOrganizationName("UNC Computer Science");
+    app.setOrganizationDomain("sketchbio.org");
+    QDir dir = QDir::current();
+    // change the working dir to the dir where the test executable is
+    QString executable = dir.absolutePath() + "/" + argv[0];
+    int last = executable.lastIndexOf("/");
+    if (QDir::setCurrent(executable.left(last)))
+        dir = QDir::current();
+    cout << "Working directory: " <<
+                 dir.absolutePath().toStdString().c_str() << endl;
+    dir.mkpath(CACHE_TEST_DIR);
+    QDir base(dir.absoluteFilePath(CACHE_TEST_DIR));
+    QString oldCache = SurfaceCache::getCacheDir();
+    SurfaceCache::setCacheDir(base.absoluteFilePath("cache"));
+    int errors = 0;
+    errors += testMakeKey(base);
+    errors += testAddAndFind(base);
+    errors += testEviction(base);
+    SurfaceCache::setCacheDir(oldCache);
+    return errors;
+}
@@ -6,9 +6,11 @@ using std::endl;
 #include <quat.h>
 
 #include <QScopedPointer>
+#include <QTime>
 
 #include <vtkSmartPointer.h>
 #include <vtkRenderer.h>
+#include <vtkPropCollection.h>
 
 #include <sketchmodel.h>
 #include <modelinstance.h>
@@ -22,6 +24,12 @@ using std::endl;
 int testRemoveObject();
 int testDeleteObject();
 int testSelection();
+int testBakeAnimation();
+int testBakeAnimationLimits();
+int testBakeAnimationGrouping();
+int testParallelAnimation();
+int testKeyframeOutlines();
+int testAnimationChanges();
 
 // Tests of bugs
 int testSelectionBug();
@@ -33,6 +41,12 @@ int main()
   errors += testRemoveObject();
   errors += testDeleteObject();
   errors += testSelection();
+  errors += testBakeAnimation();
+  errors += testBakeAnimationLimits();
+  errors += testBakeAnimationGrouping();
+  errors += testParallelAnimation();
+  errors += testKeyframeOutlines();
+  errors += testAnimationChanges();
   errors += testSelectionBug();
   errors += testClearDisplayListBug();
   return errors;
@@ -249,3 +263,369 @@ int testClearDisplayListBug()
   assert(!renderer->HasViewProp(actor3));
   return (renderer->HasViewProp(actor1) || renderer->HasViewProp(actor3)) ? 1 : 0;
 }
+
+// Keyframes two objects moving around and checks that the baked animation
+// gives the same states as computing them and that changing one object's
+// keyframes only invalidates that object
+int testBakeAnimation()
+{
+  int errors = 0;
+  QScopedPointer< SketchModel > model(TestCoreHelpers::getCubeModel());
+  vtkSmartPointer< vtkRenderer > renderer =
+      vtkSmartPointer< vtkRenderer >::New();
+  QScopedPointer< WorldManager > world(new WorldManager(renderer));
+  SketchObject *objs[2];
+  q_vec_type start = Q_NULL_VECTOR;
+  q_type startOrient = Q_ID_QUAT;
+  for (int i = 0; i < 2; i++) {
+    objs[i] = world->addObject(model.data(), start, startOrient);
+    for (int k = 0; k < 4; k++) {
+      q_vec_type pos = {k * 2.0, i * 3.0 - k, k * k * 0.5};
+      q_type orient;
+      q_from_axis_angle(orient, 0, 1, i, k * 0.7);
+      objs[i]->setPosAndOrient(pos, orient);
+      objs[i]->addKeyframeForCurrentLocation(k * 0.9);
+    }
+  }
+  world->bakeAnimation(10.0);
+  const AnimationCache &cache = world->getAnimationCache();
+  // 0 to 2.7 seconds at 10 frames per second
+  if (cache.getNumberOfFrames() != 28 || cache.getNumberOfObjects() != 2) {
+    errors++;
+    cout << "Baked " << cache.getNumberOfFrames() << " frames of "
+         << cache.getNumberOfObjects() << " objects" << endl;
+  }
+  for (int frame = 0; frame < cache.getNumberOfFrames(); frame += 3) {
+    double t = frame / 10.0;
+    world->setAnimationTime(t);
+    for (int i = 0; i < 2; i++) {
+      AnimationState live, baked;
+      objs[i]->computeAnimationState(t, live);
+      q_vec_type pos;
+      q_type orient;
+      objs[i]->getPosition(pos);
+      objs[i]->getOrientation(orient);
+      if (!cache.load(frame, objs[i], baked) ||
+          !q_vec_equals(pos, live.position) ||
+          !q_equals(orient, live.orientation)) {
+        errors++;
+        cout << "Baked state of object " << i << " wrong at " << t << endl;
+      }
+    }
+  }
+  // between frames the states are interpolated from the frames around them,
+  // unless there is a keyframe in the way
+  double times[2] = {0.15, 0.85};
+  for (int j = 0; j < 2; j++) {
+    world->setAnimationTime(times[j]);
+    for (int i = 0; i < 2; i++) {
+      AnimationState live, between;
+      objs[i]->computeAnimationState(times[j], live);
+      q_vec_type pos;
+      objs[i]->getPosition(pos);
+      bool interpolated = cache.loadBetween(times[j], objs[i], between);
+      if (interpolated != (j == 0) || !q_vec_equals(pos, live.position, 0.05)) {
+        errors++;
+        cout << "State of object " << i << " wrong between frames at "
+             << times[j] << endl;
+      }
+    }
+  }
+  AnimationState state;
+  objs[1]->removeKeyframeForTime(0.9);
+  if (!cache.load(5, objs[0], state) || cache.load(5, objs[1], state)) {
+    errors++;
+    cout << "Changing keyframes invalidated the wrong objects" << endl;
+  }
+  world->bakeAnimation(10.0);
+  if (!cache.load(5, objs[0], state) || !cache.load(5, objs[1], state)) {
+    errors++;
+    cout << "Rebaking did not fill in the changed object" << endl;
+  }
+  return errors;
+}
+
+// Bakes the animation a frame at a time, then with no memory for any frames.
+// Frames that are not baked should still be computed correctly.
+int testBakeAnimationLimits()
+{
+  int errors = 0;
+  QScopedPointer< SketchModel > model(TestCoreHelpers::getCubeModel());
+  vtkSmartPointer< vtkRenderer > renderer =
+      vtkSmartPointer< vtkRenderer >::New();
+  QScopedPointer< WorldManager > world(new WorldManager(renderer));
+  SketchObject *objs[2];
+  q_vec_type start = Q_NULL_VECTOR;
+  q_type startOrient = Q_ID_QUAT;
+  for (int i = 0; i < 2; i++) {
+    objs[i] = world->addObject(model.data(), start, startOrient);
+    for (int k = 0; k < 4; k++) {
+      q_vec_type pos = {k * 2.0, i * 3.0 - k, k * k * 0.5};
+      q_type orient;
+      q_from_axis_angle(orient, 0, 1, i, k * 0.7);
+      objs[i]->setPosAndOrient(pos, orient);
+      objs[i]->addKeyframeForCurrentLocation(k * 0.9);
+    }
+  }
+  const AnimationCache &cache = world->getAnimationCache();
+  AnimationState state;
+  // two samples per call is one frame of both objects
+  int calls = 1;
+  bool done = world->bakeAnimation(10.0, 2);
+  if (done || !cache.load(0, objs[0], state) || cache.load(1, objs[0], state)) {
+    errors++;
+    cout << "First step of the bake did not bake only the first frame" << endl;
+  }
+  while (!done && calls < 100) {
+    done = world->bakeAnimation(10.0, 2);
+    calls++;
+  }
+  if (calls != 28 || !cache.load(27, objs[1], state)) {
+    errors++;
+    cout << "Baking a frame at a time took " << calls << " calls" << endl;
+  }
+  world->setAnimationCacheMaxSize(0);
+  if (!world->bakeAnimation(10.0) || cache.getNumberOfCachedFrames() != 0 ||
+      cache.getNumberOfFrames() != 28) {
+    errors++;
+    cout << "Cache over its memory limit" << endl;
+  }
+  for (int frame = 0; frame < cache.getNumberOfFrames(); frame += 3) {
+    double t = frame / 10.0;
+    world->setAnimationTime(t);
+    for (int i = 0; i < 2; i++) {
+      AnimationState live;
+      objs[i]->computeAnimationState(t, live);
+      q_vec_type pos;
+      q_type orient;
+      objs[i]->getPosition(pos);
+      objs[i]->getOrientation(orient);
+      if (cache.load(frame, objs[i], state) ||
+          !q_vec_equals(pos, live.position) ||
+          !q_equals(orient, live.orientation)) {
+        errors++;
+        cout << "Unbaked state of object " << i << " wrong at " << t << endl;
+      }
+    }
+  }
+  return errors;
+}
+
+// Counts the objects added to and removed from the world
+class CountingObserver : public WorldObserver
+{
+ public:
+  CountingObserver() : changes(0) {}
+  virtual void objectAdded(SketchObject *) { changes++; }
+  virtual void objectRemoved(SketchObject *) { changes++; }
+  int changes;
+};
+
+// Keyframes an object in a group, then takes it out of the group without
+// keyframing that.  Baking should sample it as grouped without moving it
+// back into the group, and setAnimationTime should then group it.
+int testBakeAnimationGrouping()
+{
+  int errors = 0;
+  QScopedPointer< SketchModel > model(TestCoreHelpers::getCubeModel());
+  vtkSmartPointer< vtkRenderer > renderer =
+      vtkSmartPointer< vtkRenderer >::New();
+  QScopedPointer< WorldManager > world(new WorldManager(renderer));
+  ObjectGroup *grp = new ObjectGroup();
+  SketchObject *a = new ModelInstance(model.data());
+  SketchObject *b = new ModelInstance(model.data());
+  q_vec_type pos = {1, 0, 0};
+  a->setPosition(pos);
+  grp->addObject(a);
+  q_vec_set(pos, -1, 2, 0);
+  b->setPosition(pos);
+  grp->addObject(b);
+  q_vec_set(pos, 10, 0, 0);
+  grp->setPosition(pos);
+  world->addObject(grp);
+  grp->addKeyframeForCurrentLocation(0.0);
+  q_vec_set(pos, 0, 10, 0);
+  grp->setPosition(pos);
+  grp->addKeyframeForCurrentLocation(2.0);
+  q_vec_type groupedPos;
+  b->getKeyframeStore()->getPosition(0, groupedPos);
+  grp->removeObject(b);
+  world->addObject(b);
+
+  CountingObserver observer;
+  world->addObserver(&observer);
+  world->bakeAnimation(10.0);
+  if (observer.changes != 0 || b->getParent() != NULL) {
+    errors++;
+    cout << "Baking the animation regrouped objects" << endl;
+  }
+  AnimationState state;
+  const AnimationCache &cache = world->getAnimationCache();
+  if (!cache.load(10, b, state) || !q_vec_equals(state.position, groupedPos)) {
+    errors++;
+    cout << "Baked state of the grouped object is wrong" << endl;
+  }
+  world->setAnimationTime(1.0);
+  // the group is not rotated, so the object is just offset from it
+  q_vec_type grpPos, expected;
+  grp->getPosition(grpPos);
+  q_vec_add(expected, grpPos, groupedPos);
+  b->getPosition(pos);
+  if (b->getParent() != grp || !q_vec_equals(pos, expected)) {
+    errors++;
+    cout << "Grouped object not put back in its group" << endl;
+  }
+  world->removeObserver(&observer);
+  return errors;
+}
+
+// Animates a large scene with and without threads, prints the times and
+// checks that both put the objects in the same places
+int testParallelAnimation()
+{
+  int errors = 0;
+  const int numObjects = 5000, numFrames = 20;
+  QScopedPointer< SketchModel > model(TestCoreHelpers::getCubeModel());
+  vtkSmartPointer< vtkRenderer > renderer =
+      vtkSmartPointer< vtkRenderer >::New();
+  QScopedPointer< WorldManager > world(new WorldManager(renderer));
+  QVector< SketchObject * > objs;
+  q_vec_type start = Q_NULL_VECTOR;
+  q_type startOrient = Q_ID_QUAT;
+  for (int i = 0; i < numObjects; i++) {
+    SketchObject *obj = world->addObject(model.data(), start, startOrient);
+    for (int k = 0; k < 5; k++) {
+      q_vec_type pos = {i % 100 + k * 0.5, i / 100 - k * 1.0, k * k * 0.2};
+      q_type orient;
+      q_from_axis_angle(orient, 1, i % 3, k, k * 0.4 + i * 0.01);
+      obj->setPosAndOrient(pos, orient);
+      obj->addKeyframeForCurrentLocation(k);
+    }
+    objs.append(obj);
+  }
+  QVector< double > serialPositions(3 * numObjects * numFrames);
+  QTime timer;
+  timer.start();
+  for (int f = 0; f < numFrames; f++) {
+    world->setAnimationTime(f * 0.19, false);
+    for (int i = 0; i < numObjects; i++) {
+      objs[i]->getPosition(&serialPositions[3 * (f * numObjects + i)]);
+    }
+  }
+  int serialTime = timer.restart();
+  for (int f = 0; f < numFrames; f++) {
+    world->setAnimationTime(f * 0.19, true);
+    for (int i = 0; i < numObjects; i++) {
+      q_vec_type pos;
+      objs[i]->getPosition(pos);
+      if (!q_vec_equals(pos, &serialPositions[3 * (f * numObjects + i)])) {
+        errors++;
+        cout << "Parallel animation put object " << i << " in the wrong place"
+             << " at frame " << f << endl;
+        break;
+      }
+    }
+  }
+  int parallelTime = timer.elapsed();
+  cout << numObjects << " keyframed objects, " << numFrames << " frames: "
+       << "serial " << serialTime << " ms, parallel " << parallelTime << " ms"
+       << endl;
+  return errors;
+}
+
+// Setting the animation time should only update and notify for the objects
+// that change
+int testAnimationChanges()
+{
+  int errors = 0;
+  QScopedPointer< SketchModel > model(TestCoreHelpers::getCubeModel());
+  vtkSmartPointer< vtkRenderer > renderer =
+      vtkSmartPointer< vtkRenderer >::New();
+  QScopedPointer< WorldManager > world(new WorldManager(renderer));
+  q_vec_type pos = Q_NULL_VECTOR;
+  q_type orient = Q_ID_QUAT;
+  SketchObject *still = world->addObject(model.data(), pos, orient);
+  still->addKeyframeForCurrentLocation(0.0);
+  SketchObject *moving = world->addObject(model.data(), pos, orient);
+  moving->addKeyframeForCurrentLocation(0.0);
+  q_vec_type pos2 = {10, 5, 0};
+  moving->setPosAndOrient(pos2, orient);
+  moving->addKeyframeForCurrentLocation(10.0);
+  q_vec_type springPos = Q_NULL_VECTOR;
+  world->addSpring(still, moving, springPos, springPos, false, 1, 0);
+
+  world->setAnimationTime(5.0);
+  const AnimationFrameStats &stats = world->getLastAnimationFrameStats();
+  if (stats.objectsAnimated != 2) {
+    errors++;
+    cout << "Animated " << stats.objectsAnimated << " objects instead of 2"
+         << endl;
+  }
+  if (stats.objectsMoved != 1 || stats.transformsUpdated != 1) {
+    errors++;
+    cout << "Moved " << stats.objectsMoved << " objects and updated "
+         << stats.transformsUpdated << " transforms, expected 1 of each"
+         << endl;
+  }
+  if (!stats.connectorsUpdated) {
+    errors++;
+    cout << "Connectors not updated when an object moved" << endl;
+  }
+
+  world->setAnimationTime(5.0);
+  if (stats.objectsMoved != 0 || stats.transformsUpdated != 0 ||
+      stats.colorsChanged != 0 || stats.visibilityChanges != 0) {
+    errors++;
+    cout << "Setting the same time again changed objects" << endl;
+  }
+  if (stats.connectorsUpdated) {
+    errors++;
+    cout << "Connectors updated when nothing moved" << endl;
+  }
+  return errors;
+}
+
+// The keyframe outlines should be shown only at times where an object has a
+// keyframe, and should follow changes to the keyframes
+int testKeyframeOutlines()
+{
+  int errors = 0;
+  QScopedPointer< SketchModel > model(TestCoreHelpers::getCubeModel());
+  vtkSmartPointer< vtkRenderer > renderer =
+      vtkSmartPointer< vtkRenderer >::New();
+  QScopedPointer< WorldManager > world(new WorldManager(renderer));
+  q_vec_type pos = Q_NULL_VECTOR;
+  q_type orient = Q_ID_QUAT;
+  SketchObject *obj = world->addObject(model.data(), pos, orient);
+  int numProps = renderer->GetViewProps()->GetNumberOfItems();
+  obj->addKeyframeForCurrentLocation(0.0);
+  obj->addKeyframeForCurrentLocation(1.0);
+  world->setKeyframeOutlinesForTime(1.0);
+  if (renderer->GetViewProps()->GetNumberOfItems() != numProps + 1) {
+    errors++;
+    cout << "Keyframe outlines not shown at a keyframe" << endl;
+  }
+  world->setKeyframeOutlinesForTime(1.0);
+  if (renderer->GetViewProps()->GetNumberOfItems() != numProps + 1) {
+    errors++;
+    cout << "Keyframe outlines changed when nothing did" << endl;
+  }
+  world->setKeyframeOutlinesForTime(0.5);
+  if (renderer->GetViewProps()->GetNumberOfItems() != numProps) {
+    errors++;
+    cout << "Keyframe outlines shown between keyframes" << endl;
+  }
+  obj->removeKeyframeForTime(1.0);
+  world->setKeyframeOutlinesForTime(1.0);
+  if (renderer->GetViewProps()->GetNumberOfItems() != numProps) {
+    errors++;
+    cout << "Keyframe outlines shown for a removed keyframe" << endl;
+  }
+  obj->addKeyframeForCurrentLocation(0.5);
+  world->setKeyframeOutlinesForTime(0.5);
+  if (renderer->GetViewProps()->GetNumberOfItems() != numProps + 1) {
+    errors++;
+    cout << "Keyframe outlines not shown for a new keyframe" << endl;
+  }
+  return errors;
+}
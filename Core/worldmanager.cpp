@@ -2,6 +2,7 @@
 
 #include <limits>
 #include <iostream>
+#include <cmath>
 using std::cout;
 using std::endl;
 
@@ -17,13 +18,17 @@ using std::endl;
 #include <vtkLineSource.h>
 #include <vtkPolyData.h>
 #include <vtkAppendPolyData.h>
+#include <vtkAlgorithm.h>
 
 #include <QDebug>
+#include <QtConcurrentMap>
+#include <QThread>
 
 #include <vtkProjectToPlane.h>
 
 #include "sketchtests.h"
 #include "keyframe.h"
+#include "keyframestore.h"
 #include "sketchmodel.h"
 #include "sketchobject.h"
 #include "modelinstance.h"
@@ -37,6 +42,10 @@ using std::endl;
 // The color used for the shadows of objects
 #define SHADOW_COLOR 0.1, 0.1, 0.1
 #define HALFPLANE_COLOR 0.9, 0.3, 0.3
+// setAnimationTime only uses threads if there are at least this many animated
+// objects, and splits them into this many tasks per thread
+#define MIN_OBJECTS_FOR_PARALLEL_ANIMATION 64
+#define ANIMATION_TASKS_PER_THREAD 4
 
 void addObserverRecursive(SketchObject *obj, ObjectChangeObserver *obs) {
     obj->addObserver(obs);
@@ -67,6 +76,10 @@ WorldManager::WorldManager(vtkRenderer *r)
       renderer(r),
       orientedHalfPlaneOutlines(vtkSmartPointer< vtkAppendPolyData >::New()),
       halfPlanesActor(vtkSmartPointer< vtkActor >::New()),
+      emptyHalfPlaneOutline(vtkSmartPointer< vtkPolyData >::New()),
+      shownHalfPlaneOutlines(),
+      keyframeTimeIndex(),
+      keyframeTimeIndexRevision(0),
       maxGroupNum(0),
 	  minLuminance(0.5),
 	  maxLuminance(1.0),
@@ -76,15 +89,15 @@ WorldManager::WorldManager(vtkRenderer *r)
 	  fullResForNearbyObjects(false),
       showInvisible(true),
       showShadows(true),
-      collisionResponseMode(PhysicsMode::POSE_MODE_TRY_ONE)
+      collisionResponseMode(PhysicsMode::POSE_MODE_TRY_ONE),
+      animationCache(new AnimationCache()),
+      lastAnimationFrameStats()
 {
     PhysicsStrategyFactory::populateStrategies(strategies);
     vtkSmartPointer< vtkPoints > pts = vtkSmartPointer< vtkPoints >::New();
     pts->InsertNextPoint(0.0, 0.0, 0.0);
-    vtkSmartPointer< vtkPolyData > pdata =
-        vtkSmartPointer< vtkPolyData >::New();
-    pdata->SetPoints(pts);
-    orientedHalfPlaneOutlines->AddInputData(pdata);
+    emptyHalfPlaneOutline->SetPoints(pts);
+    orientedHalfPlaneOutlines->AddInputData(emptyHalfPlaneOutline);
     vtkSmartPointer< vtkPolyDataMapper > orientedHalfPlanesMapper =
         vtkSmartPointer< vtkPolyDataMapper >::New();
     orientedHalfPlanesMapper->SetInputConnection(
@@ -128,6 +141,7 @@ SketchObject *WorldManager::addObject(SketchModel *model, const q_vec_type pos,
 SketchObject *WorldManager::addObject(SketchObject *object)
 {
     objects.push_back(object);
+    keyframeTimeIndexRevision = 0;
     if (object->getPrimaryCollisionGroupNum() == OBJECT_HAS_NO_GROUP) {
         object->setPrimaryCollisionGroupNum(getNextGroupId());
     }
@@ -150,6 +164,7 @@ void WorldManager::removeObject(SketchObject *object)
         removeActors(object);
         removeShadows(object);
         objects.removeAt(index);
+        keyframeTimeIndexRevision = 0;
         removeObserverRecursive(object,this);
     } else if (object->getParent() != NULL) {
         // TODO - add test for this case where an object in a group is
@@ -183,46 +198,41 @@ void WorldManager::updateGroupStatus(SketchObject *object, double t,
         return;
     }
 
-    QMapIterator< double, Keyframe > it(*(object->getKeyframes()));
-    // last is the last keyframe we passed
-    double last = it.peekNext().key();
-    // go until the next one is greater than the time (the last one
-    // will be less than the time unless the time is less than the first
-    // time in the keyframes list
-    while (it.hasNext() && it.peekNext().key() < t) {
-        last = it.next().key();
-    }
+    KeyframeSpan span = object->findKeyframesAround(t);
+    const KeyframeStore &frames = *object->getKeyframeStore();
     // if we are after the end of the last keyframe defined
-    if (!it.hasNext()) {
-        if (lastUpdate >= last && lastUpdate != t) {
+    if (span.after == -1) {
+        if (lastUpdate >= span.beforeTime && lastUpdate != t) {
             return;
         }
         lastGroupUpdate = t;
-        Keyframe f = it.value();
-        if (object->getGroupingLevel() > f.getLevel()) {
+        int f = span.before;
+        if (object->getGroupingLevel() > frames.getLevel(f)) {
             ObjectGroup *grp =
                 dynamic_cast< ObjectGroup * >(object->getParent());
             grp->removeObject(object);
             addObject(object);
         }
-        if (object->getGroupingLevel() < f.getLevel()) {
-            ObjectGroup *grp = dynamic_cast< ObjectGroup * >(f.getParent());
+        if (object->getGroupingLevel() < frames.getLevel(f)) {
+            ObjectGroup *grp =
+                dynamic_cast< ObjectGroup * >(frames.getParent(f));
             removeObject(object);
             grp->addObject(object);
         }
     }
     // if we happenned to land on a keyframe or before the first one
-    else if (it.peekNext().key() == t || it.peekNext().key() == last) {
+    else if (span.afterTime == t || span.after == span.before) {
         lastGroupUpdate = t;
-        Keyframe f = it.next().value();
-        if (object->getGroupingLevel() > f.getLevel()) {
+        int f = span.after;
+        if (object->getGroupingLevel() > frames.getLevel(f)) {
             ObjectGroup *grp =
                 dynamic_cast< ObjectGroup * >(object->getParent());
             grp->removeObject(object);
             addObject(object);
         }
-        if (object->getGroupingLevel() < f.getLevel()) {
-            ObjectGroup *grp = dynamic_cast< ObjectGroup * >(f.getParent());
+        if (object->getGroupingLevel() < frames.getLevel(f)) {
+            ObjectGroup *grp =
+                dynamic_cast< ObjectGroup * >(frames.getParent(f));
             removeObject(object);
             grp->addObject(object);
         }
@@ -231,10 +241,9 @@ void WorldManager::updateGroupStatus(SketchObject *object, double t,
     else {
         lastGroupUpdate = t;
 
-        Keyframe f1 = object->getKeyframes()->value(last),
-                 f2 = it.next().value();
-        int objLevel = object->getGroupingLevel(), f1Level = f1.getLevel(),
-            f2Level = f2.getLevel();
+        int f1 = span.before, f2 = span.after;
+        int objLevel = object->getGroupingLevel(),
+            f1Level = frames.getLevel(f1), f2Level = frames.getLevel(f2);
 
         if (f1Level != f2Level) {
             // grouping level between frames is different, must float freely to
@@ -246,7 +255,7 @@ void WorldManager::updateGroupStatus(SketchObject *object, double t,
                     grp->removeObject(object);
                     addObject(object);
                 }
-            } else if (f1.getParent() != f2.getParent()) {
+            } else if (frames.getParent(f1) != frames.getParent(f2)) {
                 ObjectGroup *grp =
                     dynamic_cast< ObjectGroup * >(object->getParent());
                 grp->removeObject(object);
@@ -261,22 +270,22 @@ void WorldManager::updateGroupStatus(SketchObject *object, double t,
                 grp->removeObject(object);
                 addObject(object);
             }
-        } else if (f1.getParent() == f2.getParent()) {
+        } else if (frames.getParent(f1) == frames.getParent(f2)) {
             // the object is in the same group at both frames, so add it to that
             // group if
             // it is not there already
-            if (objLevel > 0 && object->getParent() != f1.getParent()) {
+            if (objLevel > 0 && object->getParent() != frames.getParent(f1)) {
                 ObjectGroup *old_grp =
                     dynamic_cast< ObjectGroup * >(object->getParent());
                 old_grp->removeObject(object);
                 ObjectGroup *new_grp =
-                    dynamic_cast< ObjectGroup * >(f1.getParent());
+                    dynamic_cast< ObjectGroup * >(frames.getParent(f1));
                 new_grp->addObject(object);
             }
             if (objLevel == 0) {
                 removeObject(object);
                 ObjectGroup *new_grp =
-                    dynamic_cast< ObjectGroup * >(f1.getParent());
+                    dynamic_cast< ObjectGroup * >(frames.getParent(f1));
                 new_grp->addObject(object);
             }
         } else {  // the object is in a group at both frames but not the same
@@ -323,13 +332,11 @@ void WorldManager::clearObjects()
     qDeleteAll(objects);
     objects.clear();
     shadows.clear();
+    animationCache->clear();
+    keyframeTimeIndexRevision = 0;
+    shownHalfPlaneOutlines.clear();
     orientedHalfPlaneOutlines->RemoveAllInputConnections(0);
-    vtkSmartPointer< vtkPoints > pts = vtkSmartPointer< vtkPoints >::New();
-    pts->InsertNextPoint(0.0, 0.0, 0.0);
-    vtkSmartPointer< vtkPolyData > pdata =
-        vtkSmartPointer< vtkPolyData >::New();
-    pdata->SetPoints(pts);
-    orientedHalfPlaneOutlines->AddInputData(pdata);
+    orientedHalfPlaneOutlines->AddInputData(emptyHalfPlaneOutline);
     orientedHalfPlaneOutlines->Update();
 }
 
@@ -441,7 +448,56 @@ void WorldManager::stepPhysics(double dt)
 
 //##################################################################################################
 //##################################################################################################
-bool WorldManager::setAnimationTime(double t)
+// Adds the object and the objects under it that setPositionByAnimationTime
+// would set to the list, parents before their children.  The index in the
+// list of each object's parent (or -1) is added to parents.
+static void collectAnimatedObjects(SketchObject *obj,
+                                   QVector< SketchObject * > &list,
+                                   QVector< int > &parents, int parent = -1)
+{
+    if (!obj->hasKeyframes()) {
+        return;
+    }
+    int index = list.size();
+    list.append(obj);
+    parents.append(parent);
+    QList< SketchObject * > *subObjects = obj->getSubObjects();
+    if (subObjects != NULL) {
+        for (QListIterator< SketchObject * > it(*subObjects); it.hasNext();) {
+            collectAnimatedObjects(it.next(), list, parents, index);
+        }
+    }
+}
+
+// Finds the animation states of the objects [begin,end) at time t, reading
+// them from the cache (or interpolating between the cached frames around t)
+// if they are there
+struct AnimationStateTask {
+    SketchObject *const *objects;
+    AnimationState *states;
+    // whether each state was found
+    bool *found;
+    const AnimationCache *cache;
+    double t;
+    int frame;
+    int begin, end;
+};
+
+static void computeAnimationStates(AnimationStateTask &task)
+{
+    for (int i = task.begin; i < task.end; i++) {
+        SketchObject *obj = task.objects[i];
+        AnimationState &state = task.states[i];
+        bool cached = (task.frame >= 0)
+                          ? task.cache->load(task.frame, obj, state)
+                          : task.cache->loadBetween(task.t, obj, state);
+        task.found[i] = cached || obj->computeAnimationState(task.t, state);
+    }
+}
+
+//##################################################################################################
+//##################################################################################################
+bool WorldManager::setAnimationTime(double t, bool parallel)
 {
     bool isDone = true;
 
@@ -451,53 +507,232 @@ bool WorldManager::setAnimationTime(double t)
         updateGroupStatus(obj, t, lastGroupUpdate);
     }
 
+    // Find every object's state.  This does not change anything, so it is
+    // split up among threads
+    QVector< SketchObject * > animated;
+    QVector< int > parents;
     for (QListIterator< SketchObject * > it(objects); it.hasNext();) {
-        SketchObject *obj = it.next();
-        bool wasVisible = obj->isVisible();
-        obj->setPositionByAnimationTime(t);
+        collectAnimatedObjects(it.next(), animated, parents);
+    }
+    int frame = animationCache->getFrameAt(t);
+    QVector< AnimationState > states(animated.size());
+    QVector< bool > found(animated.size());
+    int numTasks = 1;
+    if (parallel && animated.size() >= MIN_OBJECTS_FOR_PARALLEL_ANIMATION) {
+        numTasks = qMin(animated.size(), QThread::idealThreadCount() *
+                                             ANIMATION_TASKS_PER_THREAD);
+    }
+    QVector< AnimationStateTask > tasks(numTasks);
+    for (int i = 0; i < numTasks; i++) {
+        AnimationStateTask &task = tasks[i];
+        task.objects = animated.constData();
+        task.states = states.data();
+        task.found = found.data();
+        task.cache = animationCache.data();
+        task.t = t;
+        task.frame = frame;
+        task.begin = (animated.size() * i) / numTasks;
+        task.end = (animated.size() * (i + 1)) / numTasks;
+    }
+    if (numTasks > 1) {
+        QtConcurrent::blockingMap(tasks, computeAnimationStates);
+    } else {
+        computeAnimationStates(tasks[0]);
+    }
+
+    // Then set the states, which updates actors and notifies observers, on
+    // this thread.  Parents are set before their children so that children
+    // can be told when their parents moved.
+    QVector< bool > wasVisible(objects.size());
+    for (int i = 0; i < objects.size(); i++) {
+        wasVisible[i] = objects[i]->isVisible();
+    }
+    QVector< bool > moved(animated.size(), false);
+    lastAnimationFrameStats = AnimationFrameStats();
+    for (int i = 0; i < animated.size(); i++) {
+        if (!found[i]) {
+            continue;
+        }
+        bool parentMoved = parents[i] >= 0 && moved[parents[i]];
+        int changes = animated[i]->applyAnimationState(states[i], parentMoved);
+        moved[i] = (changes & AnimationState::MOVED) != 0;
+        lastAnimationFrameStats.objectsAnimated++;
+        if (changes & AnimationState::LOCAL_POSE_CHANGED) {
+            lastAnimationFrameStats.transformsUpdated++;
+        }
+        if (moved[i]) {
+            lastAnimationFrameStats.objectsMoved++;
+        }
+        if (changes & AnimationState::COLOR_CHANGED) {
+            lastAnimationFrameStats.colorsChanged++;
+        }
+        if (changes & AnimationState::VISIBILITY_CHANGED) {
+            lastAnimationFrameStats.visibilityChanges++;
+        }
+    }
+    for (int i = 0; i < objects.size(); i++) {
+        SketchObject *obj = objects[i];
         if (obj->hasKeyframes()) {
-            if (obj->getKeyframes()->upperBound(t) !=
-                obj->getKeyframes()->end()) {
+            const KeyframeStore *frames = obj->getKeyframeStore();
+            if (frames->getTime(frames->size() - 1) > t) {
                 isDone = false;
             }
         }
-        if (obj->isVisible() && !wasVisible) {
+        if (obj->isVisible() && !wasVisible[i]) {
             insertActors(obj);
-        } else if (!obj->isVisible() && wasVisible) {
+        } else if (!obj->isVisible() && wasVisible[i]) {
             removeActors(obj);
         }
     }
     setKeyframeOutlinesForTime(t);
-    updateConnectors();
+    // connectors only need their ends moved if an object moved
+    if (lastAnimationFrameStats.objectsMoved > 0) {
+        updateConnectors();
+        lastAnimationFrameStats.connectorsUpdated = true;
+    }
     return isDone;
 }
+
 //##################################################################################################
 //##################################################################################################
-void WorldManager::setKeyframeOutlinesForTime(double t)
+static void collectKeyframedObjects(SketchObject *obj,
+                                    QVector< SketchObject * > &list,
+                                    double &endTime)
 {
-    int numberWithKeyframeNow = 0;
-    bool isShowingHalfPlaneOutlines =
-        orientedHalfPlaneOutlines->GetNumberOfInputConnections(0) > 1;
-    orientedHalfPlaneOutlines->RemoveAllInputs();
-    vtkSmartPointer< vtkPoints > pts = vtkSmartPointer< vtkPoints >::New();
-    pts->InsertNextPoint(0.0, 0.0, 0.0);
-    vtkSmartPointer< vtkPolyData > pdata =
-        vtkSmartPointer< vtkPolyData >::New();
-    pdata->SetPoints(pts);
-    orientedHalfPlaneOutlines->AddInputData(pdata);
+    if (obj->hasKeyframes()) {
+        list.append(obj);
+        const KeyframeStore *frames = obj->getKeyframeStore();
+        double lastTime = frames->getTime(frames->size() - 1);
+        if (lastTime > endTime) {
+            endTime = lastTime;
+        }
+    }
+    QList< SketchObject * > *subObjects = obj->getSubObjects();
+    if (subObjects != NULL) {
+        for (QListIterator< SketchObject * > it(*subObjects); it.hasNext();) {
+            collectKeyframedObjects(it.next(), list, endTime);
+        }
+    }
+}
+
+//##################################################################################################
+//##################################################################################################
+bool WorldManager::bakeAnimation(double frameRate, int maxSamples)
+{
+    QVector< SketchObject * > animated;
+    double endTime = 0.0;
     for (QListIterator< SketchObject * > it(objects); it.hasNext();) {
-        SketchObject *obj = it.next();
-        if (obj->hasKeyframes()) {
-            if (obj->getKeyframes()->contains(t)) {
-                orientedHalfPlaneOutlines->AddInputConnection(
-                    0, obj->getOrientedHalfPlaneOutlines()->GetOutputPort(0));
-                ++numberWithKeyframeNow;
+        collectKeyframedObjects(it.next(), animated, endTime);
+    }
+    if (animated.isEmpty()) {
+        animationCache->clear();
+        return true;
+    }
+    int numFrames = static_cast< int >(ceil(endTime * frameRate - 1e-6)) + 1;
+    QVector< int > stale = animationCache->layOut(animated, frameRate,
+                                                  numFrames);
+    if (stale.isEmpty()) {
+        return true;
+    }
+    // continue from the earliest frame that some object still needs
+    int cachedFrames = animationCache->getNumberOfCachedFrames();
+    int first = cachedFrames;
+    for (int i = 0; i < stale.size(); i++) {
+        first = qMin(first, animationCache->getFilledFrames(stale[i]));
+    }
+    int last = cachedFrames;
+    if (maxSamples > 0) {
+        last = qMin(last, first + qMax(1, maxSamples / stale.size()));
+    }
+    // the states only depend on the keyframes, so the world is not changed
+    AnimationState state;
+    for (int frame = first; frame < last; frame++) {
+        double t = frame / frameRate;
+        for (int i = 0; i < stale.size(); i++) {
+            if (animationCache->getFilledFrames(stale[i]) <= frame &&
+                animated[stale[i]]->computeAnimationState(t, state)) {
+                animationCache->store(frame, stale[i], state);
             }
         }
     }
-    if (isShowingHalfPlaneOutlines && numberWithKeyframeNow == 0) {
+    for (int i = 0; i < stale.size(); i++) {
+        if (animationCache->getFilledFrames(stale[i]) < last) {
+            animationCache->setFilled(stale[i], last);
+        }
+    }
+    return last == cachedFrames;
+}
+
+//##################################################################################################
+//##################################################################################################
+double WorldManager::getBakedFrameRate() const
+{
+    return animationCache->getFrameRate();
+}
+
+//##################################################################################################
+//##################################################################################################
+const AnimationCache &WorldManager::getAnimationCache() const
+{
+    return *animationCache;
+}
+
+//##################################################################################################
+//##################################################################################################
+void WorldManager::setAnimationCacheMaxSize(qint64 bytes)
+{
+    animationCache->setMaxMemorySize(bytes);
+}
+
+//##################################################################################################
+//##################################################################################################
+const AnimationFrameStats &WorldManager::getLastAnimationFrameStats() const
+{
+    return lastAnimationFrameStats;
+}
+
+//##################################################################################################
+//##################################################################################################
+void WorldManager::setKeyframeOutlinesForTime(double t)
+{
+    if (keyframeTimeIndexRevision == 0 ||
+        keyframeTimeIndexRevision != SketchObject::getLatestKeyframeRevision()) {
+        keyframeTimeIndex.clear();
+        for (QListIterator< SketchObject * > it(objects); it.hasNext();) {
+            SketchObject *obj = it.next();
+            if (obj->hasKeyframes()) {
+                const KeyframeStore *frames = obj->getKeyframeStore();
+                for (int i = 0; i < frames->size(); i++) {
+                    keyframeTimeIndex[frames->getTime(i)].append(obj);
+                }
+            }
+        }
+        keyframeTimeIndexRevision = SketchObject::getLatestKeyframeRevision();
+    }
+    QList< vtkSmartPointer< vtkAlgorithm > > outlines;
+    QMap< double, QList< SketchObject * > >::const_iterator keyframed =
+        keyframeTimeIndex.constFind(t);
+    if (keyframed != keyframeTimeIndex.constEnd()) {
+        foreach(SketchObject * obj, keyframed.value()) {
+            outlines.append(obj->getOrientedHalfPlaneOutlines());
+        }
+    }
+    // only change the inputs if the outlines to show changed, since that
+    // makes the append filter run again
+    if (outlines == shownHalfPlaneOutlines) {
+        return;
+    }
+    bool isShowingHalfPlaneOutlines = !shownHalfPlaneOutlines.isEmpty();
+    orientedHalfPlaneOutlines->RemoveAllInputs();
+    orientedHalfPlaneOutlines->AddInputData(emptyHalfPlaneOutline);
+    foreach(vtkAlgorithm * outline, outlines) {
+        orientedHalfPlaneOutlines->AddInputConnection(
+            0, outline->GetOutputPort(0));
+    }
+    shownHalfPlaneOutlines = outlines;
+    if (isShowingHalfPlaneOutlines && outlines.isEmpty()) {
         renderer->RemoveActor(halfPlanesActor);
-    } else if (!isShowingHalfPlaneOutlines && numberWithKeyframeNow > 0) {
+    } else if (!isShowingHalfPlaneOutlines && !outlines.isEmpty()) {
         renderer->AddActor(halfPlanesActor);
     }
 }
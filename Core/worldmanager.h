@@ -6,7 +6,9 @@
 #include <QList>
 #include <QVector>
 #include <QHash>
+#include <QMap>
 #include <QSharedPointer>
+#include <QScopedPointer>
 
 #include <vtkSmartPointer.h>
 class vtkRenderer;
@@ -19,6 +21,7 @@ class vtkActor;
 class vtkAppendPolyData;
 
 class vtkProjectToPlane;
+class vtkAlgorithm;
 
 class SketchModel;
 class ModelManager;
@@ -29,6 +32,7 @@ class PhysicsStrategy;
 #include "groupidgenerator.h"
 #include "objectchangeobserver.h"
 #include "physicsstrategyfactory.h"
+#include "animationcache.h"
 
 class WorldObserver
 {
@@ -53,6 +57,26 @@ class WorldObserver
     virtual void collisionDetectionActivationChanged() {}
 };
 
+// Counts of what changed the last time WorldManager::setAnimationTime was
+// called, to see how much work each frame of an animation does
+struct AnimationFrameStats {
+    AnimationFrameStats()
+        : objectsAnimated(0), objectsMoved(0), transformsUpdated(0),
+          colorsChanged(0), visibilityChanges(0), connectorsUpdated(false)
+    {
+    }
+    // the objects set from their keyframes
+    int objectsAnimated;
+    // the objects whose observers were told they moved
+    int objectsMoved;
+    // the objects whose local transforms were recalculated
+    int transformsUpdated;
+    int colorsChanged;
+    int visibilityChanges;
+    // whether the connectors were updated
+    bool connectorsUpdated;
+};
+
 /*
  * This class contains the data that is in the modeled "world", all the objects
  * and
@@ -313,8 +337,70 @@ class WorldManager : public GroupIdGenerator, public ObjectChangeObserver
      * time (found from their keyframes).
      * Returns true if all keyframes are at times less than t
      *
+     * The objects' states are found first, split up among threads if
+     * parallel is true, then set on this thread.  States are read from the
+     * baked frames (see bakeAnimation) when t is on a frame, or
+     * interpolated between the two frames around t when no keyframe is in
+     * the way, and computed otherwise.
+     *
+     *******************************************************************/
+    bool setAnimationTime(double t, bool parallel = true);
+    /*******************************************************************
+     *
+     * Samples the animation of every object with keyframes at the given
+     * frame rate from time 0 to the last keyframe, so that setAnimationTime
+     * can read the objects' states at those times instead of computing
+     * them.  Objects whose keyframes have not changed since the last bake
+     * at the same frame rate are not sampled again.  Only as many frames as
+     * fit in the cache's memory limit are sampled (see AnimationCache), the
+     * states at later times are computed by setAnimationTime.
+     *
+     * The bake can be spread over several calls by limiting the number of
+     * samples each call takes.  Each call continues where the last one
+     * stopped, and setAnimationTime computes the states of frames that are
+     * not baked yet.
+     *
+     * The states are computed from the keyframes alone, so this does not
+     * change the world or move objects into or out of groups.
+     *
+     * frameRate  - the number of samples per second of animation time
+     * maxSamples - the most object states to sample in this call (at least
+     *              one frame is always sampled), 0 for no limit
+     *
+     * Returns true if the bake is finished.
+     *
+     *******************************************************************/
+    bool bakeAnimation(double frameRate = DEFAULT_ANIMATION_FRAME_RATE,
+                       int maxSamples = 0);
+    /*******************************************************************
+     *
+     * Returns the frame rate of the last bakeAnimation(), or 0 if the
+     * animation has not been baked
+     *
+     *******************************************************************/
+    double getBakedFrameRate() const;
+    /*******************************************************************
+     *
+     * Returns the cache filled in by bakeAnimation()
+     *
+     *******************************************************************/
+    const AnimationCache &getAnimationCache() const;
+    /*******************************************************************
+     *
+     * Sets the most memory the baked animation may use in bytes (see
+     * AnimationCache::setMaxMemorySize).  Takes effect at the next
+     * bakeAnimation().
+     *
+     *******************************************************************/
+    void setAnimationCacheMaxSize(qint64 bytes);
+    /*******************************************************************
+     *
+     * Returns counts of what changed in the last call to
+     * setAnimationTime().  Objects whose state did not change are not
+     * updated and their observers are not notified.
+     *
      *******************************************************************/
-    bool setAnimationTime(double t);
+    const AnimationFrameStats &getLastAnimationFrameStats() const;
     /*******************************************************************
      *
      * Turns on or off the keyframe outlines based on the given time.  If
@@ -569,6 +655,17 @@ class WorldManager : public GroupIdGenerator, public ObjectChangeObserver
     vtkSmartPointer< vtkRenderer > renderer;
     vtkSmartPointer< vtkAppendPolyData > orientedHalfPlaneOutlines;
     vtkSmartPointer< vtkActor > halfPlanesActor;
+    // a single point that is always an input to orientedHalfPlaneOutlines so
+    // it has something to append
+    vtkSmartPointer< vtkPolyData > emptyHalfPlaneOutline;
+    // the outlines currently appended by orientedHalfPlaneOutlines
+    QList< vtkSmartPointer< vtkAlgorithm > > shownHalfPlaneOutlines;
+    // the objects with a keyframe at each keyframe time.  This is remade
+    // when objects are added or removed or when any keyframes change, the
+    // revision is SketchObject::getLatestKeyframeRevision() when it was
+    // made, or 0 if it must be remade.
+    QMap< double, QList< SketchObject * > > keyframeTimeIndex;
+    quint64 keyframeTimeIndexRevision;
 
 	double minLuminance, maxLuminance;
     int maxGroupNum;
@@ -577,6 +674,8 @@ class WorldManager : public GroupIdGenerator, public ObjectChangeObserver
     PhysicsMode::Type collisionResponseMode;
 
     double lastGroupUpdate;
+    QScopedPointer< AnimationCache > animationCache;
+    AnimationFrameStats lastAnimationFrameStats;
     QList< WorldObserver * > observers;
 };
 
@@ -0,0 +1,207 @@
+#include "projectautosaver.h"
+
+#include <cstdio>
+#include <fstream>
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+#include <vtkSmartPointer.h>
+#include <vtkXMLDataElement.h>
+#include <vtkXMLUtilities.h>
+
+#include <QtConcurrentRun>
+#include <QSettings>
+#include <QTimer>
+#include <QFile>
+#include <QDir>
+#include <QDebug>
+
+#include <sketchioconstants.h>
+#include <sketchproject.h>
+
+#include "projecttoxml.h"
+
+// the QSettings key for the autosave interval
+#define AUTOSAVE_INTERVAL_SETTING "autosave/intervalSeconds"
+// default time between autosaves (seconds)
+#define DEFAULT_AUTOSAVE_INTERVAL 120
+// the length of one frame in milliseconds, snapshots taking longer than this
+// will cause a dropped frame so they are reported
+#define FRAME_TIME_MSECS 16
+
+// the function run on the worker thread, the snapshot is passed by value so
+// the worker holds its own reference to it
+static bool writeSnapshot(QSharedPointer< ProjectSnapshot > snapshot,
+                          QString filename)
+{
+    vtkSmartPointer< vtkXMLDataElement > root =
+        vtkSmartPointer< vtkXMLDataElement >::Take(
+            ProjectToXML::snapshotToXML(*snapshot));
+    return ProjectAutosaver::writeElementToFileAtomically(root, filename);
+}
+
+ProjectAutosaver::ProjectAutosaver(SketchBio::Project *proj, QObject *parent)
+    : QObject(parent),
+      project(proj),
+      timer(new QTimer(this)),
+      watcher(),
+      writeTimer(),
+      lastSnapshotMsecs(0),
+      maxSnapshotMsecs(0),
+      lastWriteMsecs(0),
+      numSaves(0),
+      numSkipped(0)
+{
+    timer->setInterval(getInterval() * 1000);
+    connect(timer, SIGNAL(timeout()), this, SLOT(autosave()));
+    connect(&watcher, SIGNAL(finished()), this, SLOT(writeFinished()));
+}
+
+ProjectAutosaver::~ProjectAutosaver()
+{
+    timer->stop();
+    // the worker only references the snapshot, but it must finish before
+    // the watcher goes away
+    waitForWrite();
+}
+
+void ProjectAutosaver::setProject(SketchBio::Project *proj)
+{
+    project = proj;
+}
+
+int ProjectAutosaver::getInterval() const
+{
+    QSettings settings;
+    return settings.value(AUTOSAVE_INTERVAL_SETTING,
+                          DEFAULT_AUTOSAVE_INTERVAL).toInt();
+}
+
+void ProjectAutosaver::setInterval(int seconds)
+{
+    if (seconds < 0) {
+        seconds = 0;
+    }
+    QSettings settings;
+    settings.setValue(AUTOSAVE_INTERVAL_SETTING, seconds);
+    bool wasActive = timer->isActive();
+    timer->stop();
+    timer->setInterval(seconds * 1000);
+    if (wasActive) {
+        start();
+    }
+}
+
+bool ProjectAutosaver::isWriting() const
+{
+    return watcher.isRunning();
+}
+
+void ProjectAutosaver::waitForWrite()
+{
+    watcher.waitForFinished();
+}
+
+QString ProjectAutosaver::getAutosaveFileName() const
+{
+    if (project == NULL) {
+        return QString();
+    }
+    QDir dir(project->getProjectDir());
+    return dir.absoluteFilePath(AUTOSAVE_XML_FILENAME);
+}
+
+bool ProjectAutosaver::writeElementToFileAtomically(vtkXMLDataElement *elem,
+                                                    const QString &filename)
+{
+    QString tmpName = filename + ".tmp";
+    {
+        std::ofstream os(tmpName.toStdString().c_str(),
+                         std::ios::out | std::ios::trunc);
+        if (!os.is_open()) {
+            qDebug() << "Could not open " << tmpName << " for writing.";
+            return false;
+        }
+        vtkIndent indent(0);
+        vtkXMLUtilities::FlattenElement(elem, os, &indent);
+        os.flush();
+        if (!os.good()) {
+            qDebug() << "Error writing " << tmpName;
+            os.close();
+            QFile::remove(tmpName);
+            return false;
+        }
+    }
+    // rename over the old file, on POSIX systems rename replaces the target
+    // atomically, on Windows we have to ask for that explicitly
+#if defined(_WIN32)
+    bool renamed =
+        MoveFileExW(reinterpret_cast< const wchar_t * >(tmpName.utf16()),
+                    reinterpret_cast< const wchar_t * >(filename.utf16()),
+                    MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    bool renamed = std::rename(tmpName.toStdString().c_str(),
+                               filename.toStdString().c_str()) == 0;
+#endif
+    if (!renamed) {
+        qDebug() << "Could not move " << tmpName << " to " << filename;
+        QFile::remove(tmpName);
+    }
+    return renamed;
+}
+
+void ProjectAutosaver::start()
+{
+    int interval = getInterval();
+    if (interval > 0) {
+        timer->start(interval * 1000);
+    }
+}
+
+void ProjectAutosaver::stop()
+{
+    timer->stop();
+}
+
+void ProjectAutosaver::autosave()
+{
+    if (project == NULL) {
+        return;
+    }
+    // never queue up writes behind a slow disk, just wait for the next tick
+    if (watcher.isRunning()) {
+        numSkipped++;
+        return;
+    }
+    QTime snapshotTimer;
+    snapshotTimer.start();
+    // the snapshot is the only part done on the main thread, it only copies
+    // values out of the project.  Building the xml from it and writing it out
+    // are done by the worker
+    QSharedPointer< ProjectSnapshot > snapshot =
+        ProjectToXML::snapshotProject(project);
+    QString filename = getAutosaveFileName();
+    lastSnapshotMsecs = snapshotTimer.elapsed();
+    if (lastSnapshotMsecs > maxSnapshotMsecs) {
+        maxSnapshotMsecs = lastSnapshotMsecs;
+    }
+    if (lastSnapshotMsecs > FRAME_TIME_MSECS) {
+        qDebug() << "Autosave snapshot took" << lastSnapshotMsecs
+                 << "ms, longer than one frame.";
+    }
+    writeTimer.start();
+    watcher.setFuture(QtConcurrent::run(writeSnapshot, snapshot, filename));
+}
+
+void ProjectAutosaver::writeFinished()
+{
+    lastWriteMsecs = writeTimer.elapsed();
+    numSaves++;
+    bool success = watcher.result();
+    if (!success) {
+        qDebug() << "Autosave failed.";
+    }
+    emit autosaveFinished(success);
+}
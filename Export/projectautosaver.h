@@ -0,0 +1,100 @@
+#ifndef PROJECTAUTOSAVER_H
+#define PROJECTAUTOSAVER_H
+
+#include <QObject>
+#include <QString>
+#include <QFutureWatcher>
+#include <QTime>
+
+class QTimer;
+class vtkXMLDataElement;
+
+namespace SketchBio
+{
+class Project;
+}
+
+/*
+ * This class periodically saves the project in the background.  On each
+ * autosave a snapshot of the project's values is taken on the main thread
+ * (see ProjectToXML::snapshotProject).  The snapshot is detached from the
+ * live project so the project may continue to change while a worker thread
+ * builds the xml from it and writes it out.  The file is first
+ * written to a temporary name and then renamed over the autosave file so that
+ * a crash mid-write never leaves a truncated autosave behind.
+ *
+ * Only one write is allowed to be in progress at a time, if the previous write
+ * is still running when the timer fires that autosave is skipped.
+ *
+ * The interval is stored in QSettings (in seconds) so it persists between
+ * runs, an interval of 0 disables autosave.
+ */
+class ProjectAutosaver : public QObject
+{
+    Q_OBJECT
+public:
+    ProjectAutosaver(SketchBio::Project *proj, QObject *parent = 0);
+    virtual ~ProjectAutosaver();
+
+    // Changes the project that is saved.  Any write already in progress is
+    // not affected since it only holds a snapshot of the old project
+    void setProject(SketchBio::Project *proj);
+
+    // Gets/sets the time between autosaves in seconds.  Setting the interval
+    // saves it in the application settings and restarts the timer if it
+    // was running.  An interval of 0 disables autosave.
+    int getInterval() const;
+    void setInterval(int seconds);
+
+    // Returns true if a background write is currently in progress
+    bool isWriting() const;
+    // Blocks until the current background write (if any) is finished
+    void waitForWrite();
+
+    // Timing information for the most recent autosave (in milliseconds).
+    // The snapshot time is the time spent on the main thread, the write time
+    // is the time from handing the snapshot to the worker until it finished
+    // building the xml and writing it.
+    int getLastSnapshotTime() const { return lastSnapshotMsecs; }
+    int getMaxSnapshotTime() const { return maxSnapshotMsecs; }
+    int getLastWriteTime() const { return lastWriteMsecs; }
+    int getNumberOfAutosaves() const { return numSaves; }
+    int getNumberOfSkippedAutosaves() const { return numSkipped; }
+
+    // Gets the filename that the autosave for the current project is written
+    // to (in the project directory)
+    QString getAutosaveFileName() const;
+
+    // Writes the given xml element to the given file by first writing it to a
+    // temporary file and then renaming the temporary file over the target.
+    // Returns true on success.  This does not touch any project state so it
+    // is safe to call from a worker thread.
+    static bool writeElementToFileAtomically(vtkXMLDataElement *elem,
+                                             const QString &filename);
+
+public slots:
+    // Starts the autosave timer (if the interval is nonzero)
+    void start();
+    // Stops the autosave timer, does not cancel a write in progress
+    void stop();
+    // Takes a snapshot of the project and starts writing it in the background
+    // returns immediately unless the snapshot itself is slow
+    void autosave();
+
+signals:
+    // emitted on the main thread when a background write finishes
+    void autosaveFinished(bool success);
+
+private slots:
+    void writeFinished();
+
+private:
+    SketchBio::Project *project;
+    QTimer *timer;
+    QFutureWatcher< bool > watcher;
+    QTime writeTimer;
+    int lastSnapshotMsecs, maxSnapshotMsecs, lastWriteMsecs;
+    int numSaves, numSkipped;
+};
+
+#endif // PROJECTAUTOSAVER_H
@@ -5,6 +5,7 @@
 
 #include <QFile>
 #include <QScopedPointer>
+#include <QSharedPointer>
 #include <QDebug>
 
 #include <vtkSmartPointer.h>
@@ -131,10 +132,9 @@ static inline void writeCreateModel(
                 range[0] =  10.0;
                 range[1] = -10.0;
             }
-            vtkSmartPointer< vtkColorTransferFunction > colors =
-                    vtkSmartPointer< vtkColorTransferFunction >::Take(
-                        model.cmap.getColorMap(range[0],range[1])
-                    );
+            QSharedPointer< const ColorMapType::ColorLookupTable > table =
+                    model.cmap.getLookupTable(range[0],range[1]);
+            vtkColorTransferFunction *colors = table->getTransferFunction();
             QString wrlFilename = fname + "_" + model.cmap.second + "_" +
                     ColorMapType::stringFromColorMap(model.cmap.first);
             fname = ProjectToBlenderAnimation::generateVRMLFileFor(
@@ -236,12 +236,9 @@ static inline void writeCreateObject(
         // get the current color information
         map = obj->getColorMap();
         bool isSolidColor = map.isSolidColor();
-        vtkSmartPointer< vtkColorTransferFunction > cmap =
-            vtkSmartPointer< vtkColorTransferFunction >::Take(
-                    map.getColorMap(0,1));
         const char* useVertexColorString = (isSolidColor) ? "False" : "True";
         double color[3];
-        cmap->GetColor(1.0,color);
+        map.getSolidColor(color);
 		//apply luminance variation
 		double displayLum = obj->getDisplayLuminance(); 
 		color[0] *= displayLum;
@@ -297,11 +294,8 @@ bool ProjectToBlenderAnimation::writeCreateCylinders(
         {
 			ColorMapType::Type type = c->getColorMapType();
             ColorMapType::ColorMap map(type,"modelNum");
-			vtkSmartPointer< vtkColorTransferFunction > cmap =
-				vtkSmartPointer< vtkColorTransferFunction >::Take(
-                map.getColorMap(0,1));
 			double color[3];
-			cmap->GetColor(1.0,color);
+			map.getSolidColor(color);
             
 			q_vec_type p1, p2;
             c->getEnd1WorldPosition(p1);
@@ -326,6 +320,9 @@ bool ProjectToBlenderAnimation::writeKeyframes(
     QScopedPointer<char, QScopedPointerArrayDeleter<char> > buf(new char[4096]);
     unsigned frame = 0;
     file.write("bpy.data.scenes[\"Scene\"].frame_start = 0\n");
+    // sample the animation at the export frame rate so each frame below is
+    // read from the cache
+    proj->getWorldManager().bakeAnimation(frameRate);
     double time = static_cast<double>(frame) / static_cast<double>(frameRate);
     while (!proj->goToAnimationTime(time))
     {
@@ -362,12 +359,9 @@ bool ProjectToBlenderAnimation::writeKeyframes(
                 {
                     const ColorMapType::ColorMap& map = obj->getColorMap();
                     bool isSolidColor = map.isSolidColor();
-                    vtkSmartPointer< vtkColorTransferFunction > cmap =
-                            vtkSmartPointer< vtkColorTransferFunction >::Take(
-                                map.getColorMap(0,1));
                     const char* useVertexColorString = (isSolidColor) ? "False" : "True";
                     double color[3];
-                    cmap->GetColor(1.0,color);
+                    map.getSolidColor(color);
 					double displayLuminance = obj->getDisplayLuminance();
 					color[0] *= displayLuminance;
 					color[1] *= displayLuminance;
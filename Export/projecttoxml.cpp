@@ -8,6 +8,7 @@ using std::strcmp;
 #include <vtkXMLDataElement.h>
 #include <vtkXMLUtilities.h>
 
+#include <QtConcurrentMap>
 #include <QScopedPointer>
 #include <QDebug>
 #include <QFile>
@@ -19,8 +20,10 @@ using std::strcmp;
 #include <sketchioconstants.h>
 #include <transformmanager.h>
 #include <keyframe.h>
+#include <keyframestore.h>
 #include <sketchmodel.h>
 #include <modelmanager.h>
+#include <modelstore.h>
 #include <modelinstance.h>
 #include <objectgroup.h>
 #include <springconnection.h>
@@ -133,35 +136,352 @@ inline void setPreciseVectorAttribute(vtkXMLDataElement* elem,
   elem->SetAttribute(attrName, data.trimmed().toStdString().c_str());
 }
 
+// The parts of a project that are saved, copied out of the live objects (see
+// ProjectToXML::snapshotProject).  Ids are assigned while the copy is made
+// and references between objects are kept as ids, so building the xml from a
+// snapshot never touches the project.
+
+// the resolutions that are saved for each conformation of a model, the full
+// resolution is always saved, the others only if the model has them
+static const ModelResolution::ResolutionType SAVED_RESOLUTIONS[] = {
+  ModelResolution::FULL_RESOLUTION,
+  ModelResolution::SIMPLIFIED_FULL_RESOLUTION,
+  ModelResolution::SIMPLIFIED_5000, ModelResolution::SIMPLIFIED_2000,
+  ModelResolution::SIMPLIFIED_1000
+};
+#define NUM_SAVED_RESOLUTIONS \
+  (sizeof(SAVED_RESOLUTIONS) / sizeof(SAVED_RESOLUTIONS[0]))
+
+struct ModelSnapshot {
+  QString id;
+  double inverseMass, inverseMoment;
+  // the source of each conformation
+  QVector< QString > sources;
+  // NUM_SAVED_RESOLUTIONS filenames per conformation, relative to the project
+  // directory if they are in it and empty if the model does not have that
+  // resolution
+  QVector< QString > filenames;
+};
+
+struct ObjectSnapshot {
+  QString id;
+  int numInstances;
+  // these are only set if the object is not a group
+  QString modelId;
+  ColorMapType::Type colorMap;
+  QString arrayToColorBy;
+  double luminance;
+
+  int conformation;
+  bool visible, active;
+  q_vec_type position;
+  q_type orientation;
+  // copying the store is cheap, the copies share its arrays until one of
+  // them is changed
+  KeyframeStore keyframes;
+  // the id of the parent of each keyframe, or "NULL"
+  QVector< QString > keyframeParentIds;
+  QList< ObjectSnapshot > subObjects;
+};
+
+struct ReplicatorSnapshot {
+  int numShown;
+  QString object1Id, object2Id, replicaGroupId;
+  QVector< QString > replicaIds;
+};
+
+struct ConnectorSnapshot {
+  double alpha, radius;
+  ColorMapType::Type colorMap;
+  bool isSpring, isMeasuringTape;
+  double stiffness, minRestLength, maxRestLength;
+  // how many ends are attached to objects (if only one is, it is the first
+  // one in the snapshot)
+  int numObjectEnds;
+  QString object1Id, object2Id;
+  // the connection points on the objects, or the world positions of the ends
+  // that are not attached
+  q_vec_type point1, point2;
+};
+
+class ProjectSnapshot
+{
+ public:
+  double minLuminance, maxLuminance;
+  QList< ModelSnapshot > models;
+  double worldToRoom[16], roomToEye[16];
+  QList< ObjectSnapshot > objects;
+  QList< ReplicatorSnapshot > replicators;
+  QList< ConnectorSnapshot > connectors;
+  QList< QVector< QPair< QString, QString > > > transformOps;
+};
+
+static ModelSnapshot snapshotModel(const SketchModel* model,
+                                   const QString& dir, const QString& id)
+{
+  ModelSnapshot snapshot;
+  snapshot.id = id;
+  snapshot.inverseMass = model->getInverseMass();
+  snapshot.inverseMoment = model->getInverseMomentOfInertia();
+  int numConformations = model->getNumberOfConformations();
+  snapshot.sources.reserve(numConformations);
+  snapshot.filenames.reserve(numConformations * NUM_SAVED_RESOLUTIONS);
+  for (int i = 0; i < numConformations; i++) {
+    snapshot.sources.append(model->getSource(i));
+    for (unsigned r = 0; r < NUM_SAVED_RESOLUTIONS; r++) {
+      QString filename = model->getFileNameFor(i, SAVED_RESOLUTIONS[r]);
+      if (dir.size() > 0 && filename.startsWith(dir)) {
+        filename = filename.mid(dir.length() + 1);
+      }
+      snapshot.filenames.append(filename);
+    }
+  }
+  return snapshot;
+}
+
+// snapshots the models used by the object that are not in modelIds yet
+static void snapshotModelsOf(const SketchObject* object,
+                             QHash< const SketchModel*, QString >& modelIds,
+                             QList< ModelSnapshot >& models)
+{
+  if (object->numInstances() == 1) {
+    const SketchModel* model = object->getModel();
+    if (!modelIds.contains(model)) {
+      QString idStr = QString("M%1").arg(modelIds.size());
+      models.append(snapshotModel(model, "", idStr));
+      modelIds.insert(model, idStr);
+    }
+  } else {
+    const QList< SketchObject* >* subObjs = object->getSubObjects();
+    for (QListIterator< SketchObject* > it(*subObjs); it.hasNext();) {
+      SketchObject* obj = it.next();
+      if (!modelIds.contains(obj->getModel())) {
+        snapshotModelsOf(obj, modelIds, models);
+      }
+    }
+  }
+}
+
+static ObjectSnapshot snapshotObject(
+    const SketchObject* object,
+    const QHash< const SketchModel*, QString >& modelIds,
+    QHash< const SketchObject*, QString >& objectIds, bool saveKeyframes)
+{
+  ObjectSnapshot snapshot;
+  if (objectIds.contains(object)) {
+    snapshot.id = objectIds.value(object);
+  } else {
+    snapshot.id = QString("O%1").arg(objectIds.size());
+  }
+  // do this here now so object and its children don't have same id
+  objectIds.insert(object, snapshot.id);
+  snapshot.numInstances = object->numInstances();
+  if (snapshot.numInstances == 1) {
+    QHash< const SketchModel*, QString >::const_iterator itr =
+        modelIds.constFind(object->getModel());
+    if (itr == modelIds.constEnd()) {
+      std::cout << "Error finding model." << std::endl;
+    } else {
+      snapshot.modelId = itr.value();
+    }
+    snapshot.colorMap = object->getColorMapType();
+    snapshot.arrayToColorBy = object->getArrayToColorBy();
+    snapshot.luminance = object->getLuminance();
+  }
+  snapshot.conformation = object->getModelConformation();
+  snapshot.visible = object->isVisible();
+  snapshot.active = object->isActive();
+  object->getPosition(snapshot.position);
+  object->getOrientation(snapshot.orientation);
+
+  if (saveKeyframes && object->getNumKeyframes() > 0) {
+    snapshot.keyframes = *object->getKeyframeStore();
+    const KeyframeStore& frames = snapshot.keyframes;
+    snapshot.keyframeParentIds.reserve(frames.size());
+    for (int i = 0; i < frames.size(); i++) {
+      SketchObject* parent = frames.getParent(i);
+      if (parent == NULL) {
+        snapshot.keyframeParentIds.append("NULL");
+      } else if (objectIds.contains(parent)) {
+        snapshot.keyframeParentIds.append(objectIds.value(parent));
+      } else {
+        QString parentId = QString("O%1").arg(objectIds.size());
+        objectIds.insert(parent, parentId);
+        snapshot.keyframeParentIds.append(parentId);
+      }
+    }
+  }
+
+  if (snapshot.numInstances != 1 && snapshot.numInstances != 0) {
+    const QList< SketchObject* >* subObjs = object->getSubObjects();
+    for (QListIterator< SketchObject* > it(*subObjs); it.hasNext();) {
+      snapshot.subObjects.append(
+          snapshotObject(it.next(), modelIds, objectIds, saveKeyframes));
+    }
+  }
+  return snapshot;
+}
+
+static void snapshotMatrix(const vtkMatrix4x4* matrix, double mat[16])
+{
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++) {
+      mat[i * 4 + j] = matrix->GetElement(i, j);
+    }
+  }
+}
+
+// returns false if the connector is not saved
+static bool snapshotConnector(
+    const Connector* conn,
+    const QHash< const SketchObject*, QString >& objectIds,
+    ConnectorSnapshot& snapshot)
+{
+  const MeasuringTape* tape = dynamic_cast< const MeasuringTape* >(conn);
+  if (conn->getObject1() == conn->getObject2()) {
+    // allows measuring tapes to be saved even when not connected
+    // to any objects, but not springs or transparent connectors
+    if (!(tape != NULL && conn->getObject1() == NULL)) {
+      return false;
+    }
+  }
+  const SpringConnection* spring =
+      dynamic_cast< const SpringConnection* >(conn);
+  snapshot.alpha = conn->getAlpha();
+  snapshot.radius = conn->getRadius();
+  snapshot.colorMap = conn->getColorMapType();
+  snapshot.isSpring = (spring != NULL);
+  snapshot.isMeasuringTape = (tape != NULL);
+  if (spring != NULL) {
+    snapshot.stiffness = spring->getStiffness();
+    snapshot.minRestLength = spring->getMinRestLength();
+    snapshot.maxRestLength = spring->getMaxRestLength();
+  }
+  if (conn->getObject1() != NULL && conn->getObject2() != NULL) {
+    snapshot.numObjectEnds = 2;
+    snapshot.object1Id = objectIds.value(conn->getObject1());
+    snapshot.object2Id = objectIds.value(conn->getObject2());
+    conn->getObject1ConnectionPosition(snapshot.point1);
+    conn->getObject2ConnectionPosition(snapshot.point2);
+  } else if (conn->getObject1() != NULL) {
+    snapshot.numObjectEnds = 1;
+    snapshot.object1Id = objectIds.value(conn->getObject1());
+    conn->getObject1ConnectionPosition(snapshot.point1);
+    conn->getEnd2WorldPosition(snapshot.point2);
+  } else if (conn->getObject2() != NULL) {
+    snapshot.numObjectEnds = 1;
+    snapshot.object1Id = objectIds.value(conn->getObject2());
+    conn->getObject2ConnectionPosition(snapshot.point1);
+    conn->getEnd1WorldPosition(snapshot.point2);
+  } else {
+    snapshot.numObjectEnds = 0;
+    conn->getEnd1WorldPosition(snapshot.point1);
+    conn->getEnd2WorldPosition(snapshot.point2);
+  }
+  return true;
+}
+
+QSharedPointer< ProjectSnapshot > ProjectToXML::snapshotProject(
+    const SketchBio::Project* project)
+{
+  QSharedPointer< ProjectSnapshot > snapshot(new ProjectSnapshot());
+  const WorldManager& world = project->getWorldManager();
+  snapshot->minLuminance = world.getMinLuminance();
+  snapshot->maxLuminance = world.getMaxLuminance();
+
+  QHash< const SketchModel*, QString > modelIds;
+  QHash< const SketchObject*, QString > objectIds;
+
+  const ModelManager& models = project->getModelManager();
+  modelIds.reserve(models.getNumberOfModels());
+  QVectorIterator< SketchModel* > mit = models.getModelIterator();
+  while (mit.hasNext()) {
+    const SketchModel* model = mit.next();
+    QString idStr = QString("M%1").arg(modelIds.size());
+    snapshot->models.append(
+        snapshotModel(model, project->getProjectDir(), idStr));
+    modelIds.insert(model, idStr);
+  }
+
+  const TransformManager& transforms = project->getTransformManager();
+  snapshotMatrix(transforms.getWorldToRoomMatrix(), snapshot->worldToRoom);
+  snapshotMatrix(transforms.getRoomToEyeMatrix(), snapshot->roomToEye);
+
+  for (QListIterator< SketchObject* > it(*world.getObjects()); it.hasNext();) {
+    snapshot->objects.append(
+        snapshotObject(it.next(), modelIds, objectIds, true));
+  }
+
+  const QList< StructureReplicator* >& replicators =
+      project->getCrystalByExamples();
+  for (QListIterator< StructureReplicator* > it(replicators); it.hasNext();) {
+    StructureReplicator* rep = it.next();
+    ReplicatorSnapshot repSnapshot;
+    repSnapshot.numShown = rep->getNumShown();
+    // i'm not checking contains, it had better be in there
+    repSnapshot.object1Id = objectIds.value(rep->getFirstObject());
+    repSnapshot.object2Id = objectIds.value(rep->getSecondObject());
+    repSnapshot.replicaGroupId = objectIds.value(rep->getReplicaGroup());
+    for (QListIterator< SketchObject* > itr(rep->getReplicaIterator());
+         itr.hasNext();) {
+      repSnapshot.replicaIds.append(objectIds.value(itr.next()));
+    }
+    snapshot->replicators.append(repSnapshot);
+  }
+
+  for (QListIterator< Connector* > it = world.getSpringsIterator();
+       it.hasNext();) {
+    ConnectorSnapshot connSnapshot;
+    if (snapshotConnector(it.next(), objectIds, connSnapshot)) {
+      snapshot->connectors.append(connSnapshot);
+    }
+  }
+
+  const QVector< QSharedPointer< TransformEquals > >& ops =
+      project->getTransformOps();
+  for (int i = 0; i < ops.size(); i++) {
+    QSharedPointer< TransformEquals > op(ops.at(i));
+    if (!op) continue;
+    QVector< QPair< QString, QString > > pairs;
+    const QVector< ObjectPair >* v = op->getPairsList();
+    for (int j = 0; j < v->size(); j++) {
+      pairs.append(qMakePair(objectIds.value(v->at(j).o1),
+                             objectIds.value(v->at(j).o2)));
+    }
+    snapshot->transformOps.append(pairs);
+  }
+  return snapshot;
+}
+
 vtkXMLDataElement* ProjectToXML::projectToXML(const SketchBio::Project* project)
+{
+  return snapshotToXML(*snapshotProject(project));
+}
+
+vtkXMLDataElement* ProjectToXML::snapshotToXML(const ProjectSnapshot& snapshot)
 {
   vtkXMLDataElement* element = vtkXMLDataElement::New();
   element->SetName(ROOT_ELEMENT_NAME);
   element->SetAttribute(VERSION_ATTRIBUTE_NAME,
                         SAVE_VERSION_NUM.toStdString().c_str());
-  double minLum = project->getWorldManager().getMinLuminance();
-  setPreciseVectorAttribute(element, &minLum, 1, MIN_LUMINANCE_ATTRIBUTE_NAME);
-  double maxLum = project->getWorldManager().getMaxLuminance();
-  setPreciseVectorAttribute(element, &maxLum, 1, MAX_LUMINANCE_ATTRIBUTE_NAME);
-
-  QHash< const SketchModel*, QString > modelIds;
-  QHash< const SketchObject*, QString > objectIds;
+  setPreciseVectorAttribute(element, &snapshot.minLuminance, 1,
+                            MIN_LUMINANCE_ATTRIBUTE_NAME);
+  setPreciseVectorAttribute(element, &snapshot.maxLuminance, 1,
+                            MAX_LUMINANCE_ATTRIBUTE_NAME);
 
   vtkSmartPointer< vtkXMLDataElement > child =
-      vtkSmartPointer< vtkXMLDataElement >::Take(modelManagerToXML(
-          project->getModelManager(), project->getProjectDir(), modelIds));
+      vtkSmartPointer< vtkXMLDataElement >::Take(
+          modelListToXML(snapshot.models));
   element->AddNestedElement(child);
-  child.TakeReference(transformManagerToXML(project->getTransformManager()));
+  child.TakeReference(transformManagerToXML(snapshot));
   element->AddNestedElement(child);
-  child.TakeReference(
-      objectListToXML(project->getWorldManager(), modelIds, objectIds));
+  child.TakeReference(objectListToXML(snapshot.objects));
   element->AddNestedElement(child);
-  child.TakeReference(replicatorListToXML(project->getCrystalByExamples(), objectIds));
+  child.TakeReference(replicatorListToXML(snapshot.replicators));
   element->AddNestedElement(child);
-  child.TakeReference(springListToXML(project->getWorldManager(), objectIds));
+  child.TakeReference(connectorListToXML(snapshot.connectors));
   element->AddNestedElement(child);
-  child.TakeReference(
-      transformOpListToXML(project->getTransformOps(), objectIds));
+  child.TakeReference(transformOpListToXML(snapshot.transformOps));
   element->AddNestedElement(child);
 
   return element;
@@ -177,79 +497,28 @@ vtkXMLDataElement* ProjectToXML::objectToClipboardXML(
 
   QHash< const SketchModel*, QString > modelIds;
   QHash< const SketchObject*, QString > objectIds;
+  QList< ModelSnapshot > models;
+  snapshotModelsOf(object, modelIds, models);
+  QList< ObjectSnapshot > objects;
+  objects.append(snapshotObject(object, modelIds, objectIds, false));
 
   vtkSmartPointer< vtkXMLDataElement > child =
-      vtkSmartPointer< vtkXMLDataElement >::Take(modelsToXML(object, modelIds));
+      vtkSmartPointer< vtkXMLDataElement >::Take(modelListToXML(models));
   element->AddNestedElement(child);
-  child = vtkSmartPointer< vtkXMLDataElement >::New();
-  child->SetName(OBJECTLIST_ELEMENT_NAME);
-  vtkSmartPointer< vtkXMLDataElement > objectXML =
-      vtkSmartPointer< vtkXMLDataElement >::Take(
-          objectToXML(object, modelIds, objectIds, false));
-  child->AddNestedElement(objectXML);
+  child.TakeReference(objectListToXML(objects));
   element->AddNestedElement(child);
   return element;
 }
 
-vtkXMLDataElement* ProjectToXML::modelManagerToXML(
-    const ModelManager &models, const QString& dir,
-    QHash< const SketchModel*, QString >& modelIds)
+vtkXMLDataElement* ProjectToXML::modelListToXML(
+    const QList< ModelSnapshot >& models)
 {
   vtkXMLDataElement* element = vtkXMLDataElement::New();
   element->SetName(MODEL_MANAGER_ELEMENT_NAME);
-  modelIds.reserve(models.getNumberOfModels());
-
-  int id = 0;
-
-  QVectorIterator< SketchModel* > it = models.getModelIterator();
-  while (it.hasNext()) {
-    const SketchModel* model = it.next();
-    QString idStr = QString("M%1").arg(id);
+  for (QListIterator< ModelSnapshot > it(models); it.hasNext();) {
     vtkSmartPointer< vtkXMLDataElement > child =
-        vtkSmartPointer< vtkXMLDataElement >::Take(
-            modelToXML(model, dir, idStr));
+        vtkSmartPointer< vtkXMLDataElement >::Take(modelToXML(it.next()));
     element->AddNestedElement(child);
-    modelIds.insert(model, idStr);
-    id++;
-  }
-
-  return element;
-}
-
-vtkXMLDataElement* ProjectToXML::modelsToXML(
-    const SketchObject* object, QHash< const SketchModel*, QString >& modelIds)
-{
-  vtkXMLDataElement* element = vtkXMLDataElement::New();
-  element->SetName(MODEL_MANAGER_ELEMENT_NAME);
-
-  if (object->numInstances() == 1) {
-    const SketchModel* model = object->getModel();
-    QString idStr = QString("M%1").arg(modelIds.size());
-    QString dir = "";
-    vtkSmartPointer< vtkXMLDataElement > child =
-        vtkSmartPointer< vtkXMLDataElement >::Take(
-            modelToXML(model, dir, idStr));
-    if (!modelIds.contains(model)) {
-      element->AddNestedElement(child);
-      modelIds.insert(model, idStr);
-    }
-  } else {
-    const QList< SketchObject* >* subObjs = object->getSubObjects();
-
-    for (QListIterator< SketchObject* > it(*subObjs); it.hasNext();) {
-      SketchObject* obj = it.next();
-      if (!modelIds.contains(obj->getModel())) {
-        vtkSmartPointer< vtkXMLDataElement > child =
-            vtkSmartPointer< vtkXMLDataElement >::Take(
-                modelsToXML(obj, modelIds));
-        for (int i = child->GetNumberOfNestedElements() - 1; i >= 0; i--) {
-          vtkSmartPointer< vtkXMLDataElement > subObj =
-              child->GetNestedElement(i);
-          child->RemoveNestedElement(subObj);
-          element->AddNestedElement(subObj);
-        }
-      }
-    }
   }
   return element;
 }
@@ -288,25 +557,24 @@ inline ModelResolution::ResolutionType getResolutionTypeFromId(const char* r)
   }
 }
 
-vtkXMLDataElement* ProjectToXML::modelToXML(const SketchModel* model,
-                                            const QString& dir,
-                                            const QString& id)
+vtkXMLDataElement* ProjectToXML::modelToXML(const ModelSnapshot& model)
 {
   vtkXMLDataElement* element = vtkXMLDataElement::New();
   element->SetName(MODEL_ELEMENT_NAME);
-  element->SetAttribute(ID_ATTRIBUTE_NAME, id.toStdString().c_str());
+  element->SetAttribute(ID_ATTRIBUTE_NAME, model.id.toStdString().c_str());
+  int numConformations = model.sources.size();
   element->SetIntAttribute(MODEL_NUM_CONFORMATIONS_ATTR_NAME,
-                           model->getNumberOfConformations());
+                           numConformations);
   vtkSmartPointer< vtkXMLDataElement > properties =
       vtkSmartPointer< vtkXMLDataElement >::New();
   properties->SetName(PROPERTIES_ELEMENT_NAME);
-  double d = model->getInverseMass();
-  setPreciseVectorAttribute(properties, &d, 1, MODEL_IMASS_ATTRIBUTE_NAME);
-  d = model->getInverseMomentOfInertia();
-  setPreciseVectorAttribute(properties, &d, 1, MODEL_IMOMENT_ATTRIBUTE_NAME);
+  setPreciseVectorAttribute(properties, &model.inverseMass, 1,
+                            MODEL_IMASS_ATTRIBUTE_NAME);
+  setPreciseVectorAttribute(properties, &model.inverseMoment, 1,
+                            MODEL_IMOMENT_ATTRIBUTE_NAME);
   element->AddNestedElement(properties);
 
-  for (int i = 0; i < model->getNumberOfConformations(); i++) {
+  for (int i = 0; i < numConformations; i++) {
     vtkSmartPointer< vtkXMLDataElement > conformationElt =
         vtkSmartPointer< vtkXMLDataElement >::New();
     conformationElt->SetName(MODEL_CONFORMATION_ELEMENT_NAME);
@@ -314,74 +582,20 @@ vtkXMLDataElement* ProjectToXML::modelToXML(const SketchModel* model,
     vtkSmartPointer< vtkXMLDataElement > child =
         vtkSmartPointer< vtkXMLDataElement >::New();
     child->SetName(MODEL_SOURCE_ELEMENT_NAME);
-    QString src = model->getSource(i);
+    const QString& src = model.sources[i];
     child->SetCharacterData(src.toStdString().c_str(), src.length() + 1);
     conformationElt->AddNestedElement(child);
-    QString filename;
-    filename = model->getFileNameFor(i, ModelResolution::FULL_RESOLUTION);
-    if (dir.size() > 0 && filename.startsWith(dir)) {
-      filename = filename.mid(dir.length() + 1);
-    }
-    child = vtkSmartPointer< vtkXMLDataElement >::New();
-    child->SetName(MODEL_RESOLUTION_ELEMENT_NAME);
-    child->SetAttribute(ID_ATTRIBUTE_NAME,
-                        getResolutionString(ModelResolution::FULL_RESOLUTION));
-    child->SetAttribute(MODEL_FILENAME_ATTRIBUTE_NAME,
-                        filename.toStdString().c_str());
-    conformationElt->AddNestedElement(child);
-    filename =
-        model->getFileNameFor(i, ModelResolution::SIMPLIFIED_FULL_RESOLUTION);
-    if (filename.length() > 0) {
-      if (dir.size() > 0 && filename.startsWith(dir)) {
-        filename = filename.mid(dir.length() + 1);
-      }
-      child = vtkSmartPointer< vtkXMLDataElement >::New();
-      child->SetName(MODEL_RESOLUTION_ELEMENT_NAME);
-      child->SetAttribute(
-          ID_ATTRIBUTE_NAME,
-          getResolutionString(ModelResolution::SIMPLIFIED_FULL_RESOLUTION));
-      child->SetAttribute(MODEL_FILENAME_ATTRIBUTE_NAME,
-                          filename.toStdString().c_str());
-      conformationElt->AddNestedElement(child);
-    }
-    filename = model->getFileNameFor(i, ModelResolution::SIMPLIFIED_5000);
-    if (filename.length() > 0) {
-      if (dir.size() > 0 && filename.startsWith(dir)) {
-        filename = filename.mid(dir.length() + 1);
-      }
-      child = vtkSmartPointer< vtkXMLDataElement >::New();
-      child->SetName(MODEL_RESOLUTION_ELEMENT_NAME);
-      child->SetAttribute(
-          ID_ATTRIBUTE_NAME,
-          getResolutionString(ModelResolution::SIMPLIFIED_5000));
-      child->SetAttribute(MODEL_FILENAME_ATTRIBUTE_NAME,
-                          filename.toStdString().c_str());
-      conformationElt->AddNestedElement(child);
-    }
-    filename = model->getFileNameFor(i, ModelResolution::SIMPLIFIED_2000);
-    if (filename.length() > 0) {
-      if (dir.size() > 0 && filename.startsWith(dir)) {
-        filename = filename.mid(dir.length() + 1);
-      }
-      child = vtkSmartPointer< vtkXMLDataElement >::New();
-      child->SetName(MODEL_RESOLUTION_ELEMENT_NAME);
-      child->SetAttribute(
-          ID_ATTRIBUTE_NAME,
-          getResolutionString(ModelResolution::SIMPLIFIED_2000));
-      child->SetAttribute(MODEL_FILENAME_ATTRIBUTE_NAME,
-                          filename.toStdString().c_str());
-      conformationElt->AddNestedElement(child);
-    }
-    filename = model->getFileNameFor(i, ModelResolution::SIMPLIFIED_1000);
-    if (filename.length() > 0) {
-      if (dir.size() > 0 && filename.startsWith(dir)) {
-        filename = filename.mid(dir.length() + 1);
+    for (unsigned r = 0; r < NUM_SAVED_RESOLUTIONS; r++) {
+      const QString& filename =
+          model.filenames[i * NUM_SAVED_RESOLUTIONS + r];
+      // the full resolution is always saved
+      if (r != 0 && filename.length() == 0) {
+        continue;
       }
       child = vtkSmartPointer< vtkXMLDataElement >::New();
       child->SetName(MODEL_RESOLUTION_ELEMENT_NAME);
-      child->SetAttribute(
-          ID_ATTRIBUTE_NAME,
-          getResolutionString(ModelResolution::SIMPLIFIED_1000));
+      child->SetAttribute(ID_ATTRIBUTE_NAME,
+                          getResolutionString(SAVED_RESOLUTIONS[r]));
       child->SetAttribute(MODEL_FILENAME_ATTRIBUTE_NAME,
                           filename.toStdString().c_str());
       conformationElt->AddNestedElement(child);
@@ -393,14 +607,8 @@ vtkXMLDataElement* ProjectToXML::modelToXML(const SketchModel* model,
 }
 
 inline vtkXMLDataElement* matrixToXML(const char* elementName,
-                                      const vtkMatrix4x4* matrix)
+                                      const double mat[16])
 {
-  double mat[16];
-  for (int i = 0; i < 4; i++) {
-    for (int j = 0; j < 4; j++) {
-      mat[i * 4 + j] = matrix->GetElement(i, j);
-    }
-  }
   vtkXMLDataElement* child = vtkXMLDataElement::New();
   child->SetName(elementName);
   setPreciseVectorAttribute(child, mat, 16, TRANSFORM_MATRIX_ATTRIBUTE_NAME);
@@ -408,131 +616,92 @@ inline vtkXMLDataElement* matrixToXML(const char* elementName,
 }
 
 vtkXMLDataElement* ProjectToXML::transformManagerToXML(
-    const TransformManager &transforms)
+    const ProjectSnapshot& snapshot)
 {
   vtkXMLDataElement* element = vtkXMLDataElement::New();
   element->SetName(TRANSFORM_MANAGER_ELEMENT_NAME);
 
   vtkSmartPointer< vtkXMLDataElement > child =
-      vtkSmartPointer< vtkXMLDataElement >::Take(
-          matrixToXML(TRANSFORM_WORLD_TO_ROOM_ELEMENT_NAME,
-                      transforms.getWorldToRoomMatrix()));
+      vtkSmartPointer< vtkXMLDataElement >::Take(matrixToXML(
+          TRANSFORM_WORLD_TO_ROOM_ELEMENT_NAME, snapshot.worldToRoom));
   element->AddNestedElement(child);
-  child.TakeReference(matrixToXML(TRANSFORM_ROOM_TO_EYE_ELEMENT_NAME,
-                                  transforms.getRoomToEyeMatrix()));
+  child.TakeReference(
+      matrixToXML(TRANSFORM_ROOM_TO_EYE_ELEMENT_NAME, snapshot.roomToEye));
   element->AddNestedElement(child);
 
   return element;
 }
 
 vtkXMLDataElement* ProjectToXML::objectListToXML(
-    const WorldManager &world,
-    const QHash< const SketchModel*, QString >& modelIds,
-    QHash< const SketchObject*, QString >& objectIds)
-{
-  return objectListToXML(world.getObjects(), modelIds, objectIds);
-}
-
-vtkXMLDataElement* ProjectToXML::objectListToXML(
-    const QList< SketchObject* >* objectList,
-    const QHash< const SketchModel*, QString >& modelIds,
-    QHash< const SketchObject*, QString >& objectIds,
-	bool saveKeyframes)
+    const QList< ObjectSnapshot >& objectList)
 {
   vtkXMLDataElement* element = vtkXMLDataElement::New();
   element->SetName(OBJECTLIST_ELEMENT_NAME);
-  for (QListIterator< SketchObject* > it(*objectList); it.hasNext();) {
-    const SketchObject* obj = it.next();
+  for (QListIterator< ObjectSnapshot > it(objectList); it.hasNext();) {
     vtkSmartPointer< vtkXMLDataElement > child =
-        vtkSmartPointer< vtkXMLDataElement >::Take(
-            objectToXML(obj, modelIds, objectIds, saveKeyframes));
+        vtkSmartPointer< vtkXMLDataElement >::Take(objectToXML(it.next()));
     element->AddNestedElement(child);
   }
   return element;
 }
 
-vtkXMLDataElement* ProjectToXML::objectToXML(
-    const SketchObject* object,
-    const QHash< const SketchModel*, QString >& modelIds,
-    QHash< const SketchObject*, QString >& objectIds,
-	bool saveKeyframes)
+vtkXMLDataElement* ProjectToXML::objectToXML(const ObjectSnapshot& object)
 {
   vtkXMLDataElement* element = vtkXMLDataElement::New();
   element->SetName(OBJECT_ELEMENT_NAME);
-  QString id;
-  if (objectIds.contains(object)) {
-	  id = objectIds.value(object);
-  }
-  else {
-	  id = QString("O%1").arg(objectIds.size());
-  }
-  element->SetAttribute(ID_ATTRIBUTE_NAME, (id.toStdString()).c_str());
-  // do this here now so object and its children don't have same id
-  objectIds.insert(object, id);
-  bool isGroup = object->numInstances() != 1;
+  element->SetAttribute(ID_ATTRIBUTE_NAME, object.id.toStdString().c_str());
+  bool isGroup = object.numInstances != 1;
   element->SetIntAttribute(OBJECT_NUM_INSTANCES_ATTRIBUTE_NAME,
-                           object->numInstances());
+                           object.numInstances);
 
   vtkSmartPointer< vtkXMLDataElement > child =
       vtkSmartPointer< vtkXMLDataElement >::New();
   child->SetName(PROPERTIES_ELEMENT_NAME);
   if (!isGroup) {
     QString modelId("#");
-    QHash< const SketchModel*, QString >::const_iterator itr =
-        modelIds.constFind(object->getModel());
-    if (itr == modelIds.constEnd())
-      std::cout << "Error finding model." << std::endl;
-    QString idx = itr.value();
-    modelId = modelId.append(idx);
+    modelId = modelId.append(object.modelId);
     child->SetAttribute(OBJECT_MODELID_ATTRIBUTE_NAME,
                         modelId.toStdString().c_str());
-    ColorMapType::Type cmap = object->getColorMapType();
-    const QString& array = object->getArrayToColorBy();
     child->SetAttribute(OBJECT_COLOR_MAP_ATTRIBUTE_NAME,
-                        ColorMapType::stringFromColorMap(cmap));
+                        ColorMapType::stringFromColorMap(object.colorMap));
     child->SetAttribute(OBJECT_ARRAY_TO_COLOR_BY_ATTR_NAME,
-                        array.toStdString().c_str());
-	double lum = object->getLuminance();
-	setPreciseVectorAttribute(child, &lum, 1, OBJECT_LUMINANCE_ATTRIBUTE_NAME);
+                        object.arrayToColorBy.toStdString().c_str());
+    setPreciseVectorAttribute(child, &object.luminance, 1,
+                              OBJECT_LUMINANCE_ATTRIBUTE_NAME);
   }
   child->SetIntAttribute(OBJECT_MODEL_CONF_NUM_ATTR_NAME,
-                         object->getModelConformation());
+                         object.conformation);
   // Current thoughts: collision groups should be recreated from
   //   effects placed on objects being recreated.
   //   There is no reason that they should need to be saved.
   child->SetAttribute(OBJECT_VISIBILITY_ATTRIBUTE_NAME,
-                      object->isVisible() ? "true" : "false");
+                      object.visible ? "true" : "false");
   child->SetAttribute(OBJECT_ACTIVE_ATTRIBUTE_NAME,
-                      object->isActive() ? "true" : "false");
+                      object.active ? "true" : "false");
 
   element->AddNestedElement(child);
 
   child = vtkSmartPointer< vtkXMLDataElement >::New();
   child->SetName(TRANSFORM_ELEMENT_NAME);
-  q_vec_type pos;
-  q_type orient;
-  object->getPosition(pos);
-  object->getOrientation(orient);
-  setPreciseVectorAttribute(child, pos, 3, POSITION_ATTRIBUTE_NAME);
-  setPreciseVectorAttribute(child, orient, 4, ROTATION_ATTRIBUTE_NAME);
+  setPreciseVectorAttribute(child, object.position, 3,
+                            POSITION_ATTRIBUTE_NAME);
+  setPreciseVectorAttribute(child, object.orientation, 4,
+                            ROTATION_ATTRIBUTE_NAME);
   element->AddNestedElement(child);
 
-  if (saveKeyframes && object->getNumKeyframes() > 0) {
+  const KeyframeStore& frames = object.keyframes;
+  if (frames.size() > 0) {
     // object has keyframes, save them
     child = vtkSmartPointer< vtkXMLDataElement >::New();
     child->SetName(OBJECT_KEYFRAME_LIST_ELEMENT_NAME);
-    const QMap< double, Keyframe >* keyframeMap = object->getKeyframes();
-    QMapIterator< double, Keyframe > it(*keyframeMap);
-    while (it.hasNext()) {
-      double time = it.peekNext().key();
-      const Keyframe& frame = it.next().value();
+    for (int i = 0; i < frames.size(); i++) {
+      double time = frames.getTime(i);
       q_vec_type p, pabs;
       q_type o, oabs;
-      frame.getPosition(p);
-      frame.getOrientation(o);
-	  frame.getAbsolutePosition(pabs);
-	  frame.getAbsoluteOrientation(oabs);
-	  int level = frame.getLevel();
+      frames.getPosition(i, p);
+      frames.getOrientation(i, o);
+      frames.getAbsolutePosition(i, pabs);
+      frames.getAbsoluteOrientation(i, oabs);
       vtkSmartPointer< vtkXMLDataElement > frameElement =
           vtkSmartPointer< vtkXMLDataElement >::New();
       frameElement->SetName(OBJECT_KEYFRAME_ELEMENT_NAME);
@@ -544,7 +713,7 @@ vtkXMLDataElement* ProjectToXML::objectToXML(
       setPreciseVectorAttribute(tfrm, p, 3, POSITION_ATTRIBUTE_NAME);
       setPreciseVectorAttribute(tfrm, o, 4, ROTATION_ATTRIBUTE_NAME);
       frameElement->AddNestedElement(tfrm);
-	  vtkSmartPointer< vtkXMLDataElement > absTfrm =
+      vtkSmartPointer< vtkXMLDataElement > absTfrm =
           vtkSmartPointer< vtkXMLDataElement >::New();
       absTfrm->SetName(OBJECT_KEYFRAME_ABSTRFM_ELEMENT_NAME);
       setPreciseVectorAttribute(absTfrm, pabs, 3, POSITION_ATTRIBUTE_NAME);
@@ -554,45 +723,32 @@ vtkXMLDataElement* ProjectToXML::objectToXML(
           vtkSmartPointer< vtkXMLDataElement >::New();
       visibility->SetName(PROPERTIES_ELEMENT_NAME);
       visibility->SetAttribute(OBJECT_KEYFRAME_VIS_AF_ATTR_NAME,
-                               (frame.isVisibleAfter() ? "true" : "false"));
+                               (frames.isVisibleAfter(i) ? "true" : "false"));
       visibility->SetAttribute(OBJECT_KEYFRAME_ACTIVE_ATTR_NAME,
-                               (frame.isActive() ? "true" : "false"));
+                               (frames.isActive(i) ? "true" : "false"));
       frameElement->AddNestedElement(visibility);
-	  frameElement->SetIntAttribute(OBJECT_KEYFRAME_LEVEL_ATTRIBUTE_NAME, level);
-	  QString parentId;
-	  SketchObject* parent = frame.getParent();
-	  if (objectIds.contains(parent)) {
-	      parentId = objectIds.value(parent);
-	  }
-	  else {
-		  if (parent != NULL) {
-			  parentId = QString("O%1").arg(objectIds.size());
-		      objectIds.insert(parent, parentId);
-		  }
-		  else {
-		    parentId = "NULL";
-		  }
-	  }
-	  frameElement->SetAttribute(OBJECT_KEYFRAME_PARENT_ID_ATTRIBUTE_NAME,
-								("#" + parentId.toStdString()).c_str());
-      if (object->numInstances() == 1) {
+      frameElement->SetIntAttribute(OBJECT_KEYFRAME_LEVEL_ATTRIBUTE_NAME,
+                                    frames.getLevel(i));
+      frameElement->SetAttribute(
+          OBJECT_KEYFRAME_PARENT_ID_ATTRIBUTE_NAME,
+          ("#" + object.keyframeParentIds[i].toStdString()).c_str());
+      if (object.numInstances == 1) {
+        const ColorMapType::ColorMap& cmap = frames.getColorMap(i);
         frameElement->SetAttribute(
             OBJECT_COLOR_MAP_ATTRIBUTE_NAME,
-            ColorMapType::stringFromColorMap(frame.getColorMapType()));
-        frameElement->SetAttribute(
-            OBJECT_ARRAY_TO_COLOR_BY_ATTR_NAME,
-            frame.getArrayToColorBy().toStdString().c_str());
+            ColorMapType::stringFromColorMap(cmap.first));
+        frameElement->SetAttribute(OBJECT_ARRAY_TO_COLOR_BY_ATTR_NAME,
+                                   cmap.second.toStdString().c_str());
       }
       child->AddNestedElement(frameElement);
     }
     element->AddNestedElement(child);
   }
 
-  if (object->numInstances() != 1 && object->numInstances() != 0) {
+  if (object.numInstances != 1 && object.numInstances != 0) {
     vtkSmartPointer< vtkXMLDataElement > list =
         vtkSmartPointer< vtkXMLDataElement >::Take(
-            ProjectToXML::objectListToXML(object->getSubObjects(), modelIds,
-                                          objectIds, saveKeyframes));
+            objectListToXML(object.subObjects));
     element->AddNestedElement(list);
   }
 
@@ -600,38 +756,32 @@ vtkXMLDataElement* ProjectToXML::objectToXML(
 }
 
 vtkXMLDataElement* ProjectToXML::replicatorListToXML(
-    const QList< StructureReplicator* > &replicaList,
-    QHash< const SketchObject*, QString >& objectIds)
+    const QList< ReplicatorSnapshot >& replicaList)
 {
   vtkXMLDataElement* element = vtkXMLDataElement::New();
   element->SetName(REPLICATOR_LIST_ELEMENT_NAME);
-  for (QListIterator< StructureReplicator* > it(replicaList); it.hasNext();) {
-    StructureReplicator* rep = it.next();
+  for (QListIterator< ReplicatorSnapshot > it(replicaList); it.hasNext();) {
+    const ReplicatorSnapshot& rep = it.next();
     vtkSmartPointer< vtkXMLDataElement > repElement =
         vtkSmartPointer< vtkXMLDataElement >::New();
     repElement->SetName(REPLICATOR_ELEMENT_NAME);
     repElement->SetAttribute(
         REPLICATOR_NUM_SHOWN_ATTRIBUTE_NAME,
-        QString::number(rep->getNumShown()).toStdString().c_str());
-    // i'm not checking contains, it had better be in there
-    repElement->SetAttribute(
-        REPLICATOR_OBJECT1_ATTRIBUTE_NAME,
-        ("#" + objectIds.value(rep->getFirstObject())).toStdString().c_str());
-    repElement->SetAttribute(
-        REPLICATOR_OBJECT2_ATTRIBUTE_NAME,
-        ("#" + objectIds.value(rep->getSecondObject())).toStdString().c_str());
+        QString::number(rep.numShown).toStdString().c_str());
+    repElement->SetAttribute(REPLICATOR_OBJECT1_ATTRIBUTE_NAME,
+                             ("#" + rep.object1Id).toStdString().c_str());
+    repElement->SetAttribute(REPLICATOR_OBJECT2_ATTRIBUTE_NAME,
+                             ("#" + rep.object2Id).toStdString().c_str());
     repElement->SetAttribute(
         REPLICAS_GROUP_ATTRIBUTE_NAME,
-		("#" + objectIds.value(rep->getReplicaGroup())).toStdString().c_str());
-    for (QListIterator< SketchObject* > itr(rep->getReplicaIterator());
-         itr.hasNext();) {
+        ("#" + rep.replicaGroupId).toStdString().c_str());
+    for (int i = 0; i < rep.replicaIds.size(); i++) {
       vtkSmartPointer< vtkXMLDataElement > replicaElt =
           vtkSmartPointer< vtkXMLDataElement >::New();
-      SketchObject* replica = itr.next();
       replicaElt->SetName(REPLICA_ID_ELEMENT_NAME);
       replicaElt->SetAttribute(
           REPLICA_OBJECT_ID_ATTRIBUTE_NAME,
-		  ("#" + objectIds.value(replica)).toStdString().c_str());
+          ("#" + rep.replicaIds[i]).toStdString().c_str());
       repElement->AddNestedElement(replicaElt);
     }
 
@@ -640,121 +790,83 @@ vtkXMLDataElement* ProjectToXML::replicatorListToXML(
   return element;
 }
 
-vtkXMLDataElement* ProjectToXML::springListToXML(
-    const WorldManager &world,
-    const QHash< const SketchObject*, QString >& objectIds)
+vtkXMLDataElement* ProjectToXML::connectorListToXML(
+    const QList< ConnectorSnapshot >& connectors)
 {
   vtkXMLDataElement* element = vtkXMLDataElement::New();
   element->SetName(CONNECTOR_LIST_ELEMENT_NAME);
-  for (QListIterator< Connector* > it = world.getSpringsIterator();
-       it.hasNext();) {
-    const Connector* conn = it.next();
+  for (QListIterator< ConnectorSnapshot > it(connectors); it.hasNext();) {
     vtkSmartPointer< vtkXMLDataElement > child =
-        vtkSmartPointer< vtkXMLDataElement >::Take(
-            springToXML(conn, objectIds));
+        vtkSmartPointer< vtkXMLDataElement >::Take(connectorToXML(it.next()));
     element->AddNestedElement(child);
   }
   return element;
 }
 
-vtkXMLDataElement* ProjectToXML::springToXML(
-    const Connector* conn,
-    const QHash< const SketchObject*, QString >& objectIds)
+vtkXMLDataElement* ProjectToXML::connectorToXML(const ConnectorSnapshot& conn)
 {
-  const MeasuringTape* tape =
-	  dynamic_cast< const MeasuringTape* >(conn);
-  if (conn->getObject1() == conn->getObject2()) {
-    // allows measuring tapes to be saved even when not connected
-	// to any objects, but not springs or transparent connectors
-	if (!(tape != NULL && conn->getObject1() == NULL)) {
-		return NULL;
-	}
-  }
   vtkXMLDataElement* element = vtkXMLDataElement::New();
   element->SetName(CONNECTOR_ELEMENT_NAME);
   vtkSmartPointer< vtkXMLDataElement > child =
       vtkSmartPointer< vtkXMLDataElement >::New();
-  q_vec_type pos1;
   // conn properties
   child->SetName(PROPERTIES_ELEMENT_NAME);
-  const SpringConnection* spring =
-      dynamic_cast< const SpringConnection* >(conn);
-  double v = conn->getAlpha();
-  setPreciseVectorAttribute(child, &v, 1, CONNECTOR_ALPHA_ATTRIBUTE_NAME);
-  v = conn->getRadius();
-  setPreciseVectorAttribute(child, &v, 1, CONNECTOR_RADIUS_ATTRIBUTE_NAME);
-  ColorMapType::Type cmap = conn->getColorMapType();
+  setPreciseVectorAttribute(child, &conn.alpha, 1,
+                            CONNECTOR_ALPHA_ATTRIBUTE_NAME);
+  setPreciseVectorAttribute(child, &conn.radius, 1,
+                            CONNECTOR_RADIUS_ATTRIBUTE_NAME);
   child->SetAttribute(OBJECT_COLOR_MAP_ATTRIBUTE_NAME,
-                      ColorMapType::stringFromColorMap(cmap));
-  if (spring != NULL) {
-    v = spring->getStiffness();
-    setPreciseVectorAttribute(child, &v, 1, SPRING_STIFFNESS_ATTRIBUTE_NAME);
-    v = spring->getMinRestLength();
-    setPreciseVectorAttribute(child, &v, 1, SPRING_MIN_REST_ATTRIBUTE_NAME);
-    v = spring->getMaxRestLength();
-    setPreciseVectorAttribute(child, &v, 1, SPRING_MAX_REST_ATTRIBUTE_NAME);
+                      ColorMapType::stringFromColorMap(conn.colorMap));
+  if (conn.isSpring) {
+    setPreciseVectorAttribute(child, &conn.stiffness, 1,
+                              SPRING_STIFFNESS_ATTRIBUTE_NAME);
+    setPreciseVectorAttribute(child, &conn.minRestLength, 1,
+                              SPRING_MIN_REST_ATTRIBUTE_NAME);
+    setPreciseVectorAttribute(child, &conn.maxRestLength, 1,
+                              SPRING_MAX_REST_ATTRIBUTE_NAME);
   }
-  if (tape != NULL) {
-	  child->SetAttribute(MEASURING_TAPE_ATTRIBUTE_NAME, "true");
+  if (conn.isMeasuringTape) {
+    child->SetAttribute(MEASURING_TAPE_ATTRIBUTE_NAME, "true");
   }
   element->AddNestedElement(child);
   // second end, depends on conn type
-  if (conn->getObject1() != NULL && conn->getObject2() != NULL) {
+  if (conn.numObjectEnds == 2) {
     child = vtkSmartPointer< vtkXMLDataElement >::New();
     child->SetName(CONNECTOR_OBJECT_END_ELEMENT_NAME);
-    child->SetAttribute(
-        CONNECTOR_OBJECT_ID_ATTRIBUTE_NAME,
-		("#" + objectIds.value(conn->getObject1())).toStdString().c_str());
-    conn->getObject1ConnectionPosition(pos1);
-    setPreciseVectorAttribute(child, pos1, 3,
+    child->SetAttribute(CONNECTOR_OBJECT_ID_ATTRIBUTE_NAME,
+                        ("#" + conn.object1Id).toStdString().c_str());
+    setPreciseVectorAttribute(child, conn.point1, 3,
                               CONNECTOR_CONNECTION_POINT_ATTR_NAME);
     element->AddNestedElement(child);
     child = vtkSmartPointer< vtkXMLDataElement >::New();
     child->SetName(CONNECTOR_OBJECT_END_ELEMENT_NAME);
-    child->SetAttribute(
-        CONNECTOR_OBJECT_ID_ATTRIBUTE_NAME,
-        ("#" + objectIds.value(conn->getObject2())).toStdString().c_str());
-    q_vec_type pos2;
-    conn->getObject2ConnectionPosition(pos2);
-    setPreciseVectorAttribute(child, pos2, 3,
+    child->SetAttribute(CONNECTOR_OBJECT_ID_ATTRIBUTE_NAME,
+                        ("#" + conn.object2Id).toStdString().c_str());
+    setPreciseVectorAttribute(child, conn.point2, 3,
                               CONNECTOR_CONNECTION_POINT_ATTR_NAME);
     element->AddNestedElement(child);
-  } else if ((conn->getObject1() != NULL) ^ (conn->getObject2() != NULL)) {
-	q_vec_type pos2;
-    QString objId;
-    if (conn->getObject1() != NULL) {
-      conn->getObject1ConnectionPosition(pos1);
-      conn->getEnd2WorldPosition(pos2);
-      objId = objectIds.value(conn->getObject1());
-    } else {
-      conn->getObject2ConnectionPosition(pos1);
-      conn->getEnd1WorldPosition(pos2);
-      objId = objectIds.value(conn->getObject2());
-    }
+  } else if (conn.numObjectEnds == 1) {
     child = vtkSmartPointer< vtkXMLDataElement >::New();
     child->SetName(CONNECTOR_OBJECT_END_ELEMENT_NAME);
     child->SetAttribute(CONNECTOR_OBJECT_ID_ATTRIBUTE_NAME,
-                        objId.toStdString().c_str());
-    setPreciseVectorAttribute(child, pos1, 3,
+                        conn.object1Id.toStdString().c_str());
+    setPreciseVectorAttribute(child, conn.point1, 3,
                               CONNECTOR_CONNECTION_POINT_ATTR_NAME);
     element->AddNestedElement(child);
     child = vtkSmartPointer< vtkXMLDataElement >::New();
     child->SetName(CONNECTOR_POINT_END_ELEMENT_NAME);
-    setPreciseVectorAttribute(child, pos2, 3,
+    setPreciseVectorAttribute(child, conn.point2, 3,
                               CONNECTOR_CONNECTION_POINT_ATTR_NAME);
     element->AddNestedElement(child);
   } else {
-    q_vec_type pos1, pos2;
-	conn->getEnd1WorldPosition(pos1);
-	conn->getEnd2WorldPosition(pos2);
-	child = vtkSmartPointer< vtkXMLDataElement >::New();
+    child = vtkSmartPointer< vtkXMLDataElement >::New();
     child->SetName(CONNECTOR_POINT_END_ELEMENT_NAME);
-    setPreciseVectorAttribute(child, pos1, 3,
+    setPreciseVectorAttribute(child, conn.point1, 3,
                               CONNECTOR_CONNECTION_POINT_ATTR_NAME);
     element->AddNestedElement(child);
-	 child = vtkSmartPointer< vtkXMLDataElement >::New();
+    child = vtkSmartPointer< vtkXMLDataElement >::New();
     child->SetName(CONNECTOR_POINT_END_ELEMENT_NAME);
-    setPreciseVectorAttribute(child, pos2, 3,
+    setPreciseVectorAttribute(child, conn.point2, 3,
                               CONNECTOR_CONNECTION_POINT_ATTR_NAME);
     element->AddNestedElement(child);
   }
@@ -762,29 +874,24 @@ vtkXMLDataElement* ProjectToXML::springToXML(
 }
 
 vtkXMLDataElement* ProjectToXML::transformOpListToXML(
-    const QVector< QSharedPointer< TransformEquals > > &ops,
-    const QHash< const SketchObject*, QString >& objectIds)
+    const QList< QVector< QPair< QString, QString > > >& ops)
 {
   vtkXMLDataElement* element = vtkXMLDataElement::New();
   element->SetName(TRANSFORM_OP_LIST_ELEMENT_NAME);
 
   for (int i = 0; i < ops.size(); i++) {
-    QSharedPointer< TransformEquals > op(ops.at(i));
-    if (!op) continue;
+    const QVector< QPair< QString, QString > >& v = ops.at(i);
     vtkSmartPointer< vtkXMLDataElement > child =
         vtkSmartPointer< vtkXMLDataElement >::New();
     child->SetName(TRANSFORM_OP_ELEMENT_NAME);
-    const QVector< ObjectPair >* v = op->getPairsList();
-    for (int j = 0; j < v->size(); j++) {
+    for (int j = 0; j < v.size(); j++) {
       vtkSmartPointer< vtkXMLDataElement > pair =
           vtkSmartPointer< vtkXMLDataElement >::New();
       pair->SetName(TRANSFORM_OP_PAIR_ELEMENT_NAME);
-      pair->SetAttribute(
-          TRANSFORM_OP_PAIR_FIRST_ATTRIBUTE_NAME,
-          ("#" + objectIds.value(v->at(j).o1)).toStdString().c_str());
-      pair->SetAttribute(
-          TRANSFORM_OP_PAIR_SECOND_ATTRIBUTE_NAME,
-          ("#" + objectIds.value(v->at(j).o2)).toStdString().c_str());
+      pair->SetAttribute(TRANSFORM_OP_PAIR_FIRST_ATTRIBUTE_NAME,
+                         ("#" + v.at(j).first).toStdString().c_str());
+      pair->SetAttribute(TRANSFORM_OP_PAIR_SECOND_ATTRIBUTE_NAME,
+                         ("#" + v.at(j).second).toStdString().c_str());
       child->AddNestedElement(pair);
     }
     element->AddNestedElement(child);
@@ -1226,7 +1333,8 @@ void ProjectToXML::saveObjectFromClipboardXML(vtkXMLDataElement *elem, SketchBio
 			QFile srcfile(srcfilename);
 			if (srcfile.exists()) 
 			{
-			   if(!srcfile.copy(destfilename)) {
+			   // the files are only read by the zip step, so a link is enough
+			   if(!ModelStore::linkOrCopyFile(srcfilename, destfilename)) {
 				  std::cout << "Failed to copy VTK file (may already exist)." << std::endl;
 			   }
 			   else {
@@ -1338,11 +1446,22 @@ ProjectToXML::XML_Read_Status ProjectToXML::xmlToModel(
   bool foundModel = false;
   QScopedPointer< SketchModel > model(new SketchModel(invMass, invMoment));
 
- 
+  // index the conformations by number once instead of searching the nested
+  // elements for each one (like FindNestedElementWithNameAndAttribute, the
+  // first one with a given number is used)
+  QHash< QString, vtkXMLDataElement* > conformationElements;
+  for (int i = 0; i < elem->GetNumberOfNestedElements(); i++) {
+    vtkXMLDataElement* conf = elem->GetNestedElement(i);
+    const char* num = conf->GetAttribute(MODEL_CONFORMATION_NUMBER_ATTR_NAME);
+    if (num != NULL &&
+        QString(conf->GetName()) == QString(MODEL_CONFORMATION_ELEMENT_NAME) &&
+        !conformationElements.contains(QString(num))) {
+      conformationElements.insert(QString(num), conf);
+    }
+  }
+
   for (int i = 0; i < numConformations; i++) {
-     vtkXMLDataElement* conf = elem->FindNestedElementWithNameAndAttribute(
-        MODEL_CONFORMATION_ELEMENT_NAME, MODEL_CONFORMATION_NUMBER_ATTR_NAME,
-        QString::number(i).toStdString().c_str());
+    vtkXMLDataElement* conf = conformationElements.value(QString::number(i));
     if (conf == NULL) return XML_TO_DATA_FAILURE;
     vtkXMLDataElement* src =
         conf->FindNestedElementWithName(MODEL_SOURCE_ELEMENT_NAME);
@@ -1360,9 +1479,7 @@ ProjectToXML::XML_Read_Status ProjectToXML::xmlToModel(
   for (int i = 0; i < numConformations; i++) {
     // the relationship between conformation numbers and conformations needs
     // to be kept since only the conformation number is saved with each object
-    vtkXMLDataElement* conf = elem->FindNestedElementWithNameAndAttribute(
-        MODEL_CONFORMATION_ELEMENT_NAME, MODEL_CONFORMATION_NUMBER_ATTR_NAME,
-        QString::number(i).toStdString().c_str());
+    vtkXMLDataElement* conf = conformationElements.value(QString::number(i));
     if (conf == NULL) return XML_TO_DATA_FAILURE;
     conformations++;
     vtkXMLDataElement* src =
@@ -1482,6 +1599,388 @@ ProjectToXML::XML_Read_Status ProjectToXML::xmlToTransforms(
   return XML_TO_DATA_SUCCESS;
 }
 
+//##############################################################################
+// Object and keyframe loading
+//
+// Loading is split into two phases.  The first parses the xml for each top
+// level object (including its children) into plain structs.  This doesn't
+// touch the project and only reads the xml tree so the top level objects are
+// parsed in parallel.  The second phase runs serially and creates the
+// SketchObjects, resolves model and parent ids and adds keyframes.
+
+// the minimum number of top level objects before parsing is done in parallel
+#define MIN_OBJECTS_FOR_PARALLEL_PARSE 8
+
+// An index of an element's nested elements by name.  Like
+// FindNestedElementWithName, the first element with a given name is the one
+// found.  Build one of these instead of calling FindNestedElementWithName
+// repeatedly on the same element.
+class NestedElementIndex
+{
+ public:
+  explicit NestedElementIndex(vtkXMLDataElement* elem)
+  {
+    int n = elem->GetNumberOfNestedElements();
+    names.reserve(n);
+    for (int i = 0; i < n; i++) {
+      vtkXMLDataElement* child = elem->GetNestedElement(i);
+      QString name(child->GetName());
+      if (!names.contains(name)) {
+        names.insert(name, child);
+      }
+    }
+  }
+  vtkXMLDataElement* find(const char* name) const
+  {
+    return names.value(QString(name), NULL);
+  }
+
+ private:
+  QHash< QString, vtkXMLDataElement* > names;
+};
+
+// The data read from a keyframe element.  Anything that depends on the
+// object or on other objects (default colors, parent and level for old
+// files) is filled in when the keyframe is applied.
+struct KeyframeRecord {
+  double time;
+  q_vec_type pos, absPos;
+  q_type orient, absOrient;
+  bool visibleAfter, active;
+  bool hasColorMap, hasArray;
+  ColorMapType::Type colorMap;
+  QString array;
+  bool hasParentId;
+  QString parentId;
+  bool hasLevel;
+  int level;
+};
+
+// The keyframes for an object and the objects in its object list
+struct ObjectKeyframesRecord {
+  bool valid;
+  QString id;
+  QList< KeyframeRecord > frames;
+  QList< ObjectKeyframesRecord > children;
+};
+
+// The data read from an object element, not including keyframes
+struct ObjectRecord {
+  bool valid;
+  QString id;
+  int numInstances;
+  QString modelId;
+  int confNum;
+  bool visible, active;
+  q_vec_type pos;
+  q_type orient;
+  bool hasArray, hasColorMap, hasLuminance;
+  QString array;
+  ColorMapType::Type colorMap;
+  double luminance;
+  QList< ObjectRecord > children;
+};
+
+static bool parseKeyframe(vtkXMLDataElement* frame, KeyframeRecord& rec)
+{
+  if (QString(OBJECT_KEYFRAME_ELEMENT_NAME) != QString(frame->GetName())) {
+    return false;
+  }
+  // if frame has no time, then don't know what to do with it
+  if (frame->GetScalarAttribute(OBJECT_KEYFRAME_TIME_ATTRIBUTE_NAME,
+                                rec.time) != 1) {
+    return false;
+  }
+  NestedElementIndex children(frame);
+  vtkXMLDataElement* kTrans = children.find(TRANSFORM_ELEMENT_NAME);
+  if (kTrans == NULL) return false;  // if no transform, fail
+  if (kTrans->GetVectorAttribute(POSITION_ATTRIBUTE_NAME, 3, rec.pos) != 3)
+    return false;  // position wrong length.. fail
+  if (kTrans->GetVectorAttribute(ROTATION_ATTRIBUTE_NAME, 4, rec.orient) != 4)
+    return false;  // orientation wrong length... fail
+  vtkXMLDataElement* absTrans =
+      children.find(OBJECT_KEYFRAME_ABSTRFM_ELEMENT_NAME);
+  if (absTrans == NULL) {  // may be old format with no absolute position saved
+    q_vec_copy(rec.absPos, rec.pos);
+    q_copy(rec.absOrient, rec.orient);
+  } else {
+    if (absTrans->GetVectorAttribute(POSITION_ATTRIBUTE_NAME, 3, rec.absPos) !=
+        3)
+      return false;  // position wrong length.. fail
+    if (absTrans->GetVectorAttribute(ROTATION_ATTRIBUTE_NAME, 4,
+                                     rec.absOrient) != 4)
+      return false;  // orientation wrong length... fail
+  }
+  vtkXMLDataElement* properties = children.find(PROPERTIES_ELEMENT_NAME);
+  if (properties == NULL) return false;  // if no visiblitly status.. fail
+  const char* c = properties->GetAttribute(OBJECT_KEYFRAME_VIS_AF_ATTR_NAME);
+  if (c == NULL) return false;
+  QString strA = QString(c).toLower();
+  if (strA == QString("true")) {
+    rec.visibleAfter = true;
+  } else if (strA == QString("false")) {
+    rec.visibleAfter = false;
+  } else {
+    return false;
+  }
+  c = properties->GetAttribute(OBJECT_KEYFRAME_ACTIVE_ATTR_NAME);
+  if (c == NULL) return false;
+  rec.active = (QString(c).toLower() == QString("true"));
+  c = frame->GetAttribute(OBJECT_COLOR_MAP_ATTRIBUTE_NAME);
+  rec.hasColorMap = (c != NULL);
+  if (rec.hasColorMap) {
+    rec.colorMap = ColorMapType::colorMapFromString(c);
+  }
+  c = frame->GetAttribute(OBJECT_ARRAY_TO_COLOR_BY_ATTR_NAME);
+  rec.hasArray = (c != NULL);
+  if (rec.hasArray) {
+    rec.array = QString(c);
+  }
+  const char* id = frame->GetAttribute(OBJECT_KEYFRAME_PARENT_ID_ATTRIBUTE_NAME);
+  rec.hasParentId = (id != NULL);
+  if (rec.hasParentId) {
+    rec.parentId = QString(&id[1]);
+  }
+  rec.hasLevel = (frame->GetScalarAttribute(OBJECT_KEYFRAME_LEVEL_ATTRIBUTE_NAME,
+                                            rec.level) == 1);
+  return true;
+}
+
+// Creates the keyframe from the record and adds it to the object.  This
+// must be done after all objects have been read so parents can be found.
+static bool applyKeyframe(SketchObject* object,
+                          QHash< QString, SketchObject* >& objectIds,
+                          const KeyframeRecord& rec)
+{
+  // make sure not to change the color map data, default to the object's
+  ColorMapType::Type colorMap = object->getColorMapType();
+  QString array = object->getArrayToColorBy();
+  if (object->numInstances() == 1 && rec.hasColorMap) {
+    // can have neither array or color, but if you have one, you should
+    // have both
+    if (!rec.hasArray) return false;
+    colorMap = rec.colorMap;
+    array = rec.array;
+  }
+  SketchObject* parent = NULL;
+  if (!rec.hasParentId) {
+    // if loading old version, use the object's parent (won't change at
+    // keyframes)
+    parent = object->getParent();
+  } else if (rec.parentId != QString("NULL")) {
+    QHash< QString, SketchObject* >::const_iterator it =
+        objectIds.constFind(rec.parentId);
+    if (it == objectIds.constEnd()) {
+      return false;
+    }
+    parent = it.value();
+  }
+  // if loading old version, find out the grouping level for keyframes now
+  int level = rec.hasLevel ? rec.level : object->getGroupingLevel();
+  Keyframe f(rec.pos, rec.absPos, rec.orient, rec.absOrient, colorMap, array,
+             level, parent, rec.visibleAfter, rec.active);
+  object->insertKeyframe(rec.time, f);
+  return true;
+}
+
+static bool parseKeyframesForObject(vtkXMLDataElement* elem,
+                                    ObjectKeyframesRecord& rec)
+{
+  rec.id = QString(elem->GetAttribute(ID_ATTRIBUTE_NAME));
+  NestedElementIndex children(elem);
+  vtkXMLDataElement* keyframes =
+      children.find(OBJECT_KEYFRAME_LIST_ELEMENT_NAME);
+  // keyframes list will only exist on objects that have keyframes so this
+  // being NULL simply means that the object has no keyframes
+  if (keyframes != NULL) {
+    int n = keyframes->GetNumberOfNestedElements();
+    rec.frames.reserve(n);
+    for (int i = 0; i < n; i++) {
+      vtkXMLDataElement* frame = keyframes->GetNestedElement(i);
+      // in xml: ignore extra stuff
+      if (QString(OBJECT_KEYFRAME_ELEMENT_NAME) == QString(frame->GetName())) {
+        rec.frames.append(KeyframeRecord());
+        if (!parseKeyframe(frame, rec.frames.last())) {
+          return false;
+        }
+      }
+    }
+  }
+  vtkXMLDataElement* subObjects = children.find(OBJECTLIST_ELEMENT_NAME);
+  if (subObjects != NULL) {
+    for (int i = 0; i < subObjects->GetNumberOfNestedElements(); i++) {
+      rec.children.append(ObjectKeyframesRecord());
+      if (!parseKeyframesForObject(subObjects->GetNestedElement(i),
+                                   rec.children.last())) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// wrapper with the signature QtConcurrent needs
+static ObjectKeyframesRecord parseKeyframesRecord(
+    vtkXMLDataElement* const& elem)
+{
+  ObjectKeyframesRecord rec;
+  rec.valid = parseKeyframesForObject(elem, rec);
+  return rec;
+}
+
+static bool applyKeyframesForObject(const ObjectKeyframesRecord& rec,
+                                    QHash< QString, SketchObject* >& objectIds)
+{
+  if (!rec.valid) return false;
+  if (!rec.frames.empty()) {
+    SketchObject* object = objectIds.value(rec.id, NULL);
+    if (object == NULL) return false;
+    for (int i = 0; i < rec.frames.size(); i++) {
+      if (!applyKeyframe(object, objectIds, rec.frames[i])) {
+        return false;
+      }
+    }
+  }
+  for (int i = 0; i < rec.children.size(); i++) {
+    if (!applyKeyframesForObject(rec.children[i], objectIds)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool parseObject(vtkXMLDataElement* elem, ObjectRecord& rec)
+{
+  if (QString(elem->GetName()) != QString(OBJECT_ELEMENT_NAME)) {
+    return false;
+  }
+  rec.id = QString(elem->GetAttribute(ID_ATTRIBUTE_NAME));
+  if (!elem->GetScalarAttribute(OBJECT_NUM_INSTANCES_ATTRIBUTE_NAME,
+                                rec.numInstances)) {
+    return false;
+  }
+  NestedElementIndex children(elem);
+  vtkXMLDataElement* props = children.find(PROPERTIES_ELEMENT_NAME);
+  if (props == NULL) {
+    return false;
+  }
+  rec.confNum = -1;
+  if (rec.numInstances == 1) {
+    const char* c = props->GetAttribute(OBJECT_MODELID_ATTRIBUTE_NAME);
+    if (c == NULL) {
+      return false;
+    }
+    rec.modelId = c;
+    if (props->GetScalarAttribute(OBJECT_MODEL_CONF_NUM_ATTR_NAME,
+                                  rec.confNum) == 0)
+      return false;
+  }
+  const char* c = props->GetAttribute(OBJECT_VISIBILITY_ATTRIBUTE_NAME);
+  // default to visible
+  rec.visible = (c == NULL) || (QString(c) == QString("true"));
+  c = props->GetAttribute(OBJECT_ACTIVE_ATTRIBUTE_NAME);
+  rec.active = (c != NULL) && (QString(c) == QString("true"));
+  vtkXMLDataElement* trans = children.find(TRANSFORM_ELEMENT_NAME);
+  if (trans == NULL) {
+    return false;
+  }
+  int err = trans->GetVectorAttribute(POSITION_ATTRIBUTE_NAME, 3, rec.pos);
+  err = err + trans->GetVectorAttribute(ROTATION_ATTRIBUTE_NAME, 4, rec.orient);
+  if (err != 7) {
+    return false;
+  }
+  q_normalize(rec.orient, rec.orient);
+  c = props->GetAttribute(OBJECT_ARRAY_TO_COLOR_BY_ATTR_NAME);
+  rec.hasArray = (c != NULL);
+  if (rec.hasArray) {
+    rec.array = QString(c);
+  }
+  c = props->GetAttribute(OBJECT_COLOR_MAP_ATTRIBUTE_NAME);
+  rec.hasColorMap = (c != NULL);
+  if (rec.hasColorMap) {
+    rec.colorMap = ColorMapType::colorMapFromString(c);
+  }
+  rec.hasLuminance =
+      props->GetAttribute(OBJECT_LUMINANCE_ATTRIBUTE_NAME) != NULL &&
+      props->GetScalarAttribute(OBJECT_LUMINANCE_ATTRIBUTE_NAME,
+                                rec.luminance);
+  if (rec.numInstances != 1) {
+    vtkXMLDataElement* childList = children.find(OBJECTLIST_ELEMENT_NAME);
+    if (childList == NULL) {
+      return false;
+    }
+    int n = childList->GetNumberOfNestedElements();
+    rec.children.reserve(n);
+    for (int i = 0; i < n; i++) {
+      rec.children.append(ObjectRecord());
+      if (!parseObject(childList->GetNestedElement(i), rec.children.last())) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// wrapper with the signature QtConcurrent needs
+static ObjectRecord parseObjectRecord(vtkXMLDataElement* const& elem)
+{
+  ObjectRecord rec;
+  rec.valid = parseObject(elem, rec);
+  return rec;
+}
+
+// Creates the object described by the record, returns NULL on an error
+static SketchObject* buildObject(
+    const ObjectRecord& rec,
+    QHash< QPair< QString, int >, QPair< SketchModel*, int > >& modelIds,
+    QHash< QString, SketchObject* >& objectIds)
+{
+  if (!rec.valid) {
+    return NULL;
+  }
+  QScopedPointer< SketchObject > object(NULL);
+  if (rec.numInstances == 1) {
+    // modelInstace
+    QPair< QString, int > idPair(rec.modelId, rec.confNum);
+    QHash< QPair< QString, int >, QPair< SketchModel*, int > >::const_iterator
+        it = modelIds.constFind(idPair);
+    if (it == modelIds.constEnd() || it.value().first == NULL) {
+      return NULL;
+    }
+    object.reset(new ModelInstance(it.value().first, it.value().second));
+    object->setPosAndOrient(rec.pos, rec.orient);
+    if (rec.hasArray) {
+      object->setArrayToColorBy(rec.array);
+    }
+    if (rec.hasColorMap) {
+      object->setColorMapType(rec.colorMap);
+    }
+    if (rec.hasLuminance) {
+      object->setLuminance(rec.luminance);
+    }
+  } else {
+    // group
+    QScopedPointer< ObjectGroup > group(new ObjectGroup());
+    group->setPosAndOrient(rec.pos, rec.orient);
+    for (int i = 0; i < rec.children.size(); i++) {
+      SketchObject* child = buildObject(rec.children[i], modelIds, objectIds);
+      if (child == NULL) {
+        return NULL;
+      }
+      // since each object will be saved in its actual position and not its
+      // group relative position, we can simply let addObject's averaging take
+      // care of the group position/orientation
+      group->addObject(child);
+    }
+    object.reset(group.take());
+  }
+  objectIds.insert(rec.id, object.data());
+  object->setIsVisible(rec.visible);  // set visibility after keyframes so
+                                      // frames can store visibility state
+  object->setActive(rec.active);      // similar to reason above
+  return object.take();
+}
+
 ProjectToXML::XML_Read_Status ProjectToXML::readObjectList(
     QList< SketchObject* >& list, vtkXMLDataElement* elem,
     QHash< QPair<QString, int>, QPair<SketchModel*,int> >& modelIds,
@@ -1493,18 +1992,25 @@ ProjectToXML::XML_Read_Status ProjectToXML::readObjectList(
   if (!list.empty()) {  // if the list is already populated, give up.
     return XML_TO_DATA_FAILURE;
   }
-  // this function processes whole list not single object
-  // need function that gets object and returns it for each object in list
-  // this function needs to be changed to return list of objects for caller to
-  // do something with
+  QList< vtkXMLDataElement* > elements;
   for (int i = 0; i < elem->GetNumberOfNestedElements(); i++) {
-    vtkXMLDataElement* child = elem->GetNestedElement(i);
-    SketchObject* object = readObject(child, modelIds, objectIds);
+    elements.append(elem->GetNestedElement(i));
+  }
+  // parse phase: top level objects are independent so parse them in parallel
+  QList< ObjectRecord > records;
+  if (elements.size() >= MIN_OBJECTS_FOR_PARALLEL_PARSE) {
+    records = QtConcurrent::blockingMapped(elements, parseObjectRecord);
+  } else {
+    for (int i = 0; i < elements.size(); i++) {
+      records.append(parseObjectRecord(elements[i]));
+    }
+  }
+  // link phase: create the objects in order
+  for (int i = 0; i < records.size(); i++) {
+    SketchObject* object = buildObject(records[i], modelIds, objectIds);
     if (object == NULL) {
       // if read failed, delete progress and return
-      for (int i = 0; i < list.size(); i++) {
-        delete list[i];
-      }
+      qDeleteAll(list);
       list.clear();
       return XML_TO_DATA_FAILURE;
     }
@@ -1519,34 +2025,22 @@ ProjectToXML::XML_Read_Status ProjectToXML::readKeyframesForObjectList(
   if (QString(elem->GetName()) != QString(OBJECTLIST_ELEMENT_NAME)) {
     return XML_TO_DATA_FAILURE;
   }
+  QList< vtkXMLDataElement* > elements;
   for (int i = 0; i < elem->GetNumberOfNestedElements(); i++) {
-    vtkXMLDataElement* child = elem->GetNestedElement(i);
-    QString oId(child->GetAttribute(ID_ATTRIBUTE_NAME));
-	SketchObject* object = objectIds.value(oId);
-	vtkXMLDataElement* keyframes =
-        child->FindNestedElementWithName(OBJECT_KEYFRAME_LIST_ELEMENT_NAME);
-    // keyframes list will only exist on objects that have keyframes so this
-    // being NULL simply
-    // means that the object has no keyframes
-    if (keyframes != NULL) {  // if we have keyframes... read them in
-      for (int i = 0; i < keyframes->GetNumberOfNestedElements(); i++) {
-        vtkXMLDataElement* frame = keyframes->GetNestedElement(i);
-        if (QString(OBJECT_KEYFRAME_ELEMENT_NAME) ==
-            QString(frame->GetName())) {
-          if (readKeyframe(object, objectIds, frame) == XML_TO_DATA_FAILURE) {
-            return XML_TO_DATA_FAILURE;
-          }
-        }  // in xml: ignore extra stuff
-      }
-    } 
-	vtkXMLDataElement* subObjects = 
-		child->FindNestedElementWithName(OBJECTLIST_ELEMENT_NAME);
-	if (subObjects != NULL) {
-		if (readKeyframesForObjectList(subObjects, objectIds) == 
-			XML_TO_DATA_FAILURE) {
-			return XML_TO_DATA_FAILURE;
-		}
-	}
+    elements.append(elem->GetNestedElement(i));
+  }
+  QList< ObjectKeyframesRecord > records;
+  if (elements.size() >= MIN_OBJECTS_FOR_PARALLEL_PARSE) {
+    records = QtConcurrent::blockingMapped(elements, parseKeyframesRecord);
+  } else {
+    for (int i = 0; i < elements.size(); i++) {
+      records.append(parseKeyframesRecord(elements[i]));
+    }
+  }
+  for (int i = 0; i < records.size(); i++) {
+    if (!applyKeyframesForObject(records[i], objectIds)) {
+      return XML_TO_DATA_FAILURE;
+    }
   }
   return XML_TO_DATA_SUCCESS;
 }
@@ -1555,232 +2049,19 @@ ProjectToXML::XML_Read_Status ProjectToXML::readKeyframe(
 	SketchObject* object, QHash<QString,SketchObject *> &objectIds,
 	vtkXMLDataElement* frame)
 {
-	if (QString(OBJECT_KEYFRAME_ELEMENT_NAME) != QString(frame->GetName())) {
-		return XML_TO_DATA_FAILURE;
-	}
-	// make sure not to change the color map data, save the old data
-	ColorMapType::Type colorMap;
-	QString array;
-	q_vec_type pos, absPos;
-	q_type orient, absOrient;
-	bool visA, active;
-	int level;
-	double time;
-	int numRead = 0;
-	numRead =
-		frame->GetScalarAttribute(OBJECT_KEYFRAME_TIME_ATTRIBUTE_NAME, time);
-	if (numRead != 1)
-		return XML_TO_DATA_FAILURE;  // if frame has no time, then don't know what
-	// to do with it
-	vtkXMLDataElement* kTrans =
-		frame->FindNestedElementWithName(TRANSFORM_ELEMENT_NAME);
-	if (kTrans == NULL) return XML_TO_DATA_FAILURE;  // if no transform, fail
-	numRead = kTrans->GetVectorAttribute(POSITION_ATTRIBUTE_NAME, 3, pos);
-	if (numRead != 3) return XML_TO_DATA_FAILURE;  // position wrong length.. fail
-	numRead = kTrans->GetVectorAttribute(ROTATION_ATTRIBUTE_NAME, 4, orient);
-	if (numRead != 4)
-		return XML_TO_DATA_FAILURE;  // orientation wrong length... fail
-	vtkXMLDataElement* absTrans = 
-		frame->FindNestedElementWithName(OBJECT_KEYFRAME_ABSTRFM_ELEMENT_NAME);
-	if (absTrans == NULL) { //may be old format with no absolute position saved
-		q_vec_copy(absPos, pos);
-		q_copy(absOrient, orient);
-	}
-	else {
-		numRead = absTrans->GetVectorAttribute(POSITION_ATTRIBUTE_NAME, 3, absPos);
-		if (numRead != 3) 
-			return XML_TO_DATA_FAILURE;  // position wrong length.. fail
-		numRead = absTrans->GetVectorAttribute(ROTATION_ATTRIBUTE_NAME, 4, absOrient);
-		if (numRead != 4)
-			return XML_TO_DATA_FAILURE;  // orientation wrong length... fail
-	}
-	vtkXMLDataElement* properties =
-		frame->FindNestedElementWithName(PROPERTIES_ELEMENT_NAME);
-	if (properties == NULL)
-		return XML_TO_DATA_FAILURE;  // if no visiblitly status.. fail
-	const char* c = properties->GetAttribute(OBJECT_KEYFRAME_VIS_AF_ATTR_NAME);
-	if (c != NULL) {
-		QString strA(c);
-		if (strA.toLower() == QString("true")) {
-			visA = true;
-		} else if (strA.toLower() == QString("false")) {
-			visA = false;
-		} else {
-			return XML_TO_DATA_FAILURE;
-		}
-	} else {
-		return XML_TO_DATA_FAILURE;
-	}
-	c = properties->GetAttribute(OBJECT_KEYFRAME_ACTIVE_ATTR_NAME);
-	if (c != NULL) {
-		QString strA(c);
-		if (strA.toLower() == QString("true")) {
-			active = true;
-		} else {
-			active = false;
-		}
-	} else {
-		return XML_TO_DATA_FAILURE;
-	}
-	if (object->numInstances() == 1) {
-		c = frame->GetAttribute(OBJECT_COLOR_MAP_ATTRIBUTE_NAME);
-		if (c != NULL) {
-			colorMap = ColorMapType::colorMapFromString(c);
-			c = frame->GetAttribute(OBJECT_ARRAY_TO_COLOR_BY_ATTR_NAME);
-			if (c != NULL) {
-				array = QString(c);
-			} else {
-				return XML_TO_DATA_FAILURE;  // can have neither array or color, but
-				// if you have one, you should have both
-			}
-		} else {
-			// if not defined default to state of object
-			colorMap = object->getColorMapType();
-			array = object->getArrayToColorBy();
-		}
-	} else {
-		// if not defined default to state of object
-		colorMap = object->getColorMapType();
-		array = object->getArrayToColorBy();
-	}
-	SketchObject* parent = NULL;
-	const char* id = frame->GetAttribute(OBJECT_KEYFRAME_PARENT_ID_ATTRIBUTE_NAME);
-	if (id == 0) { // if loading old version, use the object's parent (won't change at keyframes)
-		parent = object->getParent();
-	}
-	else {
-		QString parentId(&id[1]);
-		if (strcmp(&id[1], "NULL")) {
-			if (objectIds.contains(parentId)) {
-				parent = objectIds.value(parentId);
-			}
-			else {
-				return XML_TO_DATA_FAILURE;
-			}
-		}
-	}
-	numRead = frame->GetScalarAttribute(OBJECT_KEYFRAME_LEVEL_ATTRIBUTE_NAME, level);
-	if (numRead != 1) { // if loading old version, find out the grouping level for keyframes now
-		level = object->getGroupingLevel();
-	}
-	Keyframe f(pos,absPos,orient,absOrient,colorMap,array,level,parent,visA,active);
-	object->insertKeyframe(time,f);
-	return XML_TO_DATA_SUCCESS;
+  KeyframeRecord rec;
+  if (!parseKeyframe(frame, rec) || !applyKeyframe(object, objectIds, rec)) {
+    return XML_TO_DATA_FAILURE;
+  }
+  return XML_TO_DATA_SUCCESS;
 }
 
 SketchObject* ProjectToXML::readObject(
     vtkXMLDataElement* elem, QHash< QPair<QString, int>, QPair<SketchModel*,int> >& modelIds,
     QHash< QString, SketchObject* >& objectIds)
 {
-  if (QString(elem->GetName()) == QString(OBJECT_ELEMENT_NAME)) {
-    QString mId;
-    int confNum = -1;
-    q_vec_type pos;
-    q_type orient;
-    bool visibility, active;
-	double luminance;
-    QString oId(elem->GetAttribute(ID_ATTRIBUTE_NAME));
-    int numInstances;
-    if (!elem->GetScalarAttribute(OBJECT_NUM_INSTANCES_ATTRIBUTE_NAME,
-                                  numInstances)) {
-      return NULL;
-    }
-    vtkXMLDataElement* props =
-        elem->FindNestedElementWithName(PROPERTIES_ELEMENT_NAME);
-    if (props == NULL) {
-      return NULL;
-    }
-    if (numInstances == 1) {
-      const char* c = props->GetAttribute(OBJECT_MODELID_ATTRIBUTE_NAME);
-      if (c == NULL) {
-        return NULL;
-      }
-      mId = c;
-      if (props->GetScalarAttribute(OBJECT_MODEL_CONF_NUM_ATTR_NAME, confNum) ==
-          0)
-        return NULL;
-    } else {
-      mId = "";
-    }
-    const char* c = props->GetAttribute(OBJECT_VISIBILITY_ATTRIBUTE_NAME);
-    if (!c) {
-      visibility = true;  // default to visible
-    } else if (QString(c) == QString("true")) {
-      visibility = true;
-    } else {
-      visibility = false;
-    }
-    c = props->GetAttribute(OBJECT_ACTIVE_ATTRIBUTE_NAME);
-    if (!c) {
-      active = false;
-    } else if (QString(c) == QString("true")) {
-      active = true;
-    } else {
-      active = false;
-    }
-    vtkXMLDataElement* trans =
-        elem->FindNestedElementWithName(TRANSFORM_ELEMENT_NAME);
-    if (trans == NULL) {
-      return NULL;
-    }
-    int err = trans->GetVectorAttribute(POSITION_ATTRIBUTE_NAME, 3, pos);
-    err = err + trans->GetVectorAttribute(ROTATION_ATTRIBUTE_NAME, 4, orient);
-    if (err != 7) {
-      return NULL;
-    }
-    q_normalize(orient, orient);
-    QScopedPointer< SketchObject > object(NULL);
-    if (numInstances == 1) {
-      // modelInstace
-	  QPair<QString,int>idPair(mId,confNum);
-	  SketchModel* model = modelIds.value(idPair).first;
-	  int modelConfNum = modelIds.value(idPair).second;
-      object.reset(new ModelInstance(model, modelConfNum));
-      object->setPosAndOrient(pos, orient);
-      if (props->GetAttribute(OBJECT_ARRAY_TO_COLOR_BY_ATTR_NAME)) {
-        QString array(props->GetAttribute(OBJECT_ARRAY_TO_COLOR_BY_ATTR_NAME));
-        object->setArrayToColorBy(array);
-      }
-      if (props->GetAttribute(OBJECT_COLOR_MAP_ATTRIBUTE_NAME)) {
-        const char* ch = props->GetAttribute(OBJECT_COLOR_MAP_ATTRIBUTE_NAME);
-        ColorMapType::Type cmap;
-        cmap = ColorMapType::colorMapFromString(ch);
-        object->setColorMapType(cmap);
-      }
-	  if (props->GetAttribute(OBJECT_LUMINANCE_ATTRIBUTE_NAME)) {
-	    props->GetScalarAttribute(OBJECT_LUMINANCE_ATTRIBUTE_NAME, luminance);
-		object->setLuminance(luminance);
-	  }
-    } else {
-      // group
-      QScopedPointer< ObjectGroup > group(new ObjectGroup());
-      group->setPosAndOrient(pos, orient);
-      vtkXMLDataElement* childList =
-          elem->FindNestedElementWithName(OBJECTLIST_ELEMENT_NAME);
-      if (childList == NULL) {
-        return NULL;
-      }
-      QList< SketchObject* > childObjects;
-      if (readObjectList(childObjects, childList, modelIds, objectIds) ==
-          XML_TO_DATA_FAILURE) {
-        return NULL;
-      }
-      for (int i = 0; i < childObjects.size(); i++) {
-        group->addObject(childObjects[i]);
-      }
-      object.reset(group.take());
-      // since each object will be saved in its actual position and not its
-      // group relative position,
-      // we can simply let addObject's averaging take care of the group
-      // position/orientation
-    }
-    objectIds.insert(oId, object.data());
-    object->setIsVisible(visibility);  // set visibility after keyframes so
-                                       // frames can store visibility state
-    object->setActive(active);         // similar to reason above
-    return object.take();
-  }
-  return NULL;
+  ObjectRecord rec = parseObjectRecord(elem);
+  return buildObject(rec, modelIds, objectIds);
 }
 
 ProjectToXML::XML_Read_Status ProjectToXML::xmlToObjectList(
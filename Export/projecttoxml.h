@@ -7,6 +7,7 @@ class QString;
 #include <QVector>
 #include <QList>
 #include <QHash>
+#include <QPair>
 #include <QSharedPointer>
 
 class TransformManager;
@@ -17,6 +18,11 @@ class Connector;
 class WorldManager;
 class StructureReplicator;
 class TransformEquals;
+class ProjectSnapshot;
+struct ModelSnapshot;
+struct ObjectSnapshot;
+struct ReplicatorSnapshot;
+struct ConnectorSnapshot;
 //<<<<<<< HEAD
 namespace SketchBio
 {
@@ -30,6 +36,16 @@ class ProjectToXML
 
   static vtkXMLDataElement *projectToXML(const SketchBio::Project *project);
 
+  // Copies the parts of the project that projectToXML saves.  This only
+  // copies values and builds no xml, so it is much faster than projectToXML,
+  // and later changes to the project do not change the snapshot.
+  static QSharedPointer< ProjectSnapshot > snapshotProject(
+      const SketchBio::Project *project);
+  // Builds the same xml as projectToXML from a snapshot.  This does not touch
+  // the project the snapshot was taken from, so it may be called on any
+  // thread.
+  static vtkXMLDataElement *snapshotToXML(const ProjectSnapshot &snapshot);
+
   // creates a simplified version of the save to xml state that only
   // encapsulates
   // the information needed to recreate the given object
@@ -63,50 +79,29 @@ class ProjectToXML
 
  private:  // no other code should call these (this is the reason for making
            // this a class)
-  static vtkXMLDataElement *modelManagerToXML(
-      const ModelManager &models, const QString &dir,
-      QHash< const SketchModel *, QString > &modelIds);
-  static vtkXMLDataElement *modelsToXML(
-      const SketchObject *object,
-      QHash< const SketchModel *, QString > &modelIds);
-  static vtkXMLDataElement *modelToXML(const SketchModel *model,
-                                       const QString &dir, const QString &id);
+  // these build the xml from the parts of a snapshot (see snapshotProject)
+  static vtkXMLDataElement *modelListToXML(
+      const QList< ModelSnapshot > &models);
+  static vtkXMLDataElement *modelToXML(const ModelSnapshot &model);
 
   static vtkXMLDataElement *transformManagerToXML(
-      const TransformManager &transforms);
-
-  static vtkXMLDataElement *objectListToXML(
-      const WorldManager &world,
-      const QHash< const SketchModel *, QString > &modelIds,
-      QHash< const SketchObject *, QString > &objectIds);
+      const ProjectSnapshot &snapshot);
 
   static vtkXMLDataElement *objectListToXML(
-      const QList< SketchObject * > *objectList,
-      const QHash< const SketchModel *, QString > &modelIds,
-      QHash< const SketchObject *, QString > &objectIds,
-	  bool saveKeyframes = true);
+      const QList< ObjectSnapshot > &objectList);
 
-  static vtkXMLDataElement *objectToXML(
-      const SketchObject *object,
-      const QHash< const SketchModel *, QString > &modelIds,
-      QHash< const SketchObject *, QString > &objectIds,
-	  bool saveKeyframes = true);
+  static vtkXMLDataElement *objectToXML(const ObjectSnapshot &object);
 
   static vtkXMLDataElement *replicatorListToXML(
-      const QList< StructureReplicator * > &replicaList,
-      QHash< const SketchObject *, QString > &objectIds);
+      const QList< ReplicatorSnapshot > &replicaList);
 
-  static vtkXMLDataElement *springListToXML(
-      const WorldManager &world,
-      const QHash< const SketchObject *, QString > &objectIds);
+  static vtkXMLDataElement *connectorListToXML(
+      const QList< ConnectorSnapshot > &connectors);
 
-  static vtkXMLDataElement *springToXML(
-      const Connector *spring,
-      const QHash< const SketchObject *, QString > &objectIds);
+  static vtkXMLDataElement *connectorToXML(const ConnectorSnapshot &conn);
 
   static vtkXMLDataElement *transformOpListToXML(
-      const QVector< QSharedPointer< TransformEquals > > &ops,
-      const QHash< const SketchObject *, QString > &objectIds);
+      const QList< QVector< QPair< QString, QString > > > &ops);
 
   // converts the older file to the current xml project format
   // returns success unless something goes wrong in conversion
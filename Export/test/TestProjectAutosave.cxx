@@ -0,0 +1,182 @@
+#include <iostream>
+#include <sstream>
+#include <cstring>
+
+#include <QCoreApplication>
+#include <QScopedPointer>
+#include <QFile>
+#include <QDir>
+
+#include <vtkRenderer.h>
+#include <vtkXMLUtilities.h>
+#include <vtkXMLDataElement.h>
+
+#include <sketchioconstants.h>
+#include <sketchproject.h>
+#include <sketchobject.h>
+#include <projecttoxml.h>
+#include <projectautosaver.h>
+
+#include "CompareBeforeAndAfter.h"
+#include "MakeTestProject.h"
+
+using std::cout;
+using std::endl;
+
+#define AUTOSAVE_TEST_DIR "test/autosave"
+
+// Takes an autosave of the project, waits for the background write and
+// then checks that the file that was written reads back in to the same project
+int testAutosave()
+{
+    int retVal = 0;
+    vtkSmartPointer< vtkRenderer > r1 =
+            vtkSmartPointer< vtkRenderer >::New();
+    QScopedPointer< SketchBio::Project > proj1(
+                new SketchBio::Project(r1,AUTOSAVE_TEST_DIR));
+    SketchObject *obj = MakeTestProject::addObjectToProject(proj1.data());
+    MakeTestProject::addKeyframesToObject(obj,3);
+    MakeTestProject::addGroupToProject(proj1.data(),3);
+
+    ProjectAutosaver saver(proj1.data());
+    QString file = saver.getAutosaveFileName();
+    QFile::remove(file);
+    saver.autosave();
+    saver.waitForWrite();
+    if (!QFile(file).exists())
+    {
+        retVal++;
+        cout << "Autosave file was not written." << endl;
+        return retVal;
+    }
+    if (QFile(file + ".tmp").exists())
+    {
+        retVal++;
+        cout << "Temporary autosave file was left behind." << endl;
+    }
+
+    vtkSmartPointer< vtkXMLDataElement > root =
+            vtkSmartPointer< vtkXMLDataElement >::Take(
+                vtkXMLUtilities::ReadElementFromFile(
+                    file.toStdString().c_str()));
+    vtkSmartPointer< vtkRenderer > r2 =
+            vtkSmartPointer< vtkRenderer >::New();
+    QScopedPointer< SketchBio::Project > proj2(
+                new SketchBio::Project(r2,proj1->getProjectDir()));
+    if (root.GetPointer() == NULL ||
+            ProjectToXML::xmlToProject(proj2.data(),root)
+            == ProjectToXML::XML_TO_DATA_FAILURE)
+    {
+        retVal++;
+        cout << "Reading autosaved xml failed." << endl;
+        return retVal;
+    }
+    CompareBeforeAndAfter::compareProjects(proj1.data(),proj2.data(),retVal);
+    return retVal;
+}
+
+// Changes the project right after starting an autosave, the file written
+// should still be the project as it was when the autosave started
+int testSnapshotDetached()
+{
+    int retVal = 0;
+    vtkSmartPointer< vtkRenderer > r1 =
+            vtkSmartPointer< vtkRenderer >::New();
+    QScopedPointer< SketchBio::Project > proj(
+                new SketchBio::Project(r1,AUTOSAVE_TEST_DIR));
+    SketchObject *obj = MakeTestProject::addObjectToProject(proj.data());
+    MakeTestProject::addKeyframesToObject(obj,3);
+
+    vtkSmartPointer< vtkXMLDataElement > expected =
+            vtkSmartPointer< vtkXMLDataElement >::Take(
+                ProjectToXML::projectToXML(proj.data()));
+    std::ostringstream expectedText;
+    vtkIndent indent(0);
+    vtkXMLUtilities::FlattenElement(expected,expectedText,&indent);
+
+    ProjectAutosaver saver(proj.data());
+    QString file = saver.getAutosaveFileName();
+    QFile::remove(file);
+    saver.autosave();
+    q_vec_type pos = {100.0, -30.0, 2.0};
+    obj->setPosition(pos);
+    obj->addKeyframeForCurrentLocation(50.0);
+    saver.waitForWrite();
+
+    QFile written(file);
+    if (!written.open(QIODevice::ReadOnly))
+    {
+        retVal++;
+        cout << "Autosave file was not written." << endl;
+        return retVal;
+    }
+    if (written.readAll() != QByteArray(expectedText.str().c_str()))
+    {
+        retVal++;
+        cout << "Autosave file has changes made after the autosave started."
+             << endl;
+    }
+    return retVal;
+}
+
+// Tests that the atomic write replaces an existing file
+int testAtomicReplace()
+{
+    int retVal = 0;
+    QDir dir(QDir::current());
+    dir.mkpath(AUTOSAVE_TEST_DIR);
+    QString file = dir.absoluteFilePath(
+                QString(AUTOSAVE_TEST_DIR) + "/replace_test.xml");
+    vtkSmartPointer< vtkXMLDataElement > elem =
+            vtkSmartPointer< vtkXMLDataElement >::New();
+    elem->SetName("first");
+    if (!ProjectAutosaver::writeElementToFileAtomically(elem,file))
+    {
+        retVal++;
+        cout << "Failed to write new file." << endl;
+    }
+    elem->SetName("second");
+    if (!ProjectAutosaver::writeElementToFileAtomically(elem,file))
+    {
+        retVal++;
+        cout << "Failed to replace existing file." << endl;
+    }
+    vtkSmartPointer< vtkXMLDataElement > read =
+            vtkSmartPointer< vtkXMLDataElement >::Take(
+                vtkXMLUtilities::ReadElementFromFile(
+                    file.toStdString().c_str()));
+    if (read.GetPointer() == NULL || strcmp(read->GetName(),"second") != 0)
+    {
+        retVal++;
+        cout << "Replaced file has the wrong contents." << endl;
+    }
+    QFile::remove(file);
+    return retVal;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc,argv);
+    app.setApplicationName("Sketchbio");
+    app.setOrganizationName("UNC Computer Science");
+    app.setOrganizationDomain("sketchbio.org");
+    QDir dir = QDir::current();
+    // change the working dir to the dir where the test executable is
+    QString executable = dir.absolutePath() + "/" + argv[0];
+    int last = executable.lastIndexOf("/");
+    if (QDir::setCurrent(executable.left(last)))
+        dir = QDir::current();
+    std::cout << "Working directory: " <<
+                 dir.absolutePath().toStdString().c_str() << std::endl;
+    int val = 0;
+    try
+    {
+        val = testAtomicReplace() + testAutosave() + testSnapshotDetached();
+    }
+    catch (const char *c)
+    {
+        std::cout << c << std::endl;
+        val = 1;
+    }
+    return val;
+}
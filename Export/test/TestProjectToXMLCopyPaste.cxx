@@ -18,6 +18,7 @@
 #include <modelmanager.h>
 #include <modelinstance.h>
 #include <objectgroup.h>
+#include <objectclipboard.h>
 #include <worldmanager.h>
 #include <sketchproject.h>
 
@@ -35,13 +36,15 @@ int testSavePastedItem();
 int testPastedItemIsTheSame();
 int testPastedGroupIsTheSame();
 int testSaveAndLoadStructure();
+int testInMemoryPasteIsTheSame();
 
 int main(int argc, char *argv[])
 {
     return    testSavePastedItem()
             + testPastedItemIsTheSame()
             + testPastedGroupIsTheSame()
-			+ testSaveAndLoadStructure();
+			+ testSaveAndLoadStructure()
+            + testInMemoryPasteIsTheSame();
 }
 
 int testSavePastedItem()
@@ -192,3 +195,51 @@ int testSaveAndLoadStructure() {
 	CompareBeforeAndAfter::compareObjects(obj,loadedObj,retVal,true,false);
 	return retVal;
 }
+
+// tests that pasting from the project's in-memory clipboard gives the same
+// result as pasting the xml, and that it reuses the loaded models
+int testInMemoryPasteIsTheSame()
+{
+    int retVal = 0;
+    vtkSmartPointer< vtkRenderer > r1 =
+            vtkSmartPointer< vtkRenderer >::New();
+    QScopedPointer< SketchBio::Project > proj1(
+                new SketchBio::Project(r1,TEST_DIR));
+
+    SketchObject *grp = MakeTestProject::addGroupToProject(proj1.data(),3);
+    proj1->getWorldManager().removeObject(grp);
+    QScopedPointer< SketchObject > obj(grp);
+    int numModels = proj1->getModelManager().getNumberOfModels();
+
+    proj1->getClipboard().copy(obj.data(),"copied");
+    if (!proj1->getClipboard().matchesText("copied") ||
+            proj1->getClipboard().matchesText("something else"))
+    {
+        retVal++;
+        cout << "Clipboard text matching is wrong." << endl;
+    }
+    q_vec_type pos;
+    obj->getPosition(pos);
+    const int numPastes = 100;
+    for (int i = 0; i < numPastes; i++)
+    {
+        proj1->getClipboard().paste(proj1->getWorldManager(),pos);
+    }
+    const QList< SketchObject * > *list = proj1->getWorldManager().getObjects();
+    if (list->size() != numPastes)
+    {
+        retVal++;
+        cout << "Wrong number of objects in result." << endl;
+        return retVal;
+    }
+    if (proj1->getModelManager().getNumberOfModels() != numModels)
+    {
+        retVal++;
+        cout << "Pasting from memory created new models." << endl;
+    }
+    SketchObject *pasted = list->at(0);
+    pasted->setPosition(pos); // position is not preserved by copy/paste
+
+    CompareBeforeAndAfter::compareObjects(obj.data(),pasted,retVal,true,false);
+    return retVal;
+}
@@ -218,6 +218,28 @@ int testSave8()
     return saveLoadAndTest(proj1.data(),8);
 }
 
+int testSave10()
+{
+    // enough top level objects that they are parsed in parallel on load
+    vtkSmartPointer< vtkRenderer > r1 =
+            vtkSmartPointer< vtkRenderer >::New();
+    QScopedPointer< SketchBio::Project > proj1(
+                new SketchBio::Project(r1,SAVE_TEST_DIR));
+
+    for (int i = 0; i < 12; i++)
+    {
+        SketchObject *o = MakeTestProject::addObjectToProject(proj1.data());
+        MakeTestProject::addKeyframesToObject(o, (i % 3) + 1);
+    }
+    for (int i = 0; i < 4; i++)
+    {
+        SketchObject *g = MakeTestProject::addGroupToProject(proj1.data(), 3);
+        MakeTestProject::addKeyframesToObject(g, 2);
+    }
+
+    return saveLoadAndTest(proj1.data(),10);
+}
+
 
 int testSave9()
 {
@@ -261,7 +283,8 @@ int main(int argc, char *argv[])
     try
     {
         val = testSave1() + testSave2() + testSave3() + testSave4() + testSave5() +
-                testSave6() + testSave7() + testSave8() + testSave9();
+                testSave6() + testSave7() + testSave8() + testSave9() +
+                testSave10();
     }
     catch (const char *c)
     {
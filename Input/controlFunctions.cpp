@@ -23,6 +23,7 @@
 #include <transformequals.h>
 #include <keyframe.h>
 #include <objectgroup.h>
+#include <objectclipboard.h>
 #include <projecttoxml.h>
 #include <springconnection.h>
 #include <measuringtape.h>
@@ -841,8 +842,12 @@ void lockTransforms(SketchBio::Project *proj, int hand, bool wasPressed)
                                                    ProjectToXML::objectToClipboardXML(nearestObj));
         std::stringstream ss;
         vtkXMLUtilities::FlattenElement(elem, ss);
+        QString text(ss.str().c_str());
         QClipboard *clipboard = QApplication::clipboard();
-        clipboard->setText(ss.str().c_str());
+        clipboard->setText(text);
+        // keep a copy in memory that refers to the loaded models so pasting
+        // it in this project does not have to go through the xml
+        project->getClipboard().copy(nearestObj, text);
       }
       project->clearDirections();
     }
@@ -855,17 +860,28 @@ void lockTransforms(SketchBio::Project *proj, int hand, bool wasPressed)
       project->setDirections("Release the button to paste");
     } else  // button released
     {
-      std::stringstream ss;
       QClipboard *clipboard = QApplication::clipboard();
-      ss.str(clipboard->text().toStdString());
+      QString text = clipboard->text();
+      q_vec_type rpos;
+      project->getHand((hand == 0)
+                       ? SketchBioHandId::LEFT
+                       : SketchBioHandId::RIGHT).getPosition(rpos);
+      // if the system clipboard still has what was copied in this project,
+      // paste from the in-memory copy
+      ObjectClipboard &objClipboard = project->getClipboard();
+      if (objClipboard.matchesText(text)) {
+        if (objClipboard.paste(project->getWorldManager(), rpos) != NULL) {
+          addUndoState(project);
+        }
+        project->clearDirections();
+        return;
+      }
+      std::stringstream ss;
+      ss.str(text.toStdString());
       vtkSmartPointer< vtkXMLDataElement > elem =
       vtkSmartPointer< vtkXMLDataElement >::Take(
                                                  vtkXMLUtilities::ReadElementFromStream(ss));
       if (elem) {
-        q_vec_type rpos;
-        project->getHand((hand == 0)
-                         ? SketchBioHandId::LEFT
-                         : SketchBioHandId::RIGHT).getPosition(rpos);
         if (ProjectToXML::objectFromClipboardXML(project, elem, rpos) ==
             ProjectToXML::XML_TO_DATA_FAILURE) {
           std::cout << "Read xml correctly, but reading object failed."
@@ -31,7 +31,8 @@
 #include <QInputDialog>
 #include <QFileDialog>
 #include <QCloseEvent>
-#include <QProgressDialog>
+#include <QStatusBar>
+#include <QStringList>
 #include <QMessageBox>
 #include <QThread>
 #include <QTimer>
@@ -51,6 +52,7 @@
 #include <hand.h>
 
 #include <projecttoxml.h>
+#include <projectautosaver.h>
 #include <ProjectToFlorosim.h>
 
 #include <controlFunctions.h>
@@ -58,6 +60,7 @@
 
 #include <subprocessrunner.h>
 #include <subprocessutils.h>
+#include <subprocessscheduler.h>
 
 // default number extra fibers
 #define NUM_EXTRA_FIBERS 14
@@ -206,7 +209,9 @@ SimpleView::SimpleView(QString projDir, bool load_example, const QString &device
       renderer(vtkSmartPointer< vtkRenderer >::New()),
       project(new SketchBio::Project(renderer.GetPointer(), projDir)),
       inputManager(new SketchBio::InputManager(deviceFile)),
-      stateHelper(new GUIStateHelper(*inputManager))
+      stateHelper(new GUIStateHelper(*inputManager)),
+      autosaver(new ProjectAutosaver(project, this)),
+      jobScheduler(new SubprocessScheduler(0, this))
 {
     this->ui = new Ui_SimpleView;
     this->ui->setupUi(this);
@@ -257,11 +262,24 @@ SimpleView::SimpleView(QString projDir, bool load_example, const QString &device
     // start timer for frame update
     connect(timer, SIGNAL(timeout()), this, SLOT(slot_frameLoop()));
     timer->start(16);
+    // background jobs report their progress in the status bar
+    connect(jobScheduler, SIGNAL(jobStatusChanged(int, QString)), this,
+            SLOT(showJobStatus(int, QString)));
+    connect(jobScheduler, SIGNAL(jobCountsChanged(int, int)), this,
+            SLOT(updateJobStatusText()));
+    connect(jobScheduler, SIGNAL(jobFinished(int, bool)), this,
+            SLOT(jobFinished(int, bool)));
+    // start periodic background saves
+    autosaver->start();
 }
 
 SimpleView::~SimpleView()
 {
     timer->stop();
+    autosaver->stop();
+    autosaver->waitForWrite();
+    // the jobs use the project
+    jobScheduler->cancelAllJobs();
     delete inputManager;
     delete project;
     delete stateHelper;
@@ -538,10 +556,15 @@ void SimpleView::loadProject()
     renderer->SetViewport(0, 0, 1, 1);
     stateHelper->addTextToRenderer(renderer);
 
+    // the jobs use the old project
+    jobsNeedingUndoState.clear();
+    jobScheduler->cancelAllJobs();
+    autosaver->setProject(NULL);
     delete project;
     // create new one
     this->ui->qvtkWidget->GetRenderWindow()->AddRenderer(renderer);
     project = new SketchBio::Project(renderer, dirPath);
+    autosaver->setProject(project);
     stateHelper->setProject(project);
     inputManager->setProject(project);
     ControlFunctions::addUndoState(project);
@@ -790,13 +813,11 @@ void SimpleView::simplifyObjectByName(const QString name)
     }
     printf("Simplifying %s \n", name.toStdString().c_str());
 
-    SubprocessRunner *runner =
-        SubprocessUtils::simplifyObjFileByPercent(name, 10);
+    SubprocessRunner *runner = SubprocessUtils::makeSimplifiedLevelsFor(name);
     if (runner == NULL) {
-        QMessageBox::warning(NULL, "Could not run Blender to simplify model.",
-                             name);
+        QMessageBox::warning(NULL, "Could not simplify model.", name);
     } else {
-        runSubprocessAndFreezeGUI(runner);
+        runSubprocessInBackground(runner, "Simplifying " + name);
     }
 }
 
@@ -845,7 +866,7 @@ void SimpleView::importPDBId()
                 QMessageBox::warning(
                     NULL, "Could not run subprocess to import molecule ", text);
             } else {
-                runSubprocessAndFreezeGUI(objMaker, true);
+                runSubprocessInBackground(objMaker, "Importing " + text, true);
             }
         }
     }
@@ -880,7 +901,7 @@ void SimpleView::openPDBFile()
             QMessageBox::warning(
                 NULL, "Could not run subprocess to import molecule ", fn);
         } else {
-            runSubprocessAndFreezeGUI(objMaker, true);
+            runSubprocessInBackground(objMaker, "Importing " + fn, true);
         }
     }
 }
@@ -914,7 +935,7 @@ void SimpleView::exportBlenderAnimation()
         QMessageBox::warning(NULL, "Error while setting up animation",
                              "See log for details");
     } else {
-        runSubprocessAndFreezeGUI(r);
+        runSubprocessInBackground(r, "Exporting animation to " + fn);
     }
 }
 
@@ -937,24 +958,80 @@ void SimpleView::addUndoStateIfSuccess(bool success)
     }
 }
 
-void SimpleView::runSubprocessAndFreezeGUI(SubprocessRunner *runner,
+void SimpleView::jobFinished(int id, bool success)
+{
+    if (jobsNeedingUndoState.remove(id)) {
+        addUndoStateIfSuccess(success);
+    }
+    if (!success) {
+        statusBar()->showMessage("Background job failed, see log for details");
+    }
+}
+
+void SimpleView::showJobStatus(int id, QString status)
+{
+    Q_UNUSED(id);
+    lastJobStatus = status;
+    updateJobStatusText();
+}
+
+void SimpleView::updateJobStatusText()
+{
+    int running = jobScheduler->getNumberOfRunningJobs();
+    int queued = jobScheduler->getNumberOfQueuedJobs();
+    if (running == 0 && queued == 0) {
+        lastJobStatus.clear();
+        statusBar()->clearMessage();
+        return;
+    }
+    QString text = QString("Jobs: %1 running, %2 queued").arg(running).arg(
+        queued);
+    if (!lastJobStatus.isEmpty()) {
+        text += " - " + lastJobStatus;
+    }
+    statusBar()->showMessage(text);
+}
+
+void SimpleView::cancelBackgroundJobs()
+{
+    QList< int > ids = jobScheduler->getJobIds();
+    if (ids.isEmpty()) {
+        QMessageBox::information(this, "Cancel Background Jobs",
+                                 "No jobs are running.");
+        return;
+    }
+    QStringList items;
+    items << "All jobs";
+    for (int i = 0; i < ids.size(); i++) {
+        items << jobScheduler->getJobDescription(ids[i]) + " (" +
+                     jobScheduler->getJobStatus(ids[i]) + ")";
+    }
+    bool ok;
+    QString item = QInputDialog::getItem(this, tr("Cancel Background Jobs"),
+                                         tr("Job to cancel:"), items, 0,
+                                         false, &ok);
+    if (!ok) {
+        return;
+    }
+    int idx = items.indexOf(item);
+    if (idx == 0) {
+        jobsNeedingUndoState.clear();
+        jobScheduler->cancelAllJobs();
+    } else if (idx > 0) {
+        jobsNeedingUndoState.remove(ids[idx - 1]);
+        jobScheduler->cancelJob(ids[idx - 1]);
+    }
+}
+
+void SimpleView::runSubprocessInBackground(SubprocessRunner *runner,
+                                           const QString &description,
                                            bool needsUndoState)
 {
     if (runner == NULL) return;
-    timer->stop();
-    QProgressDialog *dialog = new QProgressDialog(".", "Cancel", 0, 0, NULL);
-    connect(runner, SIGNAL(statusChanged(QString)), dialog,
-            SLOT(setLabelText(QString)));
-    connect(runner, SIGNAL(finished(bool)), dialog, SLOT(reset()));
-    connect(runner, SIGNAL(finished(bool)), timer, SLOT(start()));
-    connect(runner, SIGNAL(destroyed()), dialog, SLOT(deleteLater()));
-    connect(dialog, SIGNAL(canceled()), runner, SLOT(cancel()));
-    connect(dialog, SIGNAL(canceled()), timer, SLOT(start()));
-    connect(dialog, SIGNAL(canceled()), dialog, SLOT(reset()));
-    if (needsUndoState) {
-        connect(runner, SIGNAL(finished(bool)), this,
-                SLOT(addUndoStateIfSuccess(bool)));
-    }
-    dialog->open();
-    runner->start();
+    // the frame timer keeps running, the job reports its progress in the
+    // status bar and can be canceled from the File menu
+    int id = jobScheduler->addJob(runner, description);
+    if (needsUndoState && jobScheduler->hasJob(id)) {
+        jobsNeedingUndoState.insert(id);
+    }
 }
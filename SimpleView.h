@@ -13,6 +13,7 @@ class QTimer;
 class QThread;
 class QActionGroup;
 #include <QString>
+#include <QSet>
 
 class SketchObject;
 namespace SketchBio {
@@ -21,10 +22,12 @@ class InputManager;
 }
 
 class ProjectToXML;
+class ProjectAutosaver;
 
 class vrpnServer;
 
 class SubprocessRunner;
+class SubprocessScheduler;
  
 // Forward Qt class declaration (the view)
 class Ui_SimpleView;
@@ -79,13 +82,17 @@ public slots:
   void exportFlorosim();
 
   // Throw a dialog box to browse for an OBJ file to
-  // simplify.  Produce multiple simplifications, with smaller
-  // fractional polygon counts.
+  // simplify.  Produces the simplified levels (X.decimated.5000.vtk,
+  // X.decimated.2000.vtk and X.decimated.1000.vtk) next to it.
   void simplifyOBJFile();
 
   // Restarts the internal vrpn server if there is one.
   void restartVRPNServer();
 
+  // Asks which background job (import, simplification, etc.) to cancel and
+  // cancels it
+  void cancelBackgroundJobs();
+
   // Save the current project
   void saveProjectAs();
   void saveProject();
@@ -141,11 +148,18 @@ protected slots:
   void addUndoStateIfSuccess(bool success);
 private slots:
   void updateStatusText();
+  // Background job progress
+  void jobFinished(int id, bool success);
+  void showJobStatus(int id, QString status);
+  void updateJobStatusText();
  
 private:
 
   // Methods
-  void runSubprocessAndFreezeGUI(SubprocessRunner *runner,
+  // Queues the runner to run in the background.  The frame loop keeps
+  // running while it does.
+  void runSubprocessInBackground(SubprocessRunner *runner,
+                                 const QString &description,
                                  bool needsUndoState = false);
 
   class GUIStateHelper;
@@ -158,6 +172,10 @@ private:
   SketchBio::Project *project;
   SketchBio::InputManager *inputManager;
   GUIStateHelper *stateHelper;
+  ProjectAutosaver *autosaver;
+  SubprocessScheduler *jobScheduler;
+  QSet< int > jobsNeedingUndoState;
+  QString lastJobStatus;
 };
 
 
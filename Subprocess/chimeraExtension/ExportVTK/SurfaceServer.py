@@ -0,0 +1,115 @@
+#############################################################
+#
+# This module runs inside UCSF Chimera and makes surfaces for SketchBio
+# on request, so that Chimera (and this extension) only has to be loaded
+# once instead of once per surface.  SketchBio starts Chimera with a
+# small script that adds the extension directory to the path and calls
+# ExportVTK.SurfaceServer.serve().
+#
+# Requests are read from standard input, one per line, with tab separated
+# fields:
+#
+#   surface <pdb id or file> <chains to delete> <whole bio unit (0 or 1)>
+#           <resolution> <vtk file> [<resolution> <vtk file> ...]
+#   quit
+#
+# Replies are written to standard output on lines that start with
+# SKETCHBIO_ so that they can be picked out of Chimera's other output:
+#
+#   SKETCHBIO_READY                 once, when requests can be sent
+#   SKETCHBIO_STATUS <message>      progress of the current request
+#   SKETCHBIO_DONE <ok or failed>   when a surface request is finished
+#
+# The structure is opened once per request and all of the requested
+# resolutions are made from it.
+#
+# Written as part of the SketchBio project, which is funded
+# by the NIH (award number 50-P41-EB002025).
+#
+
+import sys
+import traceback
+
+# write the replies to the real stdout, not to Chimera's reply log
+def reply(kind, *fields):
+    sys.__stdout__.write('\t'.join(['SKETCHBIO_' + kind] + list(fields)) + '\n')
+    sys.__stdout__.flush()
+
+# makes the surfaces for one request, outputs is a list of
+# (resolution, vtk file) pairs
+def make_surfaces(structure, chainsToDelete, wholeBioUnit, outputs):
+    from chimera import runCommand
+    from chimera import openModels
+    from Midas import MidasError
+    import ExportVTK
+    runCommand("open %s" % structure)
+    runCommand("~show; ~ribbon")
+    runCommand("delete solvent")
+    for c in chainsToDelete.strip().upper():
+        if c.isupper():
+            runCommand("delete #0:.%s" % c)
+    # set up to export charge
+    runCommand("surf")
+    runCommand("coulombic gpadding 20.0 gname CoulombicESP -10 red 0 white 10 blue")
+    models = openModels.list()
+    molecule, surface, volume = models[0], models[1], models[2]
+    if wholeBioUnit:
+        # TODO - can't do whole biounit charge data yet, need to store
+        # something about xform used to create point first
+        volume = None
+    for resolution, vtkFile in outputs:
+        reply('STATUS', 'Creating surface at resolution %d' % resolution)
+        before = openModels.list()
+        created = []
+        modelList = [molecule]
+        try:
+            if wholeBioUnit:
+                # this by default exports the whole biological unit
+                runCommand("sym #0 surfaces all resolution %d" % resolution)
+            else:
+                # this command explicitly defines what to export as just the
+                # existing piece and will work even when no biological unit
+                # information is present
+                runCommand("sym #0 group shift,1,0 surfaces all resolution %d"
+                           % resolution)
+            created = [m for m in openModels.list() if m not in before]
+            modelList.append(created[0])
+        except MidasError:
+            print "Failed to create Multiscale surface..."
+            modelList.append(surface)
+        ExportVTK.write_models_as_vtk(vtkFile, modelList, volume)
+        # close this resolution's surface so the next one is made from
+        # the same starting state
+        if len(created) > 0:
+            openModels.close(created)
+
+# reads requests from stdin until it is closed or a quit request is read
+def serve():
+    from chimera import runCommand
+    reply('READY')
+    while True:
+        line = sys.__stdin__.readline()
+        if not line:
+            break
+        fields = line.rstrip('\r\n').split('\t')
+        if fields[0] == 'quit':
+            break
+        if fields[0] != 'surface' or len(fields) < 6 or len(fields) % 2 != 0:
+            print "Bad request:", line
+            reply('DONE', 'failed')
+            continue
+        try:
+            outputs = list()
+            for i in range(4, len(fields), 2):
+                outputs.append((int(fields[i]), fields[i + 1]))
+            make_surfaces(fields[1], fields[2], fields[3] == '1', outputs)
+            result = 'ok'
+        except Exception:
+            traceback.print_exc()
+            result = 'failed'
+        try:
+            runCommand("close all")
+        except Exception:
+            traceback.print_exc()
+        reply('DONE', result)
+    runCommand("stop now")
@@ -0,0 +1,407 @@
+#include "chimerasurfaceserver.h"
+
+#include <QTemporaryFile>
+#include <QTimer>
+#include <QDir>
+#include <QDebug>
+
+#include <SettingsHelpers.h>
+
+#include "subprocessutils.h"
+
+// the prefix of the lines in the worker's output that are replies, everything
+// else is Chimera's own output
+#define REPLY_PREFIX "SKETCHBIO_"
+// how long to wait for the worker to quit before killing it (msec)
+#define WORKER_QUIT_TIMEOUT 3000
+
+ChimeraSurfaceServer::ChimeraSurfaceServer(int maxWorkerProcesses, QObject *parent) :
+    QObject(parent),
+    maxWorkers(qMax(1, maxWorkerProcesses)),
+    idleTimeout(DEFAULT_CHIMERA_WORKER_IDLE_TIMEOUT),
+    startupScript(NULL),
+    nextId(0)
+{
+}
+
+ChimeraSurfaceServer::~ChimeraSurfaceServer()
+{
+    // ask all the workers to quit before waiting on any of them so they shut
+    // down at the same time
+    for (int i = 0; i < workers.size(); i++)
+    {
+        workers[i]->process->disconnect(this);
+        workers[i]->idleTimer->disconnect(this);
+        if (workers[i]->process->state() != QProcess::NotRunning &&
+                !workers[i]->quitting)
+        {
+            workers[i]->process->write("quit\n");
+        }
+    }
+    for (int i = 0; i < workers.size(); i++)
+    {
+        QProcess *process = workers[i]->process;
+        if (process->state() != QProcess::NotRunning &&
+                !process->waitForFinished(WORKER_QUIT_TIMEOUT))
+        {
+            process->kill();
+            process->waitForFinished();
+        }
+        delete workers[i];
+    }
+    if (startupScript != NULL)
+    {
+        QFile f(startupScript->fileName() + "c");
+        if (f.exists())
+            f.remove();
+    }
+}
+
+int ChimeraSurfaceServer::getMaxWorkers() const
+{
+    return maxWorkers;
+}
+
+void ChimeraSurfaceServer::setMaxWorkers(int max)
+{
+    maxWorkers = qMax(1, max);
+    sendNextRequest();
+}
+
+int ChimeraSurfaceServer::getIdleTimeout() const
+{
+    return idleTimeout;
+}
+
+void ChimeraSurfaceServer::setIdleTimeout(int msec)
+{
+    idleTimeout = msec;
+}
+
+void ChimeraSurfaceServer::setWorkerCommand(const QString &program,
+                                            const QStringList &arguments)
+{
+    workerProgram = program;
+    workerArguments = arguments;
+}
+
+int ChimeraSurfaceServer::requestSurfaces(
+        const QString &pdbId, const QString &chainsToDelete,
+        bool exportWholeBioUnit, const QVector< int > &thresholds,
+        const QStringList &vtkFiles)
+{
+    Request request;
+    request.id = nextId++;
+    request.pdbId = pdbId;
+    request.chainsToDelete = chainsToDelete.trimmed();
+    request.exportWholeBioUnit = exportWholeBioUnit;
+    request.thresholds = thresholds;
+    request.vtkFiles = vtkFiles;
+    queue.append(request);
+    // the caller needs the id before anything can happen to the request
+    QTimer::singleShot(0, this, SLOT(sendNextRequest()));
+    return request.id;
+}
+
+void ChimeraSurfaceServer::cancelRequest(int id)
+{
+    for (int i = 0; i < workers.size(); i++)
+    {
+        if (workers[i]->currentRequest == id)
+        {
+            // there is no way to stop Chimera partway through a request
+            // without killing it, so just ignore the result
+            workers[i]->currentCanceled = true;
+            return;
+        }
+    }
+    for (int i = 0; i < queue.size(); i++)
+    {
+        if (queue[i].id == id)
+        {
+            queue.removeAt(i);
+            return;
+        }
+    }
+}
+
+bool ChimeraSurfaceServer::isWorkerRunning() const
+{
+    return !workers.isEmpty();
+}
+
+int ChimeraSurfaceServer::getNumberOfWorkers() const
+{
+    return workers.size();
+}
+
+int ChimeraSurfaceServer::getNumberOfPendingRequests() const
+{
+    int pending = queue.size();
+    for (int i = 0; i < workers.size(); i++)
+    {
+        if (workers[i]->currentRequest != -1)
+        {
+            pending++;
+        }
+    }
+    return pending;
+}
+
+bool ChimeraSurfaceServer::startWorker()
+{
+    QString program = workerProgram;
+    QStringList arguments = workerArguments;
+    if (program.isEmpty())
+    {
+        if (startupScript == NULL)
+        {
+            startupScript = new QTemporaryFile(QDir::tempPath() + "/XXXXXX.py",
+                                               this);
+            if (!startupScript->open())
+            {
+                delete startupScript;
+                startupScript = NULL;
+                return false;
+            }
+            startupScript->write("# Temporary file created by SketchBio to run in UCSF Chimera\n");
+            QString line = "import sys\nsys.path.insert(0,'%1')\n";
+            line = line.arg(SubprocessUtils::getChimeraVTKExtensionDir());
+            startupScript->write(line.toStdString().c_str());
+            startupScript->write("import ExportVTK.SurfaceServer\n");
+            startupScript->write("ExportVTK.SurfaceServer.serve()\n");
+            startupScript->close();
+            if (startupScript->error() != QFile::NoError)
+            {
+                delete startupScript;
+                startupScript = NULL;
+                return false;
+            }
+        }
+        program = SettingsHelpers::getSubprocessExecutablePath("chimera");
+        arguments << "--nogui" << startupScript->fileName();
+    }
+    qDebug() << "Starting Chimera surface worker";
+    Worker *worker = new Worker;
+    worker->process = new QProcess(this);
+    worker->currentRequest = -1;
+    worker->currentCanceled = false;
+    worker->ready = false;
+    worker->quitting = false;
+    worker->process->setProcessChannelMode(QProcess::MergedChannels);
+    worker->process->start(program, arguments);
+    if (!worker->process->waitForStarted())
+    {
+        delete worker->process;
+        delete worker;
+        return false;
+    }
+    worker->idleTimer = new QTimer(this);
+    worker->idleTimer->setSingleShot(true);
+    connect(worker->idleTimer, SIGNAL(timeout()), this, SLOT(workerIdleTimedOut()));
+    connect(worker->process, SIGNAL(readyRead()), this, SLOT(workerOutputReady()));
+    connect(worker->process, SIGNAL(finished(int,QProcess::ExitStatus)),
+            this, SLOT(workerFinished(int,QProcess::ExitStatus)));
+    workers.append(worker);
+    return true;
+}
+
+void ChimeraSurfaceServer::startIdleTimer(Worker *worker)
+{
+    if (idleTimeout > 0 && worker->ready && !worker->quitting &&
+            worker->currentRequest == -1)
+    {
+        worker->idleTimer->start(idleTimeout);
+    }
+}
+
+ChimeraSurfaceServer::Worker *ChimeraSurfaceServer::workerFor(
+        QObject *sender) const
+{
+    for (int i = 0; i < workers.size(); i++)
+    {
+        if (workers[i]->process == sender || workers[i]->idleTimer == sender)
+        {
+            return workers[i];
+        }
+    }
+    return NULL;
+}
+
+void ChimeraSurfaceServer::failQueuedRequests()
+{
+    QList< Request > failed = queue;
+    queue.clear();
+    for (int i = 0; i < failed.size(); i++)
+    {
+        emit requestFinished(failed[i].id, false);
+    }
+}
+
+void ChimeraSurfaceServer::sendNextRequest()
+{
+    // idle workers that are ready get requests now, the ones still starting
+    // up will call this again when they say they are ready
+    int starting = 0;
+    for (int i = 0; i < workers.size() && !queue.isEmpty(); i++)
+    {
+        if (workers[i]->currentRequest != -1 || workers[i]->quitting)
+        {
+            continue;
+        }
+        if (workers[i]->ready)
+        {
+            sendRequest(workers[i], queue.takeFirst());
+        }
+        else
+        {
+            starting++;
+        }
+    }
+    // start more workers for the requests that are left, up to the limit
+    while (queue.size() > starting && workers.size() < maxWorkers)
+    {
+        if (!startWorker())
+        {
+            qDebug() << "Could not start a Chimera surface worker.";
+            if (workers.isEmpty())
+            {
+                failQueuedRequests();
+            }
+            return;
+        }
+        starting++;
+    }
+}
+
+void ChimeraSurfaceServer::sendRequest(Worker *worker, const Request &request)
+{
+    QStringList fields;
+    fields << "surface" << request.pdbId << request.chainsToDelete
+           << (request.exportWholeBioUnit ? "1" : "0");
+    for (int i = 0; i < request.thresholds.size() && i < request.vtkFiles.size(); i++)
+    {
+        fields << QString::number(request.thresholds[i]) << request.vtkFiles[i];
+    }
+    worker->idleTimer->stop();
+    worker->currentRequest = request.id;
+    worker->currentCanceled = false;
+    worker->process->write(QFile::encodeName(fields.join("\t") + "\n"));
+    emit requestStarted(request.id);
+}
+
+void ChimeraSurfaceServer::workerOutputReady()
+{
+    Worker *worker = workerFor(sender());
+    if (worker != NULL)
+    {
+        readReplies(worker);
+    }
+}
+
+void ChimeraSurfaceServer::readReplies(Worker *worker)
+{
+    while (worker->process->canReadLine())
+    {
+        QString line = QFile::decodeName(worker->process->readLine());
+        while (line.endsWith('\n') || line.endsWith('\r'))
+        {
+            line.chop(1);
+        }
+        if (!line.startsWith(REPLY_PREFIX))
+        {
+            if (!line.trimmed().isEmpty())
+                qDebug() << "Chimera:" << line;
+            continue;
+        }
+        QStringList fields = line.mid(sizeof(REPLY_PREFIX) - 1).split('\t');
+        // the idle timer is started before anything is emitted and stopped
+        // if the worker is sent a request
+        if (fields[0] == "READY")
+        {
+            worker->ready = true;
+            startIdleTimer(worker);
+            sendNextRequest();
+        }
+        else if (fields[0] == "STATUS")
+        {
+            if (worker->currentRequest != -1 && !worker->currentCanceled)
+            {
+                emit requestStatusChanged(worker->currentRequest,
+                                          fields.value(1));
+            }
+        }
+        else if (fields[0] == "DONE")
+        {
+            int id = worker->currentRequest;
+            bool canceled = worker->currentCanceled;
+            worker->currentRequest = -1;
+            startIdleTimer(worker);
+            if (id != -1 && !canceled)
+            {
+                emit requestFinished(id, fields.value(1) == "ok");
+            }
+            sendNextRequest();
+        }
+        // whatever is connected to the signals may run an event loop in
+        // which the worker quits and is removed
+        if (!workers.contains(worker))
+        {
+            return;
+        }
+    }
+}
+
+void ChimeraSurfaceServer::workerFinished(int exitCode, QProcess::ExitStatus status)
+{
+    Worker *worker = workerFor(sender());
+    if (worker == NULL)
+    {
+        return;
+    }
+    // handle any replies that came in just before the worker quit
+    readReplies(worker);
+    workers.removeOne(worker);
+    worker->process->disconnect(this);
+    worker->process->deleteLater();
+    delete worker->idleTimer;
+    if (worker->currentRequest != -1)
+    {
+        qDebug() << "Chimera surface worker quit while making a surface. "
+                    "Exit code: " << exitCode << " status: " << status;
+        if (!worker->currentCanceled)
+        {
+            emit requestFinished(worker->currentRequest, false);
+        }
+    }
+    bool wasReady = worker->ready;
+    delete worker;
+    if (!wasReady)
+    {
+        // the worker is broken, don't keep restarting it.  Any other workers
+        // can still take the queued requests.
+        qDebug() << "Chimera surface worker quit before it was ready.";
+        if (workers.isEmpty())
+        {
+            failQueuedRequests();
+        }
+    }
+    else if (!queue.isEmpty())
+    {
+        QTimer::singleShot(0, this, SLOT(sendNextRequest()));
+    }
+}
+
+void ChimeraSurfaceServer::workerIdleTimedOut()
+{
+    Worker *worker = workerFor(sender());
+    if (worker == NULL || worker->currentRequest != -1 || worker->quitting)
+    {
+        return;
+    }
+    qDebug() << "Stopping idle Chimera surface worker";
+    // the worker is removed when its process finishes, requests that come in
+    // before then go to other workers or wait for it to be replaced
+    worker->quitting = true;
+    worker->process->write("quit\n");
+}
@@ -0,0 +1,149 @@
+#ifndef CHIMERASURFACESERVER_H
+#define CHIMERASURFACESERVER_H
+
+#include <QObject>
+#include <QProcess>
+#include <QStringList>
+#include <QVector>
+#include <QList>
+
+class QTemporaryFile;
+class QTimer;
+
+// the number of Chimera processes run at once by default.  Each one holds a
+// whole copy of Chimera in memory, so this is kept small.
+#define DEFAULT_CHIMERA_SURFACE_WORKERS 2
+// how long a worker may sit idle before it is stopped by default (msec)
+#define DEFAULT_CHIMERA_WORKER_IDLE_TIMEOUT 60000
+
+/*
+ * This class keeps a small pool of UCSF Chimera processes running in the
+ * background to make surfaces, so that Chimera and the ExportVTK extension
+ * only have to be loaded once per worker instead of once per surface.  Each
+ * worker is sent one request at a time over its stdin and the replies are read
+ * from its stdout (see chimeraExtension/ExportVTK/SurfaceServer.py for the
+ * protocol).  Requests go to an idle worker if there is one, otherwise a new
+ * worker is started if there are fewer than the maximum number of workers,
+ * otherwise they are queued.
+ *
+ * Workers are only started when there are requests for them and are
+ * restarted if they die.  Workers that have had nothing to do for the idle
+ * timeout are stopped, and all of them are stopped when this object is
+ * destroyed.
+ *
+ * SubprocessUtils has the server used by the application, the runners made by
+ * SubprocessUtils::makeChimeraSurfaceFor use it.
+ */
+class ChimeraSurfaceServer : public QObject
+{
+    Q_OBJECT
+public:
+    // maxWorkerProcesses - the most Chimera processes to run at once (at
+    //                      least 1)
+    explicit ChimeraSurfaceServer(
+            int maxWorkerProcesses = DEFAULT_CHIMERA_SURFACE_WORKERS,
+            QObject *parent = 0);
+    virtual ~ChimeraSurfaceServer();
+
+    int getMaxWorkers() const;
+    // Changing the limit does not stop any running workers, but no new
+    // workers are started until fewer than the new limit are running.
+    void setMaxWorkers(int max);
+    // How long (in msec) a worker may be idle before it is stopped, 0 or
+    // less to keep idle workers running.  Takes effect the next time a
+    // worker finishes a request.
+    int getIdleTimeout() const;
+    void setIdleTimeout(int msec);
+
+    // Sets the program and arguments used to start the worker instead of
+    // Chimera.  The program must speak the same protocol as SurfaceServer.py.
+    // Takes effect the next time a worker is started.
+    void setWorkerCommand(const QString &program, const QStringList &arguments);
+
+    // Adds a request to make surfaces of the given pdb id or file.  One surface
+    // is made for each threshold (the resolution given to Chimera's sym
+    // command) and written to the vtk file at the same index.  Returns the id
+    // of the request, requestFinished will be emitted with this id later (never
+    // from within this function).
+    int requestSurfaces(const QString &pdbId, const QString &chainsToDelete,
+                        bool exportWholeBioUnit, const QVector< int > &thresholds,
+                        const QStringList &vtkFiles);
+    // Cancels a request.  If a worker is already making its surfaces, they
+    // are still made, but requestFinished is not emitted for it.
+    void cancelRequest(int id);
+
+    // returns true if any worker process is running
+    bool isWorkerRunning() const;
+    // returns the number of worker processes running
+    int getNumberOfWorkers() const;
+    // returns the number of requests that have not finished (including the
+    // ones the workers are working on)
+    int getNumberOfPendingRequests() const;
+
+signals:
+    // emitted when a worker starts working on a request
+    void requestStarted(int id);
+    // emitted when a worker sends a status message for a request
+    void requestStatusChanged(int id, QString status);
+    // emitted when a request is finished.  Success means the worker reported
+    // success, the caller should still check that the files exist.
+    void requestFinished(int id, bool success);
+
+private slots:
+    // sends the queued requests to the idle workers, starting new workers if
+    // needed
+    void sendNextRequest();
+    void workerOutputReady();
+    void workerFinished(int exitCode, QProcess::ExitStatus status);
+    // stops the worker whose idle timer went off
+    void workerIdleTimedOut();
+
+private:
+    struct Request
+    {
+        int id;
+        QString pdbId, chainsToDelete;
+        bool exportWholeBioUnit;
+        QVector< int > thresholds;
+        QStringList vtkFiles;
+    };
+    struct Worker
+    {
+        QProcess *process;
+        // id of the request the worker is working on, or -1
+        int currentRequest;
+        // true when a request was canceled while the worker was working on it
+        bool currentCanceled;
+        // true once the worker has said it is ready for requests
+        bool ready;
+        // true once the worker has been told to quit, it gets no more
+        // requests
+        bool quitting;
+        // stops the worker when it has been idle for the idle timeout
+        QTimer *idleTimer;
+    };
+    // starts a new worker process, returns false if it could not be started
+    bool startWorker();
+    // sends the request to the (idle and ready) worker
+    void sendRequest(Worker *worker, const Request &request);
+    // handles the replies the worker has sent
+    void readReplies(Worker *worker);
+    // starts the worker's idle timer if it is idle
+    void startIdleTimer(Worker *worker);
+    // returns the worker running the given process or with the given idle
+    // timer (the sender of the worker slots) or NULL
+    Worker *workerFor(QObject *sender) const;
+    // fails all the queued requests (used when no worker can be started)
+    void failQueuedRequests();
+
+    QList< Worker * > workers;
+    int maxWorkers;
+    int idleTimeout;
+    QTemporaryFile *startupScript;
+    QString workerProgram;
+    QStringList workerArguments;
+    QList< Request > queue;
+    int nextId;
+};
+
+#endif // CHIMERASURFACESERVER_H
@@ -1,46 +1,61 @@
 #ifndef CHIMERAOBJMAKER_H
 #define CHIMERAOBJMAKER_H
 
-#include "abstractsingleprocessrunner.h"
+#include "subprocessrunner.h"
 
-class QString;
-class QProcess;
-class QTemporaryFile;
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class ChimeraSurfaceServer;
 
 /*
- * This class is designed to run UCSF Chimera as a subprocess and create OBJ files to
- * be read as models.  It uses Qt's signal/slots system to do this in the background.
+ * This class is designed to use UCSF Chimera to create VTK files to be read as
+ * models.  It sends the work to a ChimeraSurfaceServer, which keeps Chimera
+ * running in the background between surfaces, and uses Qt's signal/slots system
+ * to wait for the result.  Any number of surfaces of the same structure (at
+ * different thresholds) can be made by one runner, the structure is only
+ * loaded once for all of them.
  *
  * For usage, see the parent class, SubprocessRunner.  There is a factory method in
  * SubprocessUtils to create one of these... this class should not be used directly
  *
  */
 
-class ChimeraVTKExportRunner : public AbstractSingleProcessRunner
+class ChimeraVTKExportRunner : public SubprocessRunner
 {
     Q_OBJECT
 public:
-    // constructor
-    ChimeraVTKExportRunner(const QString &pdbId, const QString &vtkFile, int threshold,
+    // constructor - one surface is made for each threshold and written to the
+    // vtk file at the same index
+    ChimeraVTKExportRunner(ChimeraSurfaceServer *server, const QString &pdbId,
+                           const QVector< int > &thresholds,
+                           const QStringList &vtkFiles,
                            const QString &chainsToDelete, bool shouldExportWholeBioUnit,
                            QObject *parent = 0);
     // destructor
     virtual ~ChimeraVTKExportRunner();
     virtual bool isValid();
-    
-    // starts the subprocess
-    virtual void start();
 
-    // checks if the subprocess succeeded
-    virtual bool didProcessSucceed(QString output);
+    // sends the request to the server
+    virtual void start();
+    // cancels the request
+    virtual void cancel();
 
+private slots:
+    void requestStatusChanged(int id, QString status);
+    void requestFinished(int id, bool success);
 
 private:
 
     // fields
-    QTemporaryFile *cmdFile;
-    QString resultFile;
-    bool valid;
+    ChimeraSurfaceServer *surfaceServer;
+    QString pdb, chains;
+    QVector< int > surfaceThresholds;
+    QStringList resultFiles;
+    bool exportWholeBioUnit;
+    // the id of the request to the server or -1 if not started
+    int requestId;
 };
 
 #endif // CHIMERAOBJMAKER_H
@@ -0,0 +1,103 @@
+#include "meshdecimationrunner.h"
+
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+#include <vtkPolyDataAlgorithm.h>
+#include <vtkPolyDataWriter.h>
+
+#include <QtConcurrentRun>
+#include <QFutureWatcher>
+#include <QFileInfo>
+#include <QDir>
+#include <QDebug>
+
+#include <meshdecimator.h>
+#include <modelutilities.h>
+#include <modelstore.h>
+
+// Reads, simplifies and writes the model.  This runs on a worker thread so
+// it only uses its own copies of everything.
+static bool decimateFile(QString inputFile, QVector< int > counts,
+                         QStringList outputFiles)
+{
+    vtkSmartPointer< vtkPolyDataAlgorithm > source;
+    try
+    {
+        source.TakeReference(ModelUtilities::read(inputFile));
+    }
+    catch (const char *msg)
+    {
+        qDebug() << msg;
+        return false;
+    }
+    source->Update();
+    QVector< vtkSmartPointer< vtkPolyData > > levels =
+            MeshDecimator::decimate(source->GetOutput(), counts);
+    for (int i = 0; i < levels.size(); i++)
+    {
+        ModelStore::replaceFile(outputFiles[i]);
+        vtkSmartPointer< vtkPolyDataWriter > writer =
+                vtkSmartPointer< vtkPolyDataWriter >::New();
+        writer->SetInputData(levels[i]);
+        writer->SetFileName(outputFiles[i].toStdString().c_str());
+        writer->SetFileTypeToBinary();
+        if (!writer->Write())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+MeshDecimationRunner::MeshDecimationRunner(const QString &modelFile,
+                                           const QVector< int > &triangleCounts,
+                                           QObject *parent) :
+    SubprocessRunner(parent),
+    inputFile(modelFile),
+    counts(triangleCounts),
+    watcher(new QFutureWatcher< bool >(this))
+{
+    QFileInfo info(modelFile);
+    QString prefix = info.dir().absoluteFilePath(info.completeBaseName());
+    for (int i = 0; i < counts.size(); i++)
+    {
+        outputFiles.append(prefix + ".decimated." + QString::number(counts[i])
+                           + ".vtk");
+    }
+    connect(watcher, SIGNAL(finished()), this, SLOT(decimationFinished()));
+}
+
+MeshDecimationRunner::~MeshDecimationRunner()
+{
+}
+
+void MeshDecimationRunner::start()
+{
+    watcher->setFuture(QtConcurrent::run(decimateFile, inputFile, counts,
+                                         outputFiles));
+    emit statusChanged("Simplifying object...");
+}
+
+void MeshDecimationRunner::cancel()
+{
+    // the decimation cannot be interrupted, but it only uses copies of its
+    // inputs so it is safe to let it finish with nobody listening
+    watcher->disconnect(this);
+    deleteLater();
+}
+
+bool MeshDecimationRunner::isValid()
+{
+    return QFileInfo(inputFile).isFile() && !counts.isEmpty();
+}
+
+const QStringList &MeshDecimationRunner::getOutputFiles() const
+{
+    return outputFiles;
+}
+
+void MeshDecimationRunner::decimationFinished()
+{
+    emit finished(watcher->result());
+    deleteLater();
+}
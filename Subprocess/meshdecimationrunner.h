@@ -0,0 +1,52 @@
+#ifndef MESHDECIMATIONRUNNER_H
+#define MESHDECIMATIONRUNNER_H
+
+#include "subprocessrunner.h"
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+template < typename T >
+class QFutureWatcher;
+
+/*
+ *
+ * This is a SubprocessRunner that makes simplified versions of a model file
+ * in the background using MeshDecimator instead of running another program.
+ * All the simplified levels are made in one pass and written next to the
+ * model file as <model file without extension>.decimated.<triangles>.vtk
+ * (the names SimpleView::openVTKFile looks for).
+ *
+ * For more information about use see subprocessrunner.h
+ *
+ */
+class MeshDecimationRunner : public SubprocessRunner
+{
+    Q_OBJECT
+public:
+    // modelFile - the model file to simplify (any file ModelUtilities::read
+    //              can read)
+    // triangleCounts - the number of triangles in each simplified level
+    explicit MeshDecimationRunner(const QString &modelFile,
+                                  const QVector< int > &triangleCounts,
+                                  QObject *parent = 0);
+    virtual ~MeshDecimationRunner();
+
+    virtual void start();
+    virtual void cancel();
+    virtual bool isValid();
+
+    // The names of the files that will be written, in the same order as
+    // the triangle counts
+    const QStringList &getOutputFiles() const;
+private slots:
+    void decimationFinished();
+private:
+    QString inputFile;
+    QVector< int > counts;
+    QStringList outputFiles;
+    QFutureWatcher< bool > *watcher;
+};
+
+#endif // MESHDECIMATIONRUNNER_H
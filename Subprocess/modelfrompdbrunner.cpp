@@ -3,7 +3,6 @@
 #include <PQP.h>
 
 #include <vtkSmartPointer.h>
-#include <vtkDecimatePro.h>
 #include <vtkGeometryFilter.h>
 #include <vtkThreshold.h>
 #include <vtkAppendPolyData.h>
@@ -12,19 +11,134 @@
 #include <vtkPolyData.h>
 #include <vtkPointData.h>
 
+#include <QtConcurrentRun>
+#include <QFutureWatcher>
+#include <QStringList>
+#include <QMap>
+#include <QFile>
 #include <QDebug>
 #include <QDir>
+#include <QVector>
 
 #include <sketchioconstants.h>
 #include <sketchmodel.h>
+#include <sharedgeometry.h>
 #include <modelmanager.h>
 #include <modelutilities.h>
+#include <meshdecimator.h>
+#include <modelstore.h>
+#include <surfacecache.h>
 #include <sketchobject.h>
 #include <springconnection.h>
 #include <worldmanager.h>
 #include <sketchproject.h>
 
 #include "subprocessutils.h"
+#include "pdbmirror.h"
+
+// the thresholds (surface resolutions) for the full resolution surface and
+// the surface that is simplified
+#define FULL_SURFACE_THRESHOLD 0
+#define SIMPLIFIED_SURFACE_THRESHOLD 5
+// the simplified levels made after the isosurface is created
+#define NUM_SIMPLIFIED_LEVELS 3
+static const int SIMPLIFIED_LEVEL_TRIANGLES[NUM_SIMPLIFIED_LEVELS] =
+{ 5000, 2000, 1000 };
+
+// The simplified levels of a surface along with the part of the surface that
+// is not simplified (points with modelNum <= 0).  These are made on a worker
+// thread and only used by one thread at a time.
+struct SimplifiedSurfaces
+{
+    QVector< vtkSmartPointer< vtkPolyData > > levels;
+    vtkSmartPointer< vtkPolyData > unsimplified;
+};
+
+// Reads the surface from the given file and simplifies it.  This runs on a
+// worker thread, so it reads its own copy of the surface instead of using the
+// model's.  Returns no levels on failure.
+static SimplifiedSurfaces simplifySurface(QString filename)
+{
+    SimplifiedSurfaces result;
+    vtkSmartPointer< vtkPolyDataAlgorithm > source;
+    try
+    {
+        source.TakeReference(ModelUtilities::read(filename));
+    }
+    catch (const char *msg)
+    {
+        qDebug() << msg;
+        return result;
+    }
+    source->Update();
+    // all the simplified levels come from one decimation pass
+    QVector< int > levels;
+    for (int i = 0; i < NUM_SIMPLIFIED_LEVELS; i++)
+    {
+        levels.append(SIMPLIFIED_LEVEL_TRIANGLES[i]);
+    }
+    result.levels = MeshDecimator::decimate(source->GetOutput(), levels);
+    vtkSmartPointer< vtkThreshold > thresh =
+            vtkSmartPointer< vtkThreshold >::New();
+    thresh->SetInputConnection(source->GetOutputPort());
+    thresh->SetInputArrayToProcess(0,0,0,vtkDataObject::FIELD_ASSOCIATION_POINTS,
+                                   "modelNum");
+    thresh->ThresholdByLower(0.0);
+    thresh->AllScalarsOn();
+    thresh->Update();
+    vtkSmartPointer< vtkGeometryFilter > convertToPolyData =
+            vtkSmartPointer< vtkGeometryFilter >::New();
+    convertToPolyData->SetInputConnection(thresh->GetOutputPort());
+    convertToPolyData->MergingOff();
+    convertToPolyData->Update();
+    result.unsimplified = convertToPolyData->GetOutput();
+    return result;
+}
+
+// Reads the full resolution surface into geometry for the model and builds
+// its collision model.  This runs on a worker thread.  Returns a null pointer
+// on failure.
+static QSharedPointer< SharedGeometry > readSurfaceGeometry(QString filename)
+{
+    try
+    {
+        return SketchModel::readGeometry(filename);
+    }
+    catch (const char *msg)
+    {
+        qDebug() << msg;
+        return QSharedPointer< SharedGeometry >();
+    }
+}
+
+// Returns the name of the file for the given simplified level in the project
+// directory
+static QString simplifiedLevelName(const QString &prefix, int level)
+{
+    return prefix + ".decimated." +
+            QString::number(SIMPLIFIED_LEVEL_TRIANGLES[level]);
+}
+
+// Writes the simplified levels (each with the unsimplified part added back)
+// to the project directory.  This runs on a worker thread.  Returns the names
+// of the files written.
+static QStringList writeSurfaces(SimplifiedSurfaces surfaces,
+                                 QString projectDir, QString prefix)
+{
+    QStringList files;
+    QDir dir(projectDir);
+    for (int i = 0; i < surfaces.levels.size(); i++)
+    {
+        vtkSmartPointer< vtkAppendPolyData > appended =
+                vtkSmartPointer< vtkAppendPolyData >::New();
+        appended->AddInputData(surfaces.levels[i]);
+        appended->AddInputData(surfaces.unsimplified);
+        appended->Update();
+        files.append(ModelUtilities::createFileFromVTKSource(
+                         appended, simplifiedLevelName(prefix, i), dir));
+    }
+    return files;
+}
 
 ModelFromPDBRunner::ModelFromPDBRunner(
         SketchBio::Project *proj, const QString &pdb,
@@ -38,10 +152,16 @@ ModelFromPDBRunner::ModelFromPDBRunner(
     model(NULL),
     conformation(-1),
     currentRunner(NULL),
-    stepNum(0),
     importFromLocalFile(false),
-    exportWholeBiologicalUnit(shouldExportBiologicalUnit)
+    exportWholeBiologicalUnit(shouldExportBiologicalUnit),
+    usingCachedSurfaces(false),
+    geometryWatcher(new QFutureWatcher< QSharedPointer< SharedGeometry > >(this)),
+    simplifyWatcher(new QFutureWatcher< SimplifiedSurfaces >(this)),
+    writeWatcher(new QFutureWatcher< QStringList >(this))
 {
+    connect(geometryWatcher, SIGNAL(finished()), this, SLOT(geometryFinished()));
+    connect(simplifyWatcher, SIGNAL(finished()), this, SLOT(simplifyFinished()));
+    connect(writeWatcher, SIGNAL(finished()), this, SLOT(writeFinished()));
 }
 
 ModelFromPDBRunner::ModelFromPDBRunner(SketchBio::Project *proj, const QString &filename,
@@ -56,10 +176,16 @@ ModelFromPDBRunner::ModelFromPDBRunner(SketchBio::Project *proj, const QString &
     model(NULL),
     conformation(-1),
     currentRunner(NULL),
-    stepNum(0),
     importFromLocalFile(true),
-    exportWholeBiologicalUnit(shouldExportBiologicalUnit)
+    exportWholeBiologicalUnit(shouldExportBiologicalUnit),
+    usingCachedSurfaces(false),
+    geometryWatcher(new QFutureWatcher< QSharedPointer< SharedGeometry > >(this)),
+    simplifyWatcher(new QFutureWatcher< SimplifiedSurfaces >(this)),
+    writeWatcher(new QFutureWatcher< QStringList >(this))
 {
+    connect(geometryWatcher, SIGNAL(finished()), this, SLOT(geometryFinished()));
+    connect(simplifyWatcher, SIGNAL(finished()), this, SLOT(simplifyFinished()));
+    connect(writeWatcher, SIGNAL(finished()), this, SLOT(writeFinished()));
 }
 
 ModelFromPDBRunner::~ModelFromPDBRunner()
@@ -68,23 +194,84 @@ ModelFromPDBRunner::~ModelFromPDBRunner()
 
 void ModelFromPDBRunner::start()
 {
-    QString filename = (project->getProjectDir() + "/" + modelFilePrefix
-                        + ".vtk").trimmed();
-    currentRunner = SubprocessUtils::makeChimeraSurfaceFor(
-                pdbId,filename,0,chainsToDelete,exportWholeBiologicalUnit);
+    QString filename = getSurfaceFileName();
+    QString simplified = getSimplifiedSurfaceFileName();
+    // Chimera is only needed to fetch structures and make biological units,
+    // anything else is surfaced in process unless the settings say otherwise
+    bool nativeSurfaces = !exportWholeBiologicalUnit &&
+            !SubprocessUtils::getUseChimeraForSurfaces() &&
+            (importFromLocalFile || !PDBMirror::findInMirror(pdbId).isEmpty());
+    cacheKey = SurfaceCache::makeKey(pdbId,chainsToDelete,exportWholeBiologicalUnit,
+                                     nativeSurfaces ? SurfaceCache::NATIVE_SURFACES
+                                                    : SurfaceCache::CHIMERA_SURFACES);
+    if (placeCachedSurfaces())
+    {
+        usingCachedSurfaces = true;
+        emit statusChanged("Loading cached surfaces for " + pdbId);
+        qDebug() << "Using cached surfaces for " << pdbId;
+        QMetaObject::invokeMethod(this, "surfacesFinished", Qt::QueuedConnection,
+                                  Q_ARG(bool, true));
+        return;
+    }
+    ModelStore::replaceFile(filename);
+    ModelStore::replaceFile(simplified);
+    // use the local copy of the structure if there is one instead of having
+    // Chimera fetch it
+    QString structure = pdbId;
+    if (!importFromLocalFile)
+    {
+        QString local = PDBMirror::findStructure(pdbId);
+        if (!local.isEmpty())
+        {
+            qDebug() << "Using " << local << " from the local PDB mirror";
+            structure = local;
+        }
+        else if (nativeSurfaces)
+        {
+            // the mirror's file could not be used, so Chimera has to fetch it
+            nativeSurfaces = false;
+            cacheKey = SurfaceCache::makeKey(pdbId,chainsToDelete,
+                                             exportWholeBiologicalUnit);
+        }
+    }
+    // both surfaces are made from one load of the structure
+    QVector< int > thresholds;
+    thresholds << FULL_SURFACE_THRESHOLD << SIMPLIFIED_SURFACE_THRESHOLD;
+    QStringList surfaceFiles;
+    surfaceFiles << filename << simplified;
+    if (nativeSurfaces)
+    {
+        currentRunner = SubprocessUtils::makeNativeSurfacesFor(
+                    structure,thresholds,surfaceFiles,chainsToDelete);
+    }
+    else
+    {
+        currentRunner = SubprocessUtils::makeChimeraSurfacesFor(
+                    structure,thresholds,surfaceFiles,
+                    chainsToDelete,exportWholeBiologicalUnit);
+    }
     if (currentRunner == NULL) {
         emit finished(false);
         deleteLater();
+        return;
     }
-    connect(currentRunner, SIGNAL(finished(bool)), this, SLOT(stepFinished(bool)));
+    connect(currentRunner, SIGNAL(finished(bool)), this, SLOT(surfacesFinished(bool)));
     currentRunner->start();
-    emit statusChanged("Creating Connolly surface for " + pdbId);
-    qDebug() << "Creating Connolly surface for " << pdbId;
+    emit statusChanged("Creating surfaces for " + pdbId);
+    qDebug() << "Creating surfaces for " << pdbId;
 }
 
 void ModelFromPDBRunner::cancel()
 {
-    currentRunner->cancel();
+    if (currentRunner != NULL)
+    {
+        currentRunner->cancel();
+    }
+    // the worker threads only use their own copies of everything, so they
+    // can be left to finish with nobody listening
+    geometryWatcher->disconnect(this);
+    simplifyWatcher->disconnect(this);
+    writeWatcher->disconnect(this);
     deleteLater();
 }
 
@@ -93,147 +280,216 @@ bool ModelFromPDBRunner::isValid()
     return true;
 }
 
-void ModelFromPDBRunner::stepFinished(bool succeeded)
+void ModelFromPDBRunner::surfacesFinished(bool succeeded)
+{
+    // the runner that just finished deletes itself
+    currentRunner = NULL;
+    if (!succeeded)
+    {
+        emit finished(false);
+        deleteLater();
+        return;
+    }
+    QString filename = getSurfaceFileName();
+    if (!project->getFileInProjDir(filename,modelFile))
+    {
+        qDebug() << "Failed to generate model!";
+        emit finished(false);
+        deleteLater();
+        return;
+    }
+    ModelManager &manager = project->getModelManager();
+    if (manager.hasModel(getSourceName()))
+    {
+        model = manager.getModel(getSourceName());
+        modelCreated();
+        return;
+    }
+    // reading the surface and building its collision model can take a while
+    // for large structures, see geometryFinished
+    geometryWatcher->setFuture(QtConcurrent::run(readSurfaceGeometry, modelFile));
+    emit statusChanged("Loading surface for " + pdbId);
+}
+
+void ModelFromPDBRunner::geometryFinished()
+{
+    QSharedPointer< SharedGeometry > geometry = geometryWatcher->result();
+    if (!geometry.isNull())
+    {
+        model = project->getModelManager().makeModel(getSourceName(),modelFile,
+                                                     geometry,
+                                                     DEFAULT_INVERSE_MASS,
+                                                     DEFAULT_INVERSE_MOMENT);
+    }
+    modelCreated();
+}
+
+void ModelFromPDBRunner::modelCreated()
 {
-    if (succeeded)
+    QString sourceName = getSourceName();
+    QString simplified = getSimplifiedSurfaceFileName();
+    if (model == NULL)
+    {
+        qDebug() << "Failed to generate model!";
+        emit finished(false);
+        deleteLater();
+        return;
+    }
+    for (int conf = 0; conf < model->getNumberOfConformations(); conf++)
     {
-        QString filename = (project->getProjectDir() + "/" + modelFilePrefix
-                              + ".vtk").trimmed();
-        QString simplified = (project->getProjectDir() + "/" + modelFilePrefix
-                              + "_isosurface.vtk").trimmed();
-        QString sourceName; // = ModelUtilities::createSourceNameFor(pdbId,chainsToDelete);
-        if (importFromLocalFile)
+        if (model->getSource(conf) == sourceName)
         {
-            sourceName = pdbId;
+            conformation = conf;
+            break;
         }
-        else
+    }
+    if (model->hasFileNameFor(conformation,ModelResolution::SIMPLIFIED_1000))
+    {
+        // the model already had its simplified levels
+        emit finished(true);
+        deleteLater();
+        return;
+    }
+    model->addSurfaceFileForResolution(conformation,
+                                       ModelResolution::SIMPLIFIED_FULL_RESOLUTION,
+                                       simplified);
+    // the new surface is read in the background
+    model->requestResolutionForConformation(
+                conformation, ModelResolution::SIMPLIFIED_FULL_RESOLUTION);
+    {
+        q_vec_type pos = Q_NULL_VECTOR;
+        q_type orient = Q_ID_QUAT;
+        project->getWorldManager().addObject(model,pos,orient);
+    }
+    if (usingCachedSurfaces)
+    {
+        // the simplified levels were already placed from the cache
+        QStringList files;
+        for (int i = 0; i < NUM_SIMPLIFIED_LEVELS; i++)
         {
-            sourceName = modelFilePrefix;
+            files.append(getSimplifiedLevelFileName(i));
         }
-        switch (stepNum)
-        {
-        case 0:
-            //ModelUtilities::vtkConvertAsciiToBinary(filename);
+        addSimplifiedLevels(files);
+        emit finished(true);
+        deleteLater();
+        return;
+    }
+    // the rest of the work happens on worker threads, see
+    // simplifyFinished and writeFinished
+    simplifyWatcher->setFuture(QtConcurrent::run(simplifySurface,
+                                                 simplified));
+    emit statusChanged("Simplifying surface geometry for " + pdbId);
+    qDebug() << "Simplifying surface geometry for " << pdbId;
+}
+
+void ModelFromPDBRunner::simplifyFinished()
+{
+    SimplifiedSurfaces surfaces = simplifyWatcher->result();
+    if (surfaces.levels.isEmpty())
+    {
+        qDebug() << "Failed to simplify surface for " << pdbId;
+        emit finished(false);
+        deleteLater();
+        return;
+    }
+    writeWatcher->setFuture(QtConcurrent::run(writeSurfaces, surfaces,
+                                              project->getProjectDir(),
+                                              modelFilePrefix));
+    emit statusChanged("Saving simplified surfaces for " + pdbId);
+}
+
+void ModelFromPDBRunner::writeFinished()
+{
+    QStringList files = writeWatcher->result();
+    addSimplifiedLevels(files);
+    bool success = (files.size() == NUM_SIMPLIFIED_LEVELS);
+    if (success)
+    {
+        QMap< QString, QString > cached;
+        cached.insert(SurfaceCache::surfaceFileName(FULL_SURFACE_THRESHOLD),
+                      getSurfaceFileName());
+        cached.insert(SurfaceCache::surfaceFileName(SIMPLIFIED_SURFACE_THRESHOLD),
+                      getSimplifiedSurfaceFileName());
+        for (int i = 0; i < files.size(); i++)
         {
-            QString newFileName;
-            if (project->getFileInProjDir(filename,newFileName))
-            {
-                model =  project->getModelManager().makeModel(sourceName,newFileName,
-                                                              DEFAULT_INVERSE_MASS,
-                                                              DEFAULT_INVERSE_MOMENT);
-            }
+            cached.insert(SurfaceCache::simplifiedFileName(
+                              SIMPLIFIED_SURFACE_THRESHOLD,
+                              SIMPLIFIED_LEVEL_TRIANGLES[i]), files[i]);
         }
-			if (model == NULL)
-			{
-				qDebug() << "Failed to generate model!";
-				emit finished(false);
-				deleteLater();
-				return;
-			}
-            for (int conf = 0; conf < model->getNumberOfConformations(); conf++)
-            {
-                if (model->getSource(conf) == sourceName)
-                {
-                    conformation = conf;
-                    break;
-                }
-            }
-            if (! model->hasFileNameFor(conformation,ModelResolution::SIMPLIFIED_1000))
-            {
-                currentRunner = SubprocessUtils::makeChimeraSurfaceFor(
-                            pdbId,simplified,
-                            5,chainsToDelete,exportWholeBiologicalUnit);
-                if (currentRunner == NULL)
-                {
-                    emit finished(true);
-                    deleteLater();
-                }
-                else
-                {
-                    connect(currentRunner, SIGNAL(finished(bool)), this, SLOT(stepFinished(bool)));
-                    currentRunner->start();
-                    emit statusChanged("Creating simpler surface geometry for " + pdbId);
-                    qDebug() << "Creating a simpler surface geometry for " << pdbId;
-                }
-            }
-            else
-            {
-                emit finished(true);
-                deleteLater();
-            }
-            break;
-        case 1:
-            //ModelUtilities::vtkConvertAsciiToBinary(simplified);
-            model->addSurfaceFileForResolution(conformation,
-                                               ModelResolution::SIMPLIFIED_FULL_RESOLUTION,
-                                               simplified);
-            model->setResolutionForConformation(conformation,
-                                                ModelResolution::SIMPLIFIED_FULL_RESOLUTION);
+        // adding to the cache may copy files and evict old entries, so it is
+        // done on a worker thread and nothing waits for it
+        QtConcurrent::run(SurfaceCache::addEntry, cacheKey, cached);
+    }
+    emit finished(success);
+    deleteLater();
+}
+
+QString ModelFromPDBRunner::getSurfaceFileName() const
+{
+    return (project->getProjectDir() + "/" + modelFilePrefix + ".vtk").trimmed();
+}
+
+QString ModelFromPDBRunner::getSimplifiedSurfaceFileName() const
+{
+    return (project->getProjectDir() + "/" + modelFilePrefix
+            + "_isosurface.vtk").trimmed();
+}
+
+QString ModelFromPDBRunner::getSimplifiedLevelFileName(int level) const
+{
+    return QDir(project->getProjectDir()).absoluteFilePath(
+                simplifiedLevelName(modelFilePrefix, level) + ".vtk");
+}
+
+QString ModelFromPDBRunner::getSourceName() const
+{
+    return importFromLocalFile ? pdbId : modelFilePrefix;
+}
+
+bool ModelFromPDBRunner::placeCachedSurfaces()
+{
+    QString entry = SurfaceCache::findEntry(cacheKey);
+    if (entry.isEmpty())
+    {
+        return false;
+    }
+    QDir entryDir(entry);
+    QStringList cached, placed;
+    cached << entryDir.absoluteFilePath(
+                  SurfaceCache::surfaceFileName(FULL_SURFACE_THRESHOLD))
+           << entryDir.absoluteFilePath(
+                  SurfaceCache::surfaceFileName(SIMPLIFIED_SURFACE_THRESHOLD));
+    placed << getSurfaceFileName() << getSimplifiedSurfaceFileName();
+    for (int i = 0; i < NUM_SIMPLIFIED_LEVELS; i++)
+    {
+        cached << entryDir.absoluteFilePath(SurfaceCache::simplifiedFileName(
+                                                SIMPLIFIED_SURFACE_THRESHOLD,
+                                                SIMPLIFIED_LEVEL_TRIANGLES[i]));
+        placed << getSimplifiedLevelFileName(i);
+    }
+    for (int i = 0; i < cached.size(); i++)
+    {
+        // the entry may have been evicted since it was found
+        if (!QFile(cached[i]).exists() ||
+                !ModelStore::linkOrCopyFile(cached[i], placed[i]))
         {
-            q_vec_type pos = Q_NULL_VECTOR;
-            q_type orient = Q_ID_QUAT;
-            project->getWorldManager().addObject(model,pos,orient);
-        }
-            vtkSmartPointer< vtkPolyDataAlgorithm > source =
-                    model->getVTKSource(conformation);
-            vtkSmartPointer< vtkDecimatePro > decimator =
-                    vtkSmartPointer< vtkDecimatePro >::New();
-            QDir dir(project->getProjectDir());
-            decimator->SetInputConnection(source->GetOutputPort());
-            int numTris = source->GetOutput()->GetNumberOfPolys();
-            decimator->SetTargetReduction(std::max(0.0,1.0 - 5000.0/numTris));
-            decimator->SetFeatureAngle(60.0);
-            decimator->BoundaryVertexDeletionOn();
-            decimator->PreserveTopologyOn();
-            decimator->Update();
-            vtkSmartPointer< vtkThreshold > thresh =
-                    vtkSmartPointer< vtkThreshold >::New();
-            thresh->SetInputConnection(source->GetOutputPort());
-            thresh->SetInputArrayToProcess(0,0,0,vtkDataObject::FIELD_ASSOCIATION_POINTS,
-                                           "modelNum");
-            thresh->ThresholdByLower(0.0);
-            thresh->AllScalarsOn();
-            thresh->Update();
-            vtkSmartPointer< vtkGeometryFilter > convertToPolyData =
-                    vtkSmartPointer< vtkGeometryFilter >::New();
-            convertToPolyData->SetInputConnection(thresh->GetOutputPort());
-            convertToPolyData->MergingOff();
-            convertToPolyData->Update();
-            vtkSmartPointer< vtkAppendPolyData > appended =
-                    vtkSmartPointer< vtkAppendPolyData >::New();
-            appended->AddInputConnection(decimator->GetOutputPort());
-            appended->AddInputConnection(convertToPolyData->GetOutputPort());
-            appended->Update();
-            QString fname = ModelUtilities::createFileFromVTKSource(
-                        appended,modelFilePrefix + ".decimated.5000",dir);
-            model->addSurfaceFileForResolution(conformation,
-                                               ModelResolution::SIMPLIFIED_5000,
-                                               fname);
-            decimator->SetTargetReduction(std::max(0.0,1.0 - 2000.0/numTris));
-            decimator->Update();
-            appended->Update();
-            fname = ModelUtilities::createFileFromVTKSource(
-                        appended,modelFilePrefix + ".decimated.2000",dir);
-            model->addSurfaceFileForResolution(conformation,
-                                               ModelResolution::SIMPLIFIED_2000,
-                                               fname);
-            decimator->SetTargetReduction(std::max(0.0,1.0 - 1000.0/numTris));
-            decimator->Update();
-            appended->Update();
-            fname = ModelUtilities::createFileFromVTKSource(
-                        appended,modelFilePrefix + ".decimated.1000",dir);
-            model->addSurfaceFileForResolution(conformation,
-                                               ModelResolution::SIMPLIFIED_1000,
-                                               fname);
-            emit finished(true);
-            deleteLater();
-            break;
+            qDebug() << "Could not use the cached surfaces for " << pdbId;
+            return false;
         }
-        stepNum++;
     }
-    else
+    return true;
+}
+
+void ModelFromPDBRunner::addSimplifiedLevels(const QStringList &files)
+{
+    const ModelResolution::ResolutionType resolutions[NUM_SIMPLIFIED_LEVELS] = {
+        ModelResolution::SIMPLIFIED_5000,
+        ModelResolution::SIMPLIFIED_2000,
+        ModelResolution::SIMPLIFIED_1000
+    };
+    for (int i = 0; i < files.size() && i < NUM_SIMPLIFIED_LEVELS; i++)
     {
-        emit finished(false);
-        deleteLater();
+        model->addSurfaceFileForResolution(conformation, resolutions[i],
+                                           files[i]);
     }
 }
@@ -3,15 +3,27 @@
 
 #include <subprocessrunner.h>
 
+#include <QSharedPointer>
+
 namespace SketchBio {
 class Project;
 }
 class SketchModel;
+class SharedGeometry;
+class QStringList;
+struct SimplifiedSurfaces;
+template < typename T >
+class QFutureWatcher;
 
 // This is a subprocess runner to load a pdb file into a model object and
-// create the various simplification levels of it.  Currently it uses the
-// chimera to create surfaces from the pdb ids and blender to simplify them
-// to the various levels.
+// create the various simplification levels of it.  It makes the surfaces in
+// process (with NativeSurfaceRunner) when the structure is a local file or in
+// the local PDB mirror, otherwise (or when asked for a biological unit or set
+// to in the settings) it uses chimera (through the ChimeraSurfaceServer).
+// MeshDecimator simplifies them to the various levels.  Reading the surface into the model,
+// simplifying and writing the simplified levels happen on worker threads so that the GUI
+// thread is never blocked.  Only adding the finished model to the project is done on the
+// GUI thread.
 class ModelFromPDBRunner : public SubprocessRunner
 {
     Q_OBJECT
@@ -36,24 +48,56 @@ public:
     virtual void cancel();
     virtual bool isValid();
 private slots:
-    // Called when a subprocess finishes.  Since only one subprocess is called
-    // at a time, there is a definite order to which just finished, kept track of
-    // in the field stepNum
-    void stepFinished(bool succeeded);
+    // Called when the full resolution surface and the one to simplify have
+    // been made, starts reading the surface into geometry for the model
+    void surfacesFinished(bool succeeded);
+    // Called when the surface geometry and collision model have been made on
+    // a worker thread, creates the model
+    void geometryFinished();
+    // Called when the simplified levels of the surface have been made on a
+    // worker thread, starts writing them to files
+    void simplifyFinished();
+    // Called when the simplified levels have been written, adds them to the
+    // model
+    void writeFinished();
 private:
+    // the names of the surface files in the project directory
+    QString getSurfaceFileName() const;
+    QString getSimplifiedSurfaceFileName() const;
+    QString getSimplifiedLevelFileName(int level) const;
+    // the source name of the model
+    QString getSourceName() const;
+    // Adds the newly created (or already existing) model to the project and
+    // starts simplifying it
+    void modelCreated();
+    // Links the surfaces and simplified levels for this structure from the
+    // SurfaceCache into the project directory.  Returns false if they are
+    // not in the cache or could not be placed.
+    bool placeCachedSurfaces();
+    // adds the simplified level files to the model
+    void addSimplifiedLevels(const QStringList &files);
+
     // PDB id, and the chain identifiers of chains to delete before surfacing
     QString pdbId, chainsToDelete, modelFilePrefix;
     // project to add model to
     SketchBio::Project *project;
     // The model (once it is created, keep a reference to it)
     SketchModel *model;
+    // The full resolution surface file in the project directory used by the model
+    QString modelFile;
     // The conformation within the model (-1 before the model is created)
     int conformation;
     // The current subprocess (uses other SubprocessRunners instead of reimplementing)
     SubprocessRunner *currentRunner;
-    // The step number we are on (which subprocess is running)
-    int stepNum;
     bool importFromLocalFile, exportWholeBiologicalUnit;
+    // The key for this structure in the SurfaceCache, and whether the
+    // surfaces were found there (so surfacing and simplifying are skipped)
+    QString cacheKey;
+    bool usingCachedSurfaces;
+    // Watchers for the worker thread steps after the subprocesses finish
+    QFutureWatcher< QSharedPointer< SharedGeometry > > *geometryWatcher;
+    QFutureWatcher< SimplifiedSurfaces > *simplifyWatcher;
+    QFutureWatcher< QStringList > *writeWatcher;
 };
 
 #endif // MODELFROMPDBRUNNER_H
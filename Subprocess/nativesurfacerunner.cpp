@@ -0,0 +1,107 @@
+#include "nativesurfacerunner.h"
+
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+#include <vtkPolyDataWriter.h>
+
+#include <QtConcurrentRun>
+#include <QFutureWatcher>
+#include <QFileInfo>
+#include <QDebug>
+
+#include <structurereader.h>
+#include <molecularsurface.h>
+#include <modelstore.h>
+
+// Reads the structure and writes a surface for each threshold.  This runs on
+// a worker thread so it only uses its own copies of everything.
+static bool makeSurfaceFiles(QString structureFile, QString chainsToDelete,
+                             QVector< int > thresholds, QStringList vtkFiles)
+{
+    QVector< StructureReader::Atom > atoms;
+    if (!StructureReader::readStructure(structureFile, atoms))
+    {
+        qDebug() << "Could not read atoms from " << structureFile;
+        return false;
+    }
+    StructureReader::removeSolvent(atoms);
+    StructureReader::removeChains(atoms, chainsToDelete);
+    if (atoms.isEmpty())
+    {
+        qDebug() << "No atoms left to surface in " << structureFile;
+        return false;
+    }
+    for (int i = 0; i < thresholds.size(); i++)
+    {
+        vtkSmartPointer< vtkPolyData > model =
+                MolecularSurface::makeModel(atoms, thresholds[i]);
+        if (model->GetNumberOfPolys() == 0)
+        {
+            qDebug() << "Empty surface for " << structureFile;
+            return false;
+        }
+        ModelStore::replaceFile(vtkFiles[i]);
+        vtkSmartPointer< vtkPolyDataWriter > writer =
+                vtkSmartPointer< vtkPolyDataWriter >::New();
+        writer->SetInputData(model);
+        writer->SetFileName(vtkFiles[i].toStdString().c_str());
+        writer->SetFileTypeToBinary();
+        if (!writer->Write())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+NativeSurfaceRunner::NativeSurfaceRunner(const QString &structureFile,
+                                         const QVector< int > &thresholds,
+                                         const QStringList &vtkFiles,
+                                         const QString &chainsToDelete,
+                                         QObject *parent) :
+    SubprocessRunner(parent),
+    structure(structureFile),
+    chains(chainsToDelete),
+    surfaceThresholds(thresholds),
+    resultFiles(vtkFiles),
+    watcher(new QFutureWatcher< bool >(this))
+{
+    connect(watcher, SIGNAL(finished()), this, SLOT(surfacesFinished()));
+}
+
+NativeSurfaceRunner::~NativeSurfaceRunner()
+{
+}
+
+void NativeSurfaceRunner::start()
+{
+    watcher->setFuture(QtConcurrent::run(makeSurfaceFiles, structure, chains,
+                                         surfaceThresholds, resultFiles));
+    emit statusChanged("Creating surface...");
+}
+
+void NativeSurfaceRunner::cancel()
+{
+    // the surfacing cannot be interrupted, but it only uses copies of its
+    // inputs so it is safe to let it finish with nobody listening
+    qDebug() << "Object surfacing canceled.";
+    watcher->disconnect(this);
+    deleteLater();
+}
+
+bool NativeSurfaceRunner::isValid()
+{
+    return QFileInfo(structure).isFile() && !resultFiles.isEmpty() &&
+            surfaceThresholds.size() == resultFiles.size();
+}
+
+void NativeSurfaceRunner::surfacesFinished()
+{
+    bool success = watcher->result();
+    if (!success)
+        qDebug() << "Object surfacing failed.";
+    else
+        qDebug() << "Successfully surfaced object.";
+    emit finished(success);
+    deleteLater();
+}
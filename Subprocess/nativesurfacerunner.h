@@ -0,0 +1,53 @@
+#ifndef NATIVESURFACERUNNER_H
+#define NATIVESURFACERUNNER_H
+
+#include "subprocessrunner.h"
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+template < typename T >
+class QFutureWatcher;
+
+/*
+ * This is a SubprocessRunner that makes the vtk files of a structure in the
+ * background using StructureReader and MolecularSurface instead of UCSF
+ * Chimera.  The files have the same layout as the ones Chimera makes (see
+ * molecularsurface.h).  The structure is read once and one surface is made
+ * for each threshold (the resolution of the surface) and written to the vtk
+ * file at the same index.
+ *
+ * This can only read local PDB and mmCIF files, it cannot fetch structures
+ * or make biological units.
+ *
+ * For more information about use see subprocessrunner.h
+ */
+class NativeSurfaceRunner : public SubprocessRunner
+{
+    Q_OBJECT
+public:
+    // structureFile - the PDB or mmCIF file to read
+    // thresholds - the resolution of each surface to make
+    // vtkFiles - the file to write each surface to
+    // chainsToDelete - the ids of chains to remove before surfacing
+    NativeSurfaceRunner(const QString &structureFile,
+                        const QVector< int > &thresholds,
+                        const QStringList &vtkFiles,
+                        const QString &chainsToDelete,
+                        QObject *parent = 0);
+    virtual ~NativeSurfaceRunner();
+
+    virtual void start();
+    virtual void cancel();
+    virtual bool isValid();
+private slots:
+    void surfacesFinished();
+private:
+    QString structure, chains;
+    QVector< int > surfaceThresholds;
+    QStringList resultFiles;
+    QFutureWatcher< bool > *watcher;
+};
+
+#endif // NATIVESURFACERUNNER_H
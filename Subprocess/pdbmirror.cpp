@@ -0,0 +1,291 @@
+#include "pdbmirror.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QSettings>
+#include <QStringList>
+#include <QTextStream>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QAtomicInt>
+#include <QHash>
+#include <QFile>
+#include <QDir>
+#include <QDebug>
+
+#include <quazip/quagzipfile.h>
+
+// the QSettings keys for the mirror and cache locations
+#define PDB_MIRROR_PATH_SETTING "pdbmirror/path"
+#define PDB_MIRROR_CACHE_SETTING "pdbmirror/cache"
+// default cache location relative to the home directory
+#define DEFAULT_PDB_CACHE_DIR ".sketchbio/pdbcache"
+// the name of the index file in the mirror directory
+#define PDB_INDEX_FILE "pdb_index.txt"
+// size of the blocks read when decompressing a file
+#define DECOMPRESS_BLOCK_SIZE (1 << 16)
+
+namespace PDBMirror
+{
+
+//###############################################################
+// Index
+//
+// The index is read once and kept until the mirror directory or the index
+// file changes.
+
+static QMutex indexMutex;
+static QString indexMirrorDir;
+static QDateTime indexModified;
+static QHash< QString, QString > index;
+
+// Returns the PDB id of the given structure file name or an empty string if
+// the name is not one of the names structure files have.  Sets isCif to
+// whether it is an mmCIF file.
+static QString idFromFileName(const QString &fileName, bool &isCif)
+{
+    QString name = fileName.toLower();
+    if (name.endsWith(".gz"))
+    {
+        name.chop(3);
+    }
+    QString id;
+    isCif = false;
+    if (name.startsWith("pdb") && name.endsWith(".ent"))
+    {
+        id = name.mid(3, name.length() - 7);
+    }
+    else if (name.endsWith(".pdb"))
+    {
+        id = name.left(name.length() - 4);
+    }
+    else if (name.endsWith(".cif"))
+    {
+        id = name.left(name.length() - 4);
+        isCif = true;
+    }
+    // PDB ids are a digit followed by three letters or digits
+    if (id.length() != 4 || !id[0].isDigit() ||
+            !id[1].isLetterOrNumber() || !id[2].isLetterOrNumber() ||
+            !id[3].isLetterOrNumber())
+    {
+        return QString();
+    }
+    return id;
+}
+
+static void indexDir(const QDir &mirror, const QString &path,
+                     QHash< QString, QString > &pdbFiles,
+                     QHash< QString, QString > &cifFiles)
+{
+    QDir dir(path);
+    foreach(const QFileInfo &info, dir.entryInfoList(
+                QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot))
+    {
+        if (info.isDir())
+        {
+            indexDir(mirror, info.absoluteFilePath(), pdbFiles, cifFiles);
+            continue;
+        }
+        bool isCif;
+        QString id = idFromFileName(info.fileName(), isCif);
+        if (!id.isEmpty())
+        {
+            QString relative = mirror.relativeFilePath(info.absoluteFilePath());
+            (isCif ? cifFiles : pdbFiles).insert(id, relative);
+        }
+    }
+}
+
+int buildIndex(const QString &mirrorDir)
+{
+    QDir mirror(mirrorDir);
+    QHash< QString, QString > pdbFiles, cifFiles;
+    indexDir(mirror, mirror.absolutePath(), pdbFiles, cifFiles);
+    // PDB format files are used when there are both
+    for (QHash< QString, QString >::const_iterator it = cifFiles.constBegin();
+         it != cifFiles.constEnd(); ++it)
+    {
+        if (!pdbFiles.contains(it.key()))
+        {
+            pdbFiles.insert(it.key(), it.value());
+        }
+    }
+    QFile file(mirror.absoluteFilePath(PDB_INDEX_FILE));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+    {
+        return -1;
+    }
+    QStringList ids = pdbFiles.keys();
+    ids.sort();
+    QTextStream stream(&file);
+    stream << "# SketchBio PDB mirror index: PDB id, tab, file relative to this directory\n";
+    foreach(const QString &id, ids)
+    {
+        stream << id << "\t" << pdbFiles.value(id) << "\n";
+    }
+    stream.flush();
+    return (file.error() == QFile::NoError) ? ids.size() : -1;
+}
+
+// reads the index for the mirror if it has changed, must be called with the
+// mutex held
+static void updateIndex(const QString &mirrorDir)
+{
+    QFileInfo info(QDir(mirrorDir).absoluteFilePath(PDB_INDEX_FILE));
+    QDateTime modified = info.exists() ? info.lastModified() : QDateTime();
+    if (mirrorDir == indexMirrorDir && modified == indexModified)
+    {
+        return;
+    }
+    index.clear();
+    indexMirrorDir = mirrorDir;
+    indexModified = modified;
+    QFile file(info.absoluteFilePath());
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        return;
+    }
+    QTextStream stream(&file);
+    while (!stream.atEnd())
+    {
+        QString line = stream.readLine();
+        if (line.startsWith("#"))
+        {
+            continue;
+        }
+        int tab = line.indexOf('\t');
+        if (tab > 0)
+        {
+            index.insert(line.left(tab).toLower(), line.mid(tab + 1));
+        }
+    }
+}
+
+//###############################################################
+// Settings
+
+QString getMirrorDir()
+{
+    QSettings settings;
+    return settings.value(PDB_MIRROR_PATH_SETTING, QString()).toString();
+}
+
+void setMirrorDir(const QString &dir)
+{
+    QSettings settings;
+    settings.setValue(PDB_MIRROR_PATH_SETTING, dir);
+}
+
+QString getCacheDir()
+{
+    QSettings settings;
+    QString defaultDir = QDir::home().absoluteFilePath(DEFAULT_PDB_CACHE_DIR);
+    return settings.value(PDB_MIRROR_CACHE_SETTING, defaultDir).toString();
+}
+
+void setCacheDir(const QString &dir)
+{
+    QSettings settings;
+    settings.setValue(PDB_MIRROR_CACHE_SETTING, dir);
+}
+
+//###############################################################
+
+QString findInMirror(const QString &pdbId)
+{
+    QString mirrorDir = getMirrorDir();
+    QString id = pdbId.trimmed().toLower();
+    if (mirrorDir.isEmpty() || id.length() != 4)
+    {
+        return QString();
+    }
+    QDir mirror(mirrorDir);
+    {
+        QMutexLocker lock(&indexMutex);
+        updateIndex(mirrorDir);
+        if (!index.isEmpty())
+        {
+            QString relative = index.value(id);
+            if (relative.isEmpty())
+            {
+                return QString();
+            }
+            QString path = mirror.absoluteFilePath(relative);
+            return QFileInfo(path).isFile() ? path : QString();
+        }
+    }
+    // without an index just check where the files usually are
+    QString middle = id.mid(1, 2);
+    QStringList candidates;
+    candidates << id + ".pdb" << id + ".pdb.gz"
+               << "pdb" + id + ".ent" << "pdb" + id + ".ent.gz"
+               << "data/structures/divided/pdb/" + middle + "/pdb" + id + ".ent.gz"
+               << id + ".cif" << id + ".cif.gz"
+               << "data/structures/divided/mmCIF/" + middle + "/" + id + ".cif.gz";
+    foreach(const QString &candidate, candidates)
+    {
+        if (QFileInfo(mirror.absoluteFilePath(candidate)).isFile())
+        {
+            return mirror.absoluteFilePath(candidate);
+        }
+    }
+    return QString();
+}
+
+QString findStructure(const QString &pdbId)
+{
+    QString path = findInMirror(pdbId);
+    if (path.isEmpty() || !path.endsWith(".gz", Qt::CaseInsensitive))
+    {
+        return path;
+    }
+    QFileInfo source(path);
+    bool isCif;
+    QString id = idFromFileName(source.fileName(), isCif);
+    QDir cache(getCacheDir());
+    if (!cache.mkpath("."))
+    {
+        return QString();
+    }
+    QString cached = cache.absoluteFilePath(id + (isCif ? ".cif" : ".pdb"));
+    QFileInfo cachedInfo(cached);
+    if (cachedInfo.exists() && cachedInfo.lastModified() >= source.lastModified())
+    {
+        return cached;
+    }
+    // decompress to a temporary name and rename it so that nobody ever sees
+    // a partly written file
+    static QAtomicInt tempCount;
+    QString temp = cached + QString(".tmp%1").arg(tempCount.fetchAndAddRelaxed(1));
+    QuaGzipFile in(path);
+    QFile out(temp);
+    if (!in.open(QIODevice::ReadOnly) ||
+            !out.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        qDebug() << "Could not decompress " << path;
+        return QString();
+    }
+    QByteArray block;
+    do
+    {
+        block = in.read(DECOMPRESS_BLOCK_SIZE);
+        if (out.write(block) != block.size())
+        {
+            out.close();
+            QFile::remove(temp);
+            return QString();
+        }
+    } while (!block.isEmpty());
+    in.close();
+    out.close();
+    QFile::remove(cached);
+    if (!QFile::rename(temp, cached))
+    {
+        QFile::remove(temp);
+        return QString();
+    }
+    return cached;
+}
+
+}
@@ -0,0 +1,65 @@
+#ifndef PDBMIRROR_H
+#define PDBMIRROR_H
+
+#include <QString>
+
+/*
+ * This is a namespace for finding structures in a local copy of the PDB so
+ * that importing a structure by its PDB id does not need the network.
+ *
+ * The mirror is a directory of structure files.  It can be a copy of (part of)
+ * the wwPDB's own layout (data/structures/divided/pdb/mf/pdb3mfp.ent.gz) or
+ * just a directory of files named like 3mfp.pdb, pdb3mfp.ent or 3mfp.cif, any
+ * of them optionally gzipped.  An index file (pdb_index.txt in the mirror
+ * directory) maps PDB ids to files so that nothing has to be searched for.
+ * It can be made with buildIndex or with scripts/pdbmirror.py.  Without the
+ * index only the standard locations are checked.
+ *
+ * Compressed structures are decompressed into a cache directory the first
+ * time they are used so that Chimera and PyMOL can read them.
+ */
+namespace PDBMirror
+{
+/*
+ * Returns the mirror directory from the application settings (key
+ * "pdbmirror/path") or an empty string if there is no mirror.
+ */
+QString getMirrorDir();
+/*
+ * Sets the mirror directory and saves it to the application settings.  An
+ * empty string means there is no mirror.
+ */
+void setMirrorDir(const QString &dir);
+/*
+ * Returns the directory decompressed structures are kept in.  This is read
+ * from the application settings (key "pdbmirror/cache") and defaults to a
+ * directory in the user's home directory.
+ */
+QString getCacheDir();
+/*
+ * Sets the directory decompressed structures are kept in and saves it to the
+ * application settings.
+ */
+void setCacheDir(const QString &dir);
+
+/*
+ * Searches the given mirror directory for structure files and writes its
+ * index file.  Returns the number of structures indexed or -1 if the index
+ * could not be written.
+ */
+int buildIndex(const QString &mirrorDir);
+
+/*
+ * Returns the file for the given PDB id in the mirror (which may be
+ * compressed) or an empty string if it is not in the mirror.
+ */
+QString findInMirror(const QString &pdbId);
+/*
+ * Returns an uncompressed file for the given PDB id from the mirror,
+ * decompressing it into the cache directory if needed, or an empty string
+ * if it is not in the mirror.
+ */
+QString findStructure(const QString &pdbId);
+}
+
+#endif // PDBMIRROR_H
@@ -9,6 +9,7 @@
 #include <SettingsHelpers.h>
 
 #include "subprocessutils.h"
+#include "pdbmirror.h"
 
 PymolOBJMaker::PymolOBJMaker(const QString &pdbID, const QString &dirName,
                              QObject *parent)
@@ -33,11 +34,18 @@ PymolOBJMaker::PymolOBJMaker(const QString &pdbID, const QString &dirName,
   if (objFile->exists())
     if (!objFile->remove()) valid = false;
   if (pmlFile->open()) {
-    QString cmd =
-        "load "
-        "http://www.pdb.org/pdb/download/"
-        "downloadFile.do?fileFormat=pdb&compression=NO&structureId=%1\n";
-    cmd = cmd.arg(pdb);
+    QString cmd;
+    QString local = PDBMirror::findStructure(pdb);
+    if (!local.isEmpty()) {
+      cmd = "load %1, %2\n";
+      cmd = cmd.arg(local, pdb);
+    } else {
+      cmd =
+          "load "
+          "http://www.pdb.org/pdb/download/"
+          "downloadFile.do?fileFormat=pdb&compression=NO&structureId=%1\n";
+      cmd = cmd.arg(pdb);
+    }
     pmlFile->write(cmd.toStdString().c_str());
     cmd = "save %1/%2.pdb\n";
     cmd = cmd.arg(dirName, pdb);
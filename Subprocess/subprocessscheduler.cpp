@@ -0,0 +1,238 @@
+#include "subprocessscheduler.h"
+
+#include <QThread>
+#include <QtAlgorithms>
+
+#include "subprocessrunner.h"
+
+SubprocessScheduler::SubprocessScheduler(int maxConcurrentJobs, QObject *parent) :
+    QObject(parent),
+    maxJobs(maxConcurrentJobs),
+    nextId(0),
+    numRunning(0)
+{
+    if (maxJobs < 1)
+    {
+        maxJobs = qMax(1, QThread::idealThreadCount());
+    }
+}
+
+SubprocessScheduler::~SubprocessScheduler()
+{
+    blockSignals(true);
+    cancelAllJobs();
+}
+
+int SubprocessScheduler::addJob(SubprocessRunner *runner,
+                                const QString &description)
+{
+    int id = nextId++;
+    Job job;
+    job.runner = runner;
+    job.description = description;
+    job.status = description;
+    job.running = false;
+    jobs.insert(id, job);
+    queue.append(id);
+    runnerJobs.insert(runner, id);
+    connect(runner, SIGNAL(statusChanged(QString)),
+            this, SLOT(runnerStatusChanged(QString)));
+    connect(runner, SIGNAL(finished(bool)), this, SLOT(runnerFinished(bool)));
+    connect(runner, SIGNAL(destroyed(QObject*)),
+            this, SLOT(runnerDestroyed(QObject*)));
+    emit jobAdded(id, description);
+    emit jobCountsChanged(numRunning, queue.size());
+    startQueuedJobs();
+    return id;
+}
+
+int SubprocessScheduler::getMaxConcurrentJobs() const
+{
+    return maxJobs;
+}
+
+void SubprocessScheduler::setMaxConcurrentJobs(int max)
+{
+    maxJobs = qMax(1, max);
+    startQueuedJobs();
+}
+
+int SubprocessScheduler::getNumberOfRunningJobs() const
+{
+    return numRunning;
+}
+
+int SubprocessScheduler::getNumberOfQueuedJobs() const
+{
+    return queue.size();
+}
+
+QList< int > SubprocessScheduler::getJobIds() const
+{
+    QList< int > ids;
+    for (QHash< int, Job >::const_iterator it = jobs.constBegin();
+         it != jobs.constEnd(); ++it)
+    {
+        if (it->running)
+        {
+            ids.append(it.key());
+        }
+    }
+    qSort(ids);
+    ids.append(queue);
+    return ids;
+}
+
+bool SubprocessScheduler::hasJob(int id) const
+{
+    return jobs.contains(id);
+}
+
+bool SubprocessScheduler::isJobRunning(int id) const
+{
+    QHash< int, Job >::const_iterator it = jobs.constFind(id);
+    return it != jobs.constEnd() && it->running;
+}
+
+QString SubprocessScheduler::getJobDescription(int id) const
+{
+    QHash< int, Job >::const_iterator it = jobs.constFind(id);
+    return (it != jobs.constEnd()) ? it->description : QString();
+}
+
+QString SubprocessScheduler::getJobStatus(int id) const
+{
+    QHash< int, Job >::const_iterator it = jobs.constFind(id);
+    return (it != jobs.constEnd()) ? it->status : QString();
+}
+
+void SubprocessScheduler::cancelJob(int id)
+{
+    QHash< int, Job >::iterator it = jobs.find(id);
+    if (it == jobs.end())
+    {
+        return;
+    }
+    SubprocessRunner *runner = it->runner;
+    bool wasRunning = it->running;
+    removeJob(id);
+    runner->disconnect(this);
+    if (wasRunning)
+    {
+        // the runner deletes itself
+        runner->cancel();
+    }
+    else
+    {
+        runner->deleteLater();
+    }
+    emit jobCanceled(id);
+    emit jobCountsChanged(numRunning, queue.size());
+    startQueuedJobs();
+}
+
+void SubprocessScheduler::cancelAllJobs()
+{
+    // cancel the queued jobs first so none of them start when running jobs
+    // are canceled
+    while (!queue.isEmpty())
+    {
+        cancelJob(queue.last());
+    }
+    QList< int > ids = jobs.keys();
+    for (int i = 0; i < ids.size(); i++)
+    {
+        cancelJob(ids[i]);
+    }
+}
+
+void SubprocessScheduler::runnerStatusChanged(QString status)
+{
+    int id = jobIdFor(sender());
+    if (id < 0)
+    {
+        return;
+    }
+    jobs[id].status = status;
+    emit jobStatusChanged(id, status);
+}
+
+void SubprocessScheduler::runnerFinished(bool success)
+{
+    int id = jobIdFor(sender());
+    if (id < 0)
+    {
+        return;
+    }
+    sender()->disconnect(this);
+    removeJob(id);
+    emit jobFinished(id, success);
+    emit jobCountsChanged(numRunning, queue.size());
+    startQueuedJobs();
+    if (jobs.isEmpty())
+    {
+        emit allJobsFinished();
+    }
+}
+
+void SubprocessScheduler::runnerDestroyed(QObject *runner)
+{
+    // a runner that is deleted without emitting finished has failed
+    int id = jobIdFor(runner);
+    if (id < 0)
+    {
+        return;
+    }
+    removeJob(id);
+    emit jobFinished(id, false);
+    emit jobCountsChanged(numRunning, queue.size());
+    startQueuedJobs();
+    if (jobs.isEmpty())
+    {
+        emit allJobsFinished();
+    }
+}
+
+void SubprocessScheduler::startQueuedJobs()
+{
+    while (numRunning < maxJobs && !queue.isEmpty())
+    {
+        int id = queue.takeFirst();
+        Job &job = jobs[id];
+        job.running = true;
+        SubprocessRunner *runner = job.runner;
+        numRunning++;
+        emit jobStarted(id);
+        emit jobCountsChanged(numRunning, queue.size());
+        // something connected to the signals may have canceled the job
+        if (jobs.contains(id))
+        {
+            // start may finish the job (and remove it) right away if it fails
+            runner->start();
+        }
+    }
+}
+
+void SubprocessScheduler::removeJob(int id)
+{
+    QHash< int, Job >::iterator it = jobs.find(id);
+    if (it == jobs.end())
+    {
+        return;
+    }
+    if (it->running)
+    {
+        numRunning--;
+    }
+    else
+    {
+        queue.removeAll(id);
+    }
+    runnerJobs.remove(it->runner);
+    jobs.erase(it);
+}
+
+int SubprocessScheduler::jobIdFor(QObject *runner) const
+{
+    return runnerJobs.value(runner, -1);
+}
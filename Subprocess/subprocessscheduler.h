@@ -0,0 +1,102 @@
+#ifndef SUBPROCESSSCHEDULER_H
+#define SUBPROCESSSCHEDULER_H
+
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QHash>
+
+class SubprocessRunner;
+
+/*
+ *
+ * This class runs SubprocessRunners in the background.  Jobs are started in
+ * the order they are added, with at most a set number of them running at
+ * once, the rest wait in a queue.  The status messages from each runner are
+ * kept and passed on with the id of the job they came from so the GUI can
+ * show progress for each job without blocking (SimpleView used to stop its
+ * frame timer and show a modal dialog for every subprocess).
+ *
+ * The scheduler owns the runners it is given.  A runner deletes itself when
+ * it finishes or is canceled (see subprocessrunner.h), and runners that are
+ * canceled before they start are deleted by the scheduler.
+ *
+ */
+class SubprocessScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    // maxConcurrentJobs - the most jobs that may run at once, if less than 1
+    //                      the number of processor cores is used
+    explicit SubprocessScheduler(int maxConcurrentJobs = 0, QObject *parent = 0);
+    // Cancels all jobs
+    virtual ~SubprocessScheduler();
+
+    // Adds the runner to the queue and returns the id of the new job.  The
+    // runner is started as soon as fewer than the maximum number of jobs are
+    // running (possibly before this returns).  The runner must be valid and
+    // not started yet.  The description is used as the job's status until
+    // the runner reports one.
+    int addJob(SubprocessRunner *runner, const QString &description);
+
+    int getMaxConcurrentJobs() const;
+    // Changing the limit does not stop any running jobs, but no new jobs start
+    // until fewer than the new limit are running
+    void setMaxConcurrentJobs(int max);
+
+    int getNumberOfRunningJobs() const;
+    int getNumberOfQueuedJobs() const;
+    // Returns the ids of the jobs that are running or queued, running jobs
+    // first
+    QList< int > getJobIds() const;
+    bool hasJob(int id) const;
+    bool isJobRunning(int id) const;
+    QString getJobDescription(int id) const;
+    // Returns the last status message from the job's runner
+    QString getJobStatus(int id) const;
+
+public slots:
+    // Cancels the job, whether it is running or still queued
+    void cancelJob(int id);
+    // Cancels all jobs
+    void cancelAllJobs();
+
+signals:
+    void jobAdded(int id, const QString &description);
+    void jobStarted(int id);
+    void jobStatusChanged(int id, const QString &status);
+    // emitted when a job's runner finishes (not when it is canceled)
+    void jobFinished(int id, bool success);
+    void jobCanceled(int id);
+    // emitted whenever a job starts, finishes or is canceled, and when a job
+    // is added
+    void jobCountsChanged(int running, int queued);
+    // emitted when the last running job finishes and nothing is queued
+    void allJobsFinished();
+
+private slots:
+    void runnerStatusChanged(QString status);
+    void runnerFinished(bool success);
+    void runnerDestroyed(QObject *runner);
+
+private:
+    struct Job
+    {
+        SubprocessRunner *runner;
+        QString description;
+        QString status;
+        bool running;
+    };
+    void startQueuedJobs();
+    void removeJob(int id);
+    int jobIdFor(QObject *runner) const;
+
+    int maxJobs;
+    int nextId;
+    int numRunning;
+    QHash< int, Job > jobs;
+    QList< int > queue;
+    QHash< QObject *, int > runnerJobs;
+};
+
+#endif // SUBPROCESSSCHEDULER_H
@@ -1,18 +1,29 @@
 #include "subprocessutils.h"
 
 #include <QString>
+#include <QStringList>
+#include <QPointer>
 #include <QSettings>
 #include <QFile>
+#include <QVector>
 #include <QApplication>
 #include <QDebug>
 #include <QFileDialog>
 
+#include "chimerasurfaceserver.h"
 #include "chimeravtkexportrunner.h"
 #include "pymolobjmaker.h"
 #include "blenderanimationrunner.h"
 #include "blenderdecimationrunner.h"
+#include "meshdecimationrunner.h"
+#include "nativesurfacerunner.h"
 #include "modelfrompdbrunner.h"
 
+// the QSettings key for whether to always make surfaces with Chimera
+#define USE_CHIMERA_FOR_SURFACES_SETTING "surfaces/useChimera"
+// the QSettings key for the most Chimera surface workers to run at once
+#define CHIMERA_SURFACE_WORKERS_SETTING "surfaces/chimeraWorkers"
+
 namespace SubprocessUtils {
 
 QString getChimeraVTKExtensionDir()
@@ -56,12 +67,76 @@ QString getChimeraVTKExtensionDir()
 #endif
 }
 
+ChimeraSurfaceServer *getChimeraSurfaceServer()
+{
+    static QPointer< ChimeraSurfaceServer > server;
+    if (server.isNull())
+    {
+        server = new ChimeraSurfaceServer(getMaxChimeraSurfaceWorkers(),
+                                          QCoreApplication::instance());
+    }
+    return server;
+}
+
 SubprocessRunner *makeChimeraSurfaceFor(
         const QString &pdbID, const QString &vtkFile,int threshold,
         const QString &chainsToDelete,bool shouldExportBiologicalUnit)
+{
+    QVector< int > thresholds;
+    thresholds.append(threshold);
+    return makeChimeraSurfacesFor(pdbID,thresholds,QStringList(vtkFile),
+                                  chainsToDelete,shouldExportBiologicalUnit);
+}
+
+SubprocessRunner *makeChimeraSurfacesFor(
+        const QString &pdbID, const QVector< int > &thresholds,
+        const QStringList &vtkFiles, const QString &chainsToDelete,
+        bool shouldExportBiologicalUnit)
 {
     ChimeraVTKExportRunner *maker = new ChimeraVTKExportRunner(
-                pdbID,vtkFile,threshold,chainsToDelete,shouldExportBiologicalUnit);
+                getChimeraSurfaceServer(),pdbID,thresholds,vtkFiles,
+                chainsToDelete,shouldExportBiologicalUnit);
+    if (!maker->isValid())
+    {
+        delete maker;
+        maker = NULL;
+    }
+    return maker;
+}
+
+bool getUseChimeraForSurfaces()
+{
+    QSettings settings;
+    return settings.value(USE_CHIMERA_FOR_SURFACES_SETTING, false).toBool();
+}
+
+void setUseChimeraForSurfaces(bool useChimera)
+{
+    QSettings settings;
+    settings.setValue(USE_CHIMERA_FOR_SURFACES_SETTING, useChimera);
+}
+
+int getMaxChimeraSurfaceWorkers()
+{
+    QSettings settings;
+    int workers = settings.value(CHIMERA_SURFACE_WORKERS_SETTING,
+                                 DEFAULT_CHIMERA_SURFACE_WORKERS).toInt();
+    return qMax(1, workers);
+}
+
+void setMaxChimeraSurfaceWorkers(int workers)
+{
+    QSettings settings;
+    settings.setValue(CHIMERA_SURFACE_WORKERS_SETTING, workers);
+    getChimeraSurfaceServer()->setMaxWorkers(workers);
+}
+
+SubprocessRunner *makeNativeSurfacesFor(
+        const QString &structureFile, const QVector< int > &thresholds,
+        const QStringList &vtkFiles, const QString &chainsToDelete)
+{
+    NativeSurfaceRunner *maker = new NativeSurfaceRunner(
+                structureFile,thresholds,vtkFiles,chainsToDelete);
     if (!maker->isValid())
     {
         delete maker;
@@ -127,6 +202,20 @@ SubprocessRunner *simplifyObjFile(const QString &objFile, int triangles)
     return runner;
 }
 
+SubprocessRunner *makeSimplifiedLevelsFor(const QString &modelFile)
+{
+    QVector< int > levels;
+    levels << 5000 << 2000 << 1000;
+    MeshDecimationRunner *runner = new MeshDecimationRunner(modelFile, levels);
+
+    if (!runner->isValid())
+    {
+        delete runner;
+        return NULL;
+    }
+    return runner;
+}
+
 SubprocessRunner *loadFromPDBId(
         SketchBio::Project *proj, const QString &pdb,
         const QString &chainsToDelete, bool exportWholeBiologicalUnit)
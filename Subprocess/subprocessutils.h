@@ -2,7 +2,11 @@
 #define SUBPROCESSUTILS_H
 
 class QString;
+class QStringList;
+template < typename T >
+class QVector;
 class SubprocessRunner;
+class ChimeraSurfaceServer;
 namespace SketchBio {
 class Project;
 }
@@ -17,6 +21,14 @@ namespace SubprocessUtils
  */
 QString getChimeraVTKExtensionDir();
 
+/*
+ * This method gets the ChimeraSurfaceServer that keeps UCSF Chimera running in
+ * the background for the surfaces made by makeChimeraSurfaceFor and
+ * makeChimeraSurfacesFor.  It is created the first time this is called and is
+ * deleted (stopping Chimera) with the application object.
+ */
+ChimeraSurfaceServer *getChimeraSurfaceServer();
+
 
 /*
  * This method returns a valid SubprocessRunner to make an obj file
@@ -30,6 +42,60 @@ SubprocessRunner *makeChimeraSurfaceFor(
         const QString &pdbID, const QString &vtkFile, int threshold,
         const QString &chainsToDelete, bool shouldExportBiologicalUnit);
 
+/*
+ * This method returns a valid SubprocessRunner to make several vtk files
+ * from a pdb id in Chimera, one for each threshold, or NULL.  The structure
+ * is only loaded once for all of them.  The thresholds and vtkFiles must be
+ * the same length.  There is no need to check if the returned object is
+ * valid.  Simply check for NULL.  Then connect it to the signals/slots and
+ * call start().
+ *
+ * For detailed usage information, see subprocessrunner.h
+ */
+SubprocessRunner *makeChimeraSurfacesFor(
+        const QString &pdbID, const QVector< int > &thresholds,
+        const QStringList &vtkFiles, const QString &chainsToDelete,
+        bool shouldExportBiologicalUnit);
+
+/*
+ * Returns true if the surfaces of structures should be made with UCSF Chimera
+ * even when they could be made in process (see makeNativeSurfacesFor).  This
+ * is read from the application settings (key "surfaces/useChimera") and is
+ * false by default.
+ */
+bool getUseChimeraForSurfaces();
+/*
+ * Sets whether surfaces should always be made with UCSF Chimera and saves it
+ * to the application settings.
+ */
+void setUseChimeraForSurfaces(bool useChimera);
+/*
+ * Returns the most UCSF Chimera processes the surface server runs at once.
+ * This is read from the application settings (key "surfaces/chimeraWorkers")
+ * and is DEFAULT_CHIMERA_SURFACE_WORKERS by default.
+ */
+int getMaxChimeraSurfaceWorkers();
+/*
+ * Sets the most UCSF Chimera processes the surface server runs at once and
+ * saves it to the application settings.
+ */
+void setMaxChimeraSurfaceWorkers(int workers);
+
+/*
+ * This method returns a valid SubprocessRunner to make several vtk files
+ * from a local PDB or mmCIF file without starting another program, one for
+ * each threshold, or NULL.  The files have the same layout as the ones made
+ * by makeChimeraSurfacesFor, but biological units cannot be made.  The
+ * thresholds and vtkFiles must be the same length.  There is no need to
+ * check if the returned object is valid.  Simply check for NULL.  Then
+ * connect it to the signals/slots and call start().
+ *
+ * For detailed usage information, see subprocessrunner.h
+ */
+SubprocessRunner *makeNativeSurfacesFor(
+        const QString &structureFile, const QVector< int > &thresholds,
+        const QStringList &vtkFiles, const QString &chainsToDelete);
+
 /*
  * This method returns a valid SubprocessRunner to make an obj file
  * from a pdb id in PyMOL or NULL.  There is no need to check if
@@ -76,6 +142,18 @@ SubprocessRunner *simplifyObjFileByPercent(const QString &objFile, double percen
  */
 SubprocessRunner *simplifyObjFile(const QString &objFile, int triangles);
 
+/*
+ * This method returns a valid SubprocessRunner to make the simplified levels
+ * of a model file (5000, 2000 and 1000 triangles) without starting another
+ * program, or NULL.  The levels are written next to the model file as
+ * <name>.decimated.<triangles>.vtk.  There is no need to check if the
+ * returned object is valid, simply check for NULL.  Then connect it to the
+ * signals/slots and call start().
+ *
+ * For detailed usage information, see subprocessrunner.h
+ */
+SubprocessRunner *makeSimplifiedLevelsFor(const QString &modelFile);
+
 /*
  * This method returns a valid SubprocessRunner to run various subprocesses to
  * create a model and object from a PDB id or NULL.  There is no need to
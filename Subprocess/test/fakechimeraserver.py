@@ -0,0 +1,45 @@
+#
+# A stand-in for UCSF Chimera running ExportVTK.SurfaceServer for the
+# ChimeraSurfaceServer test.  It speaks the same protocol, but writes a
+# tiny vtk file with its process id in the title line instead of a surface.
+# The structure "crash" makes it quit in the middle of a request and the
+# structure "fail" makes it report a failure.
+#
+
+import os
+import sys
+
+def reply(kind, *fields):
+    sys.stdout.write('\t'.join(['SKETCHBIO_' + kind] + list(fields)) + '\n')
+    sys.stdout.flush()
+
+def write_surface(path, resolution):
+    f = open(path, 'w')
+    f.write('# vtk DataFile Version 3.0\n')
+    f.write('fake surface %d %d\n' % (os.getpid(), resolution))
+    f.write('ASCII\nDATASET POLYDATA\nPOINTS 3 float\n')
+    f.write('0 0 0\n1 0 0\n0 1 0\n')
+    f.write('POLYGONS 1 4\n3 0 1 2\n')
+    f.close()
+
+print('Fake Chimera starting up')
+reply('READY')
+while True:
+    line = sys.stdin.readline()
+    if not line:
+        break
+    fields = line.rstrip('\r\n').split('\t')
+    if fields[0] == 'quit':
+        break
+    if fields[0] != 'surface' or len(fields) < 6 or len(fields) % 2 != 0:
+        reply('DONE', 'failed')
+        continue
+    if fields[1] == 'crash':
+        sys.exit(1)
+    if fields[1] == 'fail':
+        reply('DONE', 'failed')
+        continue
+    for i in range(4, len(fields), 2):
+        reply('STATUS', 'Creating surface at resolution %s' % fields[i])
+        write_surface(fields[i + 1], int(fields[i]))
+    reply('DONE', 'ok')
@@ -0,0 +1,317 @@
+/*
+ *
+ * This is a test of the ChimeraSurfaceServer class and the runners that use
+ * it.  Instead of Chimera it runs a stand-in script (fakechimeraserver.py)
+ * that speaks the same protocol, so it only needs python.
+ *
+ */
+
+#include <iostream>
+using std::cout;
+using std::endl;
+
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QDir>
+#include <QStringList>
+#include <QVector>
+#include <QtCore/QCoreApplication>
+
+#include <SettingsHelpers.h>
+
+#include <subprocessrunner.h>
+#include <chimerasurfaceserver.h>
+#include <chimeravtkexportrunner.h>
+
+#include "testqt.h"
+
+#define FAKE_SERVER_SCRIPT "fakechimeraserver.py"
+
+static QString tempFile(const QString &name)
+{
+    return QDir::tempPath() + "/" + name;
+}
+
+static void removeFile(const QString &name)
+{
+    QFile f(name);
+    if (f.exists())
+        f.remove();
+}
+
+// returns the process id the stand-in wrote into the file or -1
+static int getWorkerPid(const QString &name)
+{
+    QFile f(name);
+    if (!f.open(QIODevice::ReadOnly))
+        return -1;
+    f.readLine();
+    QStringList fields = QString(f.readLine()).split(" ");
+    if (fields.size() < 3 || fields[0] != "fake")
+        return -1;
+    return fields[2].toInt();
+}
+
+// Makes the surfaces for one request and checks that they were all made by
+// the same worker.  If sameWorkerAs is given, the worker must be the one that
+// made that test's surfaces.
+class SurfaceTest : public Test
+{
+public:
+    SurfaceTest(ChimeraSurfaceServer &s, const QString &pdb, int numFiles,
+                const SurfaceTest *sameWorker = NULL) :
+        Test(), server(s), pdbId(pdb), runner(NULL), sameWorkerAs(sameWorker),
+        workerPid(-1)
+    {
+        for (int i = 0; i < numFiles; i++)
+        {
+            thresholds.append(i * 5);
+            files.append(tempFile(pdb + QString::number(i) + ".vtk"));
+        }
+    }
+    virtual ~SurfaceTest() {}
+    virtual void setUp()
+    {
+        for (int i = 0; i < files.size(); i++)
+            removeFile(files[i]);
+        runner = new ChimeraVTKExportRunner(&server, pdbId, thresholds, files,
+                                            "", false);
+    }
+    virtual SubprocessRunner *getRunner() { return runner; }
+    virtual int testResults()
+    {
+        int errors = 0;
+        for (int i = 0; i < files.size(); i++)
+        {
+            int pid = getWorkerPid(files[i]);
+            if (pid == -1)
+            {
+                errors++;
+                cout << "Surface file " << i << " not made." << endl;
+            }
+            else if (workerPid == -1)
+            {
+                workerPid = pid;
+            }
+            else if (pid != workerPid)
+            {
+                errors++;
+                cout << "Surfaces made by different workers." << endl;
+            }
+            removeFile(files[i]);
+        }
+        if (sameWorkerAs != NULL && sameWorkerAs->getPid() != workerPid)
+        {
+            errors++;
+            cout << "A new worker was started for the request." << endl;
+        }
+        return errors;
+    }
+    int getPid() const { return workerPid; }
+protected:
+    ChimeraSurfaceServer &server;
+    QString pdbId;
+    QVector< int > thresholds;
+    QStringList files;
+    SubprocessRunner *runner;
+    const SurfaceTest *sameWorkerAs;
+    int workerPid;
+};
+
+// A request that is canceled before it is sent to the worker should never
+// make its surface
+class CancelTest : public SurfaceTest
+{
+public:
+    CancelTest(ChimeraSurfaceServer &s, const SurfaceTest *sameWorker) :
+        SurfaceTest(s, "cancelkept", 1, sameWorker),
+        canceledFile(tempFile("canceled.vtk"))
+    {
+    }
+    virtual void setUp()
+    {
+        removeFile(canceledFile);
+        QVector< int > t;
+        t.append(0);
+        SubprocessRunner *canceled = new ChimeraVTKExportRunner(
+                    &server, "canceled", t, QStringList(canceledFile), "", false);
+        canceled->start();
+        canceled->cancel();
+        SurfaceTest::setUp();
+    }
+    virtual int testResults()
+    {
+        int errors = SurfaceTest::testResults();
+        if (QFile(canceledFile).exists())
+        {
+            errors++;
+            cout << "Canceled request made its surface." << endl;
+            removeFile(canceledFile);
+        }
+        if (server.getNumberOfPendingRequests() != 0)
+        {
+            errors++;
+            cout << "Server still has pending requests." << endl;
+        }
+        return errors;
+    }
+private:
+    QString canceledFile;
+};
+
+// The worker quits in the middle of this request, the runner should fail
+// (this uses the destroyed event so that the failure doesn't end the test)
+class CrashTest : public SurfaceTest
+{
+public:
+    CrashTest(ChimeraSurfaceServer &s) :
+        SurfaceTest(s, "crash", 1)
+    {
+    }
+    virtual bool useFinishedEvent() { return false; }
+    virtual int testResults()
+    {
+        if (QFile(files[0]).exists())
+        {
+            cout << "Crashed request made its surface." << endl;
+            removeFile(files[0]);
+            return 1;
+        }
+        return 0;
+    }
+};
+
+// Two requests made at once should be sent to two different workers
+class ParallelTest : public SurfaceTest
+{
+public:
+    ParallelTest(ChimeraSurfaceServer &s) :
+        SurfaceTest(s, "4abc", 1), other(s, "5abc", 1)
+    {
+    }
+    virtual void setUp()
+    {
+        other.setUp();
+        other.getRunner()->start();
+        SurfaceTest::setUp();
+    }
+    virtual int testResults()
+    {
+        // the other request may still be running
+        QElapsedTimer timer;
+        timer.start();
+        while (server.getNumberOfPendingRequests() > 0 && timer.elapsed() < 10000)
+        {
+            QCoreApplication::processEvents(QEventLoop::AllEvents, 100);
+        }
+        int errors = SurfaceTest::testResults() + other.testResults();
+        if (getPid() == other.getPid())
+        {
+            errors++;
+            cout << "Requests made at once went to the same worker." << endl;
+        }
+        if (server.getNumberOfWorkers() > server.getMaxWorkers())
+        {
+            errors++;
+            cout << "Too many workers started." << endl;
+        }
+        return errors;
+    }
+private:
+    SurfaceTest other;
+};
+
+// With a short idle timeout, the worker that made the surface should be
+// stopped soon after it finishes
+class IdleTest : public SurfaceTest
+{
+public:
+    IdleTest(ChimeraSurfaceServer &s) :
+        SurfaceTest(s, "6abc", 1)
+    {
+    }
+    virtual void setUp()
+    {
+        server.setIdleTimeout(100);
+        SurfaceTest::setUp();
+    }
+    virtual int testResults()
+    {
+        int errors = SurfaceTest::testResults();
+        int workers = server.getNumberOfWorkers();
+        QElapsedTimer timer;
+        timer.start();
+        while (server.getNumberOfWorkers() >= workers && timer.elapsed() < 5000)
+        {
+            QCoreApplication::processEvents(QEventLoop::AllEvents, 100);
+        }
+        if (server.getNumberOfWorkers() >= workers)
+        {
+            errors++;
+            cout << "Idle worker was not stopped." << endl;
+        }
+        server.setIdleTimeout(DEFAULT_CHIMERA_WORKER_IDLE_TIMEOUT);
+        return errors;
+    }
+};
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc,argv);
+    QDir::setCurrent(app.applicationDirPath());
+
+    cout << "Temp dir: " << QDir::tempPath().toStdString() << endl;
+
+    // set required fields to use QSettings API (these specify the location of the settings)
+    // used to locate subprocess files
+    app.setApplicationName("Sketchbio");
+    app.setOrganizationName("UNC Computer Science");
+    app.setOrganizationDomain("sketchbio.org");
+
+    ChimeraSurfaceServer server(2);
+    server.setWorkerCommand(SettingsHelpers::getSubprocessExecutablePath("python"),
+                            QStringList() << QDir::current().absoluteFilePath(
+                                FAKE_SERVER_SCRIPT));
+
+    // both resolutions from one request, then another request that should
+    // go to the same worker
+    SurfaceTest first(server, "1abc", 2);
+    SurfaceTest second(server, "2abc", 1, &first);
+    CancelTest cancel(server, &first);
+    // after the worker crashes, the next request should start a new one
+    CrashTest crash(server);
+    SurfaceTest afterCrash(server, "3abc", 2);
+    // with a free worker slot, simultaneous requests run at the same time
+    ParallelTest parallel(server);
+    // idle workers are stopped, and requests still work after that
+    IdleTest idle(server);
+    SurfaceTest afterIdle(server, "7abc", 1);
+
+    TestQObject *t1 = new TestQObject(app,first);
+    TestQObject *t2 = new TestQObject(app,second);
+    TestQObject *t3 = new TestQObject(app,cancel);
+    TestQObject *t4 = new TestQObject(app,crash);
+    TestQObject *t5 = new TestQObject(app,afterCrash);
+    TestQObject *t6 = new TestQObject(app,parallel);
+    TestQObject *t7 = new TestQObject(app,idle);
+    TestQObject *t8 = new TestQObject(app,afterIdle);
+
+    QObject::connect(t1, SIGNAL(finished()), t2, SLOT(start()));
+    QObject::connect(t2, SIGNAL(finished()), t3, SLOT(start()));
+    QObject::connect(t3, SIGNAL(finished()), t4, SLOT(start()));
+    QObject::connect(t4, SIGNAL(finished()), t5, SLOT(start()));
+    QObject::connect(t5, SIGNAL(finished()), t6, SLOT(start()));
+    QObject::connect(t6, SIGNAL(finished()), t7, SLOT(start()));
+    QObject::connect(t7, SIGNAL(finished()), t8, SLOT(start()));
+    QObject::connect(t8, SIGNAL(finished()), &app, SLOT(quit()));
+
+    QTimer::singleShot(0, t1, SLOT(start()));
+    int result = app.exec();
+    if (result == 0 && afterCrash.getPid() == first.getPid())
+    {
+        cout << "Worker was not restarted after it crashed." << endl;
+        result = 1;
+    }
+    return result;
+}
@@ -0,0 +1,91 @@
+#include "testqt.h"
+#include <QFile>
+#include <QDir>
+#include <QDebug>
+#include <QTimer>
+#include <QString>
+#include <QStringList>
+#include <QtCore/QCoreApplication>
+#include <subprocessutils.h>
+#include <meshdecimationrunner.h>
+#include <sketchmodel.h>
+#include <PQP.h>
+
+#define FILENAME  (QDir::currentPath() + "/models/1m1j.obj")
+
+class DecimationTest : public Test
+{
+public:
+    DecimationTest() : Test(), runner(NULL) {}
+    virtual ~DecimationTest() {}
+    virtual void setUp();
+    virtual SubprocessRunner *getRunner() { return runner; }
+    virtual int testResults();
+private:
+    MeshDecimationRunner *runner;
+    QStringList outputFiles;
+};
+
+void DecimationTest::setUp()
+{
+    runner = qobject_cast< MeshDecimationRunner * >(
+                SubprocessUtils::makeSimplifiedLevelsFor(FILENAME));
+    if (runner == NULL)
+        throw "Could not make decimation runner";
+    outputFiles = runner->getOutputFiles();
+}
+
+int DecimationTest::testResults()
+{
+    const int counts[3] = { 5000, 2000, 1000 };
+    if (outputFiles.size() != 3)
+    {
+        qDebug() << "Wrong number of output files.";
+        return 1;
+    }
+    int errors = 0;
+    for (int i = 0; i < outputFiles.size(); i++)
+    {
+        if (!outputFiles[i].endsWith(".decimated." + QString::number(counts[i])
+                                     + ".vtk"))
+        {
+            qDebug() << "Wrong output file name: " << outputFiles[i];
+            errors++;
+            continue;
+        }
+        SketchModel m(1,1);
+        m.addConformation(outputFiles[i],outputFiles[i]);
+        int nTris = m.getCollisionModel(0)->num_tris;
+        qDebug() << "There are " << nTris << " triangles in " << outputFiles[i];
+        if (nTris == 0 || nTris > 1.1 * counts[i])
+        {
+            qDebug() << "Wrong number of triangles in resulting model: " << nTris;
+            errors++;
+        }
+        QFile(outputFiles[i]).remove();
+    }
+    return errors;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc,argv);
+	QString appPath = app.applicationDirPath();
+#if defined(_WIN32)
+	int idx = appPath.lastIndexOf("test");
+	appPath = appPath.mid(0,idx+4);
+#endif
+    QDir::setCurrent(appPath);
+
+    app.setApplicationName("Sketchbio");
+    app.setOrganizationName("UNC Computer Science");
+    app.setOrganizationDomain("sketchbio.org");
+
+    DecimationTest d;
+    TestQObject *test = new TestQObject(app,d);
+
+    QObject::connect(test, SIGNAL(finished()), &app, SLOT(quit()));
+
+    QTimer::singleShot(0, test, SLOT(start()));
+    return app.exec();
+}
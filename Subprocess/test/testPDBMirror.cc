@@ -0,0 +1,161 @@
+/*
+ *
+ * This is a test of finding structures in a local PDB mirror.  The test
+ * makes its own small mirror directory, which stands in for the PDB.
+ *
+ */
+
+#include <iostream>
+using std::cout;
+using std::endl;
+#define PRINT_ERROR_MESSAGE(x)  cout << x << endl
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QDir>
+
+#include <quazip/quagzipfile.h>
+
+#include <pdbmirror.h>
+
+#define MIRROR_TEST_DIR "pdbmirror_test"
+
+static void writeFile(const QString &name, const QByteArray &contents)
+{
+    QFile f(name);
+    f.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    f.write(contents);
+    f.close();
+}
+
+static void writeGzipFile(const QString &name, const QByteArray &contents)
+{
+    QuaGzipFile f(name);
+    f.open(QIODevice::WriteOnly);
+    f.write(contents);
+    f.close();
+}
+
+static QByteArray readFile(const QString &name)
+{
+    QFile f(name);
+    if (!f.open(QIODevice::ReadOnly))
+        return QByteArray();
+    return f.readAll();
+}
+
+// makes a mirror with one structure in the wwPDB layout and some others in
+// the top level directory
+static void makeMirror(QDir &mirror)
+{
+    mirror.mkpath("data/structures/divided/pdb/mf");
+    writeGzipFile(mirror.absoluteFilePath(
+                      "data/structures/divided/pdb/mf/pdb3mfp.ent.gz"),
+                  "HEADER 3MFP");
+    writeFile(mirror.absoluteFilePath("1abc.pdb"), "HEADER 1ABC");
+    writeFile(mirror.absoluteFilePath("1abc.cif"), "data_1ABC");
+    writeGzipFile(mirror.absoluteFilePath("2xyz.cif.gz"), "data_2XYZ");
+    writeFile(mirror.absoluteFilePath("notes.txt"), "not a structure");
+}
+
+int testWithoutIndex(QDir &mirror)
+{
+    int errors = 0;
+    QFile::remove(mirror.absoluteFilePath("pdb_index.txt"));
+    QString found = PDBMirror::findStructure("3MFP");
+    if (readFile(found) != "HEADER 3MFP")
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Structure in the wwPDB layout not found.");
+    }
+    if (readFile(PDBMirror::findStructure("1abc")) != "HEADER 1ABC")
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Structure in the mirror directory not found.");
+    }
+    if (!PDBMirror::findStructure("9zzz").isEmpty())
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Found a structure not in the mirror.");
+    }
+    return errors;
+}
+
+int testWithIndex(QDir &mirror)
+{
+    int errors = 0;
+    if (PDBMirror::buildIndex(mirror.absolutePath()) != 3)
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Wrong number of structures indexed.");
+    }
+    if (!PDBMirror::findInMirror("3mfp").endsWith("pdb3mfp.ent.gz"))
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Index has the wrong file for 3mfp.");
+    }
+    // pdb format is used over mmCIF when there are both
+    if (!PDBMirror::findInMirror("1abc").endsWith("1abc.pdb"))
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Index has the wrong file for 1abc.");
+    }
+    QString cif = PDBMirror::findStructure("2XYZ");
+    if (!cif.endsWith(".cif") || readFile(cif) != "data_2XYZ")
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("mmCIF structure not decompressed correctly.");
+    }
+    // the decompressed file is in the cache, not in the mirror
+    QString decompressed = PDBMirror::findStructure("3mfp");
+    if (!decompressed.startsWith(QDir(PDBMirror::getCacheDir()).absolutePath()))
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Decompressed structure not in the cache.");
+    }
+    // with an index, files that are not in it are not searched for
+    writeFile(mirror.absoluteFilePath("4new.pdb"), "HEADER 4NEW");
+    if (!PDBMirror::findStructure("4new").isEmpty())
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Found a structure that is not in the index.");
+    }
+    return errors;
+}
+
+int testNoMirror()
+{
+    int errors = 0;
+    PDBMirror::setMirrorDir(QString());
+    if (!PDBMirror::findStructure("3mfp").isEmpty())
+    {
+        errors++;
+        PRINT_ERROR_MESSAGE("Found a structure without a mirror.");
+    }
+    return errors;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QDir::setCurrent(app.applicationDirPath());
+    app.setApplicationName("Sketchbio");
+    app.setOrganizationName("UNC Computer Science");
+    app.setOrganizationDomain("sketchbio.org");
+    QDir dir = QDir::current();
+    dir.mkpath(MIRROR_TEST_DIR "/mirror");
+    dir.mkpath(MIRROR_TEST_DIR "/cache");
+    QDir mirror(dir.absoluteFilePath(MIRROR_TEST_DIR "/mirror"));
+    makeMirror(mirror);
+    QString oldMirror = PDBMirror::getMirrorDir();
+    QString oldCache = PDBMirror::getCacheDir();
+    PDBMirror::setMirrorDir(mirror.absolutePath());
+    PDBMirror::setCacheDir(dir.absoluteFilePath(MIRROR_TEST_DIR "/cache"));
+    int errors = 0;
+    errors += testWithoutIndex(mirror);
+    errors += testWithIndex(mirror);
+    errors += testNoMirror();
+    PDBMirror::setMirrorDir(oldMirror);
+    PDBMirror::setCacheDir(oldCache);
+    return errors;
+}
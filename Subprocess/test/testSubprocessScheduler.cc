@@ -0,0 +1,158 @@
+/*
+ *
+ * This is a test of the SubprocessScheduler class.  It uses fake runners that
+ * finish after a timer instead of running any real subprocesses.
+ *
+ */
+
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QTimer>
+#include <QList>
+#include <QDebug>
+
+#include <subprocessrunner.h>
+#include <subprocessscheduler.h>
+
+static int running = 0, maxRunning = 0;
+static QList< int > startOrder;
+static int numCanceled = 0, numDeleted = 0;
+
+// A runner that finishes the given number of milliseconds after it starts
+class FakeRunner : public SubprocessRunner
+{
+public:
+    FakeRunner(int n, int ms) : SubprocessRunner(), num(n), time(ms), timerId(0) {}
+    virtual ~FakeRunner() { numDeleted++; }
+    virtual bool isValid() { return true; }
+    virtual void start()
+    {
+        running++;
+        maxRunning = qMax(running, maxRunning);
+        startOrder.append(num);
+        emit statusChanged("Running fake job");
+        timerId = startTimer(time);
+    }
+    virtual void cancel()
+    {
+        running--;
+        numCanceled++;
+        killTimer(timerId);
+        deleteLater();
+    }
+protected:
+    virtual void timerEvent(QTimerEvent *)
+    {
+        killTimer(timerId);
+        running--;
+        emit finished(true);
+        deleteLater();
+    }
+private:
+    int num, time, timerId;
+};
+
+// Runs the event loop until the scheduler has no more jobs
+static void waitForJobs(SubprocessScheduler &scheduler)
+{
+    if (scheduler.getJobIds().isEmpty())
+        return;
+    QEventLoop loop;
+    QObject::connect(&scheduler, SIGNAL(allJobsFinished()), &loop, SLOT(quit()));
+    QTimer::singleShot(10000, &loop, SLOT(quit()));
+    loop.exec();
+}
+
+int testConcurrencyLimit()
+{
+    int errors = 0;
+    running = maxRunning = numDeleted = 0;
+    startOrder.clear();
+    SubprocessScheduler scheduler(3);
+    for (int i = 0; i < 10; i++)
+    {
+        scheduler.addJob(new FakeRunner(i, 20), "Fake job");
+    }
+    if (scheduler.getNumberOfRunningJobs() != 3 ||
+            scheduler.getNumberOfQueuedJobs() != 7)
+    {
+        errors++;
+        qDebug() << "Wrong number of running or queued jobs.";
+    }
+    waitForJobs(scheduler);
+    // let the deleteLater calls happen
+    QCoreApplication::sendPostedEvents(0, QEvent::DeferredDelete);
+    if (maxRunning != 3)
+    {
+        errors++;
+        qDebug() << "Wrong number of jobs run at once: " << maxRunning;
+    }
+    if (startOrder.size() != 10)
+    {
+        errors++;
+        qDebug() << "Not all jobs were run.";
+    }
+    for (int i = 0; i < startOrder.size(); i++)
+    {
+        if (startOrder[i] != i)
+        {
+            errors++;
+            qDebug() << "Jobs started out of order.";
+            break;
+        }
+    }
+    if (numDeleted != 10)
+    {
+        errors++;
+        qDebug() << "Runners not deleted: " << 10 - numDeleted;
+    }
+    return errors;
+}
+
+int testCancel()
+{
+    int errors = 0;
+    running = maxRunning = numDeleted = numCanceled = 0;
+    startOrder.clear();
+    SubprocessScheduler scheduler(1);
+    int first = scheduler.addJob(new FakeRunner(0, 50), "First");
+    int second = scheduler.addJob(new FakeRunner(1, 50), "Second");
+    scheduler.addJob(new FakeRunner(2, 50), "Third");
+    if (scheduler.getJobStatus(first) != "Running fake job" ||
+            scheduler.getJobStatus(second) != "Second")
+    {
+        errors++;
+        qDebug() << "Wrong job status.";
+    }
+    // cancel a queued job, it should never start
+    scheduler.cancelJob(second);
+    // cancel the running job, the next one should start
+    scheduler.cancelJob(first);
+    if (numCanceled != 1 || !scheduler.isJobRunning(second + 1))
+    {
+        errors++;
+        qDebug() << "Canceling a running job did not start the next one.";
+    }
+    waitForJobs(scheduler);
+    QCoreApplication::sendPostedEvents(0, QEvent::DeferredDelete);
+    if (startOrder.contains(1))
+    {
+        errors++;
+        qDebug() << "Canceled queued job was started.";
+    }
+    if (numDeleted != 3)
+    {
+        errors++;
+        qDebug() << "Runners not deleted: " << 3 - numDeleted;
+    }
+    return errors;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    int errors = 0;
+    errors += testConcurrencyLimit();
+    errors += testCancel();
+    return errors;
+}
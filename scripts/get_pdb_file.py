@@ -1,3 +1,6 @@
-cmd.load("http://www.pdb.org/pdb/download/downloadFile.do?fileFormat=pdb&compression=NO&structureId=1M1J")
+import sys
+sys.path.insert(0, '.')
+import pdbmirror
+cmd.load(pdbmirror.find_structure("1M1J"), "1m1j")
 cmd.save("1m1j.pdb")
 
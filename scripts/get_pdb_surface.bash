@@ -6,6 +6,10 @@ then
 	exit 1;
 fi
 
+# structures are loaded from the local PDB mirror in $SKETCHBIO_PDB_MIRROR
+# when they are there (see pdbmirror.py)
+script_dir="$(cd "$(dirname "$0")" && pwd)";
+
 
 for pdb_id in $* 
     do
@@ -16,7 +20,10 @@ for pdb_id in $*
 		then
 		rm $pyFile;
 	fi
-	echo "cmd.load(\"http://www.pdb.org/pdb/download/downloadFile.do?fileFormat=pdb&compression=NO&structureId=${upper_pdb_id}\")" > $pyFile
+	echo "import sys" > $pyFile
+	echo "sys.path.insert(0, \"${script_dir}\")" >> $pyFile
+	echo "import pdbmirror" >> $pyFile
+	echo "cmd.load(pdbmirror.find_structure(\"${upper_pdb_id}\"), \"${lower_pdb_id}\")" >> $pyFile
 	echo "cmd.hide(\"all\")" >> $pyFile
 	echo "cmd.show(\"surface\")" >> $pyFile
 	echo "cmd.save(\"${lower_pdb_id}.obj\")" >> $pyFile
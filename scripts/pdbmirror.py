@@ -0,0 +1,102 @@
+#
+# Finds structures in a local copy of the PDB so that they can be loaded
+# without the network.  The mirror directory is given by the
+# SKETCHBIO_PDB_MIRROR environment variable.  It is laid out the same way
+# as the mirror SketchBio itself uses (see Subprocess/pdbmirror.h): either
+# the wwPDB layout (data/structures/divided/pdb/mf/pdb3mfp.ent.gz) or a
+# directory of files like 3mfp.pdb, pdb3mfp.ent or 3mfp.cif, optionally
+# gzipped, with an index file mapping PDB ids to files.
+#
+# Run it as a script to build the index for a mirror:
+#
+#   python pdbmirror.py <mirror directory>
+#
+
+import os
+import re
+import sys
+
+INDEX_FILE = 'pdb_index.txt'
+PDB_URL = 'http://www.pdb.org/pdb/download/downloadFile.do?fileFormat=pdb&compression=NO&structureId=%s'
+
+_STRUCTURE_NAME = re.compile(
+    r'^(?:pdb([0-9][a-z0-9]{3})\.ent|([0-9][a-z0-9]{3})\.(pdb|cif))(?:\.gz)?$')
+
+# returns (pdb id, is mmCIF) for a structure file name or (None, False)
+def id_from_file_name(name):
+    m = _STRUCTURE_NAME.match(name.lower())
+    if not m:
+        return None, False
+    if m.group(1):
+        return m.group(1), False
+    return m.group(2), m.group(3) == 'cif'
+
+# writes the index file for the mirror and returns the number of structures
+def build_index(mirror):
+    pdbFiles = dict()
+    cifFiles = dict()
+    for root, dirs, files in os.walk(mirror):
+        for name in files:
+            pdbId, isCif = id_from_file_name(name)
+            if pdbId is None:
+                continue
+            relative = os.path.relpath(os.path.join(root, name), mirror)
+            relative = relative.replace(os.sep, '/')
+            if isCif:
+                cifFiles[pdbId] = relative
+            else:
+                pdbFiles[pdbId] = relative
+    # PDB format files are used when there are both
+    for pdbId in cifFiles:
+        pdbFiles.setdefault(pdbId, cifFiles[pdbId])
+    index = open(os.path.join(mirror, INDEX_FILE), 'w')
+    index.write('# SketchBio PDB mirror index: PDB id, tab, file relative to this directory\n')
+    for pdbId in sorted(pdbFiles):
+        index.write('%s\t%s\n' % (pdbId, pdbFiles[pdbId]))
+    index.close()
+    return len(pdbFiles)
+
+# returns the file for the PDB id in the mirror or None
+def find_in_mirror(pdbId, mirror=None):
+    if mirror is None:
+        mirror = os.environ.get('SKETCHBIO_PDB_MIRROR')
+    if not mirror:
+        return None
+    pdbId = pdbId.strip().lower()
+    indexFile = os.path.join(mirror, INDEX_FILE)
+    if os.path.isfile(indexFile):
+        for line in open(indexFile):
+            if line.startswith('#'):
+                continue
+            fields = line.rstrip('\r\n').split('\t')
+            if len(fields) == 2 and fields[0] == pdbId:
+                path = os.path.join(mirror, fields[1])
+                if os.path.isfile(path):
+                    return path
+                return None
+        return None
+    # without an index just check where the files usually are
+    middle = pdbId[1:3]
+    for candidate in [pdbId + '.pdb', pdbId + '.pdb.gz',
+                      'pdb' + pdbId + '.ent', 'pdb' + pdbId + '.ent.gz',
+                      'data/structures/divided/pdb/%s/pdb%s.ent.gz' % (middle, pdbId),
+                      pdbId + '.cif', pdbId + '.cif.gz',
+                      'data/structures/divided/mmCIF/%s/%s.cif.gz' % (middle, pdbId)]:
+        path = os.path.join(mirror, candidate)
+        if os.path.isfile(path):
+            return path
+    return None
+
+# returns something PyMOL can load for the PDB id: the file in the mirror
+# (PyMOL reads gzipped files itself) or the download URL if it isn't there
+def find_structure(pdbId):
+    path = find_in_mirror(pdbId)
+    if path is not None:
+        return path
+    return PDB_URL % pdbId.strip().upper()
+
+if __name__ == '__main__':
+    if len(sys.argv) != 2:
+        print('Usage: python pdbmirror.py <mirror directory>')
+        sys.exit(1)
+    print('Indexed %d structures' % build_index(sys.argv[1]))